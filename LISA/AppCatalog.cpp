@@ -0,0 +1,107 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AppCatalog.h"
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+namespace { // anonymous
+
+bool matches(const std::string& filter, const std::string& value)
+{
+    return filter.empty() || filter == value;
+}
+
+} // namespace anonymous
+
+std::shared_ptr<const AppCatalog> AppCatalog::build(DataStorage& storage)
+{
+    auto catalog = std::make_shared<AppCatalog>();
+
+    catalog->apps = storage.GetAppDetailsListOuterJoin();
+    for (const auto& details : catalog->apps) {
+        catalog->appTypes.emplace(details.id, details.type);
+        if (!details.version.empty()) {
+            catalog->installedApps.emplace(AppKey{details.type, details.id, details.version},
+                                           storage.GetMetadata(details.type, details.id, details.version));
+        }
+    }
+    return catalog;
+}
+
+std::shared_ptr<const AppCatalog> AppCatalog::withMetadata(DataStorage& storage,
+                                                           const std::string& type,
+                                                           const std::string& id,
+                                                           const std::string& version) const
+{
+    auto catalog = std::make_shared<AppCatalog>(*this);
+    auto itr = catalog->installedApps.find(AppKey{type, id, version});
+    if (itr != catalog->installedApps.end()) {
+        itr->second = storage.GetMetadata(type, id, version);
+    }
+    return catalog;
+}
+
+bool AppCatalog::isAppInstalled(const std::string& type,
+                                const std::string& id,
+                                const std::string& version) const
+{
+    return installedApps.count(AppKey{type, id, version}) == 1;
+}
+
+std::string AppCatalog::getTypeOfApp(const std::string& id) const
+{
+    auto itr = appTypes.find(id);
+    return itr != appTypes.end() ? itr->second : std::string{};
+}
+
+std::vector<DataStorage::AppDetails> AppCatalog::getAppDetailsList(const std::string& type,
+                                                                   const std::string& id,
+                                                                   const std::string& version,
+                                                                   const std::string& appName,
+                                                                   const std::string& category) const
+{
+    std::vector<DataStorage::AppDetails> result;
+    for (const auto& details : apps) {
+        if (matches(type, details.type) && matches(id, details.id) && matches(version, details.version)
+                && matches(appName, details.appName) && matches(category, details.category)) {
+            result.push_back(details);
+        }
+    }
+    return result;
+}
+
+bool AppCatalog::getMetadata(const std::string& type,
+                             const std::string& id,
+                             const std::string& version,
+                             DataStorage::AppMetadata& metadata) const
+{
+    auto itr = installedApps.find(AppKey{type, id, version});
+    if (itr == installedApps.end()) {
+        return false;
+    }
+    metadata = itr->second;
+    return true;
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,85 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DataStorage.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+/**
+ * Immutable in-memory copy of the apps, installed versions and their metadata.
+ *
+ * The database stays the source of truth. A new catalog is built after every
+ * committed change and published as a whole, readers keep the snapshot they
+ * took for as long as they need it and never touch the database. Metadata
+ * writes publish a copy with only the changed version read again.
+ */
+class AppCatalog
+{
+public:
+    // reads the whole catalog from the storage, throws DataStorageError on failure
+    static std::shared_ptr<const AppCatalog> build(DataStorage& storage);
+
+    // a copy of this catalog with the metadata of one version read again from the
+    // storage, the rest copied from this one; throws DataStorageError on failure
+    std::shared_ptr<const AppCatalog> withMetadata(DataStorage& storage,
+                                                   const std::string& type,
+                                                   const std::string& id,
+                                                   const std::string& version) const;
+
+    bool isAppInstalled(const std::string& type,
+                        const std::string& id,
+                        const std::string& version) const;
+
+    // type of the app with the given id, empty if the app is unknown
+    std::string getTypeOfApp(const std::string& id) const;
+
+    // same rows and filtering as DataStorage::GetAppDetailsListOuterJoin
+    std::vector<DataStorage::AppDetails> getAppDetailsList(const std::string& type,
+                                                           const std::string& id,
+                                                           const std::string& version,
+                                                           const std::string& appName,
+                                                           const std::string& category) const;
+
+    // returns false if the app version is not installed
+    bool getMetadata(const std::string& type,
+                     const std::string& id,
+                     const std::string& version,
+                     DataStorage::AppMetadata& metadata) const;
+
+private:
+    using AppKey = std::tuple<std::string, std::string, std::string>; // type, id, version
+
+    std::vector<DataStorage::AppDetails> apps;
+    std::map<AppKey, DataStorage::AppMetadata> installedApps;
+    std::map<std::string, std::string> appTypes; // id -> type
+};
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -19,11 +19,15 @@
 
 #include "Archives.h"
 #include "Debug.h"
+#include "Filesystem.h"
 
 #include <archive.h>
 #include <archive_entry.h>
 
+#include <cassert>
 #include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace WPEFramework {
 namespace Plugin {
@@ -61,12 +65,36 @@ public:
         }
     }
 
-    void extractTo(const std::string& destination)
+    void setOwnership(int aGid, bool aWriteable)
+    {
+        uid = getuid();
+        gid = aGid;
+        writeable = aWriteable;
+    }
+
+    // a shared image layer: read-only files, nothing extracted through a symlink or ".."
+    void setLayer()
+    {
+        layer = true;
+    }
+
+    void extractTo(const std::string& destination, const EntryBoundary& atEntryBoundary)
     {
         struct archive_entry *entry{};
+        auto extractFlags = flags;
+        if (gid >= 0) {
+            extractFlags |= ARCHIVE_EXTRACT_OWNER;
+        }
+        if (layer) {
+            extractFlags |= ARCHIVE_EXTRACT_SECURE_SYMLINKS | ARCHIVE_EXTRACT_SECURE_NODOTDOT;
+        }
 
         while (true)
         {
+            if (atEntryBoundary) {
+                atEntryBoundary();
+            }
+
             auto readHeaderResult = archive_read_next_header(theArchive, &entry);
 
             if (readHeaderResult == ARCHIVE_EOF) {
@@ -88,7 +116,14 @@ public:
                 archive_entry_set_hardlink(entry, destPathHardLink.c_str());
             }
 
-            auto extractStatus = archive_read_extract(theArchive, entry, flags);
+            if (gid >= 0) {
+                applyOwnership(entry);
+            }
+            if (layer && archive_entry_filetype(entry) == AE_IFREG) {
+                archive_entry_set_perm(entry, archive_entry_perm(entry) & ~(S_IWUSR | S_IWGRP | S_IWOTH));
+            }
+
+            auto extractStatus = archive_read_extract(theArchive, entry, extractFlags);
             if (extractStatus == ARCHIVE_OK || extractStatus == ARCHIVE_WARN) {
                 INFO("extracted: ", archive_entry_pathname(entry));
                 if (extractStatus == ARCHIVE_WARN) {
@@ -102,18 +137,62 @@ public:
     }
 
 private:
+    void applyOwnership(struct archive_entry* entry) const
+    {
+        // names would take precedence over ids in the standard lookup used by archive_read_extract
+        archive_entry_set_uname(entry, nullptr);
+        archive_entry_set_gname(entry, nullptr);
+        archive_entry_set_uid(entry, uid);
+        archive_entry_set_gid(entry, gid);
+
+        auto fileType = archive_entry_filetype(entry);
+        if (fileType == AE_IFDIR || fileType == AE_IFREG) {
+            archive_entry_set_perm(entry, Filesystem::getPermissionMode(fileType == AE_IFDIR, writeable));
+        }
+    }
+
     static constexpr int flags = ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM | ARCHIVE_EXTRACT_ACL
             | ARCHIVE_EXTRACT_FFLAGS;
 
     struct archive* theArchive{};
+    uid_t uid{};
+    int gid{-1};
+    bool writeable{false};
+    bool layer{false};
 };
 
 } // namespace anonymous
 
-void unpack(const std::string& filePath, const std::string& destinationDir)
+void unpack(const std::string& filePath, const std::string& destinationDir,
+            const EntryBoundary& atEntryBoundary)
+{
+    Archive archive{filePath};
+    archive.extractTo(destinationDir, atEntryBoundary);
+}
+
+void unpack(const std::string& filePath, const std::string& destinationDir, int gid, bool writeable,
+            const EntryBoundary& atEntryBoundary)
+{
+    Archive archive{filePath};
+    archive.setOwnership(gid, writeable);
+    archive.extractTo(destinationDir, atEntryBoundary);
+}
+
+void unpackLayer(const std::string& filePath, const std::string& destinationDir,
+                 const EntryBoundary& atEntryBoundary)
+{
+    Archive archive{filePath};
+    archive.setLayer();
+    archive.extractTo(destinationDir, atEntryBoundary);
+}
+
+void unpackLayer(const std::string& filePath, const std::string& destinationDir, int gid,
+                 const EntryBoundary& atEntryBoundary)
 {
     Archive archive{filePath};
-    archive.extractTo(destinationDir);
+    archive.setOwnership(gid, false);
+    archive.setLayer();
+    archive.extractTo(destinationDir, atEntryBoundary);
 }
 
 } // namespace Archive
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <stdexcept>
 
@@ -33,7 +34,31 @@ public:
     using std::runtime_error::runtime_error;
 };
 
-void unpack(const std::string& filePath, const std::string& destinationDir);
+// called before every entry is read, blocking in it suspends the extraction with the archive kept open
+using EntryBoundary = std::function<void()>;
+
+void unpack(const std::string& filePath, const std::string& destinationDir,
+            const EntryBoundary& atEntryBoundary = {});
+
+/**
+ * Unpacks the archive and applies ownership (current uid, given gid) and LISA
+ * permissions to every entry while it is created, so no recursive pass over
+ * the destination is needed afterwards.
+ */
+void unpack(const std::string& filePath, const std::string& destinationDir, int gid, bool writeable,
+            const EntryBoundary& atEntryBoundary = {});
+
+/**
+ * Unpacks a shared image layer. Its regular files are hard linked into every app built
+ * on the layer, so they are extracted read-only for everyone, the owner included.
+ * Entries leading through a symlink or containing ".." are refused.
+ */
+void unpackLayer(const std::string& filePath, const std::string& destinationDir,
+                 const EntryBoundary& atEntryBoundary = {});
+
+// as unpackLayer, with ownership and LISA permissions applied as by unpack
+void unpackLayer(const std::string& filePath, const std::string& destinationDir, int gid,
+                 const EntryBoundary& atEntryBoundary = {});
 
 } // namespace Archive
 } // namespace LISA
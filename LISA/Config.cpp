@@ -39,6 +39,20 @@ const std::string ANNOTATIONS_REGEX_KEY_NAME{"annotationsRegex"};
 const std::string DOWNLOAD_RETRY_AFTER_SECS_KEY_NAME{"downloadRetryAfterSeconds"};
 const std::string DOWNLOAD_RETRY_MAX_TIMES_KEY_NAME{"downloadRetryMaxTimes"};
 const std::string DOWNLOAD_TIMEOUT_SECS_KEY_NAME{"downloadTimeoutSeconds"};
+const std::string REPAIR_PERMISSIONS_ON_STARTUP_KEY_NAME{"repairPermissionsOnStartup"};
+const std::string TMP_PATH_KEY_NAME{"tmppath"};
+const std::string VOLUMES_KEY_NAME{"volumes"};
+const std::string VOLUME_NAME_KEY_NAME{"name"};
+const std::string VOLUME_PATH_KEY_NAME{"path"};
+const std::string VOLUME_SPEED_KEY_NAME{"speed"};
+const std::string VOLUME_RESERVE_KB_KEY_NAME{"reserveKB"};
+const std::string PLACEMENT_POLICY_KEY_NAME{"placementPolicy"};
+const std::string DB_MMAP_SIZE_KB_KEY_NAME{"dbMmapSizeKB"};
+const std::string SEARCH_METADATA_KEYS_KEY_NAME{"searchMetadataKeys"};
+const std::string CHANGE_LOG_SIZE_KEY_NAME{"changeLogSize"};
+const std::string STORAGE_BACKEND_KEY_NAME{"storageBackend"};
+const std::string DB_READ_CONNECTIONS_KEY_NAME{"dbReadConnections"};
+const std::string JOB_HISTORY_SIZE_KEY_NAME{"jobHistorySize"};
 
 void assureEndsWithSlash(std::string& str)
 {
@@ -62,11 +76,37 @@ Config::Config(const std::string& aConfig)
         using boost::property_tree::ptree;
         ptree::const_iterator end = pt.end();
 
+        std::string tmpPath;
+        std::vector<StorageVolume> configuredVolumes;
+
         for (auto it = pt.begin(); it != end; ++it) {
             if (it->first == APPS_PATH_KEY_NAME) {
                 appsPath = it->second.get_value<std::string>();
                 assureEndsWithSlash(appsPath);
-                appsTmpPath = appsPath + "tmp/";
+            }
+            else if (it->first == TMP_PATH_KEY_NAME) {
+                tmpPath = it->second.get_value<std::string>();
+                assureEndsWithSlash(tmpPath);
+            }
+            else if (it->first == VOLUMES_KEY_NAME) {
+                for (const auto& item : it->second) {
+                    StorageVolume volume;
+                    volume.name = item.second.get<std::string>(VOLUME_NAME_KEY_NAME);
+                    volume.mountPath = item.second.get<std::string>(VOLUME_PATH_KEY_NAME);
+                    assureEndsWithSlash(volume.mountPath);
+                    volume.appsPath = volume.mountPath;
+                    if (!configuredVolumes.empty()) {
+                        volume.appsPath += SECONDARY_VOLUME_DIR;
+                    }
+                    volume.speed = (item.second.get<std::string>(VOLUME_SPEED_KEY_NAME, "fast") == "slow")
+                                   ? SpeedClass::SLOW : SpeedClass::FAST;
+                    volume.reserveBytes = item.second.get<unsigned long long>(VOLUME_RESERVE_KB_KEY_NAME, 0) * 1024;
+                    configuredVolumes.push_back(volume);
+                }
+            }
+            else if (it->first == PLACEMENT_POLICY_KEY_NAME) {
+                placementPolicy = (it->second.get_value<std::string>() == "mostFree")
+                                  ? PlacementPolicy::MOST_FREE : PlacementPolicy::PREFER_FAST;
             }
             else if (it->first == DB_PATH_KEY_NAME) {
                 databasePath = it->second.get_value<std::string>();
@@ -91,7 +131,40 @@ Config::Config(const std::string& aConfig)
             else if (it->first == DOWNLOAD_TIMEOUT_SECS_KEY_NAME) {
                 downloadTimeoutSeconds = it->second.get_value<unsigned int>();
             }
+            else if (it->first == REPAIR_PERMISSIONS_ON_STARTUP_KEY_NAME) {
+                repairPermissionsOnStartup = it->second.get_value<bool>();
+            }
+            else if (it->first == DB_MMAP_SIZE_KB_KEY_NAME) {
+                databaseMmapSize = it->second.get_value<unsigned long long>() * 1024;
+            }
+            else if (it->first == SEARCH_METADATA_KEYS_KEY_NAME) {
+                for (const auto& item : it->second) {
+                    searchMetadataKeys.push_back(item.second.get_value<std::string>());
+                }
+            }
+            else if (it->first == CHANGE_LOG_SIZE_KEY_NAME) {
+                changeLogSize = it->second.get_value<unsigned int>();
+            }
+            else if (it->first == STORAGE_BACKEND_KEY_NAME) {
+                storageBackend = (it->second.get_value<std::string>() == "kv")
+                                 ? StorageBackend::KV : StorageBackend::SQLITE;
+            }
+            else if (it->first == DB_READ_CONNECTIONS_KEY_NAME) {
+                databaseReadConnections = it->second.get_value<unsigned int>();
+            }
+            else if (it->first == JOB_HISTORY_SIZE_KEY_NAME) {
+                jobHistorySize = it->second.get_value<unsigned int>();
+            }
         }
+
+        // without explicit volumes 'appspath' is the only (primary) volume
+        if (configuredVolumes.empty()) {
+            volumes = {{PRIMARY_VOLUME_NAME, appsPath, SpeedClass::FAST, 0, appsPath}};
+        } else {
+            volumes = configuredVolumes;
+            appsPath = volumes.front().appsPath;
+        }
+        appsTmpPath = tmpPath.empty() ? (appsPath + "tmp/") : tmpPath;
     }
     catch(std::exception& exc) {
         ERROR("parsing config exception: ", exc.what());
@@ -143,6 +216,64 @@ unsigned int Config::getDownloadTimeoutSeconds() const
     return downloadTimeoutSeconds;
 }
 
+bool Config::getRepairPermissionsOnStartup() const
+{
+    return repairPermissionsOnStartup;
+}
+
+const std::vector<Config::StorageVolume>& Config::getVolumes() const
+{
+    return volumes;
+}
+
+const Config::StorageVolume* Config::getVolume(const std::string& name) const
+{
+    if (name.empty()) {
+        return &volumes.front();
+    }
+    for (const auto& volume : volumes) {
+        if (volume.name == name) {
+            return &volume;
+        }
+    }
+    return nullptr;
+}
+
+unsigned long long Config::getDatabaseMmapSize() const
+{
+    return databaseMmapSize;
+}
+
+const std::vector<std::string>& Config::getSearchMetadataKeys() const
+{
+    return searchMetadataKeys;
+}
+
+unsigned int Config::getChangeLogSize() const
+{
+    return changeLogSize;
+}
+
+Config::StorageBackend Config::getStorageBackend() const
+{
+    return storageBackend;
+}
+
+unsigned int Config::getDatabaseReadConnections() const
+{
+    return databaseReadConnections;
+}
+
+unsigned int Config::getJobHistorySize() const
+{
+    return jobHistorySize;
+}
+
+Config::PlacementPolicy Config::getPlacementPolicy() const
+{
+    return placementPolicy;
+}
+
 std::ostream& operator<<(std::ostream& out, const Config& config)
 {
     return out << "[appsPath: " << config.appsPath << " tmpPath: " << config.appsTmpPath << " appStoragePath: "
@@ -152,6 +283,14 @@ std::ostream& operator<<(std::ostream& out, const Config& config)
                << " downloadRetryAfterSeconds: " << config.downloadRetryAfterSeconds
                << " downloadRetryMaxTimes: " << config.downloadRetryMaxTimes
                << " downloadTimeoutSeconds: " << config.downloadTimeoutSeconds
+               << " repairPermissionsOnStartup: " << config.repairPermissionsOnStartup
+               << " volumes: " << config.volumes.size()
+               << " dbMmapSize: " << config.databaseMmapSize
+               << " searchMetadataKeys: " << config.searchMetadataKeys.size()
+               << " changeLogSize: " << config.changeLogSize
+               << " dbReadConnections: " << config.databaseReadConnections
+               << " jobHistorySize: " << config.jobHistorySize
+               << " storageBackend: " << (config.storageBackend == Config::StorageBackend::KV ? "kv" : "sqlite")
             << "]";
 };
 
@@ -20,14 +20,51 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace WPEFramework {
 namespace Plugin {
 namespace LISA {
 
+const std::string PRIMARY_VOLUME_NAME = "internal";
+
 class Config
 {
 public:
+    enum class SpeedClass
+    {
+        FAST,
+        SLOW
+    };
+
+    enum class PlacementPolicy
+    {
+        PREFER_FAST,    // fast volumes first, most free space among volumes of the same speed
+        MOST_FREE       // volume with most free space above its reserve
+    };
+
+    enum class StorageBackend
+    {
+        SQLITE,     // sqlite database apps.db
+        KV          // append-only log apps.kv with an in-memory index
+    };
+
+    /**
+     * A location app images can be installed to. The first volume is the primary one,
+     * its path is returned by getAppsPath(). Other volumes (e.g. USB or SD storage) are
+     * only used when their path exists, LISA never creates them. Their path is shared
+     * with other data, so LISA keeps its images in the SECONDARY_VOLUME_DIR below it.
+     */
+    struct StorageVolume
+    {
+        std::string name;
+        std::string appsPath;
+        SpeedClass speed{SpeedClass::FAST};
+        unsigned long long reserveBytes{};  // space left free for the rest of the system
+        std::string mountPath;              // configured path, the volume is available while it exists
+    };
+    static constexpr const char* SECONDARY_VOLUME_DIR = "lisa/";
+
     Config() = default;
     Config(const std::string& aConfig);
 
@@ -40,6 +77,22 @@ public:
     unsigned int getDownloadRetryAfterSeconds() const;
     unsigned int getDownloadRetryMaxTimes() const;
     unsigned int getDownloadTimeoutSeconds() const;
+    bool getRepairPermissionsOnStartup() const;
+    const std::vector<StorageVolume>& getVolumes() const;
+    // empty name returns the primary volume, nullptr if there is no such volume
+    const StorageVolume* getVolume(const std::string& name) const;
+    PlacementPolicy getPlacementPolicy() const;
+    // bytes of the database file sqlite may access through mmap, 0 disables it
+    unsigned long long getDatabaseMmapSize() const;
+    // metadata keys whose values are included in the search index, empty means all keys
+    const std::vector<std::string>& getSearchMetadataKeys() const;
+    // number of catalog changes kept for getChanges
+    unsigned int getChangeLogSize() const;
+    StorageBackend getStorageBackend() const;
+    // read-only sqlite connections serving reads next to the writer, 0 reads on the writer
+    unsigned int getDatabaseReadConnections() const;
+    // finished jobs kept for listJobs/getJob
+    unsigned int getJobHistorySize() const;
 
     friend std::ostream& operator<<(std::ostream& out, const Config& config);
 
@@ -53,6 +106,15 @@ private:
     unsigned int downloadRetryAfterSeconds{30};
     unsigned int downloadRetryMaxTimes{4};
     unsigned int downloadTimeoutSeconds{15 * 60};
+    bool repairPermissionsOnStartup{false};
+    std::vector<StorageVolume> volumes{{PRIMARY_VOLUME_NAME, appsPath, SpeedClass::FAST, 0, appsPath}};
+    PlacementPolicy placementPolicy{PlacementPolicy::PREFER_FAST};
+    unsigned long long databaseMmapSize{0};
+    std::vector<std::string> searchMetadataKeys;
+    unsigned int changeLogSize{1000};
+    StorageBackend storageBackend{StorageBackend::SQLITE};
+    unsigned int databaseReadConnections{2};
+    unsigned int jobHistorySize{32};
 };
 
 } // namespace LISA
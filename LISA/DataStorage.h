@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <ostream>
 #include <string>
 #include <stdexcept>
 #include <vector>
@@ -34,6 +36,13 @@ public:
     using std::runtime_error::runtime_error;
 };
 
+// continuation token that was not issued for the requested listing
+class InvalidCursorError : public DataStorageError
+{
+public:
+    using DataStorageError::DataStorageError;
+};
+
 class DataStorage {
     public:
         struct AppDetails
@@ -63,6 +72,49 @@ class DataStorage {
             std::vector<std::pair<std::string, std::string> > metadata;
         };
 
+        enum class SortKey
+        {
+            ID,
+            TYPE,
+            CREATED
+        };
+
+        // apps of a single page, nextCursor is empty on the last page
+        struct AppDetailsPage
+        {
+            std::vector<AppDetails> apps;
+            std::string nextCursor;
+        };
+
+        // a catalog change logged at 'generation', version and key are empty for app and version level changes
+        struct Change
+        {
+            std::uint64_t generation;
+            std::string change; // "added", "removed" or "updated"
+            std::string type;
+            std::string id;
+            std::string version;
+            std::string key;
+        };
+
+        struct ChangeSet
+        {
+            std::uint64_t generation{0};   // current catalog generation
+            bool complete{true};           // false if changes were dropped from the log, reload everything
+            std::vector<Change> changes;   // latest change of every app, version or metadata key
+        };
+
+        // an app version to register, with the versions it depends on and the image layers it is built from
+        struct Installation
+        {
+            AppDetails app;
+            std::string appPath;
+            std::string appStoragePath;
+            std::string volume;
+            std::vector<AppDetails> dependencies;   // type, id and version are used
+            std::vector<std::string> layers;
+        };
+
         virtual ~DataStorage() {}
         virtual void Initialize() = 0;
         virtual std::vector<std::string> GetAppsPaths(const std::string& type = {},
@@ -81,6 +133,30 @@ class DataStorage {
                                                       const std::string& appName = {},
                                                       const std::string& category = {}) = 0;
 
+        /**
+         * Same rows as GetAppDetailsListOuterJoin, ordered by sortKey and then by app id. A page holds
+         * up to 'limit' apps (0 = no limit) with all their matching versions. Pass the nextCursor of
+         * the previous page to continue, InvalidCursorError is thrown if the cursor does not belong
+         * to the same sort order.
+         */
+        virtual AppDetailsPage GetAppDetailsPage(const std::string& type,
+                                                 const std::string& id,
+                                                 const std::string& version,
+                                                 const std::string& appName,
+                                                 const std::string& category,
+                                                 SortKey sortKey,
+                                                 bool descending,
+                                                 const std::string& cursor,
+                                                 unsigned int limit) = 0;
+
+        // installed app versions whose name, category or searchable metadata match all words of
+        // the query (as prefixes), best matches first
+        virtual std::vector<AppDetails> SearchApps(const std::string& query) = 0;
+
+        // installed app versions having metadata 'key' set to 'value'
+        virtual std::vector<AppDetails> GetAppDetailsListByMetadata(const std::string& key,
+                                                                    const std::string& value) = 0;
+
         virtual void AddInstalledApp(const std::string& type,
                                      const std::string& id,
                                      const std::string& version,
@@ -88,7 +164,8 @@ class DataStorage {
                                      const std::string& appName,
                                      const std::string& category,
                                      const std::string& appPath,
-                                     const std::string& appStoragePath) = 0;
+                                     const std::string& appStoragePath,
+                                     const std::string& volume) = 0;
 
         virtual bool IsAppInstalled(const std::string& type,
                                     const std::string& id,
@@ -96,6 +173,17 @@ class DataStorage {
 
         virtual std::string GetTypeOfApp(const std::string& id) = 0;
 
+        // name of the storage volume the app version is installed on, empty for the primary volume
+        virtual std::string GetAppVolume(const std::string& type,
+                                         const std::string& id,
+                                         const std::string& version) = 0;
+
+        // switches the volume of an installed app version in a single update
+        virtual void SetAppVolume(const std::string& type,
+                                  const std::string& id,
+                                  const std::string& version,
+                                  const std::string& volume) = 0;
+
         virtual bool IsAppData(const std::string& type,
                                const std::string& id) = 0;
 
@@ -112,11 +200,60 @@ class DataStorage {
                          const std::string& key,
                          const std::string& value) = 0;
 
+        // sets all key/value pairs of an installed app version in a single transaction
+        virtual void SetMetadataBatch(const std::string& type,
+                                      const std::string& id,
+                                      const std::string& version,
+                                      const std::vector<std::pair<std::string, std::string> >& metadata) = 0;
+
         virtual void ClearMetadata(const std::string& type,
                          const std::string& id,
                          const std::string& version,
                          const std::string& key) = 0;
 
+        // changes logged after sinceGeneration, oldest first
+        virtual ChangeSet GetChanges(std::uint64_t sinceGeneration) = 0;
+
+        /**
+         * Shared packages: an installed app version may depend on other installed versions.
+         * The refcount of a version is the number of versions depending on it, it cannot be
+         * removed while that is not 0. Removing a dependent drops its dependencies with it.
+         */
+        virtual void AddDependency(const std::string& type,
+                                   const std::string& id,
+                                   const std::string& version,
+                                   const std::string& dependencyType,
+                                   const std::string& dependencyId,
+                                   const std::string& dependencyVersion) = 0;
+
+        virtual std::vector<AppDetails> GetDependencies(const std::string& type,
+                                                        const std::string& id,
+                                                        const std::string& version) = 0;
+
+        virtual unsigned int GetRefCount(const std::string& type,
+                                         const std::string& id,
+                                         const std::string& version) = 0;
+
+        /**
+         * Registers the app versions with their dependencies and layers as one write: either all of
+         * it is stored or nothing is. A dependency is either installed already or an earlier entry
+         * of the list. Readers never see a version without its dependencies.
+         */
+        virtual void AddInstalledApps(const std::vector<Installation>& installations) = 0;
+
+        // digests of the image layers an app version is assembled from, in manifest order
+        virtual void SetAppLayers(const std::string& type,
+                                  const std::string& id,
+                                  const std::string& version,
+                                  const std::vector<std::string>& digests) = 0;
+
+        virtual std::vector<std::string> GetAppLayers(const std::string& type,
+                                                      const std::string& id,
+                                                      const std::string& version) = 0;
+
+        // number of installed app versions using the layer
+        virtual unsigned int GetLayerRefCount(const std::string& digest) = 0;
+
         virtual AppMetadata GetMetadata(const std::string& type,
                                         const std::string& id,
                                         const std::string& version) = 0;
@@ -0,0 +1,139 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DependencyGraph.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <fstream>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+std::vector<Package> readDependencies(const std::string& annotationsFile)
+{
+    std::vector<Package> dependencies;
+    std::ifstream file(annotationsFile);
+    if (!file.good()) {
+        return dependencies;
+    }
+
+    boost::property_tree::ptree pt;
+    try {
+        boost::property_tree::read_json(file, pt);
+    } catch (const boost::property_tree::json_parser_error& error) {
+        throw DependencyError(std::string{"malformed annotations: "} + error.what());
+    }
+
+    auto declared = pt.get_child_optional("dependencies");
+    if (!declared) {
+        return dependencies;
+    }
+    for (const auto& item : *declared) {
+        Package package;
+        package.type = item.second.get<std::string>("type", "");
+        package.id = item.second.get<std::string>("id", "");
+        package.version = item.second.get<std::string>("version", "");
+        package.url = item.second.get<std::string>("url", "");
+        if (package.type.empty() || package.id.empty() || package.version.empty() || package.url.empty()) {
+            throw DependencyError("dependency needs type, id, version and url in " + annotationsFile);
+        }
+        dependencies.push_back(std::move(package));
+    }
+    return dependencies;
+}
+
+bool DependencyGraph::add(const Package& package)
+{
+    if (!index.emplace(key(package), nodes.size()).second) {
+        return false;
+    }
+    nodes.push_back({package, {}});
+    return true;
+}
+
+bool DependencyGraph::contains(const Package& package) const
+{
+    return index.count(key(package)) == 1;
+}
+
+void DependencyGraph::setDependencies(const Package& package, std::vector<Package> dependencies)
+{
+    nodes.at(index.at(key(package))).dependencies = std::move(dependencies);
+}
+
+const std::vector<Package>& DependencyGraph::dependencies(const Package& package) const
+{
+    return nodes.at(index.at(key(package))).dependencies;
+}
+
+std::vector<Package> DependencyGraph::order() const
+{
+    // Kahn's algorithm over the added packages, counting the dependencies still to be placed
+    std::vector<std::size_t> pending(nodes.size(), 0);
+    std::vector<std::vector<std::size_t> > dependents(nodes.size());
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        for (const auto& dependency : nodes[i].dependencies) {
+            auto found = index.find(key(dependency));
+            if (found != index.end()) {
+                ++pending[i];
+                dependents[found->second].push_back(i);
+            }
+        }
+    }
+
+    std::vector<std::size_t> ready;
+    for (std::size_t i = nodes.size(); i > 0; --i) {
+        if (pending[i - 1] == 0) {
+            ready.push_back(i - 1);
+        }
+    }
+    std::vector<Package> ordered;
+    ordered.reserve(nodes.size());
+    while (!ready.empty()) {
+        auto next = ready.back();
+        ready.pop_back();
+        ordered.push_back(nodes[next].package);
+        for (auto dependent : dependents[next]) {
+            if (--pending[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+
+    if (ordered.size() != nodes.size()) {
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (pending[i] > 0) {
+                throw DependencyError("dependency cycle involving " + nodes[i].package.id + " " + nodes[i].package.version);
+            }
+        }
+    }
+    return ordered;
+}
+
+DependencyGraph::Key DependencyGraph::key(const Package& package)
+{
+    return Key{package.type, package.id, package.version};
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
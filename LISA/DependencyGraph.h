@@ -0,0 +1,84 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+class DependencyError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// an app or shared package version, the url is only needed to fetch it
+struct Package
+{
+    std::string type, id, version, url;
+};
+
+/**
+ * Reads the "dependencies" array of an annotations file:
+ *   {"dependencies": [{"type": ..., "id": ..., "version": ..., "url": ...}]}
+ * A missing file or array means no dependencies, a malformed entry throws DependencyError.
+ */
+std::vector<Package> readDependencies(const std::string& annotationsFile);
+
+/**
+ * Packages resolved for a single install and their direct dependencies. Dependencies
+ * which are not added themselves (already installed) are taken as satisfied.
+ */
+class DependencyGraph
+{
+public:
+    // false if the package is already part of the graph
+    bool add(const Package& package);
+    bool contains(const Package& package) const;
+
+    void setDependencies(const Package& package, std::vector<Package> dependencies);
+    const std::vector<Package>& dependencies(const Package& package) const;
+
+    // added packages, each one after everything it depends on; throws DependencyError on a cycle
+    std::vector<Package> order() const;
+
+private:
+    using Key = std::tuple<std::string, std::string, std::string>;
+    static Key key(const Package& package);
+
+    struct Node
+    {
+        Package package;
+        std::vector<Package> dependencies;
+    };
+    // in the order the packages were added
+    std::vector<Node> nodes;
+    std::map<Key, std::size_t> index;
+};
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,276 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DirectoryWalker.h"
+#include "Filesystem.h"
+#include "Debug.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+namespace Filesystem {
+
+namespace { // anonymous
+
+// layout of the records returned by the getdents64 system call
+struct LinuxDirent64
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+constexpr size_t DIRENT_BUFFER_SIZE = 32 * 1024;
+
+std::atomic<WalkCounter*> walkCounter{nullptr};
+
+void count(std::atomic<unsigned long long> WalkCounter::*calls)
+{
+    auto* counter = walkCounter.load(std::memory_order_relaxed);
+    if (counter) {
+        ++(counter->*calls);
+    }
+}
+
+class ScopedFd
+{
+public:
+    explicit ScopedFd(int aFd) : fd(aFd) {}
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd& operator=(const ScopedFd&) = delete;
+
+    ~ScopedFd()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int get() const
+    {
+        return fd;
+    }
+
+private:
+    int fd{-1};
+};
+
+std::string errnoMessage(const std::string& what, const std::string& name)
+{
+    return std::string{} + "error " + strerror(errno) + " " + what + " " + name;
+}
+
+unsigned char typeFromMode(mode_t mode)
+{
+    switch (mode & S_IFMT) {
+        case S_IFDIR: return DT_DIR;
+        case S_IFREG: return DT_REG;
+        case S_IFLNK: return DT_LNK;
+        case S_IFCHR: return DT_CHR;
+        case S_IFBLK: return DT_BLK;
+        case S_IFIFO: return DT_FIFO;
+        case S_IFSOCK: return DT_SOCK;
+    }
+    return DT_UNKNOWN;
+}
+
+int openDirectory(const std::string& path)
+{
+    count(&WalkCounter::opens);
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        throw FilesystemError(errnoMessage("opening directory", path));
+    }
+    return fd;
+}
+
+int openSubdirectory(int dirFd, const char* name)
+{
+    count(&WalkCounter::opens);
+    int fd = openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        throw FilesystemError(errnoMessage("opening directory", name));
+    }
+    return fd;
+}
+
+bool walkFd(int dirFd, unsigned int depth, bool recursive, const WalkCallback& callback,
+            const std::atomic_bool* stopped = nullptr)
+{
+    std::vector<char> buffer(DIRENT_BUFFER_SIZE);
+
+    while (true) {
+        count(&WalkCounter::reads);
+        auto bytesRead = syscall(SYS_getdents64, dirFd, buffer.data(), buffer.size());
+        if (bytesRead < 0) {
+            throw FilesystemError(errnoMessage("reading directory", std::to_string(dirFd)));
+        }
+        if (bytesRead == 0) {
+            return true;
+        }
+
+        for (long offset = 0; offset < bytesRead;) {
+            auto dirent = reinterpret_cast<LinuxDirent64*>(buffer.data() + offset);
+            offset += dirent->d_reclen;
+
+            const char* name = dirent->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (stopped && stopped->load()) {
+                return false;
+            }
+
+            DirEntry entry{dirFd, name, dirent->d_type, depth};
+            if (entry.type == DT_UNKNOWN) {
+                struct stat st{};
+                entry.stat(st);
+                entry.type = typeFromMode(st.st_mode);
+            }
+
+            auto action = callback(entry);
+            if (action == WalkAction::STOP) {
+                return false;
+            }
+            if (recursive && action == WalkAction::CONTINUE && entry.isDirectory()) {
+                ScopedFd subdirFd{openSubdirectory(dirFd, name)};
+                if (!walkFd(subdirFd.get(), depth + 1, recursive, callback, stopped)) {
+                    return false;
+                }
+            }
+        }
+    }
+}
+
+} // namespace anonymous
+
+bool DirEntry::isDirectory() const
+{
+    return type == DT_DIR;
+}
+
+bool DirEntry::isRegularFile() const
+{
+    return type == DT_REG;
+}
+
+void DirEntry::stat(struct stat& st) const
+{
+    count(&WalkCounter::stats);
+    if (fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        throw FilesystemError(errnoMessage("reading status of", name));
+    }
+}
+
+void setWalkCounter(WalkCounter* counter)
+{
+    walkCounter.store(counter);
+}
+
+bool listDirectory(const std::string& path, const WalkCallback& callback)
+{
+    ScopedFd dirFd{openDirectory(path)};
+    return walkFd(dirFd.get(), 0, false, callback);
+}
+
+bool walkDirectory(const std::string& path, const WalkCallback& callback)
+{
+    ScopedFd dirFd{openDirectory(path)};
+    return walkFd(dirFd.get(), 0, true, callback);
+}
+
+bool walkDirectoryParallel(const std::string& path, const WalkCallback& callback, unsigned int threads)
+{
+    if (threads <= 1) {
+        return walkDirectory(path, callback);
+    }
+
+    ScopedFd rootFd{openDirectory(path)};
+
+    // top level is listed on the calling thread, subtrees are handed out to the workers
+    std::vector<std::string> subdirectories;
+    bool completed = walkFd(rootFd.get(), 0, false, [&](const DirEntry& entry) {
+        auto action = callback(entry);
+        if (action == WalkAction::CONTINUE && entry.isDirectory()) {
+            subdirectories.emplace_back(entry.name);
+        }
+        return action;
+    });
+    if (!completed) {
+        return false;
+    }
+
+    std::atomic_bool stopped{false};
+    std::atomic<size_t> nextIndex{0};
+    std::exception_ptr firstError;
+    std::mutex errorMutex;
+
+    auto worker = [&]() {
+        try {
+            size_t index;
+            while (!stopped.load() && (index = nextIndex++) < subdirectories.size()) {
+                ScopedFd subdirFd{openSubdirectory(rootFd.get(), subdirectories[index].c_str())};
+                if (!walkFd(subdirFd.get(), 1, true, callback, &stopped)) {
+                    stopped.store(true);
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+            stopped.store(true);
+        }
+    };
+
+    auto workersCount = std::min<size_t>(threads, subdirectories.size());
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < workersCount; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    return !stopped.load();
+}
+
+} // namespace Filesystem
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
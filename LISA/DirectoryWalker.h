@@ -0,0 +1,92 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <sys/stat.h>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+namespace Filesystem {
+
+/**
+ * Low level directory walker built on openat + getdents64 + fstatat(AT_SYMLINK_NOFOLLOW).
+ *
+ * Entries are reported relative to an open directory descriptor, no full path
+ * strings are built and d_type is used to avoid stat calls. Symbolic links are
+ * never followed. Errors are reported with FilesystemError.
+ */
+struct DirEntry
+{
+    int dirFd;              // descriptor of the directory containing the entry
+    const char* name;       // entry name, relative to dirFd
+    unsigned char type;     // DT_* value, never DT_UNKNOWN
+    unsigned int depth;     // 0 for direct children of the walked directory
+
+    bool isDirectory() const;
+    bool isRegularFile() const;
+
+    // fstatat(dirFd, name, AT_SYMLINK_NOFOLLOW), throws FilesystemError on failure
+    void stat(struct stat& st) const;
+};
+
+enum class WalkAction
+{
+    CONTINUE,   // go on, descend if the entry is a directory
+    SKIP,       // go on, but do not descend into this directory
+    STOP        // stop the walk
+};
+
+using WalkCallback = std::function<WalkAction(const DirEntry& entry)>;
+
+// Reports the direct children of path. Returns false if the walk was stopped.
+bool listDirectory(const std::string& path, const WalkCallback& callback);
+
+// Reports every entry below path, depth first, a directory before its contents.
+bool walkDirectory(const std::string& path, const WalkCallback& callback);
+
+/**
+ * System calls made by the walkers while the counter is installed, so tests can hold
+ * a walk to the number of calls it is expected to make.
+ */
+struct WalkCounter
+{
+    std::atomic<unsigned long long> opens{0};     // open / openat of directories
+    std::atomic<unsigned long long> reads{0};     // getdents64
+    std::atomic<unsigned long long> stats{0};     // fstatat
+};
+
+// installs the counter for all walks, nullptr removes it; it must outlive the walks
+void setWalkCounter(WalkCounter* counter);
+
+/**
+ * Same as walkDirectory but the subtrees of the top level directories are walked
+ * by up to 'threads' worker threads. The callback is called concurrently and must
+ * be thread safe; the order of entries is unspecified.
+ */
+bool walkDirectoryParallel(const std::string& path, const WalkCallback& callback, unsigned int threads);
+
+} // namespace Filesystem
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -20,8 +20,10 @@
 #include "Downloader.h"
 #include "Debug.h"
 
+#include <algorithm>
 #include <cassert>
 #include <thread>
+#include <unistd.h>
 
 namespace WPEFramework {
 namespace Plugin {
@@ -83,20 +85,30 @@ unsigned long long Downloader::getContentLength()
     curl_off_t curlContentLength{};
     auto res = curl_easy_getinfo(curl.get(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &curlContentLength);
     if (res == CURLE_OK && curlContentLength != -1)
-      return static_cast<unsigned long long>(curlContentLength);
+      contentLength = static_cast<unsigned long long>(curlContentLength);
     else
-      return 0;
+      contentLength = 0;
+    return contentLength;
 }
 
 void Downloader::get(const std::string& destination)
 {
-    Filesystem::File destinationFile{destination};
+    Filesystem::File file{destination};
     INFO("downloading...");
 
+    destinationFile = static_cast<FILE*>(file.getHandle());
+    resumeOffset = 0;
     curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 0);
-    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, destinationFile.getHandle());
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, destinationFile);
 
-    performAction();
+    try {
+        performAction();
+    }
+    catch (...) {
+        destinationFile = nullptr;
+        throw;
+    }
+    destinationFile = nullptr;
 }
 
 void Downloader::performAction()
@@ -106,16 +118,41 @@ void Downloader::performAction()
         CURLcode result = curl_easy_perform(curl.get());
 
         if (result == CURLE_ABORTED_BY_CALLBACK) {
-            throw CancelledException();
-        } else if (result != CURLE_OK) {
-            std::string message = std::string{"download error "} + curl_easy_strerror(result);
-            throw DownloadError(message);
+            if (!transferPaused) {
+                throw CancelledException();
+            }
+            transferPaused = false;
+            listener.waitWhilePaused();
+            if (listener.isCancelled()) {
+                throw CancelledException();
+            }
+            resumeTransfer();
+            continue;
         }
 
         long httpStatus{};
         curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &httpStatus);
 
-        if (httpStatus == HTTP_OK) {
+        if (httpStatus == HTTP_RANGE_NOT_SATISFIABLE && resumeOffset > 0) {
+            // paused after the last byte arrived, nothing is left to request
+            if (isTransferComplete()) {
+                INFO("download complete at ", resumeOffset);
+                break;
+            }
+            INFO("download restarted, partial download does not match the remote file");
+            restartTransfer();
+            continue;
+        } else if (result == CURLE_RANGE_ERROR && resumeOffset > 0) {
+            // the server does not support ranges, the whole file is downloaded again
+            INFO("download restarted, range request not supported");
+            restartTransfer();
+            continue;
+        } else if (result != CURLE_OK) {
+            std::string message = std::string{"download error "} + curl_easy_strerror(result);
+            throw DownloadError(message);
+        }
+
+        if (httpStatus == HTTP_OK || httpStatus == HTTP_PARTIAL_CONTENT) {
             break;
         } else if (httpStatus == HTTP_ACCEPTED) {
             if (retryMaxTimes > 0) {
@@ -131,6 +168,39 @@ void Downloader::performAction()
     }
 }
 
+void Downloader::resumeTransfer()
+{
+    if (!destinationFile) {
+        // nothing written yet, the request is simply repeated
+        return;
+    }
+    fflush(destinationFile);
+    resumeOffset = ftello(destinationFile);
+    INFO("download resumed from ", resumeOffset);
+    curl_easy_setopt(curl.get(), CURLOPT_RESUME_FROM_LARGE, resumeOffset);
+}
+
+void Downloader::restartTransfer()
+{
+    if (ftruncate(fileno(destinationFile), 0) != 0) {
+        throw DownloadError("download error unable to truncate partial download");
+    }
+    rewind(destinationFile);
+    resumeOffset = 0;
+    curl_easy_setopt(curl.get(), CURLOPT_RESUME_FROM_LARGE, resumeOffset);
+}
+
+bool Downloader::isTransferComplete()
+{
+    // whatever came with the error response is not part of the file
+    if (ftruncate(fileno(destinationFile), resumeOffset) != 0 || fseeko(destinationFile, resumeOffset, SEEK_SET) != 0) {
+        throw DownloadError("download error unable to truncate partial download");
+    }
+    // the length of the body as announced before the pause, if any
+    auto expected = contentLength > 0 ? contentLength : static_cast<unsigned long long>(std::max(progress.total, 0L));
+    return expected == 0 || expected == static_cast<unsigned long long>(resumeOffset);
+}
+
 void Downloader::doRetryWait()
 {
     auto retryTime = getRetryAfterTimeSec();
@@ -195,17 +265,24 @@ int Downloader::curlProgressCb(void* userData,
 
 bool Downloader::onProgress(long dlTotal, long dlNow)
 {
-    if (! listener.isCancelled()) {
-        Progress newProgres = {dlTotal, dlNow};
+    if (listener.isCancelled()) {
+        INFO("download canceled");
+        return true;
+    } else if (listener.isPaused()) {
+        INFO("download paused");
+        transferPaused = true;
+        return true;
+    } else {
+        // after a resume curl counts only the requested range
+        auto offset = static_cast<long>(resumeOffset);
+        Progress newProgres = {dlTotal == 0 ? 0 : dlTotal + offset, dlNow + offset};
         if (newProgres != progress) {
             progress = newProgres;
             INFO("download progress ", progress);
+            listener.setBytesDownloaded(progress.now);
             listener.setProgress(progress.percent());
         }
         return false;
-    } else {
-        INFO("download canceled");
-        return true;
     }
 }
 
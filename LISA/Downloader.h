@@ -27,6 +27,7 @@
 #include <functional>
 #include <memory>
 #include <chrono>
+#include <cstdio>
 #include <stdexcept>
 
 namespace WPEFramework {
@@ -61,7 +62,11 @@ public:
     virtual ~DownloaderListener() = default;
 
     virtual void setProgress(int progress) = 0;
+    virtual void setBytesDownloaded(unsigned long long bytes) = 0;
     virtual bool isCancelled() = 0;
+    virtual bool isPaused() = 0;
+    // blocks until the operation is resumed or cancelled
+    virtual void waitWhilePaused() = 0;
 };
 
 class Downloader
@@ -78,6 +83,9 @@ public:
 
 private:
     void performAction();
+    void resumeTransfer();
+    void restartTransfer();
+    bool isTransferComplete();
     void doRetryWait();
     std::chrono::seconds getRetryAfterTimeSec();
 
@@ -93,6 +101,8 @@ private:
 
     static constexpr int HTTP_OK{200};
     static constexpr int HTTP_ACCEPTED{202};
+    static constexpr int HTTP_PARTIAL_CONTENT{206};
+    static constexpr int HTTP_RANGE_NOT_SATISFIABLE{416};
 
     using CURLPtr = std::unique_ptr<CURL, CurlDeleter>;
     CURLPtr curl{nullptr};
@@ -110,6 +120,13 @@ private:
     friend std::ostream& operator<<(std::ostream& out, const Progress& aProgress);
     Progress progress{};
 
+    // a paused transfer is torn down and continued with a range request from what is already written
+    FILE* destinationFile{nullptr};
+    curl_off_t resumeOffset{0};
+    // from getContentLength, 0 if not known
+    unsigned long long contentLength{0};
+    bool transferPaused{false};
+
     DownloaderListener& listener;
 
     std::chrono::seconds retryAfterTime{300};
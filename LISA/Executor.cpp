@@ -24,15 +24,21 @@
 #include "Debug.h"
 #include "Downloader.h"
 #include "Filesystem.h"
+#include "ImageStore.h"
+#include "KvDataStorage.h"
 #include "SqlDataStorage.h"
 #include "AuthModule/Auth.h"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <random>
 #include <limits>
 #include <fstream>
+#include <future>
+#include <iterator>
 #include <regex>
+#include <set>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/filesystem.hpp>
@@ -55,12 +61,48 @@ extern "C" AuthMethod getAuthenticationMethod(const char* appType, const char* i
 namespace // anonymous
 {
 
+// category of the shared packages installed as dependencies, only those are removed when unused
+const std::string DEPENDENCY_CATEGORY = "dependency";
+
+const std::string JOB_JOURNAL_NAME = "jobs.journal";
+// a job interrupted by the device going down over and over again is given up
+constexpr unsigned int MAX_JOB_RECOVERIES = 2;
+
 std::string extractFilename(const std::string& uri)
 {
     std::size_t found = uri.find_last_of('/');
     return uri.substr(found+1);
 }
 
+bool isValidInstallParams(const std::string& type, const std::string& id, const std::string& version)
+{
+    if (type.empty() || id.empty() || version.empty()) {
+        return false;
+    }
+    return Filesystem::isAcceptableFilePath(id) && Filesystem::isAcceptableFilePath(version) && id != Image::LAYERS_DIR;
+}
+
+// waits for every fetch, none may outlive a failed one; rethrows the first failure
+template<typename T>
+std::vector<T> collectAll(std::vector<std::future<T> >& futures)
+{
+    std::vector<T> results;
+    std::exception_ptr failure;
+    for (auto& future : futures) {
+        try {
+            results.push_back(future.get());
+        } catch (...) {
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return results;
+}
+
 std::string generateHandle()
 {
     static std::random_device rd;
@@ -130,16 +172,58 @@ std::vector<AppId> scanDirectories(const std::string& appsPath, bool scanDataSto
 
 } // namespace anonymous
 
+bool Executor::priorityFromStr(const std::string& name, Priority& priority)
+{
+    if (name == "user") {
+        priority = Priority::USER_INITIATED;
+    } else if (name.empty() || name == "foreground") {
+        priority = Priority::FOREGROUND;
+    } else if (name == "background") {
+        priority = Priority::BACKGROUND;
+    } else if (name == "maintenance") {
+        priority = Priority::MAINTENANCE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 uint32_t Executor::Configure(const std::string& configString)
 {
     INFO("config: '", configString, "'");
     config = Config{configString};
 
+    {
+        LockGuard lock(taskMutex);
+        jobs.setLimit(config.getJobHistorySize());
+    }
+
     auto result{Core::ERROR_NONE};
     try {
         handleDirectories();
         initializeDataBase(config.getDatabasePath());
-        doMaintenance();
+        auto journalPath = config.getDatabasePath() + Filesystem::LISA_EPOCH + '/' + JOB_JOURNAL_NAME;
+        bool journalIntact;
+        {
+            LockGuard lock(taskMutex);
+            journalIntact = journal.open(journalPath);
+        }
+        if (journalIntact) {
+            // every operation in flight is known, their leftovers are removed by the recovery
+            Filesystem::removeDirectory(config.getAppsTmpPath());
+            Filesystem::createDirectory(config.getAppsTmpPath());
+        } else {
+            doMaintenance();
+        }
+        recoverJobs();
+        refreshCatalog();
+        if (config.getRepairPermissionsOnStartup()) {
+            doRepairPermissions();
+        }
+        {
+            LockGuard lock(taskMutex);
+            startPendingTask();
+        }
         INFO("configuration done");
     } catch (std::exception& error) {
         ERROR("Unable to configure executor: ", error.what());
@@ -154,88 +238,141 @@ uint32_t Executor::Install(const std::string& type,
                            const std::string& url,
                            const std::string& appName,
                            const std::string& category,
-                           std::string& handle)
+                           std::string& handle,
+                           Priority priority)
 {
     INFO("type=", type, " id=", id, " version=", version, " url=", url, " appName=", appName, " cat=", category);
 
-    if (type.empty() || id.empty() || version.empty()) {
+    if (!isValidInstallParams(type, id, version)) {
         handle = "WrongParams";
         return ERROR_WRONG_PARAMS;
     }
 
-    if (!Filesystem::isAcceptableFilePath(id) || !Filesystem::isAcceptableFilePath(version)) {
-        handle = "WrongParams";
-        return ERROR_WRONG_PARAMS;
+    LockGuard lock(taskMutex);
+    if (!admits(priority) || isWorkerBusy(type, id, version)) {
+        handle = "TooManyRequests";
+        return ERROR_TOO_MANY_REQUESTS;
+    }
+
+    auto result = checkInstallable(type, id, version, handle);
+    if (result != ERROR_NONE) {
+        return result;
+    }
+
+    handle = scheduleTask(OperationType::INSTALLING, type, id, version, priority, {url, appName, category});
+
+    INFO("task[", handle, "] scheduled ");
+    return ERROR_NONE;
+}
+
+uint32_t Executor::Uninstall(const std::string& type,
+        const std::string& id,
+        const std::string& version,
+        const std::string& uninstallType,
+        std::string& handle,
+        Priority priority)
+{
+    INFO("type=", type, " id=", id, " version=", version, " uninstallType=", uninstallType);
+
+    auto result = checkUninstallable(type, id, version, uninstallType, handle);
+    if (result != ERROR_NONE) {
+        return result;
     }
 
     LockGuard lock(taskMutex);
-    if (isWorkerBusy()) {
+    if (!admits(priority) || isWorkerBusy(type, id, version)) {
         handle = "TooManyRequests";
         return ERROR_TOO_MANY_REQUESTS;
     }
 
-    if (isAppInstalled(type, id, version)) {
-        handle = "AlreadyInstalled";
-        return ERROR_ALREADY_INSTALLED;
+    if (lockedApps.count({type, id, version}) == 1) {
+        handle = "AppLocked";
+        INFO("Cannot uninstall app because of lock!");
+        return ERROR_APP_LOCKED;
     }
 
-    try {
-        if (dataBase->GetTypeOfApp(id) != type) {
-            ERROR("In the DB id '", id, "' is already used with another type! App id must be unique.");
-            handle = "WrongParams";
-            return ERROR_WRONG_PARAMS;
+    handle = scheduleTask(OperationType::UNINSTALLING, type, id, version, priority, {uninstallType});
+    return ERROR_NONE;
+}
+
+uint32_t Executor::InstallBatch(const std::vector<BatchItem>& items, std::vector<BatchResult>& results)
+{
+    INFO("items=", items.size());
+
+    results.clear();
+    results.reserve(items.size());
+
+    LockGuard lock(taskMutex);
+    for (const auto& item : items) {
+        BatchResult result;
+        if (!isValidInstallParams(item.type, item.id, item.version)) {
+            result.handle = "WrongParams";
+            result.code = ERROR_WRONG_PARAMS;
+        } else if (isWorkerBusy(item.type, item.id, item.version)) {
+            result.handle = "TooManyRequests";
+            result.code = ERROR_TOO_MANY_REQUESTS;
+        } else {
+            result.code = checkInstallable(item.type, item.id, item.version, result.handle);
         }
-    } catch (const SqlDataStorageError&) {
-        // fine, no problem, not a single version of app(id) installed yet
-    }
 
-    currentTask.handle = generateHandle();
-    currentTask.operation = OperationType::INSTALLING;
-    currentTask.type = type;
-    currentTask.id = id;
-    currentTask.version = version;
+        if (result.code == ERROR_NONE) {
+            result.handle = scheduleTask(OperationType::INSTALLING, item.type, item.id, item.version, item.priority,
+                                         {item.url, item.appName, item.category});
+        }
+        results.push_back(std::move(result));
+    }
+    return ERROR_NONE;
+}
 
-    executeTask([=] {
-        INFO("executing doInstall");
-        doInstall(type, id, version, url, appName, category);
-    });
+uint32_t Executor::UninstallBatch(const std::vector<BatchItem>& items, std::vector<BatchResult>& results)
+{
+    INFO("items=", items.size());
 
-    INFO(currentTask, " scheduled ");
+    results.clear();
+    results.reserve(items.size());
 
-    handle = currentTask.handle;
+    LockGuard lock(taskMutex);
+    for (const auto& item : items) {
+        BatchResult result;
+        result.code = checkUninstallable(item.type, item.id, item.version, item.uninstallType, result.handle);
+        if (result.code == ERROR_NONE) {
+            if (isWorkerBusy(item.type, item.id, item.version)) {
+                result.handle = "TooManyRequests";
+                result.code = ERROR_TOO_MANY_REQUESTS;
+            } else if (lockedApps.count({item.type, item.id, item.version}) == 1) {
+                result.handle = "AppLocked";
+                result.code = ERROR_APP_LOCKED;
+            } else {
+                result.handle = scheduleTask(OperationType::UNINSTALLING, item.type, item.id, item.version,
+                                             item.priority, {item.uninstallType});
+            }
+        }
+        results.push_back(std::move(result));
+    }
     return ERROR_NONE;
 }
 
-uint32_t Executor::Uninstall(const std::string& type,
+uint32_t Executor::Move(const std::string& type,
         const std::string& id,
         const std::string& version,
-        const std::string& uninstallType,
+        const std::string& volume,
         std::string& handle)
 {
-    INFO("type=", type, " id=", id, " version=", version, " uninstallType=", uninstallType);
+    INFO("type=", type, " id=", id, " version=", version, " volume=", volume);
 
-    // TODO what are param requirements?
-    if (uninstallType != "full" && uninstallType != "upgrade") {
+    if (type.empty() || id.empty() || version.empty() || volume.empty()) {
         handle = "WrongParams";
         return ERROR_WRONG_PARAMS;
     }
 
-    // If an app was uninstalled earlier with uninstallType=upgrade, then the
-    // app record will still be inside the database. Also the data storage dir will
-    // still exist. Allow the uninstallation of these artifacts with "if test" below.
-    // Second "if test" is the uninstallation of the usual case: uninstalling an app
-    // of specific version.
-    if (version.empty() && !type.empty() && !id.empty() && uninstallType == "full") {
-        // verify that such an app record exists
-        if (dataBase->GetDataPaths(type, id).size() == 0) {
-            return ERROR_WRONG_PARAMS;
-        }
-        // only allowed when no specific version of app installed anymore
-        // if there are: the usual uninstall with a specific version should be called
-        if (dataBase->GetAppsPaths(type, id, "").size() > 0) {
-            return ERROR_WRONG_PARAMS;
-        }
-    } else if (!isAppInstalled(type, id, version)) {
+    auto targetVolume = config.getVolume(volume);
+    if (!targetVolume || !Filesystem::directoryExists(targetVolume->mountPath)) {
+        ERROR("Volume '", volume, "' not configured or not available");
+        handle = "WrongParams";
+        return ERROR_WRONG_PARAMS;
+    }
+
+    if (!isAppInstalled(type, id, version)) {
         handle = "WrongParams";
         return ERROR_WRONG_PARAMS;
     }
@@ -246,24 +383,15 @@ uint32_t Executor::Uninstall(const std::string& type,
         return ERROR_TOO_MANY_REQUESTS;
     }
 
+    // a locked app may be running from its current location
     if (lockedApps.count({type, id, version}) == 1) {
         handle = "AppLocked";
-        INFO("Cannot uninstall app because of lock!");
+        INFO("Cannot move app because of lock!");
         return ERROR_APP_LOCKED;
     }
 
-    currentTask.handle = generateHandle();
-    currentTask.operation = OperationType::UNINSTALLING;
-    currentTask.type = type;
-    currentTask.id = id;
-    currentTask.version = version;
-
-    executeTask([=] {
-        INFO("executing doUninstall");
-        doUninstall(type, id, version, uninstallType);
-    });
-
-    handle = currentTask.handle;
+    // the worker is idle, the move is started right away
+    handle = scheduleTask(OperationType::MOVING, type, id, version, Priority::FOREGROUND, {volume});
     return ERROR_NONE;
 }
 
@@ -286,8 +414,9 @@ uint32_t Executor::Lock(const std::string& type,
     }
 
     LockGuard lock(taskMutex);
-    if (isWorkerBusy(type, id, version)) {
-        if (currentTask.operation == OperationType::UNINSTALLING)
+    OperationType operation;
+    if (isWorkerBusy(type, id, version, &operation)) {
+        if (operation == OperationType::UNINSTALLING)
             return ERROR_APP_UNINSTALLING;
         else
             return ERROR_TOO_MANY_REQUESTS;
@@ -357,11 +486,27 @@ uint32_t Executor::GetProgress(const std::string& handle, std::uint32_t& progres
     if (isCurrentHandle(handle)) {
         progress = currentTask.progress;
         return ERROR_NONE;
+    } else if (findPendingTask(handle) != pendingTasks.end()) {
+        progress = 0;
+        return ERROR_NONE;
     } else {
         return ERROR_WRONG_PARAMS;
     }
 }
 
+uint32_t Executor::ListJobs(std::vector<JobInfo>& jobList)
+{
+    LockGuard lock(taskMutex);
+    jobList = jobs.list();
+    return ERROR_NONE;
+}
+
+uint32_t Executor::GetJob(const std::string& handle, JobInfo& job)
+{
+    LockGuard lock(taskMutex);
+    return jobs.find(handle, job) ? ERROR_NONE : ERROR_WRONG_HANDLE;
+}
+
 uint32_t Executor::GetStorageDetails(const std::string& type,
                            const std::string& id,
                            const std::string& version,
@@ -374,9 +519,15 @@ uint32_t Executor::GetStorageDetails(const std::string& type,
         if(type.empty() && id.empty() && version.empty()) {
             INFO("Calculating overall usage");
             details.appPath = config.getAppsPath();
-            details.appUsedKB = std::to_string((fs::getDirectorySpace(config.getAppsPath()) + fs::getDirectorySpace(config.getAppsTmpPath())) / 1024);
+            // tmp may be nested in apps path, the usage engine counts it only once
+            std::vector<std::string> appsRoots{config.getAppsTmpPath()};
+            for (const auto& volume : config.getVolumes()) {
+                appsRoots.push_back(volume.appsPath);
+            }
+            auto appsUsage = fs::getDirectoryUsage(appsRoots);
+            details.appUsedKB = std::to_string(appsUsage.allocatedBytes / 1024);
             details.persistentPath = config.getAppsStoragePath();
-            details.persistentUsedKB = std::to_string(fs::getDirectorySpace(config.getAppsStoragePath()) / 1024);
+            details.persistentUsedKB = std::to_string(fs::getDirectoryUsage({config.getAppsStoragePath()}).allocatedBytes / 1024);
         } else if (!id.empty()) {
             // When specific id is passed, calculate disk usage for this app.
             // Type is optional since id is unique and sufficient. But if passed, it must match.
@@ -389,22 +540,23 @@ uint32_t Executor::GetStorageDetails(const std::string& type,
                     // return error when app not found
                     return ERROR_WRONG_PARAMS;
                 }
-                unsigned long long appUsedKB{};
+                std::vector<std::string> absAppsPaths;
                 // In Stage 1 there will be only one entry here
+                auto appsRoot = getAppsPath(type, id, version);
                 for (const auto &i: appsPaths) {
-                    details.appPath = config.getAppsPath() + i;
-                    appUsedKB += fs::getDirectorySpace(details.appPath);
+                    details.appPath = appsRoot + i;
+                    absAppsPaths.push_back(details.appPath);
                 }
-                details.appUsedKB = std::to_string(appUsedKB / 1024);
+                details.appUsedKB = std::to_string(fs::getDirectoryUsage(absAppsPaths).allocatedBytes / 1024);
             }
             std::vector<std::string> dataPaths = dataBase->GetDataPaths(type, id);
-            unsigned long long persistentUsedKB{};
+            std::vector<std::string> absDataPaths;
             for(const auto& i: dataPaths)
             {
                 details.persistentPath = config.getAppsStoragePath() + i;
-                persistentUsedKB += fs::getDirectorySpace(details.persistentPath);
+                absDataPaths.push_back(details.persistentPath);
             }
-            details.persistentUsedKB = std::to_string(persistentUsedKB / 1024);
+            details.persistentUsedKB = std::to_string(fs::getDirectoryUsage(absDataPaths).allocatedBytes / 1024);
         } else {
             return ERROR_WRONG_PARAMS;
         }
@@ -422,6 +574,12 @@ uint32_t Executor::GetAppDetailsList(const std::string& type,
                           const std::string& category,
                           std::vector<DataStorage::AppDetails>& appsDetailsList) const
 {
+    auto snapshot = getCatalog();
+    if (snapshot) {
+        appsDetailsList = snapshot->getAppDetailsList(type, id, version, appName, category);
+        return ERROR_NONE;
+    }
+
     try {
         appsDetailsList = dataBase->GetAppDetailsListOuterJoin(type, id, version, appName, category);
     } catch (std::exception& error) {
@@ -431,19 +589,147 @@ uint32_t Executor::GetAppDetailsList(const std::string& type,
     return ERROR_NONE;
 }
 
+uint32_t Executor::GetAppDetailsPage(const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          const std::string& appName,
+                          const std::string& category,
+                          const std::string& sortBy,
+                          const std::string& sortOrder,
+                          const std::string& cursor,
+                          std::uint32_t limit,
+                          std::vector<DataStorage::AppDetails>& appsDetailsList,
+                          std::string& nextCursor) const
+{
+    DataStorage::SortKey sortKey;
+    if (sortBy.empty() || sortBy == "id") {
+        sortKey = DataStorage::SortKey::ID;
+    } else if (sortBy == "type") {
+        sortKey = DataStorage::SortKey::TYPE;
+    } else if (sortBy == "created") {
+        sortKey = DataStorage::SortKey::CREATED;
+    } else {
+        ERROR("Unknown sort key: ", sortBy);
+        return ERROR_WRONG_PARAMS;
+    }
+    if (!sortOrder.empty() && sortOrder != "asc" && sortOrder != "desc") {
+        ERROR("Unknown sort order: ", sortOrder);
+        return ERROR_WRONG_PARAMS;
+    }
+
+    try {
+        auto page = dataBase->GetAppDetailsPage(type, id, version, appName, category,
+                                                sortKey, sortOrder == "desc", cursor, limit);
+        appsDetailsList = std::move(page.apps);
+        nextCursor = std::move(page.nextCursor);
+    } catch (InvalidCursorError& error) {
+        ERROR("Invalid cursor: ", error.what());
+        return ERROR_WRONG_PARAMS;
+    } catch (std::exception& error) {
+        ERROR("Unable to get Applications details: ", error.what());
+        return Core::ERROR_GENERAL;
+    }
+    return ERROR_NONE;
+}
+
+uint32_t Executor::SearchApps(const std::string& query,
+                              std::vector<DataStorage::AppDetails>& appsDetailsList) const
+{
+    try {
+        appsDetailsList = dataBase->SearchApps(query);
+    } catch (std::exception& error) {
+        ERROR("Unable to search applications: ", error.what());
+        return Core::ERROR_GENERAL;
+    }
+    return ERROR_NONE;
+}
+
+uint32_t Executor::GetAppDetailsListByMetadata(const std::string& key,
+                                               const std::string& value,
+                                               std::vector<DataStorage::AppDetails>& appsDetailsList) const
+{
+    if (key.empty()) {
+        return ERROR_WRONG_PARAMS;
+    }
+
+    try {
+        appsDetailsList = dataBase->GetAppDetailsListByMetadata(key, value);
+    } catch (std::exception& error) {
+        ERROR("Unable to get Applications details: ", error.what());
+        return Core::ERROR_GENERAL;
+    }
+    return ERROR_NONE;
+}
+
 uint32_t Executor::Cancel(const std::string& handle)
 {
     INFO(" ");
     {
         LockGuard lock(taskMutex);
+        auto pending = findPendingTask(handle);
+        if (pending != pendingTasks.end()) {
+            // never started, nothing to wait for
+            OperationStatusEvent event{pending->handle, pending->operation, pending->type, pending->id,
+                                       pending->version, OperationStatus::CANCELLED, ""};
+            pendingTasks.erase(pending);
+            jobs.finish(handle, JobState::CANCELLED, "");
+            journal.finish(handle);
+            operationStatusCallback(event);
+            return ERROR_NONE;
+        }
         if (!isCurrentHandle(handle)
             || (currentTask.progress >= stageBase[enumToInt(OperationStage::EXTRACTING)])) {
             return ERROR_WRONG_PARAMS;
         } else {
+            // an explicit cancel wins over a preemption still in progress
+            currentTask.preempted = false;
             currentTask.cancelled.store(true);
+            pauseCondition.notify_all();
         }
     }
     worker.join();
+
+    // the cancelled worker is not detached, the next queued task is started once it is joined
+    LockGuard lock(taskMutex);
+    startPendingTask();
+    return ERROR_NONE;
+}
+
+uint32_t Executor::Pause(const std::string& handle)
+{
+    INFO(" ");
+    LockGuard lock(taskMutex);
+    // nothing can be suspended once the database is being updated
+    if (!isCurrentHandle(handle) || currentTask.operation != OperationType::INSTALLING
+        || (currentTask.progress >= stageBase[enumToInt(OperationStage::UPDATING_DATABASE)])) {
+        return ERROR_WRONG_PARAMS;
+    }
+    if (!currentTask.paused.load()) {
+        currentTask.paused.store(true);
+        jobs.pause(handle);
+        INFO(currentTask, " paused");
+    }
+    return ERROR_NONE;
+}
+
+uint32_t Executor::Resume(const std::string& handle)
+{
+    INFO(" ");
+    LockGuard lock(taskMutex);
+    // preempted while paused, it is waiting in the queue
+    auto pending = findPendingTask(handle);
+    if (pending != pendingTasks.end() && pending->paused) {
+        pending->paused = false;
+        INFO("task[", handle, "] resumed in the queue");
+        return ERROR_NONE;
+    }
+    if (!isCurrentHandle(handle) || !currentTask.paused.load()) {
+        return ERROR_WRONG_PARAMS;
+    }
+    currentTask.paused.store(false);
+    jobs.resume(handle);
+    pauseCondition.notify_all();
+    INFO(currentTask, " resumed");
     return ERROR_NONE;
 }
 
@@ -468,6 +754,31 @@ uint32_t Executor::SetMetadata(const std::string& type,
         ERROR("Unable to set metadata: ", error.what());
         return Core::ERROR_GENERAL;
     }
+    refreshMetadata(type, id, version);
+    return ERROR_NONE;
+}
+
+uint32_t Executor::SetMetadataBatch(const std::string& type,
+                         const std::string& id,
+                         const std::string& version,
+                         const std::vector<std::pair<std::string, std::string> >& metadata)
+{
+    if (type.empty() || id.empty() || version.empty()) {
+        return ERROR_WRONG_PARAMS;
+    }
+    for (const auto& keyValue : metadata) {
+        if (keyValue.first.empty()) {
+            return ERROR_WRONG_PARAMS;
+        }
+    }
+
+    try {
+        dataBase->SetMetadataBatch(type, id, version, metadata);
+    } catch (std::exception& error) {
+        ERROR("Unable to set metadata: ", error.what());
+        return Core::ERROR_GENERAL;
+    }
+    refreshMetadata(type, id, version);
     return ERROR_NONE;
 }
 
@@ -486,6 +797,7 @@ uint32_t Executor::ClearMetadata(const std::string& type,
         ERROR("Unable to clear metadata: ", error.what());
         return Core::ERROR_GENERAL;
     }
+    refreshMetadata(type, id, version);
     return ERROR_NONE;
 }
 
@@ -493,11 +805,43 @@ uint32_t Executor::GetMetadata(const std::string& type,
                          const std::string& id,
                          const std::string& version,
                          DataStorage::AppMetadata& metadata) const
+{
+    return readMetadata(getCatalog().get(), type, id, version, metadata);
+}
+
+uint32_t Executor::GetMetadataBatch(const std::vector<BatchItem>& items, std::vector<BatchResult>& results) const
+{
+    results.clear();
+    results.reserve(items.size());
+
+    // one snapshot for the whole batch, all items see the same catalog
+    auto snapshot = getCatalog();
+    for (const auto& item : items) {
+        BatchResult result;
+        result.code = readMetadata(snapshot.get(), item.type, item.id, item.version, result.metadata);
+        results.push_back(std::move(result));
+    }
+    return ERROR_NONE;
+}
+
+uint32_t Executor::readMetadata(const AppCatalog* snapshot,
+                                const std::string& type,
+                                const std::string& id,
+                                const std::string& version,
+                                DataStorage::AppMetadata& metadata) const
 {
     if (type.empty() || id.empty() || version.empty()) {
         return ERROR_WRONG_PARAMS;
     }
 
+    if (snapshot) {
+        if (!snapshot->getMetadata(type, id, version, metadata)) {
+            ERROR("Unable to get metadata: ", type, " ", id, " ", version, " not installed");
+            return Core::ERROR_GENERAL;
+        }
+        return ERROR_NONE;
+    }
+
     try {
         metadata = dataBase->GetMetadata(type, id, version);
     } catch (std::exception& error) {
@@ -507,6 +851,35 @@ uint32_t Executor::GetMetadata(const std::string& type,
     return ERROR_NONE;
 }
 
+uint32_t Executor::GetChanges(std::uint64_t sinceGeneration, DataStorage::ChangeSet& changes) const
+{
+    try {
+        changes = dataBase->GetChanges(sinceGeneration);
+    } catch (std::exception& error) {
+        ERROR("Unable to get changes: ", error.what());
+        return Core::ERROR_GENERAL;
+    }
+    return ERROR_NONE;
+}
+
+uint32_t Executor::RepairPermissions()
+{
+    INFO(" ");
+
+    LockGuard lock(taskMutex);
+    if (isWorkerBusy()) {
+        return ERROR_TOO_MANY_REQUESTS;
+    }
+
+    try {
+        doRepairPermissions();
+    } catch (std::exception& error) {
+        ERROR("Unable to repair permissions: ", error.what());
+        return Core::ERROR_GENERAL;
+    }
+    return ERROR_NONE;
+}
+
 void Executor::handleDirectories()
 {
 #if LISA_APPS_GID
@@ -521,13 +894,91 @@ void Executor::handleDirectories()
 #endif
     Filesystem::removeAllDirectoriesExcept(config.getAppsPath(), Filesystem::LISA_EPOCH);
     Filesystem::removeAllDirectoriesExcept(config.getAppsStoragePath(), Filesystem::LISA_EPOCH);
+
+    // secondary volumes are used only when mounted, their root is never created and
+    // only LISA's own directory below it is cleaned
+    for (const auto* volume : getAvailableVolumes()) {
+        if (volume->appsPath == config.getAppsPath()) {
+            continue;
+        }
+#if LISA_APPS_GID
+        Filesystem::createDirectory(volume->appsPath + Filesystem::LISA_EPOCH, LISA_APPS_GID, false);
+#else
+        Filesystem::createDirectory(volume->appsPath + Filesystem::LISA_EPOCH);
+#endif
+        Filesystem::removeAllDirectoriesExcept(volume->appsPath, Filesystem::LISA_EPOCH);
+    }
 }
 
-void Executor::initializeDataBase(const std::string& dbPath)
+std::vector<const Config::StorageVolume*> Executor::getAvailableVolumes() const
+{
+    std::vector<const Config::StorageVolume*> result;
+    for (const auto& volume : config.getVolumes()) {
+        if (Filesystem::directoryExists(volume.mountPath)) {
+            result.push_back(&volume);
+        } else {
+            INFO("volume ", volume.name, " not available at ", volume.mountPath);
+        }
+    }
+    return result;
+}
+
+const Config::StorageVolume& Executor::selectVolume(unsigned long long requiredBytes) const
+{
+    const Config::StorageVolume* selected{nullptr};
+    unsigned long long selectedFreeSpace{};
+
+    for (const auto* volume : getAvailableVolumes()) {
+        auto freeSpace = Filesystem::getFreeSpace(volume->mountPath);
+        INFO("volume ", volume->name, " free: ", freeSpace / 1024, " Kb, reserve: ", volume->reserveBytes / 1024, " Kb");
+        if (freeSpace < volume->reserveBytes || freeSpace - volume->reserveBytes < requiredBytes) {
+            continue;
+        }
+        auto usableSpace = freeSpace - volume->reserveBytes;
+
+        bool better{!selected};
+        if (selected) {
+            if (config.getPlacementPolicy() == Config::PlacementPolicy::PREFER_FAST && volume->speed != selected->speed) {
+                better = (volume->speed == Config::SpeedClass::FAST);
+            } else {
+                better = (usableSpace > selectedFreeSpace);
+            }
+        }
+        if (better) {
+            selected = volume;
+            selectedFreeSpace = usableSpace;
+        }
+    }
+
+    if (!selected) {
+        std::string message = std::string{} + "not enough space on any storage volume (required: "
+                + std::to_string(requiredBytes / 1024) + " Kb)";
+        throw std::runtime_error(message);
+    }
+    INFO("selected volume ", selected->name);
+    return *selected;
+}
+
+std::string Executor::getAppsPath(const std::string& type, const std::string& id, const std::string& version) const
+{
+    auto volumeName = dataBase->GetAppVolume(type, id, version);
+    auto volume = config.getVolume(volumeName);
+    if (!volume) {
+        throw std::runtime_error(std::string{} + "unknown storage volume '" + volumeName + "'");
+    }
+    return volume->appsPath;
+}
+
+void Executor::initializeDataBase(const std::string& dbPath)
 {
     std::string path = dbPath + Filesystem::LISA_EPOCH + '/';
     Filesystem::ScopedDir dbDir(path);
-    dataBase = std::make_unique<LISA::SqlDataStorage>(path);
+    if (config.getStorageBackend() == Config::StorageBackend::KV) {
+        dataBase = std::make_unique<LISA::KvDataStorage>(path, config.getSearchMetadataKeys(), config.getChangeLogSize());
+    } else {
+        dataBase = std::make_unique<LISA::SqlDataStorage>(path, config.getDatabaseMmapSize(), config.getSearchMetadataKeys(),
+                                                          config.getChangeLogSize(), config.getDatabaseReadConnections());
+    }
     dataBase->Initialize();
     dbDir.commit();
     INFO("Database created");
@@ -535,16 +986,345 @@ void Executor::initializeDataBase(const std::string& dbPath)
 
 bool Executor::isWorkerBusy() const
 {
-    return ! currentTask.handle.empty();
+    return ! currentTask.handle.empty() || ! pendingTasks.empty();
+}
+
+bool Executor::admits(Priority priority) const
+{
+    return !isWorkerBusy() || (!currentTask.handle.empty() && priority < currentTask.priority);
 }
 
 bool Executor::isWorkerBusy(const std::string& type,
                             const std::string& id,
-                            const std::string& version) const
+                            const std::string& version,
+                            OperationType* operation) const
 {
     if (!isWorkerBusy())
         return false;
-    return currentTask.type == type && currentTask.id == id && currentTask.version == version;
+    if (!currentTask.handle.empty()
+        && currentTask.type == type && currentTask.id == id && currentTask.version == version) {
+        if (operation) {
+            *operation = currentTask.operation;
+        }
+        return true;
+    }
+    for (const auto& pending : pendingTasks) {
+        if (pending.type == type && pending.id == id && pending.version == version) {
+            if (operation) {
+                *operation = pending.operation;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t Executor::checkInstallable(const std::string& type,
+                                    const std::string& id,
+                                    const std::string& version,
+                                    std::string& handle)
+{
+    if (isAppInstalled(type, id, version)) {
+        handle = "AlreadyInstalled";
+        return ERROR_ALREADY_INSTALLED;
+    }
+
+    auto snapshot = getCatalog();
+    if (snapshot) {
+        auto appType = snapshot->getTypeOfApp(id);
+        if (!appType.empty() && appType != type) {
+            ERROR("In the DB id '", id, "' is already used with another type! App id must be unique.");
+            handle = "WrongParams";
+            return ERROR_WRONG_PARAMS;
+        }
+    } else {
+        try {
+            if (dataBase->GetTypeOfApp(id) != type) {
+                ERROR("In the DB id '", id, "' is already used with another type! App id must be unique.");
+                handle = "WrongParams";
+                return ERROR_WRONG_PARAMS;
+            }
+        } catch (const SqlDataStorageError&) {
+            // fine, no problem, not a single version of app(id) installed yet
+        }
+    }
+    return ERROR_NONE;
+}
+
+uint32_t Executor::checkUninstallable(const std::string& type,
+                                      const std::string& id,
+                                      const std::string& version,
+                                      const std::string& uninstallType,
+                                      std::string& handle)
+{
+    // TODO what are param requirements?
+    if (uninstallType != "full" && uninstallType != "upgrade") {
+        handle = "WrongParams";
+        return ERROR_WRONG_PARAMS;
+    }
+
+    // If an app was uninstalled earlier with uninstallType=upgrade, then the
+    // app record will still be inside the database. Also the data storage dir will
+    // still exist. Allow the uninstallation of these artifacts with "if test" below.
+    // Second "if test" is the uninstallation of the usual case: uninstalling an app
+    // of specific version.
+    if (version.empty() && !type.empty() && !id.empty() && uninstallType == "full") {
+        // verify that such an app record exists
+        if (dataBase->GetDataPaths(type, id).size() == 0) {
+            return ERROR_WRONG_PARAMS;
+        }
+        // only allowed when no specific version of app installed anymore
+        // if there are: the usual uninstall with a specific version should be called
+        if (dataBase->GetAppsPaths(type, id, "").size() > 0) {
+            return ERROR_WRONG_PARAMS;
+        }
+    } else if (!isAppInstalled(type, id, version)) {
+        handle = "WrongParams";
+        return ERROR_WRONG_PARAMS;
+    } else if (dataBase->GetRefCount(type, id, version) > 0) {
+        ERROR(id, " ", version, " is a dependency of installed apps");
+        handle = "AppInUse";
+        return ERROR_APP_LOCKED;
+    }
+    return ERROR_NONE;
+}
+
+std::string Executor::startTask(OperationType operation,
+                                const std::string& type,
+                                const std::string& id,
+                                const std::string& version,
+                                Priority priority,
+                                std::function<void()> task,
+                                const std::string& handle,
+                                bool paused)
+{
+    currentTask.handle = handle.empty() ? generateHandle() : handle;
+    currentTask.paused.store(paused);
+    currentTask.operation = operation;
+    currentTask.priority = priority;
+    currentTask.type = type;
+    currentTask.id = id;
+    currentTask.version = version;
+
+    // the first stage has no progress report of its own
+    const char* firstStage = operation == OperationType::INSTALLING ? "DOWNLOADING"
+                           : operation == OperationType::MOVING ? "COPYING" : "REMOVING";
+    jobs.start(currentTask.handle, OperationStatusEvent::operationStr(operation), type, id, version, firstStage);
+    journal.start(currentTask.handle, firstStage);
+    if (paused) {
+        jobs.pause(currentTask.handle);
+    }
+
+    executeTask(std::move(task));
+    return currentTask.handle;
+}
+
+std::string Executor::scheduleTask(OperationType operation,
+                                   const std::string& type,
+                                   const std::string& id,
+                                   const std::string& version,
+                                   Priority priority,
+                                   const std::vector<std::string>& arguments)
+{
+    auto handle = generateHandle();
+    JobJournal::Job job;
+    job.handle = handle;
+    job.operation = OperationStatusEvent::operationStr(operation);
+    job.type = type;
+    job.id = id;
+    job.version = version;
+    job.priority = enumToInt(priority);
+    job.arguments = arguments;
+    journal.queue(job);
+
+    auto task = makeTask(operation, type, id, version, arguments);
+    if (!isWorkerBusy()) {
+        return startTask(operation, type, id, version, priority, std::move(task), handle);
+    }
+
+    PendingTask pending{handle, type, id, version, operation, priority, std::move(task)};
+    jobs.queue(handle, OperationStatusEvent::operationStr(operation), type, id, version);
+    queueTask(std::move(pending), false);
+    if (!currentTask.handle.empty() && priority < currentTask.priority) {
+        preemptCurrentTask();
+    }
+    return handle;
+}
+
+void Executor::queueTask(PendingTask pending, bool aheadOfEqual)
+{
+    auto position = std::find_if(pendingTasks.begin(), pendingTasks.end(), [&](const PendingTask& queued) {
+        return aheadOfEqual ? queued.priority >= pending.priority : queued.priority > pending.priority;
+    });
+    INFO("task[", pending.handle, "] queued behind ", std::distance(pendingTasks.begin(), position), " others");
+    pendingTasks.insert(position, std::move(pending));
+}
+
+void Executor::preemptCurrentTask()
+{
+    // only a download can be stopped safely, anything else runs to its end first
+    if (currentTask.preempted || currentTask.cancelled.load() || currentTask.operation != OperationType::INSTALLING
+        || (currentTask.progress >= stageBase[enumToInt(OperationStage::EXTRACTING)])) {
+        return;
+    }
+    INFO(currentTask, " preempted");
+    currentTask.preempted = true;
+    currentTask.cancelled.store(true);
+    pauseCondition.notify_all();
+}
+
+void Executor::startPendingTask()
+{
+    if (!currentTask.handle.empty() || pendingTasks.empty()) {
+        return;
+    }
+
+    auto next = std::move(pendingTasks.front());
+    pendingTasks.pop_front();
+    startTask(next.operation, next.type, next.id, next.version, next.priority, std::move(next.task), next.handle,
+              next.paused);
+    INFO(currentTask, " started from the queue");
+}
+
+std::function<void()> Executor::makeTask(OperationType operation,
+                                         const std::string& type,
+                                         const std::string& id,
+                                         const std::string& version,
+                                         const std::vector<std::string>& arguments)
+{
+    switch (operation) {
+        case OperationType::INSTALLING: {
+            auto url = arguments.at(0);
+            auto appName = arguments.at(1);
+            auto category = arguments.at(2);
+            return [=] {
+                INFO("executing doInstall");
+                doInstall(type, id, version, url, appName, category);
+            };
+        }
+        case OperationType::UNINSTALLING: {
+            auto uninstallType = arguments.at(0);
+            return [=] {
+                INFO("executing doUninstall");
+                doUninstall(type, id, version, uninstallType);
+            };
+        }
+        case OperationType::MOVING: {
+            auto volume = arguments.at(0);
+            return [=] {
+                INFO("executing doMove");
+                doMove(type, id, version, volume);
+            };
+        }
+    }
+    throw std::invalid_argument("unknown operation");
+}
+
+void Executor::journalDirectory(const std::string& path)
+{
+    LockGuard lock{taskMutex};
+    journal.addPath(currentTask.handle, path);
+}
+
+void Executor::recoverJobs()
+{
+    LockGuard lock(taskMutex);
+    // recovering a job writes to the journal
+    const auto pending = journal.pending();
+    for (auto job : pending) {
+        INFO("recovering job ", job.handle, ": ", job.operation, " ", job.id, ":", job.version,
+             (job.stage.empty() ? " not started" : " in stage " + job.stage));
+        jobs.queue(job.handle, job.operation, job.type, job.id, job.version);
+
+        OperationType operation{};
+        JobState state = JobState::SUCCEEDED;
+        std::string details;
+        try {
+            const std::array<OperationType, 3> operations = {{OperationType::INSTALLING, OperationType::UNINSTALLING,
+                                                               OperationType::MOVING}};
+            auto found = std::find_if(operations.begin(), operations.end(), [&job](OperationType candidate) {
+                return OperationStatusEvent::operationStr(candidate) == job.operation;
+            });
+            if (found == operations.end()) {
+                throw std::runtime_error("unknown operation " + job.operation);
+            }
+            operation = *found;
+
+            // whatever the job did is either complete or undone here, so it can run again from the start
+            bool rerun = job.stage.empty();
+            if (rerun) {
+                // never started
+            } else if (operation == OperationType::INSTALLING) {
+                // the database is updated last and in one write: a registered app is complete, an app
+                // not registered has no rows of its own or of its dependencies, only directories to remove
+                rerun = !dataBase->IsAppInstalled(job.type, job.id, job.version);
+            } else if (operation == OperationType::UNINSTALLING) {
+                // the database is updated first, the rest is finished here
+                rerun = !job.version.empty() && dataBase->IsAppInstalled(job.type, job.id, job.version);
+                if (!rerun) {
+                    if (!job.version.empty()) {
+                        for (const auto* volume : getAvailableVolumes()) {
+                            Filesystem::removeDirectory(volume->appsPath + Filesystem::createAppPath(job.id, job.version));
+                        }
+                        releaseDependencies(dataBase->GetAppDetailsList("", "", "", "", DEPENDENCY_CATEGORY));
+                    }
+                    if (job.arguments.at(0) == "full" && dataBase->GetAppsPaths(job.type, job.id, "").empty()) {
+                        if (dataBase->IsAppData(job.type, job.id)) {
+                            dataBase->RemoveAppData(job.type, job.id);
+                        }
+                        Filesystem::removeDirectory(config.getAppsStoragePath() + Filesystem::createAppPath(job.id));
+                    }
+                }
+            } else {
+                // the copy is complete once the database points at it, only the source is left to remove
+                const auto* target = config.getVolume(job.arguments.at(0));
+                if (!target) {
+                    throw std::runtime_error("volume " + job.arguments.at(0) + " not configured");
+                }
+                rerun = config.getVolume(dataBase->GetAppVolume(job.type, job.id, job.version)) != target;
+                if (!rerun) {
+                    for (const auto* volume : getAvailableVolumes()) {
+                        if (volume != target) {
+                            Filesystem::removeDirectory(volume->appsPath + Filesystem::createAppPath(job.id, job.version));
+                        }
+                    }
+                }
+            }
+
+            if (rerun) {
+                if (!job.stage.empty()) {
+                    for (auto path = job.paths.rbegin(); path != job.paths.rend(); ++path) {
+                        INFO("rolling back ", *path);
+                        Filesystem::removeDirectory(*path);
+                    }
+                    if (++job.recoveries > MAX_JOB_RECOVERIES) {
+                        throw std::runtime_error("interrupted by a restart " + std::to_string(job.recoveries) + " times");
+                    }
+                }
+                auto task = makeTask(operation, job.type, job.id, job.version, job.arguments);
+                journal.queue(job);
+                queueTask({job.handle, job.type, job.id, job.version, operation,
+                           static_cast<Priority>(job.priority), std::move(task)}, false);
+                continue;
+            }
+            INFO("job ", job.handle, " completed before the restart");
+        } catch (const std::exception& error) {
+            ERROR("job ", job.handle, " cannot be recovered: ", error.what());
+            state = JobState::FAILED;
+            details = error.what();
+        }
+
+        // nobody can be subscribed yet while configuring, the outcome is kept in the job history only
+        journal.finish(job.handle);
+        jobs.finish(job.handle, state, details);
+    }
+}
+
+std::deque<Executor::PendingTask>::iterator Executor::findPendingTask(const std::string& handle)
+{
+    return std::find_if(pendingTasks.begin(), pendingTasks.end(), [&handle](const PendingTask& pending) {
+        return pending.handle == handle;
+    });
 }
 
 void Executor::executeTask(std::function<void()> task)
@@ -564,6 +1344,7 @@ void Executor::taskRunner(std::function<void()> task)
     OperationStatusEvent event;
     event.status = OperationStatus::SUCCESS;
     std::string details;
+    auto interrupted{false};
 
     try {
         task();
@@ -572,6 +1353,7 @@ void Executor::taskRunner(std::function<void()> task)
     }
     catch(CancelledException& exc){
         // nothing to do, cancelled flag already set
+        interrupted = true;
     }
     catch(std::exception& exc){
         ERROR("exception running ", task, ": ", exc.what());
@@ -579,7 +1361,11 @@ void Executor::taskRunner(std::function<void()> task)
         event.details = exc.what();
     }
 
+    // published before the worker is released so the next request sees the outcome
+    refreshCatalog();
+
     auto cancelled{false};
+    auto requeued{false};
     {
         LockGuard lock(taskMutex);
         event.handle = currentTask.handle;
@@ -588,24 +1374,83 @@ void Executor::taskRunner(std::function<void()> task)
         event.version = currentTask.version;
         event.operation = currentTask.operation;
 
-        cancelled = currentTask.cancelled.load();
+        // a preempted worker is not joined by anybody
+        cancelled = currentTask.cancelled.load() && !currentTask.preempted;
         if (! cancelled){
             worker.detach();
         } else {
             event.status = OperationStatus::CANCELLED;
         }
+        requeued = currentTask.preempted && interrupted;
+        if (requeued) {
+            // started from scratch again once the more urgent tasks are done
+            jobs.requeue(event.handle);
+            queueTask({event.handle, event.type, event.id, event.version, event.operation,
+                       currentTask.priority, task, currentTask.paused.load()}, true);
+        } else {
+            journal.finish(event.handle);
+            jobs.finish(event.handle,
+                        event.status == OperationStatus::SUCCESS ? JobState::SUCCEEDED
+                        : event.status == OperationStatus::CANCELLED ? JobState::CANCELLED : JobState::FAILED,
+                        event.details);
+        }
         currentTask.reset();
     }
 
-    INFO("scheduled ", currentTask, (cancelled ? " cancelled" : " done"));
+    INFO("scheduled ", currentTask, (cancelled ? " cancelled" : requeued ? " preempted" : " done"));
+
+    // the outcome goes out before anything of the next task does
+    if (!requeued) {
+        operationStatusCallback(event);
+    }
+
+    // a cancelled worker is being joined by Cancel, which starts the next one itself
+    if (! cancelled) {
+        LockGuard lock(taskMutex);
+        startPendingTask();
+    }
+}
+
+std::shared_ptr<const AppCatalog> Executor::getCatalog() const
+{
+    return std::atomic_load(&catalog);
+}
 
-    operationStatusCallback(event);
+void Executor::refreshCatalog()
+{
+    // builds are serialized so an older catalog never replaces a newer one
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    std::shared_ptr<const AppCatalog> snapshot;
+    try {
+        snapshot = AppCatalog::build(*dataBase);
+    } catch (std::exception& error) {
+        ERROR("Unable to build the catalog, reading from the database: ", error.what());
+    }
+    std::atomic_store(&catalog, snapshot);
+}
+
+void Executor::refreshMetadata(const std::string& type, const std::string& id, const std::string& version)
+{
+    std::lock_guard<std::mutex> lock(catalogMutex);
+    auto current = std::atomic_load(&catalog);
+    std::shared_ptr<const AppCatalog> snapshot;
+    try {
+        snapshot = current ? current->withMetadata(*dataBase, type, id, version) : AppCatalog::build(*dataBase);
+    } catch (std::exception& error) {
+        ERROR("Unable to update the catalog, reading from the database: ", error.what());
+    }
+    std::atomic_store(&catalog, snapshot);
 }
 
 bool Executor::isAppInstalled(const std::string& type,
                               const std::string& id,
                               const std::string& version)
 {
+    auto snapshot = getCatalog();
+    if (snapshot) {
+        return snapshot->isAppInstalled(type, id, version);
+    }
+
     auto appInstalled{false};
     try {
         appInstalled = dataBase->IsAppInstalled(type, id, version);
@@ -644,17 +1489,21 @@ void Executor::importAnnotations(const std::string& type,
 
         if (pt.count("annotations") > 0) {
             std::regex pattern(config.getAnnotationsRegex());
+            std::vector<std::pair<std::string, std::string> > metadata;
             for (const auto &kvp: pt.get_child("annotations")) {
                 auto& key = kvp.first;
                 auto& value = kvp.second.data();
 
                 if (std::regex_search(key, pattern)) {
                     INFO("Importing ", key, " = ", value, " as metadata");
-                    try {
-                        dataBase->SetMetadata(type, id, version, key, value);
-                    } catch (std::exception &error) {
-                        ERROR("Unable to save metadata: ", error.what());
-                    }
+                    metadata.emplace_back(key, value);
+                }
+            }
+            if (!metadata.empty()) {
+                try {
+                    dataBase->SetMetadataBatch(type, id, version, metadata);
+                } catch (std::exception &error) {
+                    ERROR("Unable to save metadata: ", error.what());
                 }
             }
         }
@@ -702,32 +1551,124 @@ void Executor::doInstall(std::string type,
         throw std::runtime_error(message);
     }
 
+    // unpacked size is not known upfront, download size is the best estimate
+    const auto* volume = &selectVolume(downloadSize);
+
     auto tmpFilePath = tmpDirPath + extractFilename(url);
 
     downloader.get(tmpFilePath);
 
-    const std::string appsPath = config.getAppsPath() + appSubPath;
+    // an image manifest instead of a tarball: the app is assembled from layers stored once per volume
+    std::unique_ptr<Image::Manifest> manifest;
+    if (Image::isManifest(tmpFilePath)) {
+        manifest = std::make_unique<Image::Manifest>(Image::readManifest(tmpFilePath));
+        // layers already on the volume are not needed, but which volume has them is not known yet
+        volume = &selectVolume(manifest->size());
+    }
+
+    const std::string appsPath = volume->appsPath + appSubPath;
     INFO("creating ", appsPath);
+    journalDirectory(appsPath);
+#if LISA_APPS_GID
+    Filesystem::ScopedDir scopedAppDir{appsPath, LISA_APPS_GID, false};
+#else
     Filesystem::ScopedDir scopedAppDir{appsPath};
+#endif
 
     setProgress(0, OperationStage::EXTRACTING);
-    INFO("unpacking ", tmpFilePath, "to ", appsPath);
-    Archive::unpack(tmpFilePath, appsPath);
+    std::vector<std::unique_ptr<Filesystem::ScopedDir> > layerDirs;
+    std::vector<std::string> layers;
+    if (manifest) {
+        layerDirs = fetchLayers(url, *manifest, *volume);
+        for (const auto& layer : manifest->layers) {
+            waitWhilePaused();
+            INFO("merging layer ", layer.digest, " into ", appsPath);
+            Image::mergeLayer(volume->appsPath + Image::createLayerPath(layer.digest), appsPath);
+            layers.push_back(layer.digest);
+        }
+    } else {
+        INFO("unpacking ", tmpFilePath, "to ", appsPath);
+#if LISA_APPS_GID
+        Archive::unpack(tmpFilePath, appsPath, LISA_APPS_GID, false, [this] { waitWhilePaused(); });
+#else
+        Archive::unpack(tmpFilePath, appsPath, [this] { waitWhilePaused(); });
+#endif
+    }
+
+    // shared packages are declared in the annotations file packed with the app
+    std::vector<Package> dependencies;
+    std::vector<FetchedPackage> packages;
+    if (!config.getAnnotationsFile().empty()) {
+        dependencies = readDependencies(appsPath + config.getAnnotationsFile());
+        if (!dependencies.empty()) {
+            packages = fetchDependencies(Package{type, id, version, url}, dependencies);
+        }
+    }
 
     auto appStorageSubPath = Filesystem::createAppPath(id);
     auto appStoragePath = config.getAppsStoragePath() + appStorageSubPath;
 
     INFO("creating storage ", appStoragePath);
+    // the storage of installed versions is never rolled back
+    if (!Filesystem::directoryExists(appStoragePath)) {
+        journalDirectory(appStoragePath);
+    }
+#if LISA_DATA_GID
+    Filesystem::ScopedDir scopedAppStorageDir{appStoragePath, LISA_DATA_GID, true};
+#else
     Filesystem::ScopedDir scopedAppStorageDir{appStoragePath};
+#endif
 
     setProgress(0, OperationStage::UPDATING_DATABASE);
-    dataBase->AddInstalledApp(type, id, version, url, appName, category, appSubPath, appStorageSubPath);
+    auto toDetails = [](const Package& package) {
+        DataStorage::AppDetails details;
+        details.type = package.type;
+        details.id = package.id;
+        details.version = package.version;
+        details.url = package.url;
+        return details;
+    };
+    // one write, a crash leaves either all of it or nothing registered
+    std::vector<DataStorage::Installation> installations;
+    for (const auto& fetched : packages) {
+        DataStorage::Installation installation;
+        installation.app = toDetails(fetched.package);
+        installation.app.appName = fetched.package.id;
+        installation.app.category = DEPENDENCY_CATEGORY;
+        installation.appPath = Filesystem::createAppPath(fetched.package.id, fetched.package.version);
+        installation.appStoragePath = Filesystem::createAppPath(fetched.package.id);
+        installation.volume = fetched.volume;
+        std::transform(fetched.dependencies.begin(), fetched.dependencies.end(),
+                       std::back_inserter(installation.dependencies), toDetails);
+        installations.push_back(std::move(installation));
+    }
+    DataStorage::Installation installation;
+    installation.app = toDetails(Package{type, id, version, url});
+    installation.app.appName = appName;
+    installation.app.category = category;
+    installation.appPath = appSubPath;
+    installation.appStoragePath = appStorageSubPath;
+    installation.volume = volume->name;
+    std::transform(dependencies.begin(), dependencies.end(), std::back_inserter(installation.dependencies), toDetails);
+    installation.layers = layers;
+    installations.push_back(std::move(installation));
+    dataBase->AddInstalledApps(installations);
 
     // everything went fine, mark app directories to not be removed
+    for (auto& layerDir : layerDirs) {
+        layerDir->commit();
+    }
+    for (auto& fetched : packages) {
+        fetched.appDir->commit();
+        fetched.storageDir->commit();
+    }
     scopedAppDir.commit();
     scopedAppStorageDir.commit();
 
     // auto-import annotations as metadata
+    for (const auto& fetched : packages) {
+        importAnnotations(fetched.package.type, fetched.package.id, fetched.package.version, fetched.appPath);
+    }
     importAnnotations(type, id, version, appsPath);
 
     setProgress(0, OperationStage::FINISHED);
@@ -742,13 +1683,25 @@ void Executor::doUninstall(std::string type, std::string id, std::string version
     INFO("type=", type, " id=", id, " version=", version, " uninstallType=", uninstallType);
 
     if (!version.empty()) {
+        auto appsRoot = getAppsPath(type, id, version);
+        auto dependencies = dataBase->GetDependencies(type, id, version);
+        auto layers = dataBase->GetAppLayers(type, id, version);
         dataBase->RemoveInstalledApp(type, id, version);
 
         auto appSubPath = Filesystem::createAppPath(id, version);
-        auto appPath = config.getAppsPath() + appSubPath;
+        auto appPath = appsRoot + appSubPath;
 
         INFO("removing ", appPath);
         Filesystem::removeDirectory(appPath);
+
+        for (const auto& digest : std::set<std::string>(layers.begin(), layers.end())) {
+            if (dataBase->GetLayerRefCount(digest) == 0) {
+                INFO("removing unused layer ", digest);
+                Filesystem::removeDirectory(appsRoot + Image::createLayerPath(digest));
+            }
+        }
+
+        releaseDependencies(dependencies);
     }
 
     if (uninstallType == "full") {
@@ -766,6 +1719,239 @@ void Executor::doUninstall(std::string type, std::string id, std::string version
     INFO("finished");
 }
 
+std::vector<Executor::FetchedPackage> Executor::fetchDependencies(const Package& app, const std::vector<Package>& dependencies)
+{
+    DependencyGraph graph;
+    graph.add(app);
+    graph.setDependencies(app, dependencies);
+    std::vector<FetchedPackage> fetched;
+
+    auto level = dependencies;
+    while (!level.empty()) {
+        std::vector<Package> fetching, next;
+        for (const auto& package : level) {
+            if (graph.contains(package) || isAppInstalled(package.type, package.id, package.version)) {
+                continue;
+            }
+            // versions of one id share its directories, they are not created side by side
+            auto sameId = std::find_if(fetching.begin(), fetching.end(), [&package](const Package& other) {
+                return other.id == package.id;
+            });
+            if (sameId != fetching.end()) {
+                next.push_back(package);
+                continue;
+            }
+            std::string reason;
+            if (checkInstallable(package.type, package.id, package.version, reason) != ERROR_NONE) {
+                throw DependencyError("dependency " + package.id + " " + package.version + " cannot be installed: " + reason);
+            }
+            graph.add(package);
+            fetching.push_back(package);
+        }
+
+        INFO("fetching ", fetching.size(), " dependencies of ", app.id);
+        std::vector<std::future<FetchedPackage> > futures;
+        for (const auto& package : fetching) {
+            futures.push_back(std::async(std::launch::async, &Executor::fetchPackage, this, package));
+        }
+        for (auto& package : collectAll(futures)) {
+            graph.setDependencies(package.package, package.dependencies);
+            next.insert(next.end(), package.dependencies.begin(), package.dependencies.end());
+            fetched.push_back(std::move(package));
+        }
+        level = std::move(next);
+    }
+
+    std::vector<FetchedPackage> ordered;
+    for (const auto& package : graph.order()) {
+        auto found = std::find_if(fetched.begin(), fetched.end(), [&package](const FetchedPackage& candidate) {
+            return candidate.package.type == package.type && candidate.package.id == package.id
+                   && candidate.package.version == package.version;
+        });
+        if (found != fetched.end()) {
+            ordered.push_back(std::move(*found));
+        }
+    }
+    return ordered;
+}
+
+Executor::FetchedPackage Executor::fetchPackage(const Package& package)
+{
+    INFO("fetching ", package.id, " ", package.version, " from ", package.url);
+
+    auto appSubPath = Filesystem::createAppPath(package.id, package.version);
+    auto tmpDirPath = config.getAppsTmpPath() + appSubPath;
+    Filesystem::ScopedDir scopedTmpDir{tmpDirPath};
+
+    FetchListener listener{*this};
+    Downloader downloader{package.url, listener, config};
+
+    auto downloadSize = downloader.getContentLength();
+    if (downloadSize == 0) {
+        throw std::runtime_error("download size of " + package.id + " unknown or could not be determined");
+    }
+    const auto& volume = selectVolume(downloadSize);
+
+    auto tmpFilePath = tmpDirPath + extractFilename(package.url);
+    downloader.get(tmpFilePath);
+
+    FetchedPackage fetched;
+    fetched.package = package;
+    fetched.volume = volume.name;
+    fetched.appPath = volume.appsPath + appSubPath;
+    auto storagePath = config.getAppsStoragePath() + Filesystem::createAppPath(package.id);
+    journalDirectory(fetched.appPath);
+    if (!Filesystem::directoryExists(storagePath)) {
+        journalDirectory(storagePath);
+    }
+#if LISA_APPS_GID
+    fetched.appDir = std::make_unique<Filesystem::ScopedDir>(fetched.appPath, LISA_APPS_GID, false);
+    Archive::unpack(tmpFilePath, fetched.appPath, LISA_APPS_GID, false, [this] { waitWhilePaused(); });
+#else
+    fetched.appDir = std::make_unique<Filesystem::ScopedDir>(fetched.appPath);
+    Archive::unpack(tmpFilePath, fetched.appPath, [this] { waitWhilePaused(); });
+#endif
+#if LISA_DATA_GID
+    fetched.storageDir = std::make_unique<Filesystem::ScopedDir>(storagePath, LISA_DATA_GID, true);
+#else
+    fetched.storageDir = std::make_unique<Filesystem::ScopedDir>(storagePath);
+#endif
+
+    fetched.dependencies = readDependencies(fetched.appPath + config.getAnnotationsFile());
+    return fetched;
+}
+
+std::vector<std::unique_ptr<Filesystem::ScopedDir> > Executor::fetchLayers(const std::string& manifestUrl,
+                                                                             const Image::Manifest& manifest,
+                                                                             const Config::StorageVolume& volume)
+{
+    std::set<std::string> fetching;
+    std::vector<std::future<std::unique_ptr<Filesystem::ScopedDir> > > futures;
+    for (const auto& layer : manifest.layers) {
+        auto layerPath = volume.appsPath + Image::createLayerPath(layer.digest);
+        // a layer directory is complete once it exists outside of an install, it is only ever created by one
+        if (Filesystem::directoryExists(layerPath) || !fetching.insert(layer.digest).second) {
+            INFO("layer ", layer.digest, " present");
+            continue;
+        }
+        // parents are created upfront, so every fetch only owns, and on failure removes, its own directory
+        auto parentOf = [](const std::string& path) {
+            return path.substr(0, path.rfind('/', path.size() - 2) + 1);
+        };
+        Filesystem::createDirectory(parentOf(config.getAppsTmpPath() + Image::createLayerPath(layer.digest)));
+#if LISA_APPS_GID
+        Filesystem::createDirectory(parentOf(layerPath), LISA_APPS_GID, false);
+#else
+        Filesystem::createDirectory(parentOf(layerPath));
+#endif
+        futures.push_back(std::async(std::launch::async, &Executor::fetchLayer, this,
+                                     Image::blobUrl(manifestUrl, layer.digest), layer.digest, layerPath));
+    }
+    INFO("fetching ", futures.size(), " of ", manifest.layers.size(), " layers");
+    return collectAll(futures);
+}
+
+std::unique_ptr<Filesystem::ScopedDir> Executor::fetchLayer(const std::string& url, const std::string& digest,
+                                                            const std::string& layerPath)
+{
+    INFO("fetching layer ", digest, " from ", url);
+    auto tmpDirPath = config.getAppsTmpPath() + Image::createLayerPath(digest);
+    Filesystem::ScopedDir scopedTmpDir{tmpDirPath};
+
+    FetchListener listener{*this};
+    Downloader downloader{url, listener, config};
+    auto tmpFilePath = tmpDirPath + "blob";
+    downloader.get(tmpFilePath);
+
+    auto received = Image::sha256Digest(tmpFilePath);
+    if (received != digest) {
+        throw std::runtime_error("layer " + digest + " does not match its digest, received " + received);
+    }
+
+    journalDirectory(layerPath);
+#if LISA_APPS_GID
+    auto layerDir = std::make_unique<Filesystem::ScopedDir>(layerPath, LISA_APPS_GID, false);
+    Archive::unpackLayer(tmpFilePath, layerPath, LISA_APPS_GID, [this] { waitWhilePaused(); });
+#else
+    auto layerDir = std::make_unique<Filesystem::ScopedDir>(layerPath);
+    Archive::unpackLayer(tmpFilePath, layerPath, [this] { waitWhilePaused(); });
+#endif
+    return layerDir;
+}
+
+void Executor::releaseDependencies(const std::vector<DataStorage::AppDetails>& dependencies)
+{
+    for (const auto& package : dependencies) {
+        if (package.category != DEPENDENCY_CATEGORY
+                || dataBase->GetRefCount(package.type, package.id, package.version) > 0) {
+            continue;
+        }
+        INFO("removing unused dependency ", package.id, " ", package.version);
+        auto ownDependencies = dataBase->GetDependencies(package.type, package.id, package.version);
+        auto appPath = getAppsPath(package.type, package.id, package.version)
+                       + Filesystem::createAppPath(package.id, package.version);
+        dataBase->RemoveInstalledApp(package.type, package.id, package.version);
+        Filesystem::removeDirectory(appPath);
+
+        if (dataBase->GetAppsPaths(package.type, package.id, "").empty()) {
+            dataBase->RemoveAppData(package.type, package.id);
+            Filesystem::removeDirectory(config.getAppsStoragePath() + Filesystem::createAppPath(package.id));
+        }
+        releaseDependencies(ownDependencies);
+    }
+}
+
+void Executor::doMove(std::string type, std::string id, std::string version, std::string volume)
+{
+    INFO("type=", type, " id=", id, " version=", version, " volume=", volume);
+
+    const auto& targetVolume = *config.getVolume(volume);
+    auto appSubPath = Filesystem::createAppPath(id, version);
+    auto sourcePath = getAppsPath(type, id, version) + appSubPath;
+    auto targetPath = targetVolume.appsPath + appSubPath;
+    if (sourcePath == targetPath) {
+        throw std::runtime_error(std::string{} + "app already on volume " + volume);
+    }
+
+    auto requiredSpace = Filesystem::getDirectoryUsage({sourcePath}).allocatedBytes;
+    auto freeSpace = Filesystem::getFreeSpace(targetVolume.mountPath);
+    if (freeSpace < targetVolume.reserveBytes || freeSpace - targetVolume.reserveBytes < requiredSpace) {
+        std::string message = std::string{} + "not enough space on volume " + volume + " (available: "
+                + std::to_string(freeSpace / 1024) + " Kb, reserve: " + std::to_string(targetVolume.reserveBytes / 1024)
+                + " Kb, required: " + std::to_string(requiredSpace / 1024) + " Kb)";
+        throw std::runtime_error(message);
+    }
+
+    INFO("copying ", sourcePath, " to ", targetPath);
+    journalDirectory(targetPath);
+#if LISA_APPS_GID
+    Filesystem::ScopedDir scopedTargetDir{targetPath, LISA_APPS_GID, false};
+#else
+    Filesystem::ScopedDir scopedTargetDir{targetPath};
+#endif
+    if (!Filesystem::copyDirectory(sourcePath, targetPath, [this] { return isCancelled(); })) {
+        throw CancelledException();
+    }
+    Filesystem::verifyDirectoryCopy(sourcePath, targetPath);
+
+    // past this point the move cannot be cancelled anymore
+    setProgress(0, OperationStage::UPDATING_DATABASE);
+    if (isCancelled()) {
+        throw CancelledException();
+    }
+    dataBase->SetAppVolume(type, id, version, targetVolume.name);
+    scopedTargetDir.commit();
+
+    INFO("removing ", sourcePath);
+    Filesystem::removeDirectory(sourcePath);
+
+    setProgress(0, OperationStage::FINISHED);
+
+    doMaintenance();
+
+    INFO("finished");
+}
+
 void Executor::doMaintenance()
 {
     try {
@@ -773,15 +1959,45 @@ void Executor::doMaintenance()
         Filesystem::removeDirectory(config.getAppsTmpPath());
         Filesystem::createDirectory(config.getAppsTmpPath());
 
-        // remove installed apps data not present in installed_apps
-        auto appsPathRoot = config.getAppsPath() + Filesystem::LISA_EPOCH + '/';
-        auto foundApps = scanDirectories(appsPathRoot, false);
-        for (const auto& app : foundApps) {
-            INFO(app);
-            if (!dataBase->IsAppInstalled("", app.id, app.version)) {
-                ERROR(app, " not found in installed apps, removing dir");
-                auto path = config.getAppsPath() + Filesystem::createAppPath(app.id, app.version);
-                Filesystem::removeDirectory(path);
+        // remove installed apps data not present in installed_apps (or installed on other volume)
+        auto volumes = getAvailableVolumes();
+        for (const auto* volume : volumes) {
+            auto appsPathRoot = volume->appsPath + Filesystem::LISA_EPOCH + '/';
+            if (!Filesystem::directoryExists(appsPathRoot)) {
+                continue;
+            }
+            auto foundApps = scanDirectories(appsPathRoot, false);
+            for (const auto& app : foundApps) {
+                if (app.id == Image::LAYERS_DIR) {
+                    continue;
+                }
+                INFO(app);
+                if (!dataBase->IsAppInstalled("", app.id, app.version)
+                        || config.getVolume(dataBase->GetAppVolume("", app.id, app.version)) != volume) {
+                    ERROR(app, " not found in installed apps on ", volume->name, ", removing dir");
+                    auto path = volume->appsPath + Filesystem::createAppPath(app.id, app.version);
+                    Filesystem::removeDirectory(path);
+                }
+            }
+
+            // layers no app on this volume is assembled from, left by a failed install or a move
+            auto layersRoot = appsPathRoot + Image::LAYERS_DIR + '/';
+            if (Filesystem::directoryExists(layersRoot)) {
+                std::set<std::string> usedLayers;
+                for (const auto& details : dataBase->GetAppDetailsList()) {
+                    if (config.getVolume(dataBase->GetAppVolume(details.type, details.id, details.version)) == volume) {
+                        auto digests = dataBase->GetAppLayers(details.type, details.id, details.version);
+                        usedLayers.insert(digests.begin(), digests.end());
+                    }
+                }
+                for (const auto& algorithm : Filesystem::getSubdirectories(layersRoot)) {
+                    for (const auto& hex : Filesystem::getSubdirectories(layersRoot + algorithm + '/')) {
+                        if (!usedLayers.count(algorithm + ':' + hex)) {
+                            ERROR("layer ", algorithm, ":", hex, " not used on ", volume->name, ", removing dir");
+                            Filesystem::removeDirectory(layersRoot + algorithm + '/' + hex + '/');
+                        }
+                    }
+                }
             }
         }
 
@@ -806,11 +2022,19 @@ void Executor::doMaintenance()
             INFO("PATHS APPS:");
             for (const auto& path : appPaths) {
                 INFO("path: ", path);
-                auto appPath = config.getAppsPath() + path;
+                // records of apps on an unmounted volume are kept until it comes back
+                auto volume = config.getVolume(dataBase->GetAppVolume(details.type, details.id, details.version));
+                if (!volume || std::find(volumes.begin(), volumes.end(), volume) == volumes.end()) {
+                    INFO("volume of ", details.id, ":", details.version, " not available, skipping");
+                    continue;
+                }
+                auto appPath = volume->appsPath + path;
                 INFO("abs path: ", appPath);
 
                 bool noAppFiles = Filesystem::directoryExists(appPath) ? Filesystem::isEmpty(appPath) : true;
-                if (noAppFiles) {
+                if (noAppFiles && dataBase->GetRefCount(details.type, details.id, details.version) > 0) {
+                    ERROR("files of ", details.id, ":", details.version, " missing, kept as other apps depend on it");
+                } else if (noAppFiles) {
                     dataBase->RemoveInstalledApp(details.type, details.id, details.version);
                 }
             }
@@ -823,23 +2047,37 @@ void Executor::doMaintenance()
                 auto dataPath = config.getAppsStoragePath() + path;
                 INFO("abs path: ", dataPath);
                 if (!Filesystem::directoryExists(dataPath)) {
+#if LISA_DATA_GID
+                    Filesystem::createDirectory(dataPath, LISA_DATA_GID, true);
+#else
                     Filesystem::createDirectory(dataPath);
+#endif
                 }
             }
 
         }
+    }
+    catch(std::exception& exc) {
+        ERROR("ERROR: ", exc.what());
+    }
+}
 
+void Executor::doRepairPermissions()
+{
+    INFO(" ");
 #if LISA_APPS_GID
-        Filesystem::setPermissionsRecursively(config.getAppsPath(), LISA_APPS_GID, false);
+    for (const auto* volume : getAvailableVolumes()) {
+        Filesystem::setPermissionsRecursively(volume->appsPath, LISA_APPS_GID, false);
+        // apps are hard links into their layers, whose files stay read-only
+        auto layersRoot = volume->appsPath + Filesystem::LISA_EPOCH + '/' + Image::LAYERS_DIR + '/';
+        if (Filesystem::directoryExists(layersRoot)) {
+            Filesystem::setFilesReadOnlyRecursively(layersRoot);
+        }
+    }
 #endif
 #if LISA_DATA_GID
-        Filesystem::setPermissionsRecursively(config.getAppsStoragePath(), LISA_DATA_GID, true);
+    Filesystem::setPermissionsRecursively(config.getAppsStoragePath(), LISA_DATA_GID, true);
 #endif
-
-    }
-    catch(std::exception& exc) {
-        ERROR("ERROR: ", exc.what());
-    }
 }
 
 void Executor::setProgress(int progress)
@@ -847,17 +2085,49 @@ void Executor::setProgress(int progress)
     setProgress(progress, OperationStage::DOWNLOADING);
 }
 
+void Executor::setBytesDownloaded(unsigned long long bytes)
+{
+    LockGuard lock{taskMutex};
+    jobs.setBytesDownloaded(currentTask.handle, bytes);
+}
+
 bool Executor::isCancelled()
 {
     return currentTask.cancelled.load();
 }
 
+bool Executor::isPaused()
+{
+    return currentTask.paused.load();
+}
+
+void Executor::waitWhilePaused()
+{
+    if (!isPaused()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock{taskMutex};
+    INFO(currentTask, " waiting while paused");
+    pauseCondition.wait(lock, [this] {
+        return !currentTask.paused.load() || currentTask.cancelled.load();
+    });
+}
+
 void Executor::setProgress(int stagePercent, OperationStage stage)
 {
     int stageIndex = enumToInt(stage);
     int resultPercent = stageBase[stageIndex] + (static_cast<int>(stagePercent * stageFactor[stageIndex]));
     static int prevResultPercent = -1;
 
+    {
+        // entering a stage may leave the overall percentage unchanged
+        std::ostringstream stageName;
+        stageName << stage;
+        LockGuard lock{taskMutex};
+        jobs.enterStage(currentTask.handle, stageName.str());
+        journal.enterStage(currentTask.handle, stageName.str());
+    }
+
     if (resultPercent == prevResultPercent)
       return;
     prevResultPercent = resultPercent;
@@ -866,6 +2136,7 @@ void Executor::setProgress(int stagePercent, OperationStage stage)
 
     LockGuard lock{taskMutex};
     currentTask.progress = resultPercent;
+    jobs.setProgress(currentTask.handle, resultPercent);
 
     std::stringstream ss;
     ss << stage << " " << resultPercent << " %";
@@ -19,13 +19,20 @@
 
 #pragma once
 
+#include "AppCatalog.h"
 #include "Config.h"
 #include "Debug.h"
 #include "DataStorage.h"
+#include "DependencyGraph.h"
 #include "Downloader.h"
+#include "ImageStore.h"
+#include "JobHistory.h"
+#include "JobJournal.h"
 
 #include <array>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -41,6 +48,7 @@ namespace LISA {
 
 namespace Filesystem {
 struct StorageDetails;
+class ScopedDir;
 }
 
 class Executor : private DownloaderListener
@@ -65,7 +73,8 @@ public:
     };
     enum class OperationType {
         INSTALLING,
-        UNINSTALLING
+        UNINSTALLING,
+        MOVING
     };
     struct OperationStatusEvent {
         std::string handle, type, id, version, details;
@@ -100,6 +109,8 @@ public:
                     return "Installing";
                 case LISA::Executor::OperationType::UNINSTALLING:
                     return "Uninstalling";
+                case LISA::Executor::OperationType::MOVING:
+                    return "Moving";
             }
             return "";
         }
@@ -109,6 +120,28 @@ public:
     };
     using OperationStatusCallback = std::function<void (const OperationStatusEvent& event)> ;
 
+    // scheduling classes, most urgent first
+    enum class Priority {
+        USER_INITIATED,
+        FOREGROUND,
+        BACKGROUND,
+        MAINTENANCE
+    };
+    // "user", "foreground", "background" or "maintenance", empty means foreground
+    static bool priorityFromStr(const std::string& name, Priority& priority);
+
+    // one app of a batch call, fields not used by the call are left empty
+    struct BatchItem {
+        std::string type, id, version, url, appName, category, uninstallType;
+        Priority priority{Priority::FOREGROUND};
+    };
+    // outcome of one batch item, code and handle as returned by the single call
+    struct BatchResult {
+        uint32_t code{ERROR_NONE};
+        std::string handle{};
+        DataStorage::AppMetadata metadata{};
+    };
+
     Executor(OperationStatusCallback callback) :
         operationStatusCallback(callback)
     {
@@ -116,18 +149,36 @@ public:
 
     uint32_t Configure(const std::string& configString);
 
+    // A busy worker only accepts requests outranking the running task. Those are queued
+    // ahead of less urgent ones and a running install is preempted while it downloads:
+    // it is stopped and queued again behind the urgent task, keeping its handle.
     uint32_t Install(const std::string& type,
             const std::string& id,
             const std::string& version,
             const std::string& url,
             const std::string& appName,
             const std::string& category,
-            std::string& handle);
+            std::string& handle,
+            Priority priority = Priority::FOREGROUND);
 
     uint32_t Uninstall(const std::string& type,
             const std::string& id,
             const std::string& version,
             const std::string& uninstallType,
+            std::string& handle,
+            Priority priority = Priority::FOREGROUND);
+
+    // Every accepted item becomes a task with its own handle; tasks finding the worker
+    // busy are queued and run in order. Items are validated one by one, a rejected item
+    // does not affect the others.
+    uint32_t InstallBatch(const std::vector<BatchItem>& items, std::vector<BatchResult>& results);
+    uint32_t UninstallBatch(const std::vector<BatchItem>& items, std::vector<BatchResult>& results);
+
+    // Moves an installed app version to another storage volume. Locked apps are not moved.
+    uint32_t Move(const std::string& type,
+            const std::string& id,
+            const std::string& version,
+            const std::string& volume,
             std::string& handle);
 
     uint32_t Lock(const std::string& type,
@@ -147,6 +198,11 @@ public:
 
     uint32_t GetProgress(const std::string& handle, std::uint32_t& progress);
 
+    // queued, running and recently finished jobs, oldest first
+    uint32_t ListJobs(std::vector<JobInfo>& jobList);
+    // ERROR_WRONG_HANDLE once the job dropped out of the history
+    uint32_t GetJob(const std::string& handle, JobInfo& job);
+
     uint32_t GetStorageDetails(const std::string& type,
                                const std::string& id,
                                const std::string& version,
@@ -159,14 +215,49 @@ public:
                                const std::string& category,
                                std::vector<DataStorage::AppDetails>& appsDetailsList) const;
 
+    // One page of GetAppDetailsList ordered by sortBy ("id", "type" or "created") and
+    // sortOrder ("asc" or "desc"). Pass the returned nextCursor to get the following page.
+    uint32_t GetAppDetailsPage(const std::string& type,
+                               const std::string& id,
+                               const std::string& version,
+                               const std::string& appName,
+                               const std::string& category,
+                               const std::string& sortBy,
+                               const std::string& sortOrder,
+                               const std::string& cursor,
+                               std::uint32_t limit,
+                               std::vector<DataStorage::AppDetails>& appsDetailsList,
+                               std::string& nextCursor) const;
+
+    // installed app versions matching all words of the query in name, category or searchable metadata
+    uint32_t SearchApps(const std::string& query,
+                        std::vector<DataStorage::AppDetails>& appsDetailsList) const;
+
+    // installed app versions having metadata 'key' set to 'value'
+    uint32_t GetAppDetailsListByMetadata(const std::string& key,
+                                         const std::string& value,
+                                         std::vector<DataStorage::AppDetails>& appsDetailsList) const;
+
     uint32_t Cancel(const std::string& handle);
 
+    // Suspends a running install until it is resumed or cancelled. Downloads are torn
+    // down and continued with a range request, extraction stops between archive entries.
+    // A paused install stays paused when preempted and queued again.
+    uint32_t Pause(const std::string& handle);
+    uint32_t Resume(const std::string& handle);
+
     uint32_t SetMetadata(const std::string& type,
                          const std::string& id,
                          const std::string& version,
                          const std::string& key,
                          const std::string& value);
 
+    // sets all key/value pairs at once, nothing is stored if any of them fails
+    uint32_t SetMetadataBatch(const std::string& type,
+                              const std::string& id,
+                              const std::string& version,
+                              const std::vector<std::pair<std::string, std::string> >& metadata);
+
     uint32_t ClearMetadata(const std::string& type,
                          const std::string& id,
                          const std::string& version,
@@ -176,6 +267,16 @@ public:
                          const std::string& id,
                          const std::string& version,
                          DataStorage::AppMetadata& metadata) const;
+
+    // metadata of every item, all read from the same catalog snapshot
+    uint32_t GetMetadataBatch(const std::vector<BatchItem>& items, std::vector<BatchResult>& results) const;
+
+    // catalog changes since the given generation, see DataStorage::GetChanges
+    uint32_t GetChanges(std::uint64_t sinceGeneration, DataStorage::ChangeSet& changes) const;
+
+    // Ownership and permissions are applied while extracting; this walks the whole
+    // apps and data trees and is only meant to repair them on demand.
+    uint32_t RepairPermissions();
 private:
 
     enum class OperationStage
@@ -194,15 +295,76 @@ private:
     bool isCurrentHandle(const std::string& aHandle);
 
     void handleDirectories();
+    const Config::StorageVolume& selectVolume(unsigned long long requiredBytes) const;
+    std::vector<const Config::StorageVolume*> getAvailableVolumes() const;
+    std::string getAppsPath(const std::string& type, const std::string& id, const std::string& version) const;
     void initializeDataBase(const std::string& dbpath);
 
+    // lock free access to the last published catalog, null if it could not be built
+    std::shared_ptr<const AppCatalog> getCatalog() const;
+    // rebuilds the catalog from the database, called after every committed install or uninstall
+    void refreshCatalog();
+    // publishes the catalog with the metadata of one version updated, after a metadata write
+    void refreshMetadata(const std::string& type, const std::string& id, const std::string& version);
+
+    // queued tasks count as busy too
     bool isWorkerBusy() const;
+    // true when a request of this priority may be started or queued now
+    bool admits(Priority priority) const;
     bool isWorkerBusy(const std::string& type,
                       const std::string& id,
-                      const std::string& version) const;
+                      const std::string& version,
+                      OperationType* operation = nullptr) const;
+
+    uint32_t checkInstallable(const std::string& type,
+                              const std::string& id,
+                              const std::string& version,
+                              std::string& handle);
+    uint32_t checkUninstallable(const std::string& type,
+                                const std::string& id,
+                                const std::string& version,
+                                const std::string& uninstallType,
+                                std::string& handle);
+
+    uint32_t readMetadata(const AppCatalog* snapshot,
+                          const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          DataStorage::AppMetadata& metadata) const;
+
+    // all of these are called with taskMutex held
+    std::string startTask(OperationType operation,
+                          const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          Priority priority,
+                          std::function<void()> task,
+                          const std::string& handle = {},
+                          bool paused = false);
+    // journals the task, then starts it or queues it when the worker is busy, returns its handle;
+    // a queued task outranking the running one preempts it
+    std::string scheduleTask(OperationType operation,
+                             const std::string& type,
+                             const std::string& id,
+                             const std::string& version,
+                             Priority priority,
+                             const std::vector<std::string>& arguments);
+    void startPendingTask();
+    // the operation with the arguments it was journaled with: url, app name and category
+    // of an install, uninstall type of an uninstall, target volume of a move
+    std::function<void()> makeTask(OperationType operation,
+                                   const std::string& type,
+                                   const std::string& id,
+                                   const std::string& version,
+                                   const std::vector<std::string>& arguments);
 
     void executeTask(std::function<void()> task);
     void taskRunner(std::function<void()> task);
+    // records a directory the current task is about to create, removed if the task is rolled back
+    void journalDirectory(const std::string& path);
+    // Requeues, rolls forward or rolls back the jobs journaled as in flight, called at startup.
+    // Jobs resolved here send no status event, their outcome is found with GetJob and ListJobs.
+    void recoverJobs();
 
     bool isAppInstalled(const std::string& type,
                         const std::string& id,
@@ -225,27 +387,99 @@ private:
                      std::string version,
                      std::string uninstallType);
 
+    // a shared package downloaded and unpacked for the install in progress, not yet registered
+    struct FetchedPackage
+    {
+        Package package;
+        std::string volume;
+        std::string appPath;
+        std::vector<Package> dependencies;
+        std::unique_ptr<Filesystem::ScopedDir> appDir;
+        std::unique_ptr<Filesystem::ScopedDir> storageDir;
+    };
+    // reports the fetches running next to the install to the current task, without progress
+    class FetchListener : public DownloaderListener
+    {
+    public:
+        explicit FetchListener(Executor& anExecutor) : executor(anExecutor) {}
+        void setProgress(int) override {}
+        void setBytesDownloaded(unsigned long long) override {}
+        bool isCancelled() override { return executor.isCancelled(); }
+        bool isPaused() override { return executor.isPaused(); }
+        void waitWhilePaused() override { executor.waitWhilePaused(); }
+    private:
+        Executor& executor;
+    };
+    // fetches the missing dependencies of the app level by level, each level in parallel;
+    // returns them in registration order, dependencies first
+    std::vector<FetchedPackage> fetchDependencies(const Package& app, const std::vector<Package>& dependencies);
+    FetchedPackage fetchPackage(const Package& package);
+    // removes the shared packages no installed app depends on anymore
+    void releaseDependencies(const std::vector<DataStorage::AppDetails>& dependencies);
+    // fetches the layers missing on the volume in parallel, their directories are removed unless committed
+    std::vector<std::unique_ptr<Filesystem::ScopedDir> > fetchLayers(const std::string& manifestUrl,
+                                                                      const Image::Manifest& manifest,
+                                                                      const Config::StorageVolume& volume);
+    std::unique_ptr<Filesystem::ScopedDir> fetchLayer(const std::string& url, const std::string& digest,
+                                                      const std::string& layerPath);
+
+    void doMove(std::string type,
+                std::string id,
+                std::string version,
+                std::string volume);
+
     void doMaintenance();
+    void doRepairPermissions();
 
     void setProgress(int progress) override;
+    void setBytesDownloaded(unsigned long long bytes) override;
     bool isCancelled() override;
+    bool isPaused() override;
+    void waitWhilePaused() override;
     void setProgress(int percentValue, OperationStage stage);
 
     std::unique_ptr<LISA::DataStorage> dataBase;
 
+    std::shared_ptr<const AppCatalog> catalog{};
+    std::mutex catalogMutex{};
+
     using LockGuard = std::lock_guard<std::mutex>;
     struct Task {
         void reset() {
             handle.clear();
             progress = 0;
             cancelled.store(false);
+            paused.store(false);
+            preempted = false;
         }
         std::string handle{}, type, id, version;
         OperationType operation{OperationType::INSTALLING};
+        Priority priority{Priority::FOREGROUND};
         int progress{0};
         std::atomic_bool cancelled{false};
+        std::atomic_bool paused{false};
+        // stopped through 'cancelled' to make room for a more urgent task, it is queued again
+        bool preempted{false};
     };
     Task currentTask{};
+    // signalled with taskMutex when a paused task is resumed or cancelled
+    std::condition_variable pauseCondition{};
+    struct PendingTask {
+        std::string handle, type, id, version;
+        OperationType operation;
+        Priority priority;
+        std::function<void()> task;
+        // paused when it was preempted, it starts again paused
+        bool paused{false};
+    };
+    // ordered by priority, first come first served within one
+    std::deque<PendingTask> pendingTasks{};
+    // a preempted task goes back in front of the tasks of its own priority
+    void queueTask(PendingTask pending, bool aheadOfEqual);
+    void preemptCurrentTask();
+    std::deque<PendingTask>::iterator findPendingTask(const std::string& handle);
+    JobHistory jobs{};
+    JobJournal journal{};
     std::thread worker{};
     std::mutex taskMutex{};
     OperationStatusCallback operationStatusCallback;
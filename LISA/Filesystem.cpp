@@ -18,9 +18,20 @@
  */
 
 #include "Filesystem.h"
+#include "DirectoryWalker.h"
 #include "Debug.h"
 
 #include <boost/filesystem.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace WPEFramework {
@@ -39,6 +50,257 @@ void normalizeName(std::string& str)
     std::replace_if(str.begin(), str.end(), isNotPosixCompatibile, '_');
 }
 
+constexpr size_t COPY_BUFFER_SIZE = 64 * 1024;
+constexpr size_t COPY_CHUNK_SIZE = 1024 * 1024;
+
+std::string errnoMessage(const std::string& what, const std::string& name)
+{
+    return std::string{} + "error " + strerror(errno) + " " + what + " " + name;
+}
+
+/**
+ * Descriptors of the destination directories matching the current walk position,
+ * index 0 is the root, entries of depth N are created in the directory at index N.
+ */
+class DirectoryFdStack
+{
+public:
+    DirectoryFdStack() = default;
+    DirectoryFdStack(const DirectoryFdStack&) = delete;
+    DirectoryFdStack& operator=(const DirectoryFdStack&) = delete;
+
+    ~DirectoryFdStack()
+    {
+        resize(0);
+    }
+
+    void push(int fd)
+    {
+        fds.push_back(fd);
+    }
+
+    void resize(size_t size)
+    {
+        while (fds.size() > size) {
+            close(fds.back());
+            fds.pop_back();
+        }
+    }
+
+    int top() const
+    {
+        return fds.back();
+    }
+
+private:
+    std::vector<int> fds;
+};
+
+int openDirectoryAt(int dirFd, const char* name)
+{
+    int fd = openat(dirFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        throw FilesystemError(errnoMessage("opening directory", name));
+    }
+    return fd;
+}
+
+void copyFileData(int srcFd, int dstFd, const std::string& name)
+{
+#ifdef FICLONE
+    if (ioctl(dstFd, FICLONE, srcFd) == 0) {
+        return;
+    }
+#endif
+    bool useCopyFileRange{true};
+    std::vector<char> buffer;
+    while (true) {
+        ssize_t copied{};
+        if (useCopyFileRange) {
+            copied = copy_file_range(srcFd, nullptr, dstFd, nullptr, COPY_CHUNK_SIZE, 0);
+            if (copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useCopyFileRange = false;
+                continue;
+            }
+        } else {
+            buffer.resize(COPY_BUFFER_SIZE);
+            copied = read(srcFd, buffer.data(), buffer.size());
+            for (ssize_t written = 0; copied > 0 && written < copied;) {
+                auto result = write(dstFd, buffer.data() + written, copied - written);
+                if (result < 0) {
+                    throw FilesystemError(errnoMessage("writing", name));
+                }
+                written += result;
+            }
+        }
+        if (copied < 0) {
+            throw FilesystemError(errnoMessage("copying", name));
+        }
+        if (copied == 0) {
+            return;
+        }
+    }
+}
+
+std::string readLink(int dirFd, const char* name, size_t size)
+{
+    std::vector<char> target(size + 1);
+    auto length = readlinkat(dirFd, name, target.data(), target.size());
+    if (length < 0) {
+        throw FilesystemError(errnoMessage("reading link", name));
+    }
+    return std::string(target.data(), length);
+}
+
+// true when both files are backed by the very same extents, i.e. one is a clone of the other
+bool sharesExtents(int srcFd, int dstFd)
+{
+#ifdef FS_IOC_FIEMAP
+    constexpr unsigned int MAX_EXTENTS = 64;
+    auto mapExtents = [](int fd, std::vector<std::uint64_t>& buffer) -> const struct fiemap* {
+        buffer.assign((sizeof(struct fiemap) + MAX_EXTENTS * sizeof(struct fiemap_extent)) / sizeof(std::uint64_t) + 1, 0);
+        auto* map = reinterpret_cast<struct fiemap*>(buffer.data());
+        map->fm_length = FIEMAP_MAX_OFFSET;
+        map->fm_flags = FIEMAP_FLAG_SYNC;
+        map->fm_extent_count = MAX_EXTENTS;
+        return ioctl(fd, FS_IOC_FIEMAP, map) == 0 ? map : nullptr;
+    };
+    std::vector<std::uint64_t> srcBuffer, dstBuffer;
+    auto* src = mapExtents(srcFd, srcBuffer);
+    auto* dst = mapExtents(dstFd, dstBuffer);
+    // a map cut short by the buffer is not a proof, neither is an empty one
+    if (!src || !dst || src->fm_mapped_extents == 0 || src->fm_mapped_extents != dst->fm_mapped_extents
+            || !(src->fm_extents[src->fm_mapped_extents - 1].fe_flags & FIEMAP_EXTENT_LAST)) {
+        return false;
+    }
+    for (unsigned int i = 0; i < src->fm_mapped_extents; ++i) {
+        const auto& a = src->fm_extents[i];
+        const auto& b = dst->fm_extents[i];
+        if ((a.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_NOT_ALIGNED))
+                || a.fe_logical != b.fe_logical || a.fe_physical != b.fe_physical || a.fe_length != b.fe_length) {
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t readFully(int fd, char* buffer, size_t size, const char* name)
+{
+    size_t total = 0;
+    while (total < size) {
+        auto result = read(fd, buffer + total, size - total);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw FilesystemError(errnoMessage("reading", name));
+        }
+        if (result == 0) {
+            break;
+        }
+        total += result;
+    }
+    return total;
+}
+
+// throws FilesystemError unless the files hold the same bytes, clones are taken as equal
+void verifyFileData(int srcDirFd, int dstDirFd, const char* name)
+{
+    int srcFd = openat(srcDirFd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (srcFd < 0) {
+        throw FilesystemError(errnoMessage("opening", name));
+    }
+    int dstFd = openat(dstDirFd, name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (dstFd < 0) {
+        close(srcFd);
+        throw FilesystemError(errnoMessage("opening copy of", name));
+    }
+    try {
+        if (!sharesExtents(srcFd, dstFd)) {
+            std::vector<char> srcBuffer(COPY_BUFFER_SIZE);
+            std::vector<char> dstBuffer(COPY_BUFFER_SIZE);
+            while (true) {
+                auto srcRead = readFully(srcFd, srcBuffer.data(), srcBuffer.size(), name);
+                auto dstRead = readFully(dstFd, dstBuffer.data(), dstBuffer.size(), name);
+                if (srcRead != dstRead || memcmp(srcBuffer.data(), dstBuffer.data(), srcRead) != 0) {
+                    throw FilesystemError(std::string{} + "data of copy of " + name + " differs from source");
+                }
+                if (srcRead < srcBuffer.size()) {
+                    break;
+                }
+            }
+        }
+    } catch (...) {
+        close(srcFd);
+        close(dstFd);
+        throw;
+    }
+    close(srcFd);
+    close(dstFd);
+}
+
+void copyOwnerAndMode(int fd, const struct stat& st, const char* name)
+{
+    if (fchown(fd, st.st_uid, st.st_gid) != 0) {
+        ERROR("Could not change owner of ", name);
+    }
+    if (fchmod(fd, st.st_mode & 07777) != 0) {
+        throw FilesystemError(errnoMessage("setting mode of", name));
+    }
+}
+
+void copyEntry(const DirEntry& entry, int dstDirFd, DirectoryFdStack& dstFds)
+{
+    struct stat st{};
+    entry.stat(st);
+
+    if (entry.isDirectory()) {
+        if (mkdirat(dstDirFd, entry.name, S_IRWXU) != 0) {
+            throw FilesystemError(errnoMessage("creating directory", entry.name));
+        }
+        int fd = openDirectoryAt(dstDirFd, entry.name);
+        dstFds.push(fd);
+        copyOwnerAndMode(fd, st, entry.name);
+    } else if (entry.isRegularFile()) {
+        int srcFd = openat(entry.dirFd, entry.name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+        if (srcFd < 0) {
+            throw FilesystemError(errnoMessage("opening", entry.name));
+        }
+        int dstFd = openat(dstDirFd, entry.name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (dstFd < 0) {
+            close(srcFd);
+            throw FilesystemError(errnoMessage("creating", entry.name));
+        }
+        try {
+            copyFileData(srcFd, dstFd, entry.name);
+            copyOwnerAndMode(dstFd, st, entry.name);
+            const struct timespec times[2] = {st.st_atim, st.st_mtim};
+            futimens(dstFd, times);
+        } catch (...) {
+            close(srcFd);
+            close(dstFd);
+            throw;
+        }
+        close(srcFd);
+        if (close(dstFd) != 0) {
+            throw FilesystemError(errnoMessage("closing", entry.name));
+        }
+    } else if (entry.type == DT_LNK) {
+        auto target = readLink(entry.dirFd, entry.name, st.st_size);
+        if (symlinkat(target.c_str(), dstDirFd, entry.name) != 0) {
+            throw FilesystemError(errnoMessage("creating link", entry.name));
+        }
+        if (fchownat(dstDirFd, entry.name, st.st_uid, st.st_gid, AT_SYMLINK_NOFOLLOW) != 0) {
+            ERROR("Could not change owner of ", entry.name);
+        }
+    } else {
+        ERROR("Skipping special file ", entry.name);
+    }
+}
+
 } // namespace anonymous
 
 bool isAcceptableFilePath(const std::string& pathPart)
@@ -113,6 +375,22 @@ bool createDirectory(const std::string& path, int gid, bool writeable)
 }
 
 ScopedDir::ScopedDir(const std::string& path)
+{
+    findDirToRemove(path);
+    dirExists = createDirectory(path);
+
+    INFO("path ", path, " existing dir: ", dirToRemove);
+}
+
+ScopedDir::ScopedDir(const std::string& path, int gid, bool writeable)
+{
+    findDirToRemove(path);
+    dirExists = createDirectory(path, gid, writeable);
+
+    INFO("path ", path, " existing dir: ", dirToRemove, " gid: ", gid);
+}
+
+void ScopedDir::findDirToRemove(const std::string& path)
 {
     auto currentPathIndex = path.find_first_of("/");
 
@@ -125,10 +403,6 @@ ScopedDir::ScopedDir(const std::string& path)
         }
         currentPathIndex = path.find("/", currentPathIndex + 1);
     }
-
-    dirExists = createDirectory(path);
-
-    INFO("path ", path, " existing dir: ", dirToRemove);
 }
 
 ScopedDir::~ScopedDir()
@@ -165,18 +439,20 @@ void removeAllDirectoriesExcept(const std::string& path, const std::string& exce
 {
     INFO("removing directories ", path, " except ", except);
 
-    try {
-        boost::filesystem::directory_iterator end_itr;
-        for(boost::filesystem::directory_iterator itr(path); itr != end_itr; ++itr)
-        {
-           if(itr->path().filename().compare(except)) {
-               removeDirectory(itr->path().string());
-           }
+    std::vector<std::string> toRemove;
+    listDirectory(path, [&](const DirEntry& entry) {
+        if (except != entry.name) {
+            toRemove.emplace_back(entry.name);
         }
+        return WalkAction::CONTINUE;
+    });
+
+    auto dirPath = path;
+    if (!dirPath.empty() && dirPath.back() != '/') {
+        dirPath += '/';
     }
-    catch(boost::filesystem::filesystem_error& error) {
-        std::string message = std::string{} + "error " + error.what() + " removing directories " + path;
-        throw FilesystemError(message);
+    for (const auto& name : toRemove) {
+        removeDirectory(dirPath + name);
     }
 }
 
@@ -185,21 +461,26 @@ std::vector<std::string> getSubdirectories(const std::string& path)
     INFO("path: ", path);
 
     std::vector<std::string> result;
-    try {
-        namespace bfs = boost::filesystem;
-        bfs::directory_iterator endItr;
-        for(bfs::directory_iterator itr(path); itr != endItr; ++itr)
-        {
-           if(bfs::is_directory(*itr)) {
-               result.emplace_back(itr->path().filename().string());
-           }
+    listDirectory(path, [&result](const DirEntry& entry) {
+        if (entry.isDirectory()) {
+            result.emplace_back(entry.name);
         }
+        return WalkAction::CONTINUE;
+    });
+    return result;
+}
+
+unsigned int getPermissionMode(bool isdir, bool group_writeable)
+{
+    auto perms = boost::filesystem::owner_read | boost::filesystem::owner_write | boost::filesystem::group_read;
+    if (isdir) {
+        perms |= boost::filesystem::owner_exe;
+        perms |= boost::filesystem::group_exe;
     }
-    catch(boost::filesystem::filesystem_error& error) {
-        std::string message = std::string{} + "error " + error.what() + " removing directories " + path;
-        throw FilesystemError(message);
+    if (group_writeable) {
+        perms |= boost::filesystem::group_write;
     }
-    return result;
+    return static_cast<unsigned int>(perms);
 }
 
 void setPermission(const std::string& path, int uid, int gid, bool isdir, bool group_writeable)
@@ -209,14 +490,7 @@ void setPermission(const std::string& path, int uid, int gid, bool isdir, bool g
     }
 
     try {
-        auto perms = boost::filesystem::owner_read | boost::filesystem::owner_write | boost::filesystem::group_read;
-        if (isdir) {
-            perms |= boost::filesystem::owner_exe;
-            perms |= boost::filesystem::group_exe;
-        }
-        if (group_writeable) {
-            perms |= boost::filesystem::group_write;
-        }
+        auto perms = static_cast<boost::filesystem::perms>(getPermissionMode(isdir, group_writeable));
         //INFO("Changing permissions for ", path);
         boost::filesystem::permissions(path, perms);
     }
@@ -245,19 +519,34 @@ void setPermissionsRecursively(const std::string& path, int gid, bool writeable)
     }
 }
 
-bool isEmpty(const std::string& path)
+void setFilesReadOnlyRecursively(const std::string& path)
 {
-    INFO("path: ", path);
+    INFO("setFilesReadOnlyRecursively: ", path);
 
-    auto result{false};
     try {
-        result = boost::filesystem::is_empty(path);
+        namespace bfs = boost::filesystem;
+        bfs::recursive_directory_iterator endItr;
+        for(bfs::recursive_directory_iterator itr(path); itr != endItr; ++itr)
+        {
+            if (bfs::is_regular_file(itr->symlink_status())) {
+                bfs::permissions(itr->path(), bfs::remove_perms | bfs::owner_write | bfs::group_write | bfs::others_write);
+            }
+        }
     }
     catch(boost::filesystem::filesystem_error& error) {
-        std::string message = std::string{} + "error " + error.what() + " while checking if " + path + " is empty";
+        std::string message = std::string{} + "error " + error.what() + " setting permissions " + path;
         throw FilesystemError(message);
     }
-    return result;
+}
+
+bool isEmpty(const std::string& path)
+{
+    INFO("path: ", path);
+
+    // the walk is stopped on the first entry found
+    return listDirectory(path, [](const DirEntry&) {
+        return WalkAction::STOP;
+    });
 }
 
 unsigned long long getFreeSpace(const std::string& path)
@@ -278,23 +567,115 @@ unsigned long long getFreeSpace(const std::string& path)
 
 unsigned long long getDirectorySpace(const std::string& path)
 {
-    uintmax_t space{};
-    namespace bf = boost::filesystem;
-    try {
-        if(directoryExists(path)) {
-            for(bf::recursive_directory_iterator it(path); it != bf::recursive_directory_iterator(); ++it)
-            {
-                if(bf::exists(*it) && !bf::is_directory(*it) && !bf::is_symlink(*it)) {
-                    space += bf::file_size(*it);
-                }
-            }
+    return getDirectoryUsage({path}).apparentBytes;
+}
+
+DirectoryUsage getDirectoryUsage(const std::vector<std::string>& paths)
+{
+    static constexpr unsigned long long STAT_BLOCK_SIZE = 512;
+
+    DirectoryUsage usage;
+    std::set<std::pair<dev_t, ino_t>> seen;
+
+    // returns false when the inode was already accounted for
+    auto account = [&usage, &seen](const struct stat& st) {
+        if ((S_ISDIR(st.st_mode) || st.st_nlink > 1) && !seen.emplace(st.st_dev, st.st_ino).second) {
+            return false;
+        }
+        if (S_ISREG(st.st_mode)) {
+            usage.apparentBytes += st.st_size;
         }
+        usage.allocatedBytes += st.st_blocks * STAT_BLOCK_SIZE;
+        return true;
+    };
+
+    for (const auto& path : paths) {
+        struct stat st{};
+        if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            continue;
+        }
+        if (!account(st)) {
+            // nested in or identical to one of the previous roots
+            continue;
+        }
+        walkDirectory(path, [&account](const DirEntry& entry) {
+            struct stat st{};
+            entry.stat(st);
+            return account(st) ? WalkAction::CONTINUE : WalkAction::SKIP;
+        });
     }
-    catch(bf::filesystem_error& error) {
-        std::string message = std::string{} + "error " + error.what() + " reading directory space on " + path;
-        throw FilesystemError(message);
+    return usage;
+}
+
+bool copyDirectory(const std::string& from, const std::string& to, const std::function<bool()>& isCancelled)
+{
+    INFO("copying ", from, " to ", to);
+
+    DirectoryFdStack dstFds;
+    dstFds.push(openDirectoryAt(AT_FDCWD, to.c_str()));
+
+    struct stat rootStat{};
+    if (::stat(from.c_str(), &rootStat) != 0) {
+        throw FilesystemError(errnoMessage("reading status of", from));
+    }
+    copyOwnerAndMode(dstFds.top(), rootStat, to.c_str());
+
+    // the walk reports a directory before its contents, which are one level deeper
+    return walkDirectory(from, [&](const DirEntry& entry) {
+        if (isCancelled && isCancelled()) {
+            return WalkAction::STOP;
+        }
+        dstFds.resize(entry.depth + 1);
+        copyEntry(entry, dstFds.top(), dstFds);
+        return WalkAction::CONTINUE;
+    });
+}
+
+void verifyDirectoryCopy(const std::string& from, const std::string& to)
+{
+    INFO("verifying ", to, " against ", from);
+
+    unsigned long long sourceEntries{};
+    DirectoryFdStack dstFds;
+    dstFds.push(openDirectoryAt(AT_FDCWD, to.c_str()));
+
+    walkDirectory(from, [&](const DirEntry& entry) {
+        ++sourceEntries;
+        dstFds.resize(entry.depth + 1);
+
+        struct stat srcStat{};
+        struct stat dstStat{};
+        entry.stat(srcStat);
+        if (fstatat(dstFds.top(), entry.name, &dstStat, AT_SYMLINK_NOFOLLOW) != 0) {
+            throw FilesystemError(errnoMessage("verifying copy of", entry.name));
+        }
+        if ((srcStat.st_mode & S_IFMT) != (dstStat.st_mode & S_IFMT)
+                || (!S_ISLNK(srcStat.st_mode) && srcStat.st_mode != dstStat.st_mode)
+                || (S_ISREG(srcStat.st_mode) && srcStat.st_size != dstStat.st_size)) {
+            throw FilesystemError(std::string{} + "copy of " + entry.name + " differs from source");
+        }
+        if (S_ISLNK(srcStat.st_mode)
+                && readLink(entry.dirFd, entry.name, srcStat.st_size) != readLink(dstFds.top(), entry.name, dstStat.st_size)) {
+            throw FilesystemError(std::string{} + "copy of link " + entry.name + " differs from source");
+        }
+        if (S_ISREG(srcStat.st_mode)) {
+            verifyFileData(entry.dirFd, dstFds.top(), entry.name);
+        }
+        if (entry.isDirectory()) {
+            dstFds.push(openDirectoryAt(dstFds.top(), entry.name));
+        }
+        return WalkAction::CONTINUE;
+    });
+
+    unsigned long long copiedEntries{};
+    walkDirectory(to, [&copiedEntries](const DirEntry&) {
+        ++copiedEntries;
+        return WalkAction::CONTINUE;
+    });
+    if (copiedEntries != sourceEntries) {
+        throw FilesystemError(std::string{} + "copy " + to + " has " + std::to_string(copiedEntries)
+                              + " entries, source has " + std::to_string(sourceEntries));
     }
-    return (unsigned long long)space;
 }
 
 } // namespace Filesystem
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <stdexcept>
 #include <vector>
@@ -67,8 +68,11 @@ bool createDirectory(const std::string& path, int gid, bool writeable);
 void removeDirectory(const std::string& path);
 void removeAllDirectoriesExcept(const std::string& path, const std::string& except);
 std::vector<std::string> getSubdirectories(const std::string& path);
+unsigned int getPermissionMode(bool isdir, bool writeable);
 void setPermission(const std::string& path, int uid, int gid, bool isdir, bool writeable);
 void setPermissionsRecursively(const std::string& path, int gid, bool writeable);
+// clears the write bits of every regular file below path, directories keep theirs
+void setFilesReadOnlyRecursively(const std::string& path);
 bool isEmpty(const std::string& path);
 
 /**
@@ -79,6 +83,7 @@ class ScopedDir
 {
 public:
     ScopedDir(const std::string& path);
+    ScopedDir(const std::string& path, int gid, bool writeable);
 
     ScopedDir(const ScopedDir& other) = delete;
     ScopedDir& operator=(const ScopedDir& other) = delete;
@@ -87,13 +92,38 @@ public:
     void commit();
     bool exists() const;
 private:
+    void findDirToRemove(const std::string& path);
+
     bool wasCommited{false};
     bool dirExists{false};
     std::string dirToRemove{};
 };
 
+/**
+ * On-disk usage of one or more directory trees, computed in a single walk.
+ * Hardlinked files and directories reachable from several roots are counted once.
+ */
+struct DirectoryUsage
+{
+    unsigned long long apparentBytes{};   // sum of file sizes (st_size) of regular files
+    unsigned long long allocatedBytes{};  // sum of allocated blocks (st_blocks * 512) of all entries
+};
+
 unsigned long long getFreeSpace(const std::string& path);
 unsigned long long getDirectorySpace(const std::string& path);
+DirectoryUsage getDirectoryUsage(const std::vector<std::string>& paths);
+
+/**
+ * Copies the contents of directory 'from' into the existing directory 'to', keeping
+ * modes, ownership and file times. File data is cloned (FICLONE) when the filesystem
+ * supports it, otherwise copied in kernel with copy_file_range, falling back to
+ * read/write across filesystems. Returns false if stopped by 'isCancelled'.
+ */
+bool copyDirectory(const std::string& from, const std::string& to, const std::function<bool()>& isCancelled);
+
+// Throws FilesystemError if 'to' does not hold the same entries, types, modes, links and file data as 'from';
+// the data of files cloned from the source is not read again.
+void verifyDirectoryCopy(const std::string& from, const std::string& to);
 
 } // namespace Filesystem
 } // namespace LISA
@@ -0,0 +1,301 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ImageStore.h"
+#include "Filesystem.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <openssl/evp.h>
+#include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+namespace Image {
+
+const std::string LAYERS_DIR = ".layers";
+
+namespace // anonymous
+{
+
+const std::string WHITEOUT_PREFIX = ".wh.";
+const std::string OPAQUE_WHITEOUT = ".wh..wh..opq";
+
+const std::set<std::string> MANIFEST_TYPES = {
+    "application/vnd.oci.image.manifest.v1+json",
+    "application/vnd.docker.distribution.manifest.v2+json"
+};
+const std::set<std::string> INDEX_TYPES = {
+    "application/vnd.oci.image.index.v1+json",
+    "application/vnd.docker.distribution.manifest.list.v2+json"
+};
+// layer formats the archive reader handles, all tar, plain or gzip compressed
+const std::set<std::string> LAYER_TYPES = {
+    "application/vnd.oci.image.layer.v1.tar",
+    "application/vnd.oci.image.layer.v1.tar+gzip",
+    "application/vnd.docker.image.rootfs.diff.tar.gzip"
+};
+
+bool isValidDigest(const std::string& digest)
+{
+    const std::string algorithm = "sha256:";
+    if (digest.compare(0, algorithm.size(), algorithm) != 0 || digest.size() != algorithm.size() + 64) {
+        return false;
+    }
+    return digest.find_first_not_of("0123456789abcdef", algorithm.size()) == std::string::npos;
+}
+
+bool readJson(const std::string& filePath, boost::property_tree::ptree& pt)
+{
+    std::ifstream file(filePath);
+    if (!file.good()) {
+        return false;
+    }
+    try {
+        boost::property_tree::read_json(file, pt);
+    } catch (const boost::property_tree::json_parser_error&) {
+        return false;
+    }
+    return true;
+}
+
+// removes what a lower layer put at the path, whatever its type
+void removeEntry(const boost::filesystem::path& path)
+{
+    boost::system::error_code error;
+    auto status = boost::filesystem::symlink_status(path, error);
+    if (error || !boost::filesystem::exists(status)) {
+        return;
+    }
+    boost::filesystem::remove_all(path);
+}
+
+// a lower layer may have put a symlink where an upper one expects a directory: acting on
+// the path would then reach outside the root, so no component but the last may be a symlink
+void checkInsideRoot(const boost::filesystem::path& root, const boost::filesystem::path& relative)
+{
+    auto path = root;
+    for (const auto& component : relative.parent_path()) {
+        if (component == "..") {
+            throw ImageError("entry " + relative.string() + " leaves the root");
+        }
+        path /= component;
+        boost::system::error_code error;
+        auto status = boost::filesystem::symlink_status(path, error);
+        if (boost::filesystem::is_symlink(status)) {
+            throw ImageError("entry " + relative.string() + " leads through the symlink " + path.string());
+        }
+        if (error || !boost::filesystem::exists(status)) {
+            return;
+        }
+    }
+}
+
+// entries created in the root get the owner and group the layer was unpacked with
+void copyOwnership(const boost::filesystem::path& from, const boost::filesystem::path& to)
+{
+    struct stat st{};
+    if (lstat(from.c_str(), &st) != 0 || lchown(to.c_str(), st.st_uid, st.st_gid) != 0) {
+        throw ImageError("unable to set owner of " + to.string() + ": " + strerror(errno));
+    }
+}
+
+} // namespace anonymous
+
+unsigned long long Manifest::size() const
+{
+    unsigned long long total = 0;
+    for (const auto& layer : layers) {
+        total += layer.size;
+    }
+    return total;
+}
+
+bool isManifest(const std::string& filePath)
+{
+    // app tarballs are gzip compressed, a quick look saves parsing them
+    std::ifstream file(filePath);
+    char first = 0;
+    while (file.get(first) && std::isspace(static_cast<unsigned char>(first))) {
+    }
+    if (first != '{') {
+        return false;
+    }
+    boost::property_tree::ptree pt;
+    return readJson(filePath, pt) && pt.count("schemaVersion") == 1 && pt.count("layers") + pt.count("manifests") > 0;
+}
+
+Manifest readManifest(const std::string& filePath)
+{
+    boost::property_tree::ptree pt;
+    if (!readJson(filePath, pt)) {
+        throw ImageError("malformed image manifest");
+    }
+    auto mediaType = pt.get<std::string>("mediaType", "");
+    if (INDEX_TYPES.count(mediaType) || pt.count("manifests")) {
+        throw ImageError("image index is not supported, the manifest of the platform is needed");
+    }
+    if (!mediaType.empty() && !MANIFEST_TYPES.count(mediaType)) {
+        throw ImageError("unsupported manifest type " + mediaType);
+    }
+
+    Manifest manifest;
+    auto layers = pt.get_child_optional("layers");
+    if (!layers || layers->empty()) {
+        throw ImageError("image manifest without layers");
+    }
+    for (const auto& item : *layers) {
+        Layer layer;
+        layer.mediaType = item.second.get<std::string>("mediaType", "");
+        layer.digest = item.second.get<std::string>("digest", "");
+        layer.size = item.second.get<unsigned long long>("size", 0);
+        if (!LAYER_TYPES.count(layer.mediaType)) {
+            throw ImageError("unsupported layer type " + layer.mediaType);
+        }
+        if (!isValidDigest(layer.digest)) {
+            throw ImageError("invalid layer digest '" + layer.digest + "'");
+        }
+        manifest.layers.push_back(std::move(layer));
+    }
+    return manifest;
+}
+
+std::string blobUrl(const std::string& manifestUrl, const std::string& digest)
+{
+    const std::string manifests = "/manifests/";
+    auto registry = manifestUrl.rfind(manifests);
+    if (registry != std::string::npos && manifestUrl.find('/', registry + manifests.size()) == std::string::npos) {
+        return manifestUrl.substr(0, registry) + "/blobs/" + digest;
+    }
+    auto base = manifestUrl.substr(0, manifestUrl.rfind('/') + 1);
+    auto separator = digest.find(':');
+    return base + "blobs/" + digest.substr(0, separator) + '/' + digest.substr(separator + 1);
+}
+
+std::string sha256Digest(const std::string& filePath)
+{
+    std::FILE* file = std::fopen(filePath.c_str(), "rb");
+    if (!file) {
+        throw ImageError("unable to open " + filePath);
+    }
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> context{EVP_MD_CTX_new(), EVP_MD_CTX_free};
+    bool failed = !context || !EVP_DigestInit_ex(context.get(), EVP_sha256(), nullptr);
+    std::vector<unsigned char> buffer(64 * 1024);
+    std::size_t read;
+    while (!failed && (read = std::fread(buffer.data(), 1, buffer.size(), file)) > 0) {
+        failed = !EVP_DigestUpdate(context.get(), buffer.data(), read);
+    }
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestSize = 0;
+    failed = failed || std::ferror(file) || !EVP_DigestFinal_ex(context.get(), digest, &digestSize);
+    std::fclose(file);
+    if (failed) {
+        throw ImageError("unable to read " + filePath);
+    }
+    static const char* hexDigits = "0123456789abcdef";
+    std::string hex;
+    for (unsigned int i = 0; i < digestSize; ++i) {
+        hex += hexDigits[digest[i] >> 4];
+        hex += hexDigits[digest[i] & 0x0f];
+    }
+    return "sha256:" + hex;
+}
+
+std::string createLayerPath(const std::string& digest)
+{
+    auto separator = digest.find(':');
+    return Filesystem::LISA_EPOCH + '/' + LAYERS_DIR + '/' + digest.substr(0, separator) + '/'
+           + digest.substr(separator + 1) + '/';
+}
+
+void mergeLayer(const std::string& layerDir, const std::string& rootDir)
+{
+    namespace fs = boost::filesystem;
+    const fs::path layer{layerDir};
+    const fs::path root{rootDir};
+    try {
+        std::vector<fs::path> entries;
+        for (fs::recursive_directory_iterator it{layer}, end; it != end; ++it) {
+            entries.push_back(it->path());
+        }
+
+        // whiteouts hide lower entries only, so they all go before this layer adds any
+        for (const auto& entry : entries) {
+            auto name = entry.filename().string();
+            if (name.compare(0, WHITEOUT_PREFIX.size(), WHITEOUT_PREFIX) != 0) {
+                continue;
+            }
+            auto directory = entry.parent_path().lexically_relative(layer);
+            // the opaque whiteout acts on its directory, which must not be a symlink either
+            checkInsideRoot(root, directory / name);
+            auto target = root / directory;
+            if (name == OPAQUE_WHITEOUT) {
+                if (fs::is_directory(fs::symlink_status(target))) {
+                    for (fs::directory_iterator it{target}, end; it != end; ++it) {
+                        removeEntry(it->path());
+                    }
+                }
+            } else {
+                removeEntry(target / name.substr(WHITEOUT_PREFIX.size()));
+            }
+        }
+
+        for (const auto& entry : entries) {
+            if (entry.filename().string().compare(0, WHITEOUT_PREFIX.size(), WHITEOUT_PREFIX) == 0) {
+                continue;
+            }
+            auto relative = entry.lexically_relative(layer);
+            checkInsideRoot(root, relative);
+            auto target = root / relative;
+            auto status = fs::symlink_status(entry);
+            if (fs::is_directory(status)) {
+                if (!fs::is_directory(fs::symlink_status(target))) {
+                    removeEntry(target);
+                    fs::create_directory(target);
+                }
+                fs::permissions(target, status.permissions());
+                copyOwnership(entry, target);
+            } else {
+                removeEntry(target);
+                if (fs::is_symlink(status)) {
+                    fs::create_symlink(fs::read_symlink(entry), target);
+                    copyOwnership(entry, target);
+                } else {
+                    fs::create_hard_link(entry, target);
+                }
+            }
+        }
+    } catch (const fs::filesystem_error& error) {
+        throw ImageError(std::string{"merging layer "} + layerDir + ": " + error.what());
+    }
+}
+
+} // namespace Image
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
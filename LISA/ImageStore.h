@@ -0,0 +1,87 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+namespace Image {
+
+class ImageError : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct Layer
+{
+    std::string mediaType;
+    std::string digest;     // "sha256:<hex>"
+    unsigned long long size{};
+};
+
+// OCI image manifest, or docker v2 schema 2 manifest, of a single platform
+struct Manifest
+{
+    std::vector<Layer> layers;
+
+    // sum of the layer sizes, as declared
+    unsigned long long size() const;
+};
+
+// true if the downloaded file is an image manifest and not an app tarball
+bool isManifest(const std::string& filePath);
+
+// throws ImageError for an image index, unsupported layer types or malformed digests
+Manifest readManifest(const std::string& filePath);
+
+/**
+ * Location of a blob next to the manifest it was listed in. A registry manifest
+ * ".../v2/<name>/manifests/<reference>" has its blobs at ".../v2/<name>/blobs/<digest>",
+ * any other manifest is taken as part of an OCI image layout directory and its blobs
+ * are at "blobs/<algorithm>/<hex>" beside it.
+ */
+std::string blobUrl(const std::string& manifestUrl, const std::string& digest);
+
+// "sha256:<hex>" of the file content
+std::string sha256Digest(const std::string& filePath);
+
+// unpacked layers of one storage volume, relative to its apps path
+std::string createLayerPath(const std::string& digest);
+// the directory in the apps path holding the layers, it is not an app id
+extern const std::string LAYERS_DIR;
+
+/**
+ * Adds an unpacked layer on top of the root assembled from the layers below it.
+ * Whiteouts (".wh.<name>") remove lower entries and an opaque whiteout (".wh..wh..opq")
+ * empties the lower directory. Files are hard linked, so the layer is stored once; they
+ * share the read-only mode and the ownership given when the layer was unpacked.
+ * Directories get the mode and owner of the layer directory they come from, so the
+ * merged root never needs a permission pass of its own.
+ */
+void mergeLayer(const std::string& layerDir, const std::string& rootDir);
+
+} // namespace Image
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
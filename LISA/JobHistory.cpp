@@ -0,0 +1,248 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JobHistory.h"
+
+#include <algorithm>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+namespace { // anonymous
+
+std::uint64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template<typename Duration>
+std::uint64_t toMs(Duration duration)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+}
+
+const std::string PAUSED_STAGE{"PAUSED"};
+const std::string PREEMPTED_STAGE{"PREEMPTED"};
+
+} // namespace anonymous
+
+std::string jobStateStr(JobState state)
+{
+    switch (state) {
+        case JobState::QUEUED: return "Queued";
+        case JobState::RUNNING: return "Running";
+        case JobState::PAUSED: return "Paused";
+        case JobState::SUCCEEDED: return "Success";
+        case JobState::FAILED: return "Failed";
+        case JobState::CANCELLED: return "Cancelled";
+    }
+    return "";
+}
+
+bool JobInfo::finished() const
+{
+    return state != JobState::QUEUED && state != JobState::RUNNING && state != JobState::PAUSED;
+}
+
+JobHistory::JobHistory(unsigned int aLimit)
+    : limit(aLimit)
+{
+}
+
+void JobHistory::setLimit(unsigned int aLimit)
+{
+    limit = aLimit;
+    trim();
+}
+
+void JobHistory::queue(const std::string& handle, const std::string& operation,
+                       const std::string& type, const std::string& id, const std::string& version)
+{
+    Entry entry{};
+    entry.info.handle = handle;
+    entry.info.operation = operation;
+    entry.info.type = type;
+    entry.info.id = id;
+    entry.info.version = version;
+    entry.info.queuedAt = nowMs();
+    jobs.push_back(std::move(entry));
+}
+
+void JobHistory::start(const std::string& handle, const std::string& operation,
+                       const std::string& type, const std::string& id, const std::string& version,
+                       const std::string& stage)
+{
+    auto job = entry(handle);
+    if (!job) {
+        queue(handle, operation, type, id, version);
+        job = &jobs.back();
+    }
+    auto now = Clock::now();
+    endStage(*job, now);
+    job->info.state = JobState::RUNNING;
+    if (job->info.startedAt == 0) {
+        job->info.startedAt = nowMs();
+    }
+    job->info.stages.emplace_back(stage, 0);
+    job->stageStarted = now;
+}
+
+void JobHistory::enterStage(const std::string& handle, const std::string& stage)
+{
+    auto job = entry(handle);
+    if (!job || job->info.finished() || (!job->info.stages.empty() && job->info.stages.back().first == stage)) {
+        return;
+    }
+    auto now = Clock::now();
+    endStage(*job, now);
+    job->info.stages.emplace_back(stage, 0);
+    job->stageStarted = now;
+}
+
+void JobHistory::pause(const std::string& handle)
+{
+    auto job = entry(handle);
+    if (!job || job->info.state != JobState::RUNNING) {
+        return;
+    }
+    enterStage(handle, PAUSED_STAGE);
+    job->info.state = JobState::PAUSED;
+}
+
+void JobHistory::resume(const std::string& handle)
+{
+    auto job = entry(handle);
+    if (!job || job->info.state != JobState::PAUSED) {
+        return;
+    }
+    job->info.state = JobState::RUNNING;
+    auto& stages = job->info.stages;
+    if (stages.size() > 1 && stages.back().first == PAUSED_STAGE) {
+        auto interrupted = stages[stages.size() - 2].first;
+        enterStage(handle, interrupted);
+    }
+}
+
+void JobHistory::requeue(const std::string& handle)
+{
+    auto job = entry(handle);
+    if (!job || job->info.finished()) {
+        return;
+    }
+    enterStage(handle, PREEMPTED_STAGE);
+    job->info.state = JobState::QUEUED;
+    job->info.progress = 0;
+}
+
+void JobHistory::setProgress(const std::string& handle, int progress)
+{
+    auto job = entry(handle);
+    if (job) {
+        job->info.progress = progress;
+    }
+}
+
+void JobHistory::setBytesDownloaded(const std::string& handle, std::uint64_t bytes)
+{
+    auto job = entry(handle);
+    if (job) {
+        job->info.bytesDownloaded = bytes;
+    }
+}
+
+void JobHistory::finish(const std::string& handle, JobState state, const std::string& error)
+{
+    auto job = entry(handle);
+    if (!job || job->info.finished()) {
+        return;
+    }
+    endStage(*job, Clock::now());
+    job->info.state = state;
+    job->info.error = error;
+    job->info.finishedAt = nowMs();
+    trim();
+}
+
+bool JobHistory::find(const std::string& handle, JobInfo& job) const
+{
+    auto found = std::find_if(jobs.begin(), jobs.end(), [&handle](const Entry& entry) {
+        return entry.info.handle == handle;
+    });
+    if (found == jobs.end()) {
+        return false;
+    }
+    job = snapshot(*found);
+    return true;
+}
+
+std::vector<JobInfo> JobHistory::list() const
+{
+    std::vector<JobInfo> result;
+    result.reserve(jobs.size());
+    for (const auto& entry : jobs) {
+        result.push_back(snapshot(entry));
+    }
+    return result;
+}
+
+JobHistory::Entry* JobHistory::entry(const std::string& handle)
+{
+    // searched from the back, updates are for the most recent jobs
+    auto found = std::find_if(jobs.rbegin(), jobs.rend(), [&handle](const Entry& entry) {
+        return entry.info.handle == handle;
+    });
+    return found == jobs.rend() ? nullptr : &*found;
+}
+
+JobInfo JobHistory::snapshot(const Entry& entry) const
+{
+    JobInfo info = entry.info;
+    if (!info.finished() && !info.stages.empty()) {
+        info.stages.back().second = toMs(Clock::now() - entry.stageStarted);
+    }
+    return info;
+}
+
+void JobHistory::endStage(Entry& entry, Clock::time_point now)
+{
+    if (!entry.info.stages.empty()) {
+        entry.info.stages.back().second = toMs(now - entry.stageStarted);
+    }
+}
+
+void JobHistory::trim()
+{
+    auto finished = std::count_if(jobs.begin(), jobs.end(), [](const Entry& entry) {
+        return entry.info.finished();
+    });
+    for (auto it = jobs.begin(); it != jobs.end() && finished > static_cast<long>(limit);) {
+        if (it->info.finished()) {
+            it = jobs.erase(it);
+            --finished;
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
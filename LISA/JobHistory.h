@@ -0,0 +1,118 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+enum class JobState
+{
+    QUEUED,
+    RUNNING,
+    PAUSED,
+    SUCCEEDED,
+    FAILED,
+    CANCELLED
+};
+
+std::string jobStateStr(JobState state);
+
+struct JobInfo
+{
+    std::string handle, operation, type, id, version;
+    JobState state{JobState::QUEUED};
+    int progress{0};
+    std::uint64_t bytesDownloaded{0};
+    // milliseconds since the epoch, 0 until it happened
+    std::uint64_t queuedAt{0}, startedAt{0}, finishedAt{0};
+    // stages in the order they were entered with their duration in milliseconds,
+    // the last one is still running while the job is
+    std::vector<std::pair<std::string, std::uint64_t> > stages;
+    std::string error;
+
+    bool finished() const;
+};
+
+/**
+ * Queued, running and recently finished jobs of the executor, oldest first.
+ *
+ * Active jobs are always kept, of the finished ones only the 'limit' most recent.
+ * Unknown handles are ignored. Not thread safe, the executor guards it with its
+ * task mutex.
+ */
+class JobHistory
+{
+public:
+    static constexpr unsigned int DEFAULT_LIMIT = 32;
+
+    explicit JobHistory(unsigned int limit = DEFAULT_LIMIT);
+
+    void setLimit(unsigned int limit);
+
+    void queue(const std::string& handle, const std::string& operation,
+               const std::string& type, const std::string& id, const std::string& version);
+    // queues the job first if it was not, a requeued job continues its stage list
+    void start(const std::string& handle, const std::string& operation,
+               const std::string& type, const std::string& id, const std::string& version,
+               const std::string& stage);
+    // ends the running stage and starts the next one, no-op if it is already running
+    void enterStage(const std::string& handle, const std::string& stage);
+    // the pause is recorded as a stage of its own, resume re-enters the stage it interrupted
+    void pause(const std::string& handle);
+    void resume(const std::string& handle);
+    // a running job stopped to be started again later, recorded as a PREEMPTED stage
+    void requeue(const std::string& handle);
+    void setProgress(const std::string& handle, int progress);
+    void setBytesDownloaded(const std::string& handle, std::uint64_t bytes);
+    void finish(const std::string& handle, JobState state, const std::string& error);
+
+    // copies with the duration of running stages up to now
+    bool find(const std::string& handle, JobInfo& job) const;
+    std::vector<JobInfo> list() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        JobInfo info;
+        Clock::time_point stageStarted;
+    };
+
+    Entry* entry(const std::string& handle);
+    JobInfo snapshot(const Entry& entry) const;
+    void endStage(Entry& entry, Clock::time_point now);
+    void trim();
+
+    unsigned int limit;
+    std::deque<Entry> jobs;
+};
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,329 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "JobJournal.h"
+#include "Debug.h"
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+namespace {
+
+using boost::property_tree::ptree;
+
+std::string serialize(const ptree& record)
+{
+    std::ostringstream out;
+    boost::property_tree::write_json(out, record, false);
+    return out.str();
+}
+
+ptree list(const std::vector<std::string>& items)
+{
+    ptree array;
+    for (const auto& item : items) {
+        ptree value;
+        value.put("", item);
+        array.push_back({"", value});
+    }
+    return array;
+}
+
+std::vector<std::string> list(const ptree& array)
+{
+    std::vector<std::string> items;
+    for (const auto& item : array) {
+        items.push_back(item.second.get_value<std::string>());
+    }
+    return items;
+}
+
+ptree queueRecord(const JobJournal::Job& job)
+{
+    ptree record;
+    record.put("record", "queue");
+    record.put("handle", job.handle);
+    record.put("operation", job.operation);
+    record.put("type", job.type);
+    record.put("id", job.id);
+    record.put("version", job.version);
+    record.put("priority", job.priority);
+    record.put("recoveries", job.recoveries);
+    record.add_child("arguments", list(job.arguments));
+    return record;
+}
+
+ptree handleRecord(const std::string& kind, const std::string& handle)
+{
+    ptree record;
+    record.put("record", kind);
+    record.put("handle", handle);
+    return record;
+}
+
+bool writeAll(int fd, const std::string& data)
+{
+    std::size_t written = 0;
+    while (written < data.size()) {
+        auto result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<std::size_t>(result);
+    }
+    return true;
+}
+
+} // namespace
+
+JobJournal::~JobJournal()
+{
+    close();
+}
+
+bool JobJournal::open(const std::string& journalPath)
+{
+    close();
+    jobs.clear();
+    path = journalPath;
+
+    bool intact = true;
+    std::ifstream file(path);
+    if (!file.good()) {
+        INFO("no job journal at ", path);
+        intact = false;
+    }
+    std::string line;
+    while (intact && std::getline(file, line)) {
+        if (file.eof()) {
+            // a line without its newline was cut short by the power loss
+            ERROR("job journal ends with a torn record, dropping it");
+            break;
+        }
+        try {
+            apply(line);
+        } catch (const std::exception& error) {
+            ERROR("job journal is damaged: ", error.what());
+            intact = false;
+        }
+    }
+    file.close();
+
+    // keeping only the jobs still in flight also cuts off whatever was damaged
+    rewrite();
+    if (fd == -1) {
+        return false;
+    }
+    INFO("job journal opened, jobs in flight: ", jobs.size());
+    return intact;
+}
+
+const std::vector<JobJournal::Job>& JobJournal::pending() const
+{
+    return jobs;
+}
+
+void JobJournal::queue(const Job& job)
+{
+    auto record = serialize(queueRecord(job));
+    apply(record);
+    append(record);
+}
+
+void JobJournal::start(const std::string& handle, const std::string& stage)
+{
+    if (!find(handle)) {
+        return;
+    }
+    auto record = handleRecord("start", handle);
+    record.put("stage", stage);
+    auto line = serialize(record);
+    apply(line);
+    append(line);
+}
+
+void JobJournal::enterStage(const std::string& handle, const std::string& stage)
+{
+    auto* job = find(handle);
+    if (!job || job->stage == stage) {
+        return;
+    }
+    auto record = handleRecord("stage", handle);
+    record.put("stage", stage);
+    auto line = serialize(record);
+    apply(line);
+    append(line);
+}
+
+void JobJournal::addPath(const std::string& handle, const std::string& dirPath)
+{
+    auto* job = find(handle);
+    if (!job || std::find(job->paths.begin(), job->paths.end(), dirPath) != job->paths.end()) {
+        return;
+    }
+    auto record = handleRecord("path", handle);
+    record.put("path", dirPath);
+    auto line = serialize(record);
+    apply(line);
+    append(line);
+}
+
+void JobJournal::finish(const std::string& handle)
+{
+    if (!find(handle)) {
+        return;
+    }
+    auto line = serialize(handleRecord("finish", handle));
+    apply(line);
+    if (jobs.empty()) {
+        // nothing in flight, nothing to replay
+        if (fd != -1 && (ftruncate(fd, 0) != 0 || fdatasync(fd) != 0)) {
+            ERROR("truncating job journal failed: ", std::strerror(errno));
+            append(line);
+        }
+    } else {
+        append(line);
+    }
+}
+
+JobJournal::Job* JobJournal::find(const std::string& handle)
+{
+    auto found = std::find_if(jobs.begin(), jobs.end(), [&handle](const Job& job) { return job.handle == handle; });
+    return found == jobs.end() ? nullptr : &*found;
+}
+
+void JobJournal::apply(const std::string& line)
+{
+    ptree record;
+    std::istringstream in(line);
+    boost::property_tree::read_json(in, record);
+
+    const auto kind = record.get<std::string>("record");
+    const auto handle = record.get<std::string>("handle");
+    if (kind == "queue") {
+        Job job;
+        job.handle = handle;
+        job.operation = record.get<std::string>("operation");
+        job.type = record.get<std::string>("type");
+        job.id = record.get<std::string>("id");
+        job.version = record.get<std::string>("version");
+        job.priority = record.get<int>("priority");
+        job.arguments = list(record.get_child("arguments", ptree{}));
+        job.recoveries = record.get<unsigned int>("recoveries", 0);
+        auto* queued = find(handle);
+        if (queued) {
+            *queued = std::move(job);
+        } else {
+            jobs.push_back(std::move(job));
+        }
+        return;
+    }
+
+    auto* job = find(handle);
+    if (!job) {
+        throw std::runtime_error("record for unknown job " + handle);
+    }
+    if (kind == "start" || kind == "stage") {
+        job->stage = record.get<std::string>("stage");
+    } else if (kind == "path") {
+        job->paths.push_back(record.get<std::string>("path"));
+    } else if (kind == "finish") {
+        jobs.erase(jobs.begin() + (job - jobs.data()));
+    } else {
+        throw std::runtime_error("unknown record " + kind);
+    }
+}
+
+void JobJournal::append(const std::string& line)
+{
+    if (fd == -1) {
+        return;
+    }
+    if (!writeAll(fd, line) || fdatasync(fd) != 0) {
+        // without a reliable journal the next start falls back to a full maintenance
+        ERROR("writing job journal failed: ", std::strerror(errno), ", journal disabled");
+        close();
+        unlink(path.c_str());
+    }
+}
+
+void JobJournal::rewrite()
+{
+    std::string snapshot;
+    for (const auto& job : jobs) {
+        snapshot += serialize(queueRecord(job));
+        if (!job.stage.empty()) {
+            auto record = handleRecord("start", job.handle);
+            record.put("stage", job.stage);
+            snapshot += serialize(record);
+        }
+        for (const auto& dirPath : job.paths) {
+            auto record = handleRecord("path", job.handle);
+            record.put("path", dirPath);
+            snapshot += serialize(record);
+        }
+    }
+
+    const auto tmpPath = path + ".tmp";
+    int tmpFd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tmpFd == -1 || !writeAll(tmpFd, snapshot) || fdatasync(tmpFd) != 0
+        || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        ERROR("writing job journal ", path, " failed: ", std::strerror(errno), ", journal disabled");
+        if (tmpFd != -1) {
+            ::close(tmpFd);
+        }
+        unlink(tmpPath.c_str());
+        unlink(path.c_str());
+        return;
+    }
+    ::close(tmpFd);
+
+    fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd == -1) {
+        ERROR("opening job journal ", path, " failed: ", std::strerror(errno), ", journal disabled");
+        unlink(path.c_str());
+    }
+}
+
+void JobJournal::close()
+{
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,86 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+/**
+ * Write-ahead journal of the jobs admitted by the executor, so the ones in flight
+ * when the device went down can be resumed or rolled back on the next start.
+ *
+ * One JSON object per line, each synced before the call returns; a torn last line
+ * ends the replay. Every directory a job creates is recorded before it is created.
+ * The file is emptied whenever no job is in flight. Not thread safe, the executor
+ * guards it with its task mutex.
+ */
+class JobJournal
+{
+public:
+    struct Job
+    {
+        std::string handle, operation, type, id, version;
+        int priority{0};
+        // what the operation needs to run again, e.g. url, app name and category of an install
+        std::vector<std::string> arguments;
+        // times it was queued again after the device went down while it was running
+        unsigned int recoveries{0};
+        // the last stage entered, empty until the job is started
+        std::string stage;
+        // directories created by the job, for a rollback
+        std::vector<std::string> paths;
+    };
+
+    JobJournal() = default;
+    JobJournal(const JobJournal&) = delete;
+    JobJournal& operator=(const JobJournal&) = delete;
+    ~JobJournal();
+
+    // false if there was no journal or it was damaged, the jobs in flight are unknown then
+    bool open(const std::string& path);
+    // jobs not finished when the journal was last written, in the order they were admitted
+    const std::vector<Job>& pending() const;
+
+    // queueing a job again replaces it, it is then not started and owns no directories
+    void queue(const Job& job);
+    void start(const std::string& handle, const std::string& stage);
+    // appended only when the stage changes
+    void enterStage(const std::string& handle, const std::string& stage);
+    void addPath(const std::string& handle, const std::string& path);
+    void finish(const std::string& handle);
+
+private:
+    Job* find(const std::string& handle);
+    void apply(const std::string& record);
+    void append(const std::string& record);
+    void rewrite();
+    void close();
+
+    std::string path;
+    int fd{-1};
+    std::vector<Job> jobs;
+};
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,149 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Module.h"
+
+#include <interfaces/ILISA.h>
+#include <list>
+#include <string>
+
+namespace WPEFramework {
+namespace Plugin {
+
+// ILISA key/value pairs and their iterator, shared by the implementation and the JSON-RPC layer
+class KeyValueImpl : public Exchange::ILISA::IKeyValue
+{
+public:
+    KeyValueImpl() = delete;
+    KeyValueImpl(const KeyValueImpl&) = delete;
+    KeyValueImpl& operator=(const KeyValueImpl&) = delete;
+
+    KeyValueImpl(const std::string key, const std::string value)
+        : _key(key), _value(value)
+    {
+    }
+
+    ~KeyValueImpl() override
+    {
+    }
+
+    uint32_t Key(std::string& key) const override
+    {
+        key = _key;
+        return Core::ERROR_NONE;
+    }
+
+    uint32_t Value(std::string& value) const override
+    {
+        value = _value;
+        return Core::ERROR_NONE;
+    }
+
+private:
+    std::string _key;
+    std::string _value;
+
+public:
+    BEGIN_INTERFACE_MAP(KeyValueImpl)
+        INTERFACE_ENTRY(Exchange::ILISA::IKeyValue)
+    END_INTERFACE_MAP
+}; // class KeyValueImpl
+
+class KeyValueIteratorImpl : public Exchange::ILISA::IKeyValueIterator {
+    public:
+        KeyValueIteratorImpl() = delete;
+        KeyValueIteratorImpl(const KeyValueIteratorImpl&) = delete;
+        KeyValueIteratorImpl& operator=(const KeyValueIteratorImpl&) = delete;
+
+        KeyValueIteratorImpl(const std::list<KeyValueImpl*>& container)
+        {
+            std::list<KeyValueImpl*>::const_iterator index = container.begin();
+            while (index != container.end()) {
+                Exchange::ILISA::IKeyValue* element = (*index);
+                element->AddRef();
+                _list.push_back(element);
+                index++;
+            }
+        }
+
+        ~KeyValueIteratorImpl() override
+        {
+            while (_list.size() != 0) {
+                _list.front()->Release();
+                _list.pop_front();
+            }
+        }
+
+    public:
+        uint32_t Reset() override
+        {
+            _index = 0;
+            return Core::ERROR_NONE;
+        }
+
+        bool IsValid() const
+        {
+            return ((_index != 0) && (_index <= _list.size()));
+        }
+
+        uint32_t IsValid(bool& isValid) const override
+        {
+            isValid = IsValid();
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Next(bool& hasNext) override
+        {
+            if (_index == 0) {
+                _index = 1;
+                _iterator = _list.begin();
+            } else if (_index <= _list.size()) {
+                _index++;
+                _iterator++;
+            }
+            hasNext = IsValid();
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Current(Exchange::ILISA::IKeyValue*& keyValue) const override
+        {
+            ASSERT(IsValid() == true);
+            Exchange::ILISA::IKeyValue* result = nullptr;
+            result = (*_iterator);
+            ASSERT(result != nullptr);
+            result->AddRef();
+            keyValue = result;
+            return Core::ERROR_NONE;
+        }
+
+    private:
+        uint32_t _index = 0;
+        std::list<Exchange::ILISA::IKeyValue*> _list;
+        std::list<Exchange::ILISA::IKeyValue*>::iterator _iterator;
+
+    public:
+        BEGIN_INTERFACE_MAP(KeyValueIteratorImpl)
+            INTERFACE_ENTRY(Exchange::ILISA::IKeyValueIterator)
+        END_INTERFACE_MAP
+}; // class KeyValueIteratorImpl
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,1409 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KvDataStorage.h"
+#include "Debug.h"
+#include "StorageCursor.h"
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+namespace { // anonymous
+    // file header, changed whenever the record format changes
+    const char LOG_MAGIC[8] = {'L', 'I', 'S', 'A', 'K', 'V', '0', '1'};
+    // record header: payload length and crc32 of the payload
+    constexpr std::size_t RECORD_HEADER_SIZE = 8;
+    // a log shorter than this is never compacted
+    constexpr std::uint64_t COMPACTION_MIN_RECORDS = 256;
+
+    std::int64_t timeNow()
+    {
+        const auto now = std::chrono::system_clock::now();
+        return std::chrono::system_clock::to_time_t(now);
+    }
+
+    std::uint32_t crc32(const char* data, std::size_t size)
+    {
+        static const auto table = [] {
+            std::vector<std::uint32_t> entries(256);
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : (crc >> 1);
+                }
+                entries[i] = crc;
+            }
+            return entries;
+        }();
+        std::uint32_t crc = 0xFFFFFFFFu;
+        for (std::size_t i = 0; i < size; ++i) {
+            crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    std::string errnoMessage(const std::string& what, const std::string& path)
+    {
+        return "error " + std::string{strerror(errno)} + " " + what + " " + path;
+    }
+
+    void writeAll(int fd, const std::string& data)
+    {
+        std::size_t written = 0;
+        while (written < data.size()) {
+            auto rc = write(fd, data.data() + written, data.size() - written);
+            if (rc < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw DataStorageError(errnoMessage("writing", "app store log"));
+            }
+            written += rc;
+        }
+    }
+
+    // listing names as used by SqlDataStorage, so cursors look the same
+    std::string listingName(DataStorage::SortKey sortKey, bool descending)
+    {
+        std::string column = "app_id";
+        if (sortKey == DataStorage::SortKey::TYPE) {
+            column = "type";
+        } else if (sortKey == DataStorage::SortKey::CREATED) {
+            column = "created";
+        }
+        return column + (descending ? ":DESC" : ":ASC");
+    }
+
+    // lower case words, split like the FTS5 unicode61 tokenizer splits ASCII text
+    std::vector<std::string> tokenize(const std::string& text)
+    {
+        std::vector<std::string> tokens;
+        std::string token;
+        for (unsigned char c : text) {
+            if (c >= 0x80 || isalnum(c)) {
+                token += static_cast<char>(tolower(c));
+            } else if (!token.empty()) {
+                tokens.push_back(std::move(token));
+                token.clear();
+            }
+        }
+        if (!token.empty()) {
+            tokens.push_back(std::move(token));
+        }
+        return tokens;
+    }
+
+    bool hasPrefix(const std::string& word, const std::string& prefix)
+    {
+        return word.compare(0, prefix.size(), prefix) == 0;
+    }
+} // namespace anonymous
+
+/**
+ * A log record: [u32 payload length][u32 crc32][payload], little endian.
+ * The payload is the operation followed by its fields: u64 numbers and u32 length prefixed strings.
+ */
+class KvDataStorage::Record
+{
+    public:
+        enum Operation : std::uint8_t
+        {
+            ADD_INSTALLED_APP = 1,
+            REMOVE_INSTALLED_APP,
+            REMOVE_APP_DATA,
+            SET_APP_VOLUME,
+            SET_METADATA,
+            CLEAR_METADATA,
+            // snapshot written by compaction, restores state without logging changes
+            RESTORE_APP,
+            RESTORE_VERSION,
+            RESTORE_CHANGE_LOG,
+            ADD_DEPENDENCY,
+            SET_LAYERS,
+            // records applied together or not at all
+            BATCH
+        };
+
+        explicit Record(Operation operation) : data(1, static_cast<char>(operation)) {}
+
+        Record(const char* payload, std::size_t size) : data(payload, size)
+        {
+            if (data.empty()) {
+                throw DataStorageError("empty record");
+            }
+        }
+
+        Operation operation() const
+        {
+            return static_cast<Operation>(data[0]);
+        }
+
+        Record& add(const std::string& value)
+        {
+            auto size = static_cast<std::uint32_t>(value.size());
+            for (int i = 0; i < 4; ++i) {
+                data += static_cast<char>((size >> (8 * i)) & 0xFF);
+            }
+            data += value;
+            return *this;
+        }
+
+        Record& add(std::uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i) {
+                data += static_cast<char>((value >> (8 * i)) & 0xFF);
+            }
+            return *this;
+        }
+
+        // nested in a BATCH record
+        Record& add(const Record& record)
+        {
+            return add(record.data);
+        }
+
+        Record record()
+        {
+            auto payload = string();
+            return Record{payload.data(), payload.size()};
+        }
+
+        std::string string()
+        {
+            if (data.size() - position < 4) {
+                throw DataStorageError("malformed record");
+            }
+            std::size_t size = 0;
+            for (int i = 0; i < 4; ++i) {
+                size |= static_cast<std::size_t>(static_cast<unsigned char>(data[position + i])) << (8 * i);
+            }
+            position += 4;
+            if (size > data.size() - position) {
+                throw DataStorageError("malformed record");
+            }
+            std::string value = data.substr(position, size);
+            position += size;
+            return value;
+        }
+
+        std::uint64_t number()
+        {
+            if (data.size() - position < 8) {
+                throw DataStorageError("malformed record");
+            }
+            std::uint64_t value = 0;
+            for (int i = 0; i < 8; ++i) {
+                value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[position + i])) << (8 * i);
+            }
+            position += 8;
+            return value;
+        }
+
+        // the record with its header, ready to be appended
+        std::string bytes() const
+        {
+            auto payloadSize = static_cast<std::uint32_t>(data.size());
+            auto crc = crc32(data.data(), data.size());
+            std::string bytes(RECORD_HEADER_SIZE, '\0');
+            for (int i = 0; i < 4; ++i) {
+                bytes[i] = static_cast<char>((payloadSize >> (8 * i)) & 0xFF);
+                bytes[4 + i] = static_cast<char>((crc >> (8 * i)) & 0xFF);
+            }
+            return bytes + data;
+        }
+
+    private:
+        // fields are read after the operation, appending does not move the read position
+        std::string data;
+        std::size_t position{1};
+};
+
+    KvDataStorage::~KvDataStorage()
+    {
+        Terminate();
+    }
+
+    void KvDataStorage::Terminate()
+    {
+        if (log_fd >= 0) {
+            close(log_fd);
+        }
+        log_fd = -1;
+    }
+
+    void KvDataStorage::Initialize()
+    {
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        Terminate();
+        Reset();
+        Load();
+        CompactIfNeeded();
+    }
+
+    void KvDataStorage::Reset()
+    {
+        apps.clear();
+        apps_by_id.clear();
+        next_app_key = 0;
+        generation = 0;
+        trimmed_through = 0;
+        change_log.clear();
+        change_log_by_entity.clear();
+        log_bytes = 0;
+        log_records = 0;
+    }
+
+    void KvDataStorage::Load()
+    {
+        INFO("Opening app store log: ", log_path);
+        // left over by an interrupted compaction, the log itself is still complete
+        unlink((log_path + ".tmp").c_str());
+
+        log_fd = open(log_path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (log_fd < 0) {
+            throw DataStorageError(errnoMessage("opening", log_path));
+        }
+        struct stat st{};
+        if (fstat(log_fd, &st) != 0) {
+            throw DataStorageError(errnoMessage("reading status of", log_path));
+        }
+        std::uint64_t size = st.st_size;
+
+        std::uint64_t validSize = 0;
+        if (size >= sizeof(LOG_MAGIC)) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, log_fd, 0);
+            if (mapping == MAP_FAILED) {
+                throw DataStorageError(errnoMessage("mapping", log_path));
+            }
+            const char* data = static_cast<const char*>(mapping);
+            if (memcmp(data, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0) {
+                validSize = sizeof(LOG_MAGIC);
+                try {
+                    while (validSize < size) {
+                        auto recordSize = validSize;
+                        if (!Replay(data, size, recordSize)) {
+                            break;
+                        }
+                        validSize = recordSize;
+                        ++log_records;
+                    }
+                } catch (const DataStorageError& error) {
+                    ERROR("invalid record in app store log: ", error.what());
+                }
+            }
+            munmap(mapping, size);
+        }
+
+        if (validSize == 0) {
+            if (size != 0) {
+                ERROR("app store log is damaged, starting with an empty store");
+                Reset();
+            }
+            if (ftruncate(log_fd, 0) != 0) {
+                throw DataStorageError(errnoMessage("truncating", log_path));
+            }
+            writeAll(log_fd, std::string(LOG_MAGIC, sizeof(LOG_MAGIC)));
+            validSize = sizeof(LOG_MAGIC);
+        } else if (validSize < size) {
+            ERROR("app store log has a damaged tail, dropping ", size - validSize, " bytes");
+            if (ftruncate(log_fd, validSize) != 0) {
+                throw DataStorageError(errnoMessage("truncating", log_path));
+            }
+        }
+        if (fdatasync(log_fd) != 0) {
+            throw DataStorageError(errnoMessage("syncing", log_path));
+        }
+        log_bytes = validSize;
+        INFO("app store loaded: ", apps.size(), " apps, ", log_records, " records");
+    }
+
+    // applies the record at offset, false if the log ends there (torn or damaged record)
+    bool KvDataStorage::Replay(const char* data, std::uint64_t size, std::uint64_t& offset)
+    {
+        if (size - offset < RECORD_HEADER_SIZE) {
+            return false;
+        }
+        std::uint32_t payloadSize = 0, crc = 0;
+        for (int i = 0; i < 4; ++i) {
+            payloadSize |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset + i])) << (8 * i);
+            crc |= static_cast<std::uint32_t>(static_cast<unsigned char>(data[offset + 4 + i])) << (8 * i);
+        }
+        const char* payload = data + offset + RECORD_HEADER_SIZE;
+        if (payloadSize > size - offset - RECORD_HEADER_SIZE || crc32(payload, payloadSize) != crc) {
+            return false;
+        }
+        Record record{payload, payloadSize};
+        Apply(record);
+        offset += RECORD_HEADER_SIZE + payloadSize;
+        return true;
+    }
+
+    void KvDataStorage::Append(const Record& record)
+    {
+        const auto bytes = record.bytes();
+        try {
+            writeAll(log_fd, bytes);
+            if (fdatasync(log_fd) != 0) {
+                throw DataStorageError(errnoMessage("syncing", log_path));
+            }
+        } catch (const DataStorageError&) {
+            // a partial record must not stay in front of the next one
+            if (ftruncate(log_fd, log_bytes) != 0) {
+                ERROR(errnoMessage("truncating", log_path));
+            }
+            throw;
+        }
+        log_bytes += bytes.size();
+        ++log_records;
+    }
+
+    // the record is durable before the in-memory index changes
+    void KvDataStorage::Commit(Record& record)
+    {
+        Append(record);
+        Apply(record);
+        CompactIfNeeded();
+    }
+
+    std::uint64_t KvDataStorage::LiveEntries() const
+    {
+        std::uint64_t entries = 1;
+        for (const auto& app : apps) {
+            ++entries;
+            for (const auto& version : app.second.versions) {
+                entries += 1 + version.metadata.size() + version.dependencies.size() + (version.layers.empty() ? 0 : 1);
+            }
+        }
+        return entries;
+    }
+
+    void KvDataStorage::CompactIfNeeded()
+    {
+        if (log_records < COMPACTION_MIN_RECORDS || log_records < 2 * LiveEntries()) {
+            return;
+        }
+        try {
+            Compact();
+        } catch (const DataStorageError& error) {
+            // the log is still complete, compaction is retried on a later write
+            ERROR("app store compaction failed: ", error.what());
+            unlink((log_path + ".tmp").c_str());
+        }
+    }
+
+    void KvDataStorage::Compact()
+    {
+        INFO("compacting app store log, records: ", log_records);
+        std::string snapshot(LOG_MAGIC, sizeof(LOG_MAGIC));
+        std::uint64_t records = 0;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            Record appRecord{Record::RESTORE_APP};
+            appRecord.add(app.type).add(app.id).add(app.dataPath).add(static_cast<std::uint64_t>(app.created));
+            snapshot += appRecord.bytes();
+            ++records;
+            for (const auto& version : app.versions) {
+                Record versionRecord{Record::RESTORE_VERSION};
+                versionRecord.add(app.type).add(app.id).add(version.version).add(version.name).add(version.category)
+                             .add(version.url).add(version.appPath).add(version.volume)
+                             .add(static_cast<std::uint64_t>(version.created)).add(version.metadata.size());
+                for (const auto& keyValue : version.metadata) {
+                    versionRecord.add(keyValue.first).add(keyValue.second);
+                }
+                snapshot += versionRecord.bytes();
+                ++records;
+            }
+        }
+        // dependencies may point at any version, so they follow all of them
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            for (const auto& version : app.versions) {
+                if (!version.layers.empty()) {
+                    Record layersRecord{Record::SET_LAYERS};
+                    layersRecord.add(app.type).add(app.id).add(version.version).add(static_cast<std::uint64_t>(version.layers.size()));
+                    for (const auto& digest : version.layers) {
+                        layersRecord.add(digest);
+                    }
+                    snapshot += layersRecord.bytes();
+                    ++records;
+                }
+                for (const auto& dependency : version.dependencies) {
+                    Record dependencyRecord{Record::ADD_DEPENDENCY};
+                    dependencyRecord.add(app.type).add(app.id).add(version.version)
+                                    .add(std::get<0>(dependency)).add(std::get<1>(dependency)).add(std::get<2>(dependency));
+                    snapshot += dependencyRecord.bytes();
+                    ++records;
+                }
+            }
+        }
+        Record changesRecord{Record::RESTORE_CHANGE_LOG};
+        changesRecord.add(generation).add(trimmed_through).add(change_log.size());
+        for (const auto& entry : change_log) {
+            const auto& change = entry.second;
+            changesRecord.add(change.generation).add(change.change).add(change.type).add(change.id).add(change.version).add(change.key);
+        }
+        snapshot += changesRecord.bytes();
+        ++records;
+
+        const std::string tmpPath = log_path + ".tmp";
+        int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw DataStorageError(errnoMessage("creating", tmpPath));
+        }
+        try {
+            writeAll(fd, snapshot);
+            if (fdatasync(fd) != 0) {
+                throw DataStorageError(errnoMessage("syncing", tmpPath));
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        if (rename(tmpPath.c_str(), log_path.c_str()) != 0) {
+            throw DataStorageError(errnoMessage("replacing", log_path));
+        }
+
+        auto directory = log_path.substr(0, log_path.rfind('/') + 1);
+        int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            fsync(dirFd);
+            close(dirFd);
+        }
+
+        Terminate();
+        log_fd = open(log_path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+        if (log_fd < 0) {
+            throw DataStorageError(errnoMessage("opening", log_path));
+        }
+        log_bytes = snapshot.size();
+        log_records = records;
+    }
+
+    void KvDataStorage::Apply(Record& record)
+    {
+        switch (record.operation()) {
+            case Record::ADD_INSTALLED_APP: {
+                auto type = record.string();
+                auto id = record.string();
+                Version version;
+                version.version = record.string();
+                version.url = record.string();
+                version.name = record.string();
+                version.category = record.string();
+                version.appPath = record.string();
+                auto dataPath = record.string();
+                version.volume = record.string();
+                version.created = static_cast<std::int64_t>(record.number());
+
+                auto app = FindApp(type, id, false);
+                if (!app) {
+                    if (apps_by_id.count(id)) {
+                        throw DataStorageError("app " + id + " exists with another type");
+                    }
+                    auto key = next_app_key++;
+                    app = &apps[key];
+                    app->type = type;
+                    app->id = id;
+                    app->dataPath = dataPath;
+                    app->created = version.created;
+                    apps_by_id[id] = key;
+                    LogChange("added", Entity{type, id, "", ""});
+                }
+                if (FindVersion(type, id, version.version, false)) {
+                    throw DataStorageError("app already installed: " + id + " " + version.version);
+                }
+                auto versionName = version.version;
+                app->versions.push_back(std::move(version));
+                LogChange("added", Entity{type, id, versionName, ""});
+                break;
+            }
+            case Record::REMOVE_INSTALLED_APP: {
+                auto type = record.string();
+                auto id = record.string();
+                auto versionName = record.string();
+                auto app = FindApp(type, id, false);
+                if (!app) {
+                    throw DataStorageError("app not found: " + id);
+                }
+                auto version = std::find_if(app->versions.begin(), app->versions.end(), [&](const Version& v) {
+                    return v.version == versionName;
+                });
+                if (version == app->versions.end()) {
+                    throw DataStorageError("app not installed: " + id + " " + versionName);
+                }
+                for (const auto& keyValue : version->metadata) {
+                    LogChange("removed", Entity{type, id, versionName, keyValue.first});
+                }
+                app->versions.erase(version);
+                DropChanges(type, id, &versionName);
+                LogChange("removed", Entity{type, id, versionName, ""});
+                break;
+            }
+            case Record::REMOVE_APP_DATA: {
+                auto type = record.string();
+                auto id = record.string();
+                auto app = FindApp(type, id, false);
+                if (!app || !app->versions.empty()) {
+                    throw DataStorageError("app data cannot be removed: " + id);
+                }
+                apps.erase(apps_by_id[id]);
+                apps_by_id.erase(id);
+                DropChanges(type, id, nullptr);
+                LogChange("removed", Entity{type, id, "", ""});
+                break;
+            }
+            case Record::SET_APP_VOLUME: {
+                auto type = record.string();
+                auto id = record.string();
+                auto versionName = record.string();
+                auto version = FindVersion(type, id, versionName, false);
+                if (!version) {
+                    throw DataStorageError("app not installed: " + id + " " + versionName);
+                }
+                version->volume = record.string();
+                LogChange("updated", Entity{type, id, versionName, ""});
+                break;
+            }
+            case Record::SET_METADATA: {
+                auto type = record.string();
+                auto id = record.string();
+                auto versionName = record.string();
+                auto version = FindVersion(type, id, versionName, false);
+                if (!version) {
+                    throw DataStorageError("app not installed: " + id + " " + versionName);
+                }
+                for (auto count = record.number(); count > 0; --count) {
+                    auto key = record.string();
+                    version->metadata[key] = record.string();
+                    LogChange("updated", Entity{type, id, versionName, key});
+                }
+                break;
+            }
+            case Record::CLEAR_METADATA: {
+                auto type = record.string();
+                auto id = record.string();
+                auto versionName = record.string();
+                auto key = record.string();
+                auto version = FindVersion(type, id, versionName, false);
+                if (!version) {
+                    throw DataStorageError("app not installed: " + id + " " + versionName);
+                }
+                for (auto it = version->metadata.begin(); it != version->metadata.end();) {
+                    if (key.empty() || it->first == key) {
+                        LogChange("removed", Entity{type, id, versionName, it->first});
+                        it = version->metadata.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                break;
+            }
+            case Record::RESTORE_APP: {
+                auto key = next_app_key++;
+                auto& app = apps[key];
+                app.type = record.string();
+                app.id = record.string();
+                app.dataPath = record.string();
+                app.created = static_cast<std::int64_t>(record.number());
+                if (!apps_by_id.emplace(app.id, key).second) {
+                    throw DataStorageError("duplicate app in snapshot: " + app.id);
+                }
+                break;
+            }
+            case Record::RESTORE_VERSION: {
+                auto type = record.string();
+                auto id = record.string();
+                auto app = FindApp(type, id, false);
+                if (!app) {
+                    throw DataStorageError("app missing from snapshot: " + id);
+                }
+                Version version;
+                version.version = record.string();
+                version.name = record.string();
+                version.category = record.string();
+                version.url = record.string();
+                version.appPath = record.string();
+                version.volume = record.string();
+                version.created = static_cast<std::int64_t>(record.number());
+                for (auto count = record.number(); count > 0; --count) {
+                    auto key = record.string();
+                    version.metadata[key] = record.string();
+                }
+                app->versions.push_back(std::move(version));
+                break;
+            }
+            case Record::RESTORE_CHANGE_LOG: {
+                generation = record.number();
+                trimmed_through = record.number();
+                change_log.clear();
+                change_log_by_entity.clear();
+                for (auto count = record.number(); count > 0; --count) {
+                    Change change;
+                    change.generation = record.number();
+                    change.change = record.string();
+                    change.type = record.string();
+                    change.id = record.string();
+                    change.version = record.string();
+                    change.key = record.string();
+                    change_log_by_entity[Entity{change.type, change.id, change.version, change.key}] = change.generation;
+                    change_log[change.generation] = std::move(change);
+                }
+                break;
+            }
+            case Record::ADD_DEPENDENCY: {
+                auto type = record.string();
+                auto id = record.string();
+                auto versionName = record.string();
+                auto dependencyType = record.string();
+                auto dependencyId = record.string();
+                auto dependency = std::make_tuple(dependencyType, dependencyId, record.string());
+                auto version = FindVersion(type, id, versionName, false);
+                if (!version || !FindVersion(std::get<0>(dependency), std::get<1>(dependency), std::get<2>(dependency), false)) {
+                    throw DataStorageError("dependency between versions not installed: " + id + " " + versionName);
+                }
+                if (std::find(version->dependencies.begin(), version->dependencies.end(), dependency) == version->dependencies.end()) {
+                    version->dependencies.push_back(std::move(dependency));
+                }
+                break;
+            }
+            case Record::SET_LAYERS: {
+                auto type = record.string();
+                auto id = record.string();
+                auto versionName = record.string();
+                auto version = FindVersion(type, id, versionName, false);
+                if (!version) {
+                    throw DataStorageError("app not installed: " + id + " " + versionName);
+                }
+                version->layers.clear();
+                for (auto count = record.number(); count > 0; --count) {
+                    version->layers.push_back(record.string());
+                }
+                break;
+            }
+            case Record::BATCH: {
+                // validated as a whole before it was logged
+                for (auto count = record.number(); count > 0; --count) {
+                    auto nested = record.record();
+                    Apply(nested);
+                }
+                break;
+            }
+            default:
+                throw DataStorageError("unknown record " + std::to_string(record.operation()));
+        }
+    }
+
+    // an empty type matches any type if anyType is set
+    KvDataStorage::App* KvDataStorage::FindApp(const std::string& type, const std::string& id, bool anyType)
+    {
+        return const_cast<App*>(static_cast<const KvDataStorage*>(this)->FindApp(type, id, anyType));
+    }
+
+    const KvDataStorage::App* KvDataStorage::FindApp(const std::string& type, const std::string& id, bool anyType) const
+    {
+        auto it = apps_by_id.find(id);
+        if (it == apps_by_id.end()) {
+            return nullptr;
+        }
+        const auto& app = apps.at(it->second);
+        if (!(anyType && type.empty()) && app.type != type) {
+            return nullptr;
+        }
+        return &app;
+    }
+
+    KvDataStorage::Version* KvDataStorage::FindVersion(const std::string& type, const std::string& id,
+                                                       const std::string& version, bool anyType)
+    {
+        return const_cast<Version*>(static_cast<const KvDataStorage*>(this)->FindVersion(type, id, version, anyType));
+    }
+
+    const KvDataStorage::Version* KvDataStorage::FindVersion(const std::string& type, const std::string& id,
+                                                             const std::string& version, bool anyType) const
+    {
+        auto app = FindApp(type, id, anyType);
+        if (!app) {
+            return nullptr;
+        }
+        for (const auto& installed : app->versions) {
+            if (installed.version == version) {
+                return &installed;
+            }
+        }
+        return nullptr;
+    }
+
+    unsigned int KvDataStorage::RefCount(const std::string& type, const std::string& id, const std::string& version) const
+    {
+        const auto target = std::make_tuple(type, id, version);
+        unsigned int count = 0;
+        for (const auto& entry : apps) {
+            for (const auto& installed : entry.second.versions) {
+                count += std::count(installed.dependencies.begin(), installed.dependencies.end(), target);
+            }
+        }
+        return count;
+    }
+
+    void KvDataStorage::LogChange(const std::string& change, const Entity& entity)
+    {
+        ++generation;
+        if (generation > change_log_size) {
+            trimmed_through = std::max(trimmed_through, generation - change_log_size);
+        }
+        while (!change_log.empty() && change_log.begin()->first <= trimmed_through) {
+            const auto& trimmed = change_log.begin()->second;
+            change_log_by_entity.erase(Entity{trimmed.type, trimmed.id, trimmed.version, trimmed.key});
+            change_log.erase(change_log.begin());
+        }
+
+        auto existing = change_log_by_entity.find(entity);
+        if (existing != change_log_by_entity.end()) {
+            change_log.erase(existing->second);
+            existing->second = generation;
+        } else {
+            change_log_by_entity.emplace(entity, generation);
+        }
+        change_log[generation] = Change{generation, change, std::get<0>(entity), std::get<1>(entity),
+                                        std::get<2>(entity), std::get<3>(entity)};
+    }
+
+    // drops the logged changes of an app, or of one of its versions, superseded by its removal
+    void KvDataStorage::DropChanges(const std::string& type, const std::string& id, const std::string* version)
+    {
+        auto it = change_log_by_entity.lower_bound(Entity{type, id, version ? *version : "", ""});
+        while (it != change_log_by_entity.end() && std::get<0>(it->first) == type && std::get<1>(it->first) == id
+               && (!version || std::get<2>(it->first) == *version)) {
+            change_log.erase(it->second);
+            it = change_log_by_entity.erase(it);
+        }
+    }
+
+    std::vector<std::string> KvDataStorage::GetAppsPaths(const std::string& type, const std::string& id, const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<std::string> paths;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            if ((!type.empty() && app.type != type) || (!id.empty() && app.id != id)) {
+                continue;
+            }
+            for (const auto& installed : app.versions) {
+                if (version.empty() || installed.version == version) {
+                    paths.push_back(installed.appPath);
+                }
+            }
+        }
+        return paths;
+    }
+
+    std::vector<std::string> KvDataStorage::GetDataPaths(const std::string& type, const std::string& id)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<std::string> paths;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            if ((type.empty() || app.type == type) && (id.empty() || app.id == id)) {
+                paths.push_back(app.dataPath);
+            }
+        }
+        return paths;
+    }
+
+    std::vector<DataStorage::AppDetails> KvDataStorage::GetAppDetailsList(const std::string& type, const std::string& id, const std::string& version,
+                                                                          const std::string& appName, const std::string& category)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<AppDetails> appsList;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            if ((!type.empty() && app.type != type) || (!id.empty() && app.id != id)) {
+                continue;
+            }
+            for (const auto& installed : app.versions) {
+                if ((version.empty() || installed.version == version) && (appName.empty() || installed.name == appName)
+                    && (category.empty() || installed.category == category)) {
+                    appsList.push_back(AppDetails{app.type.c_str(), app.id.c_str(), installed.version.c_str(),
+                                                  installed.name.c_str(), installed.category.c_str(), installed.url.c_str()});
+                }
+            }
+        }
+        return appsList;
+    }
+
+    // version, appName, category will by empty when no installed version exists for a type+id
+    std::vector<DataStorage::AppDetails> KvDataStorage::GetAppDetailsListOuterJoin(const std::string& type, const std::string& id, const std::string& version,
+                                                                                   const std::string& appName, const std::string& category)
+    {
+        INFO(" ");
+        const bool versionFilter = !version.empty() || !appName.empty() || !category.empty();
+        std::vector<AppDetails> appsList;
+        {
+            std::shared_lock<std::shared_timed_mutex> lock(mutex);
+            for (const auto& entry : apps) {
+                const auto& app = entry.second;
+                if ((!type.empty() && app.type != type) || (!id.empty() && app.id != id)) {
+                    continue;
+                }
+                if (app.versions.empty() && !versionFilter) {
+                    appsList.push_back(AppDetails{app.type.c_str(), app.id.c_str(), "", "", "", ""});
+                }
+            }
+        }
+        // installed versions in the same order as the inner join
+        auto installed = GetAppDetailsList(type, id, version, appName, category);
+        appsList.insert(appsList.end(), installed.begin(), installed.end());
+        return appsList;
+    }
+
+    DataStorage::AppDetailsPage KvDataStorage::GetAppDetailsPage(const std::string& type,
+                                                                 const std::string& id,
+                                                                 const std::string& version,
+                                                                 const std::string& appName,
+                                                                 const std::string& category,
+                                                                 SortKey sortKey,
+                                                                 bool descending,
+                                                                 const std::string& cursor,
+                                                                 unsigned int limit)
+    {
+        INFO(" ");
+        const auto listing = listingName(sortKey, descending);
+        std::string lastSortValue, lastId;
+        if (!cursor.empty()) {
+            auto fields = decodeCursor(cursor);
+            if (fields.size() != 3 || fields[0] != listing) {
+                throw InvalidCursorError("cursor does not match the requested order: " + cursor);
+            }
+            lastSortValue = fields[1];
+            lastId = fields[2];
+        }
+
+        auto sortValue = [sortKey](const App& app) {
+            switch (sortKey) {
+                case SortKey::TYPE: return app.type;
+                case SortKey::CREATED: return std::to_string(app.created);
+                case SortKey::ID: break;
+            }
+            return app.id;
+        };
+        // negative if a sorts before b in ascending order
+        auto compare = [sortKey](const std::string& aValue, const std::string& aId, const std::string& bValue, const std::string& bId) {
+            int result = 0;
+            if (sortKey == SortKey::CREATED) {
+                auto a = std::strtoll(aValue.c_str(), nullptr, 10);
+                auto b = std::strtoll(bValue.c_str(), nullptr, 10);
+                result = (a < b) ? -1 : (a > b ? 1 : 0);
+            } else {
+                result = aValue.compare(bValue);
+            }
+            return result != 0 ? result : aId.compare(bId);
+        };
+        auto versionMatches = [&](const Version& installed) {
+            return (version.empty() || installed.version == version) && (appName.empty() || installed.name == appName)
+                   && (category.empty() || installed.category == category);
+        };
+        const bool versionFilter = !version.empty() || !appName.empty() || !category.empty();
+
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<std::pair<std::string, const App*> > selected;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            if ((!type.empty() && app.type != type) || (!id.empty() && app.id != id)) {
+                continue;
+            }
+            if (versionFilter && std::none_of(app.versions.begin(), app.versions.end(), versionMatches)) {
+                continue;
+            }
+            auto value = sortValue(app);
+            if (!cursor.empty()) {
+                auto order = compare(value, app.id, lastSortValue, lastId);
+                if (descending ? order >= 0 : order <= 0) {
+                    continue;
+                }
+            }
+            selected.emplace_back(std::move(value), &app);
+        }
+        std::sort(selected.begin(), selected.end(), [&](const std::pair<std::string, const App*>& a,
+                                                        const std::pair<std::string, const App*>& b) {
+            auto order = compare(a.first, a.second->id, b.first, b.second->id);
+            return descending ? order > 0 : order < 0;
+        });
+
+        AppDetailsPage page;
+        std::size_t count = selected.size();
+        if (limit != 0 && count > limit) {
+            count = limit;
+            page.nextCursor = encodeCursor({listing, selected[count - 1].first, selected[count - 1].second->id});
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto& app = *selected[i].second;
+            bool any = false;
+            for (const auto& installed : app.versions) {
+                if (versionMatches(installed)) {
+                    page.apps.push_back(AppDetails{app.type.c_str(), app.id.c_str(), installed.version.c_str(),
+                                                   installed.name.c_str(), installed.category.c_str(), installed.url.c_str()});
+                    any = true;
+                }
+            }
+            if (!any) {
+                page.apps.push_back(AppDetails{app.type.c_str(), app.id.c_str(), "", "", "", ""});
+            }
+        }
+        return page;
+    }
+
+    std::vector<DataStorage::AppDetails> KvDataStorage::SearchApps(const std::string& query)
+    {
+        INFO(" ");
+        auto terms = tokenize(query);
+        if (terms.empty()) {
+            return {};
+        }
+        const std::set<std::string> searchedKeys(search_metadata_keys.begin(), search_metadata_keys.end());
+
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<AppDetails> appsList;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            for (const auto& installed : app.versions) {
+                std::string text = installed.name + ' ' + installed.category;
+                for (const auto& keyValue : installed.metadata) {
+                    if (searchedKeys.empty() || searchedKeys.count(keyValue.first)) {
+                        text += ' ' + keyValue.second;
+                    }
+                }
+                auto words = tokenize(text);
+                bool matches = std::all_of(terms.begin(), terms.end(), [&words](const std::string& term) {
+                    return std::any_of(words.begin(), words.end(), [&term](const std::string& word) {
+                        return hasPrefix(word, term);
+                    });
+                });
+                if (matches) {
+                    appsList.push_back(AppDetails{app.type.c_str(), app.id.c_str(), installed.version.c_str(),
+                                                  installed.name.c_str(), installed.category.c_str(), installed.url.c_str()});
+                }
+            }
+        }
+        return appsList;
+    }
+
+    std::vector<DataStorage::AppDetails> KvDataStorage::GetAppDetailsListByMetadata(const std::string& key,
+                                                                                     const std::string& value)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<AppDetails> appsList;
+        for (const auto& entry : apps) {
+            const auto& app = entry.second;
+            for (const auto& installed : app.versions) {
+                auto it = installed.metadata.find(key);
+                if (it != installed.metadata.end() && it->second == value) {
+                    appsList.push_back(AppDetails{app.type.c_str(), app.id.c_str(), installed.version.c_str(),
+                                                  installed.name.c_str(), installed.category.c_str(), installed.url.c_str()});
+                }
+            }
+        }
+        std::stable_sort(appsList.begin(), appsList.end(), [](const AppDetails& a, const AppDetails& b) {
+            return a.id < b.id;
+        });
+        return appsList;
+    }
+
+    void KvDataStorage::AddInstalledApp(const std::string& type,
+                                        const std::string& id,
+                                        const std::string& version,
+                                        const std::string& url,
+                                        const std::string& appName,
+                                        const std::string& category,
+                                        const std::string& appPath,
+                                        const std::string& appStoragePath,
+                                        const std::string& volume)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        auto app = FindApp(type, id, false);
+        if (!app && apps_by_id.count(id)) {
+            throw DataStorageError("app " + id + " exists with another type");
+        }
+        if (FindVersion(type, id, version, false)) {
+            throw DataStorageError("app already installed: " + id + " " + version);
+        }
+        Record record{Record::ADD_INSTALLED_APP};
+        record.add(type).add(id).add(version).add(url).add(appName).add(category).add(appPath).add(appStoragePath)
+              .add(volume).add(static_cast<std::uint64_t>(timeNow()));
+        Commit(record);
+    }
+
+    bool KvDataStorage::IsAppInstalled(const std::string& type,
+                                       const std::string& id,
+                                       const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        return FindVersion(type, id, version, true) != nullptr;
+    }
+
+    std::string KvDataStorage::GetTypeOfApp(const std::string& id)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        auto app = FindApp({}, id, true);
+        if (!app) {
+            throw DataStorageError("app not found: " + id);
+        }
+        return app->type;
+    }
+
+    std::string KvDataStorage::GetAppVolume(const std::string& type,
+                                            const std::string& id,
+                                            const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        auto installed = FindVersion(type, id, version, true);
+        if (!installed) {
+            throw DataStorageError("app not installed: " + id + " " + version);
+        }
+        return installed->volume;
+    }
+
+    void KvDataStorage::SetAppVolume(const std::string& type,
+                                     const std::string& id,
+                                     const std::string& version,
+                                     const std::string& volume)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        if (!FindVersion(type, id, version, false)) {
+            throw DataStorageError("app not installed: " + id + " " + version);
+        }
+        Record record{Record::SET_APP_VOLUME};
+        record.add(type).add(id).add(version).add(volume);
+        Commit(record);
+    }
+
+    bool KvDataStorage::IsAppData(const std::string& type,
+                                  const std::string& id)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        if (!id.empty()) {
+            return FindApp(type, id, true) != nullptr;
+        }
+        return std::any_of(apps.begin(), apps.end(), [&type](const std::pair<const std::uint64_t, App>& entry) {
+            return type.empty() || entry.second.type == type;
+        });
+    }
+
+    void KvDataStorage::RemoveInstalledApp(const std::string& type,
+                                           const std::string& id,
+                                           const std::string& version)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        if (!FindApp(type, id, false)) {
+            throw DataStorageError("app not found: " + id);
+        }
+        if (!FindVersion(type, id, version, false)) {
+            return;
+        }
+        if (RefCount(type, id, version) > 0) {
+            throw DataStorageError("app is a dependency of other apps: " + id + " " + version);
+        }
+        Record record{Record::REMOVE_INSTALLED_APP};
+        record.add(type).add(id).add(version);
+        Commit(record);
+    }
+
+    void KvDataStorage::RemoveAppData(const std::string& type,
+                                      const std::string& id)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        auto app = FindApp(type, id, false);
+        if (!app) {
+            return;
+        }
+        if (!app->versions.empty()) {
+            throw DataStorageError("app has installed versions: " + id);
+        }
+        Record record{Record::REMOVE_APP_DATA};
+        record.add(type).add(id);
+        Commit(record);
+    }
+
+    void KvDataStorage::SetMetadata(const std::string& type,
+                                    const std::string& id,
+                                    const std::string& version,
+                                    const std::string& key,
+                                    const std::string& value)
+    {
+        SetMetadataBatch(type, id, version, {{key, value}});
+    }
+
+    void KvDataStorage::SetMetadataBatch(const std::string& type,
+                                         const std::string& id,
+                                         const std::string& version,
+                                         const std::vector<std::pair<std::string, std::string> >& metadata)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        if (!FindVersion(type, id, version, false)) {
+            throw DataStorageError("app not installed: " + id + " " + version);
+        }
+        Record record{Record::SET_METADATA};
+        record.add(type).add(id).add(version).add(static_cast<std::uint64_t>(metadata.size()));
+        for (const auto& keyValue : metadata) {
+            record.add(keyValue.first).add(keyValue.second);
+        }
+        Commit(record);
+    }
+
+    // key can be empty to clear all metadata of an app
+    void KvDataStorage::ClearMetadata(const std::string& type,
+                                      const std::string& id,
+                                      const std::string& version,
+                                      const std::string& key)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        auto installed = FindVersion(type, id, version, false);
+        if (!installed || installed->metadata.empty() || (!key.empty() && !installed->metadata.count(key))) {
+            return;
+        }
+        Record record{Record::CLEAR_METADATA};
+        record.add(type).add(id).add(version).add(key);
+        Commit(record);
+    }
+
+    DataStorage::AppMetadata KvDataStorage::GetMetadata(const std::string& type,
+                                                        const std::string& id,
+                                                        const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        auto app = FindApp(type, id, false);
+        auto installed = FindVersion(type, id, version, false);
+        if (!installed) {
+            throw DataStorageError("app not installed: " + id + " " + version);
+        }
+        AppMetadata appMetadata;
+        appMetadata.appDetails = AppDetails{app->type.c_str(), app->id.c_str(), installed->version.c_str(),
+                                            installed->name.c_str(), installed->category.c_str(), installed->url.c_str()};
+        appMetadata.metadata.assign(installed->metadata.begin(), installed->metadata.end());
+        return appMetadata;
+    }
+
+    DataStorage::ChangeSet KvDataStorage::GetChanges(std::uint64_t sinceGeneration)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        ChangeSet changeSet;
+        changeSet.generation = generation;
+        // a generation from the future means the store was recreated
+        changeSet.complete = sinceGeneration >= trimmed_through && sinceGeneration <= generation;
+        if (!changeSet.complete) {
+            return changeSet;
+        }
+        for (auto it = change_log.upper_bound(sinceGeneration); it != change_log.end(); ++it) {
+            changeSet.changes.push_back(it->second);
+        }
+        return changeSet;
+    }
+
+    void KvDataStorage::AddDependency(const std::string& type,
+                                      const std::string& id,
+                                      const std::string& version,
+                                      const std::string& dependencyType,
+                                      const std::string& dependencyId,
+                                      const std::string& dependencyVersion)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        auto installed = FindVersion(type, id, version, false);
+        if (!installed) {
+            throw DataStorageError("app not installed: " + id + " " + version);
+        }
+        if (!FindVersion(dependencyType, dependencyId, dependencyVersion, false)) {
+            throw DataStorageError("app not installed: " + dependencyId + " " + dependencyVersion);
+        }
+        const auto dependency = std::make_tuple(dependencyType, dependencyId, dependencyVersion);
+        if (std::find(installed->dependencies.begin(), installed->dependencies.end(), dependency) != installed->dependencies.end()) {
+            return;
+        }
+        Record record{Record::ADD_DEPENDENCY};
+        record.add(type).add(id).add(version).add(dependencyType).add(dependencyId).add(dependencyVersion);
+        Commit(record);
+    }
+
+    std::vector<DataStorage::AppDetails> KvDataStorage::GetDependencies(const std::string& type,
+                                                                        const std::string& id,
+                                                                        const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        std::vector<AppDetails> dependencies;
+        auto installed = FindVersion(type, id, version, false);
+        if (!installed) {
+            return dependencies;
+        }
+        for (const auto& dependency : installed->dependencies) {
+            auto app = FindApp(std::get<0>(dependency), std::get<1>(dependency), false);
+            auto package = FindVersion(std::get<0>(dependency), std::get<1>(dependency), std::get<2>(dependency), false);
+            dependencies.push_back(AppDetails{app->type.c_str(), app->id.c_str(), package->version.c_str(),
+                                              package->name.c_str(), package->category.c_str(), package->url.c_str()});
+        }
+        // same order as SqlDataStorage
+        std::sort(dependencies.begin(), dependencies.end(), [](const AppDetails& a, const AppDetails& b) {
+            return std::tie(a.id, a.version) < std::tie(b.id, b.version);
+        });
+        return dependencies;
+    }
+
+    unsigned int KvDataStorage::GetRefCount(const std::string& type,
+                                            const std::string& id,
+                                            const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        return RefCount(type, id, version);
+    }
+
+    void KvDataStorage::AddInstalledApps(const std::vector<Installation>& installations)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        // checked against the index and the versions added before them in the batch
+        std::set<std::tuple<std::string, std::string, std::string> > added;
+        std::map<std::string, std::string> addedTypes;
+        auto isInstalled = [&](const std::string& type, const std::string& id, const std::string& version) {
+            return FindVersion(type, id, version, false) != nullptr || added.count(std::make_tuple(type, id, version)) != 0;
+        };
+
+        std::vector<Record> records;
+        const auto timeCreated = static_cast<std::uint64_t>(timeNow());
+        for (const auto& installation : installations) {
+            const auto& app = installation.app;
+            auto addedType = addedTypes.find(app.id);
+            if ((!FindApp(app.type, app.id, false) && apps_by_id.count(app.id))
+                || (addedType != addedTypes.end() && addedType->second != app.type)) {
+                throw DataStorageError("app " + app.id + " exists with another type");
+            }
+            if (isInstalled(app.type, app.id, app.version)) {
+                throw DataStorageError("app already installed: " + app.id + " " + app.version);
+            }
+            Record record{Record::ADD_INSTALLED_APP};
+            record.add(app.type).add(app.id).add(app.version).add(app.url).add(app.appName).add(app.category)
+                  .add(installation.appPath).add(installation.appStoragePath).add(installation.volume).add(timeCreated);
+            records.push_back(std::move(record));
+            added.emplace(app.type, app.id, app.version);
+            addedTypes.emplace(app.id, app.type);
+
+            for (const auto& dependency : installation.dependencies) {
+                if (!isInstalled(dependency.type, dependency.id, dependency.version)) {
+                    throw DataStorageError("app not installed: " + dependency.id + " " + dependency.version);
+                }
+                Record dependencyRecord{Record::ADD_DEPENDENCY};
+                dependencyRecord.add(app.type).add(app.id).add(app.version)
+                                .add(dependency.type).add(dependency.id).add(dependency.version);
+                records.push_back(std::move(dependencyRecord));
+            }
+            if (!installation.layers.empty()) {
+                Record layersRecord{Record::SET_LAYERS};
+                layersRecord.add(app.type).add(app.id).add(app.version).add(static_cast<std::uint64_t>(installation.layers.size()));
+                for (const auto& digest : installation.layers) {
+                    layersRecord.add(digest);
+                }
+                records.push_back(std::move(layersRecord));
+            }
+        }
+
+        Record batch{Record::BATCH};
+        batch.add(static_cast<std::uint64_t>(records.size()));
+        for (const auto& record : records) {
+            batch.add(record);
+        }
+        Commit(batch);
+    }
+
+    void KvDataStorage::SetAppLayers(const std::string& type,
+                                     const std::string& id,
+                                     const std::string& version,
+                                     const std::vector<std::string>& digests)
+    {
+        INFO(" ");
+        std::unique_lock<std::shared_timed_mutex> lock(mutex);
+        if (!FindVersion(type, id, version, false)) {
+            throw DataStorageError("app not installed: " + id + " " + version);
+        }
+        Record record{Record::SET_LAYERS};
+        record.add(type).add(id).add(version).add(static_cast<std::uint64_t>(digests.size()));
+        for (const auto& digest : digests) {
+            record.add(digest);
+        }
+        Commit(record);
+    }
+
+    std::vector<std::string> KvDataStorage::GetAppLayers(const std::string& type,
+                                                         const std::string& id,
+                                                         const std::string& version)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        auto installed = FindVersion(type, id, version, false);
+        return installed ? installed->layers : std::vector<std::string>{};
+    }
+
+    unsigned int KvDataStorage::GetLayerRefCount(const std::string& digest)
+    {
+        INFO(" ");
+        std::shared_lock<std::shared_timed_mutex> lock(mutex);
+        unsigned int count = 0;
+        for (const auto& entry : apps) {
+            for (const auto& installed : entry.second.versions) {
+                if (std::find(installed.layers.begin(), installed.layers.end(), digest) != installed.layers.end()) {
+                    ++count;
+                }
+            }
+        }
+        return count;
+    }
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,245 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DataStorage.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+/**
+ * DataStorage kept in memory and persisted in an append-only log (apps.kv).
+ *
+ * Every write is validated against the in-memory index, appended as a single
+ * checksummed record, synced and only then applied. On Initialize the log is
+ * mapped and replayed; a torn or corrupted record at the tail (power loss in the
+ * middle of a write) ends the replay and is cut off. When most of the log is
+ * superseded it is compacted into a snapshot, written aside and renamed over it.
+ *
+ * Behaves like SqlDataStorage, except that search results are not ranked.
+ */
+class KvDataStorage: public DataStorage
+{
+    public:
+        explicit KvDataStorage(const std::string& path,
+                               const std::vector<std::string>& searchMetadataKeys = {},
+                               unsigned int changeLogSize = DEFAULT_CHANGE_LOG_SIZE)
+            : log_path(path + log_name), search_metadata_keys(searchMetadataKeys),
+              change_log_size(std::max(changeLogSize, 1u)) {}
+        KvDataStorage(const KvDataStorage&) = delete;
+        KvDataStorage& operator=(const KvDataStorage&) = delete;
+        ~KvDataStorage();
+
+        void Initialize() override;
+        std::vector<std::string> GetAppsPaths(const std::string& type, const std::string& id, const std::string& version) override;
+
+        std::vector<std::string> GetDataPaths(const std::string& type, const std::string& id) override;
+
+        std::vector<DataStorage::AppDetails> GetAppDetailsList(const std::string& type, const std::string& id, const std::string& version,
+                                                  const std::string& appName, const std::string& category) override;
+
+        std::vector<DataStorage::AppDetails> GetAppDetailsListOuterJoin(const std::string& type, const std::string& id, const std::string& version,
+                                                                        const std::string& appName, const std::string& category) override;
+        AppDetailsPage GetAppDetailsPage(const std::string& type,
+                                         const std::string& id,
+                                         const std::string& version,
+                                         const std::string& appName,
+                                         const std::string& category,
+                                         SortKey sortKey,
+                                         bool descending,
+                                         const std::string& cursor,
+                                         unsigned int limit) override;
+        std::vector<DataStorage::AppDetails> SearchApps(const std::string& query) override;
+        std::vector<DataStorage::AppDetails> GetAppDetailsListByMetadata(const std::string& key,
+                                                                         const std::string& value) override;
+        void AddInstalledApp(const std::string& type,
+                             const std::string& id,
+                             const std::string& version,
+                             const std::string& url,
+                             const std::string& appName,
+                             const std::string& category,
+                             const std::string& appPath,
+                             const std::string& appStoragePath,
+                             const std::string& volume) override;
+
+        bool IsAppInstalled(const std::string& type,
+                            const std::string& id,
+                            const std::string& version) override;
+
+        std::string GetTypeOfApp(const std::string& id) override;
+
+        std::string GetAppVolume(const std::string& type,
+                                 const std::string& id,
+                                 const std::string& version) override;
+
+        void SetAppVolume(const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          const std::string& volume) override;
+
+        bool IsAppData(const std::string& type,
+                       const std::string& id) override;
+
+        void RemoveInstalledApp(const std::string& type,
+                                const std::string& id,
+                                const std::string& version) override;
+
+        void RemoveAppData(const std::string& type,
+                           const std::string& id) override;
+
+        void SetMetadata(const std::string& type,
+                         const std::string& id,
+                         const std::string& version,
+                         const std::string& key,
+                         const std::string& value) override;
+
+        void SetMetadataBatch(const std::string& type,
+                              const std::string& id,
+                              const std::string& version,
+                              const std::vector<std::pair<std::string, std::string> >& metadata) override;
+
+        void ClearMetadata(const std::string& type,
+                         const std::string& id,
+                         const std::string& version,
+                         const std::string& key) override;
+
+        DataStorage::AppMetadata GetMetadata(const std::string& type,
+                               const std::string& id,
+                               const std::string& version) override;
+
+        DataStorage::ChangeSet GetChanges(std::uint64_t sinceGeneration) override;
+
+        void AddDependency(const std::string& type,
+                           const std::string& id,
+                           const std::string& version,
+                           const std::string& dependencyType,
+                           const std::string& dependencyId,
+                           const std::string& dependencyVersion) override;
+
+        std::vector<DataStorage::AppDetails> GetDependencies(const std::string& type,
+                                                             const std::string& id,
+                                                             const std::string& version) override;
+
+        unsigned int GetRefCount(const std::string& type,
+                                 const std::string& id,
+                                 const std::string& version) override;
+
+        void AddInstalledApps(const std::vector<Installation>& installations) override;
+
+        void SetAppLayers(const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          const std::vector<std::string>& digests) override;
+
+        std::vector<std::string> GetAppLayers(const std::string& type,
+                                              const std::string& id,
+                                              const std::string& version) override;
+
+        unsigned int GetLayerRefCount(const std::string& digest) override;
+
+        constexpr static unsigned int DEFAULT_CHANGE_LOG_SIZE = 1000;
+
+    private:
+        struct Version
+        {
+            std::string version;
+            std::string name;
+            std::string category;
+            std::string url;
+            std::string appPath;
+            std::string volume;
+            std::int64_t created{};
+            std::map<std::string, std::string> metadata;
+            // type, id, version of the installed packages this version depends on
+            std::vector<std::tuple<std::string, std::string, std::string> > dependencies;
+            // digests of the image layers, in manifest order
+            std::vector<std::string> layers;
+        };
+
+        struct App
+        {
+            std::string type;
+            std::string id;
+            std::string dataPath;
+            std::int64_t created{};
+            std::vector<Version> versions;  // in installation order
+        };
+
+        // type, id, version, key - the entity a change log entry is about
+        using Entity = std::tuple<std::string, std::string, std::string, std::string>;
+
+        class Record;
+
+        const std::string log_name = "apps.kv";
+        const std::string log_path;
+        const std::vector<std::string> search_metadata_keys;
+        const unsigned int change_log_size;
+
+        mutable std::shared_timed_mutex mutex;
+        int log_fd{-1};
+        std::uint64_t log_bytes{0};
+        // records in the log, compared with the live entries to decide on compaction
+        std::uint64_t log_records{0};
+
+        // apps in creation order, the key never changes
+        std::map<std::uint64_t, App> apps;
+        std::unordered_map<std::string, std::uint64_t> apps_by_id;
+        std::uint64_t next_app_key{0};
+
+        std::uint64_t generation{0};
+        std::uint64_t trimmed_through{0};
+        std::map<std::uint64_t, Change> change_log;
+        std::map<Entity, std::uint64_t> change_log_by_entity;
+
+        void Terminate();
+        void Load();
+        bool Replay(const char* data, std::uint64_t size, std::uint64_t& offset);
+        void Append(const Record& record);
+        void Commit(Record& record);
+        void CompactIfNeeded();
+        void Compact();
+        void Apply(Record& record);
+        void Reset();
+
+        App* FindApp(const std::string& type, const std::string& id, bool anyType);
+        const App* FindApp(const std::string& type, const std::string& id, bool anyType) const;
+        Version* FindVersion(const std::string& type, const std::string& id, const std::string& version, bool anyType);
+        const Version* FindVersion(const std::string& type, const std::string& id, const std::string& version, bool anyType) const;
+        std::uint64_t LiveEntries() const;
+        unsigned int RefCount(const std::string& type, const std::string& id, const std::string& version) const;
+
+        // the change log follows the triggers of SqlDataStorage
+        void LogChange(const std::string& change, const Entity& entity);
+        void DropChanges(const std::string& type, const std::string& id, const std::string* version);
+    };
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -19,6 +19,7 @@
 
 #pragma once
 #include "Module.h"
+#include "OperationStatusFilter.h"
 #include <interfaces/json/JsonData_LISA.h>
 #include <interfaces/ILISA.h>
 
@@ -111,11 +112,16 @@ class LISA : public PluginHost::IPlugin, public PluginHost::JSONRPC {
         PluginHost::IShell* _service;
         Exchange::ILISA* _lisa;
         Core::Sink<Notification> _notification;
+        OperationStatusFilters _operationStatusFilters;
 
     // JSON-RPC
     private:
         void Register(PluginHost::JSONRPC& module, Exchange::ILISA* destination);
         void Unregister(PluginHost::JSONRPC& module);
+        // event (un)registrations and closed channels, so operationStatus filters follow their subscribers
+        uint32_t Subscribe(const uint32_t channelId, const string& eventId, const string& designator) override;
+        uint32_t Unsubscribe(const uint32_t channelId, const string& eventId, const string& designator) override;
+        void Close(const uint32_t channelId) override;
         void SendEventOperationStatus(PluginHost::JSONRPC& module, const string& handle, const string& operation,
                                       const string& type, const string& id,
                                       const string& version, const string& status, const string& details);
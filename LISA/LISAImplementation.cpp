@@ -21,6 +21,9 @@
 #include "Executor.h"
 #include "Filesystem.h"
 #include "DataStorage.h"
+#include "KeyValueIterator.h"
+#include "NotificationDispatcher.h"
+#include "PackedPayload.h"
 
 #include <interfaces/ILISA.h>
 #include <string>
@@ -52,6 +55,23 @@ public:
         return executor.Install(type, id, version, url, appName, category, handle);
     }
 
+    uint32_t InstallWithPriority(const std::string& type,
+            const std::string& id,
+            const std::string& version,
+            const std::string& url,
+            const std::string& appName,
+            const std::string& category,
+            const std::string& priority,
+            std::string& handle /* @out */) override
+    {
+        LISA::Executor::Priority taskPriority;
+        if (!LISA::Executor::priorityFromStr(priority, taskPriority)) {
+            handle = "WrongParams";
+            return LISA::Executor::ERROR_WRONG_PARAMS;
+        }
+        return executor.Install(type, id, version, url, appName, category, handle, taskPriority);
+    }
+
     uint32_t Uninstall(const std::string& type,
             const std::string& id,
             const std::string& version,
@@ -61,6 +81,30 @@ public:
         return executor.Uninstall(type, id, version, uninstallType, handle);
     }
 
+    uint32_t UninstallWithPriority(const std::string& type,
+            const std::string& id,
+            const std::string& version,
+            const std::string& uninstallType,
+            const std::string& priority,
+            std::string& handle /* @out */) override
+    {
+        LISA::Executor::Priority taskPriority;
+        if (!LISA::Executor::priorityFromStr(priority, taskPriority)) {
+            handle = "WrongParams";
+            return LISA::Executor::ERROR_WRONG_PARAMS;
+        }
+        return executor.Uninstall(type, id, version, uninstallType, handle, taskPriority);
+    }
+
+    uint32_t Move(const std::string& type,
+            const std::string& id,
+            const std::string& version,
+            const std::string& volume,
+            std::string& handle /* @out */) override
+    {
+        return executor.Move(type, id, version, volume, handle);
+    }
+
     class HandleResultImpl : public ILISA::IHandleResult
     {
     public:
@@ -270,122 +314,6 @@ public:
         END_INTERFACE_MAP
     }; // StoragePayload
 
-    class KeyValueImpl : public ILISA::IKeyValue
-    {
-    public:
-        KeyValueImpl() = delete;
-        KeyValueImpl(const KeyValueImpl&) = delete;
-        KeyValueImpl& operator=(const KeyValueImpl&) = delete;
-
-        KeyValueImpl(const std::string key, const std::string value)
-            : _key(key), _value(value)
-        {
-        }
-
-        ~KeyValueImpl() override
-        {
-        }
-
-        uint32_t Key(std::string& key) const override
-        {
-            key = _key;
-            return Core::ERROR_NONE;
-        }
-
-        uint32_t Value(std::string& value) const override
-        {
-            value = _value;
-            return Core::ERROR_NONE;
-        }
-
-    private:
-        std::string _key;
-        std::string _value;
-
-    public:
-        BEGIN_INTERFACE_MAP(KeyValueImpl)
-            INTERFACE_ENTRY(Exchange::ILISA::IKeyValue)
-        END_INTERFACE_MAP
-    }; // class KeyValueImpl
-
-    class KeyValueIteratorImpl : public ILISA::IKeyValueIterator {
-        public:
-            KeyValueIteratorImpl() = delete;
-            KeyValueIteratorImpl(const KeyValueIteratorImpl&) = delete;
-            KeyValueIteratorImpl& operator=(const KeyValueIteratorImpl&) = delete;
-
-            KeyValueIteratorImpl(const std::list<KeyValueImpl*>& container)
-            {
-                std::list<KeyValueImpl*>::const_iterator index = container.begin();
-                while (index != container.end()) {
-                    ILISA::IKeyValue* element = (*index);
-                    element->AddRef();
-                    _list.push_back(element);
-                    index++;
-                }
-            }
-
-            ~KeyValueIteratorImpl() override
-            {
-                while (_list.size() != 0) {
-                    _list.front()->Release();
-                    _list.pop_front();
-                }
-            }
-
-        public:
-            uint32_t Reset() override
-            {
-                _index = 0;
-                return Core::ERROR_NONE;
-            }
-
-            bool IsValid() const
-            {
-                return ((_index != 0) && (_index <= _list.size()));
-            }
-
-            uint32_t IsValid(bool& isValid) const override
-            {
-                isValid = IsValid();
-                return Core::ERROR_NONE;
-            }
-
-            uint32_t Next(bool& hasNext) override
-            {
-                if (_index == 0) {
-                    _index = 1;
-                    _iterator = _list.begin();
-                } else if (_index <= _list.size()) {
-                    _index++;
-                    _iterator++;
-                }
-                hasNext = IsValid();
-                return Core::ERROR_NONE;
-            }
-
-            uint32_t Current(ILISA::IKeyValue*& keyValue) const override
-            {
-                ASSERT(IsValid() == true);
-                ILISA::IKeyValue* result = nullptr;
-                result = (*_iterator);
-                ASSERT(result != nullptr);
-                result->AddRef();
-                keyValue = result;
-                return Core::ERROR_NONE;
-            }
-
-        private:
-            uint32_t _index = 0;
-            std::list<ILISA::IKeyValue*> _list;
-            std::list<ILISA::IKeyValue*>::iterator _iterator;
-
-        public:
-            BEGIN_INTERFACE_MAP(KeyValueIteratorImpl)
-                INTERFACE_ENTRY(Exchange::ILISA::IKeyValueIterator)
-            END_INTERFACE_MAP
-    }; // class KeyValueIteratorImpl
-
     class MetadataPayloadImpl : public ILISA::IMetadataPayload
     {
     public:
@@ -484,6 +412,27 @@ public:
         return executor.SetMetadata(type, id, version, key, value);
     }
 
+    uint32_t SetAuxMetadataBatch(const std::string& type,
+            const std::string& id,
+            const std::string& version,
+            ILISA::IKeyValueIterator* metadata) override
+    {
+        std::vector<std::pair<std::string, std::string> > keyValues;
+        bool hasNext = false;
+        while (metadata != nullptr && metadata->Next(hasNext) == Core::ERROR_NONE && hasNext) {
+            ILISA::IKeyValue* keyValue = nullptr;
+            if (metadata->Current(keyValue) != Core::ERROR_NONE || keyValue == nullptr) {
+                return Core::ERROR_GENERAL;
+            }
+            std::string key, value;
+            keyValue->Key(key);
+            keyValue->Value(value);
+            keyValue->Release();
+            keyValues.emplace_back(key, value);
+        }
+        return executor.SetMetadataBatch(type, id, version, keyValues);
+    }
+
     uint32_t ClearAuxMetadata(const std::string& type,
             const std::string& id,
             const std::string& version,
@@ -499,27 +448,47 @@ public:
     {
         LISA::DataStorage::AppMetadata appMetadata;
         auto rc = executor.GetMetadata(type, id, version, appMetadata);
+        if (rc != Core::ERROR_NONE) {
+            appMetadata.metadata.clear();
+        }
+        result = createMetadataPayload(appMetadata);
+        return Core::ERROR_NONE;
+    }
+
+    // same as GetMetadata, the whole payload packed in one JSON string
+    uint32_t GetMetadataPacked(const std::string& type,
+            const std::string& id,
+            const std::string& version,
+            std::string& payload) override
+    {
+        LISA::DataStorage::AppMetadata appMetadata;
+        auto rc = executor.GetMetadata(type, id, version, appMetadata);
+        if (rc != Core::ERROR_NONE) {
+            appMetadata.metadata.clear();
+        }
+        payload = LISA::packMetadata(appMetadata);
+        return Core::ERROR_NONE;
+    }
 
+    static ILISA::IMetadataPayload* createMetadataPayload(const LISA::DataStorage::AppMetadata& appMetadata)
+    {
         std::list<KeyValueImpl*> resources;
         std::list<KeyValueImpl*> auxMetadata;
 
-        if (rc == Core::ERROR_NONE) {
-            // TODO: add resources (downloads) to the result here when download function is implemented
+        // TODO: add resources (downloads) to the result here when download function is implemented
 
-            // Add metadata to the result
-            for (auto pair : appMetadata.metadata)
-            {
-                KeyValueImpl* keyValue = Core::Service<KeyValueImpl>::Create<KeyValueImpl>(
-                    pair.first, pair.second);
-                auxMetadata.push_back(keyValue);
-            }
+        // Add metadata to the result
+        for (auto pair : appMetadata.metadata)
+        {
+            KeyValueImpl* keyValue = Core::Service<KeyValueImpl>::Create<KeyValueImpl>(
+                pair.first, pair.second);
+            auxMetadata.push_back(keyValue);
         }
 
         ILISA::IMetadataPayload* metadataPayload = Core::Service<MetadataPayloadImpl>::Create<ILISA::IMetadataPayload>(
             appMetadata.appDetails.appName, appMetadata.appDetails.category, appMetadata.appDetails.url,
             resources, auxMetadata
         );
-        result = metadataPayload;
 
         for (auto res : resources) {
             res->Release();
@@ -527,7 +496,50 @@ public:
         for (auto meta : auxMetadata) {
             meta->Release();
         }
-        return Core::ERROR_NONE;
+        return metadataPayload;
+    }
+
+    // the batch calls take and return one packed JSON document, see PackedPayload.h
+    uint32_t InstallBatch(const std::string& items, std::string& results /* @out */) override
+    {
+        std::vector<LISA::Executor::BatchItem> batch;
+        if (!LISA::unpackBatchItems(items, batch)) {
+            return LISA::Executor::ERROR_WRONG_PARAMS;
+        }
+        std::vector<LISA::Executor::BatchResult> batchResults;
+        auto rc = executor.InstallBatch(batch, batchResults);
+        if (rc == Core::ERROR_NONE) {
+            results = LISA::packBatchResults(batch, batchResults, false);
+        }
+        return rc;
+    }
+
+    uint32_t UninstallBatch(const std::string& items, std::string& results /* @out */) override
+    {
+        std::vector<LISA::Executor::BatchItem> batch;
+        if (!LISA::unpackBatchItems(items, batch)) {
+            return LISA::Executor::ERROR_WRONG_PARAMS;
+        }
+        std::vector<LISA::Executor::BatchResult> batchResults;
+        auto rc = executor.UninstallBatch(batch, batchResults);
+        if (rc == Core::ERROR_NONE) {
+            results = LISA::packBatchResults(batch, batchResults, false);
+        }
+        return rc;
+    }
+
+    uint32_t GetMetadataBatch(const std::string& items, std::string& results /* @out */) override
+    {
+        std::vector<LISA::Executor::BatchItem> batch;
+        if (!LISA::unpackBatchItems(items, batch)) {
+            return LISA::Executor::ERROR_WRONG_PARAMS;
+        }
+        std::vector<LISA::Executor::BatchResult> batchResults;
+        auto rc = executor.GetMetadataBatch(batch, batchResults);
+        if (rc == Core::ERROR_NONE) {
+            results = LISA::packBatchResults(batch, batchResults, true);
+        }
+        return rc;
     }
 
     uint32_t Cancel(const std::string& handle) override
@@ -535,11 +547,42 @@ public:
         return executor.Cancel(handle);
     }
 
+    uint32_t Pause(const std::string& handle) override
+    {
+        return executor.Pause(handle);
+    }
+
+    uint32_t Resume(const std::string& handle) override
+    {
+        return executor.Resume(handle);
+    }
+
     uint32_t GetProgress(const std::string& handle, uint32_t& progress) override
     {
         return executor.GetProgress(handle, progress);
     }
 
+    // queued, running and recently finished jobs packed in one JSON string
+    uint32_t ListJobs(std::string& payload) override
+    {
+        std::vector<LISA::JobInfo> jobs;
+        auto rc = executor.ListJobs(jobs);
+        if (rc == Core::ERROR_NONE) {
+            payload = LISA::packJobs(jobs);
+        }
+        return rc;
+    }
+
+    uint32_t GetJob(const std::string& handle, std::string& payload) override
+    {
+        LISA::JobInfo job;
+        auto rc = executor.GetJob(handle, job);
+        if (rc == Core::ERROR_NONE) {
+            payload = LISA::packJob(job);
+        }
+        return rc;
+    }
+
     uint32_t Configure(const std::string& config) override
     {
         return executor.Configure(config);
@@ -553,6 +596,9 @@ public:
 
         _notificationCallbacks.push_back(notification);
         notification->AddRef();
+        dispatcher.subscribe(notification, [notification](const LISA::Executor::OperationStatusEvent& event) {
+            notification->operationStatus(event.handle, event.operationStr(), event.type, event.id, event.version, event.statusStr(), event.details);
+        });
 
         INFO("Register INotification: ", notification);
 
@@ -568,6 +614,7 @@ public:
         ASSERT(index != _notificationCallbacks.end());
 
         if (index != _notificationCallbacks.end()) {
+            dispatcher.unsubscribe(notification);
             (*index)->Release();
             _notificationCallbacks.erase(index);
         }
@@ -578,10 +625,8 @@ private:
     void onOperationStatus(const LISA::Executor::OperationStatusEvent& event)
     {
         INFO("LISA onOperationStatus handle:", event.handle, " status: ", event.status, " details: ", event.details);
-        LockGuard lock(notificationMutex);
-        for(const auto index: _notificationCallbacks) {
-            index->operationStatus(event.handle, event.operationStr(), event.type, event.id, event.version, event.statusStr(), event.details);
-        }
+        // called on the install worker, every subscriber is notified from its own dispatcher thread
+        dispatcher.post(event);
     }
 
 public:
@@ -900,6 +945,176 @@ public:
         END_INTERFACE_MAP
     }; // AppsPayloadImpl
 
+    class ChangeImpl : public ILISA::IChange
+    {
+    public:
+        class IteratorImpl : public ILISA::IChange::IIterator {
+        public:
+            IteratorImpl() = delete;
+            IteratorImpl(const IteratorImpl&) = delete;
+            IteratorImpl& operator=(const IteratorImpl&) = delete;
+
+            IteratorImpl(const std::list<ChangeImpl*>& container)
+            {
+                std::list<ChangeImpl*>::const_iterator index = container.begin();
+                while (index != container.end()) {
+                    ILISA::IChange* element = (*index);
+                    element->AddRef();
+                    _list.push_back(element);
+                    index++;
+                }
+            }
+
+            ~IteratorImpl() override
+            {
+                while (_list.size() != 0) {
+                    _list.front()->Release();
+                    _list.pop_front();
+                }
+            }
+
+        public:
+            uint32_t Reset() override
+            {
+                _index = 0;
+                return Core::ERROR_NONE;
+            }
+
+            bool IsValid() const
+            {
+                return ((_index != 0) && (_index <= _list.size()));
+            }
+
+            uint32_t IsValid(bool& isValid) const override
+            {
+                isValid = IsValid();
+                return Core::ERROR_NONE;
+            }
+
+            uint32_t Next(bool& hasNext) override
+            {
+                if (_index == 0) {
+                    _index = 1;
+                    _iterator = _list.begin();
+                } else if (_index <= _list.size()) {
+                    _index++;
+                    _iterator++;
+                }
+                hasNext = IsValid();
+                return Core::ERROR_NONE;
+            }
+
+            uint32_t Current(ILISA::IChange*& change) const override
+            {
+                ASSERT(IsValid() == true);
+                ILISA::IChange* result = nullptr;
+                result = (*_iterator);
+                ASSERT(result != nullptr);
+                result->AddRef();
+                change = result;
+                return Core::ERROR_NONE;
+            }
+
+        public:
+            BEGIN_INTERFACE_MAP(ChangeImpl::IteratorImpl)
+                INTERFACE_ENTRY(Exchange::ILISA::IChange::IIterator)
+            END_INTERFACE_MAP
+
+        private:
+            uint32_t _index = 0;
+            std::list<ILISA::IChange*> _list;
+            std::list<ILISA::IChange*>::iterator _iterator;
+        }; // class IteratorImpl
+
+    public:
+        ChangeImpl() = delete;
+        ChangeImpl(const ChangeImpl&) = delete;
+        ChangeImpl& operator=(const ChangeImpl&) = delete;
+
+        ChangeImpl(const LISA::DataStorage::Change& change)
+            : _change(change)
+        {
+        }
+
+        ~ChangeImpl() override
+        {
+        }
+
+        uint32_t Generation(uint64_t& generation) const override
+        {
+            generation = _change.generation;
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Change(std::string& change) const override
+        {
+            change = _change.change;
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Type(std::string& type) const override
+        {
+            type = _change.type;
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Id(std::string& id) const override
+        {
+            id = _change.id;
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Version(std::string& version) const override
+        {
+            version = _change.version;
+            return Core::ERROR_NONE;
+        }
+
+        uint32_t Key(std::string& key) const override
+        {
+            key = _change.key;
+            return Core::ERROR_NONE;
+        }
+
+    private:
+        LISA::DataStorage::Change _change;
+
+    public:
+        BEGIN_INTERFACE_MAP(ChangeImpl)
+            INTERFACE_ENTRY(Exchange::ILISA::IChange)
+        END_INTERFACE_MAP
+    }; // class ChangeImpl
+
+    uint32_t GetChanges(const uint64_t sinceGeneration,
+            uint64_t& generation,
+            bool& complete,
+            ILISA::IChange::IIterator*& changes) const override
+    {
+        INFO(" ");
+
+        LISA::DataStorage::ChangeSet changeSet;
+        auto rc = executor.GetChanges(sinceGeneration, changeSet);
+        if (rc == Core::ERROR_NONE) {
+            generation = changeSet.generation;
+            complete = changeSet.complete;
+
+            std::list<ChangeImpl*> changeList;
+            for (const auto& change : changeSet.changes) {
+                changeList.push_back(Core::Service<ChangeImpl>::Create<ChangeImpl>(change));
+            }
+            changes = Core::Service<ChangeImpl::IteratorImpl>::Create<ILISA::IChange::IIterator>(changeList);
+            for (auto change : changeList) {
+                change->Release();
+            }
+        }
+        return rc;
+    }
+
+    uint32_t RepairPermissions() override
+    {
+        return executor.RepairPermissions();
+    }
+
     /* @brief List installed applications. */
     uint32_t GetList(
         const std::string& type,
@@ -947,6 +1162,105 @@ public:
         return rc;
     }
 
+    // same as GetList, the whole list packed in one JSON string
+    uint32_t GetListPacked(
+        const std::string& type,
+        const std::string& id,
+        const std::string& version,
+        const std::string& appName,
+        const std::string& category,
+        std::string& payload) const override
+    {
+        INFO(" ");
+
+        std::vector<LISA::DataStorage::AppDetails> appsDetailsList{};
+        auto rc = executor.GetAppDetailsList(type, id, version, appName, category, appsDetailsList);
+        if (rc == Core::ERROR_NONE) {
+            payload = LISA::packAppsList(appsDetailsList);
+        }
+        return rc;
+    }
+
+    uint32_t GetListPage(
+        const std::string& type,
+        const std::string& id,
+        const std::string& version,
+        const std::string& appName,
+        const std::string& category,
+        const std::string& sortBy,
+        const std::string& sortOrder,
+        const std::string& cursor,
+        const uint32_t limit,
+        IAppsPayload*& result,
+        std::string& nextCursor) const override
+    {
+        INFO(" ");
+
+        std::vector<LISA::DataStorage::AppDetails> appsDetailsList{};
+        auto rc = executor.GetAppDetailsPage(type, id, version, appName, category, sortBy, sortOrder, cursor, limit,
+                                             appsDetailsList, nextCursor);
+        if (rc == Core::ERROR_NONE) {
+            result = createAppsPayload(appsDetailsList);
+        }
+        return rc;
+    }
+
+    uint32_t Search(const std::string& query, IAppsPayload*& result) const override
+    {
+        INFO(" ");
+
+        std::vector<LISA::DataStorage::AppDetails> appsDetailsList{};
+        auto rc = executor.SearchApps(query, appsDetailsList);
+        if (rc == Core::ERROR_NONE) {
+            result = createAppsPayload(appsDetailsList);
+        }
+        return rc;
+    }
+
+    uint32_t GetListByMetadata(const std::string& key, const std::string& value, IAppsPayload*& result) const override
+    {
+        INFO(" ");
+
+        std::vector<LISA::DataStorage::AppDetails> appsDetailsList{};
+        auto rc = executor.GetAppDetailsListByMetadata(key, value, appsDetailsList);
+        if (rc == Core::ERROR_NONE) {
+            result = createAppsPayload(appsDetailsList);
+        }
+        return rc;
+    }
+
+    // groups the versions by app, apps keep the order in which they first appear in the list
+    static ILISA::IAppsPayload* createAppsPayload(const std::vector<LISA::DataStorage::AppDetails>& appsDetailsList)
+    {
+        std::vector<std::pair<const LISA::DataStorage::AppDetails*, std::list<AppVersionImpl*>>> appsDet;
+        std::map<std::pair<std::string, std::string>, size_t> appIndex;
+        for (const auto& app : appsDetailsList) {
+            auto inserted = appIndex.emplace(std::make_pair(app.type, app.id), appsDet.size());
+            if (inserted.second) {
+                appsDet.emplace_back(&app, std::list<AppVersionImpl*>{});
+            }
+            if (!app.version.empty()) {
+                appsDet[inserted.first->second].second.push_back(
+                        Core::Service<AppVersionImpl>::Create<AppVersionImpl>(app.version, app.appName,
+                                                                              app.category, app.url));
+            }
+        }
+        std::list<AppImpl*> apps;
+        for (const auto& app : appsDet) {
+            apps.push_back(Core::Service<AppImpl>::Create<AppImpl>(app.first->type, app.first->id, app.second));
+            for (auto appVersion : app.second) {
+                appVersion->Release();
+            }
+        }
+
+        ILISA::IAppsPayload* appsPayload = Core::Service<AppsPayloadImpl>::Create<ILISA::IAppsPayload>(apps);
+
+        for (auto app : apps) {
+            app->Release();
+        }
+        return appsPayload;
+    }
+
     uint32_t GetStorageDetails(const std::string& type,
             const std::string& id,
             const std::string& version,
@@ -966,6 +1280,8 @@ public:
     }
 
 private:
+    // declared before the executor, whose worker posts to it until destroyed
+    LISA::NotificationDispatcher dispatcher;
     LISA::Executor executor{
         [this](const LISA::Executor::OperationStatusEvent& event)
         {
@@ -18,6 +18,7 @@
  */
 
 #include "Debug.h"
+#include "KeyValueIterator.h"
 #include "LISA.h"
 
 #include <memory>
@@ -52,6 +53,77 @@ namespace Plugin {
 
     using namespace JsonData::LISA;
 
+namespace { // anonymous
+
+    // converts the apps payload of GetList and similar calls to the JSON response
+    uint32_t toAppsList(Exchange::ILISA::IAppsPayload* appList, AppslistpayloadData& response)
+    {
+        using namespace Exchange;
+
+        uint32_t errorCode = Core::ERROR_NONE;
+        ILISA::IApp::IIterator* appsRaw = nullptr;
+        errorCode = appList->Apps(appsRaw);
+        auto apps = makeUniqueRpc(appsRaw);
+        if (errorCode != Core::ERROR_NONE) {
+            ERROR("Apps() result: ", errorCode);
+            return errorCode;
+        }
+
+        // Loop through apps in the response
+        bool hasNext = false;
+        while ((errorCode = apps->Next(hasNext)) == Core::ERROR_NONE && hasNext)
+        {
+            ILISA::IApp* iAppRaw = nullptr;
+            errorCode = apps->Current(iAppRaw);
+            auto iApp = makeUniqueRpc(iAppRaw);
+            if (errorCode != Core::ERROR_NONE) {
+                ERROR("Current() result: ", errorCode);
+                return errorCode;
+            }
+
+            AppslistpayloadData::AppData app;
+            std::string val;
+            iApp->Id(val);
+            app.Id = Core::ToString(val);
+            INFO("GetList app: ", val);
+            iApp->Type(val);
+            app.Type = Core::ToString(val);
+
+            ILISA::IAppVersion::IIterator* versionsRaw = nullptr;
+            errorCode = iApp->Installed(versionsRaw);
+            auto versions = makeUniqueRpc(versionsRaw);
+            if (errorCode != Core::ERROR_NONE) {
+               ERROR("Installed() result: ", errorCode);
+               return errorCode;
+            }
+
+            // Loop through versions of a single app
+            while ((errorCode = versions->Next(hasNext)) == Core::ERROR_NONE && hasNext)
+            {
+                ILISA::IAppVersion* iVersionRaw = nullptr;
+                errorCode = versions->Current(iVersionRaw);
+                auto iVersion = makeUniqueRpc(iVersionRaw);
+                if (errorCode != Core::ERROR_NONE) {
+                    ERROR("Current() result: ", errorCode);
+                    return errorCode;
+                }
+
+                AppslistpayloadData::AppData::InstalledappData installedApp;
+                iVersion->Version(val);
+                installedApp.Version = Core::ToString(val);
+                iVersion->AppName(val);
+                installedApp.AppName = Core::ToString(val);
+                iVersion->Url(val);
+                installedApp.Url = Core::ToString(val);
+                app.Installed.Add(installedApp);
+            }
+            response.Apps.Add(app);
+        }
+        return errorCode;
+    }
+
+} // namespace anonymous
+
     void LISA::Register(PluginHost::JSONRPC& module, Exchange::ILISA* destination)
     {
         ASSERT(destination != nullptr);
@@ -63,13 +135,24 @@ namespace Plugin {
                 INFO("Install");
 
                 std::string result;
-                errorCode = destination->Install(
-                    params.Type.Value(),
-                    params.Id.Value(),
-                    params.Version.Value(),
-                    params.Url.Value(),
-                    params.AppName.Value(),
-                    params.Category.Value(), result);
+                if (params.Priority.IsSet()) {
+                    errorCode = destination->InstallWithPriority(
+                        params.Type.Value(),
+                        params.Id.Value(),
+                        params.Version.Value(),
+                        params.Url.Value(),
+                        params.AppName.Value(),
+                        params.Category.Value(),
+                        params.Priority.Value(), result);
+                } else {
+                    errorCode = destination->Install(
+                        params.Type.Value(),
+                        params.Id.Value(),
+                        params.Version.Value(),
+                        params.Url.Value(),
+                        params.AppName.Value(),
+                        params.Category.Value(), result);
+                }
                 response = result;
 
                 INFO("Install finished with code: ", errorCode);
@@ -83,14 +166,41 @@ namespace Plugin {
                 INFO("Uninstall");
 
                 std::string result;
-                errorCode = destination->Uninstall(
+                if (params.Priority.IsSet()) {
+                    errorCode = destination->UninstallWithPriority(
+                        params.Type.Value(),
+                        params.Id.Value(),
+                        params.Version.Value(),
+                        params.UninstallType.Value(),
+                        params.Priority.Value(), result);
+                } else {
+                    errorCode = destination->Uninstall(
+                        params.Type.Value(),
+                        params.Id.Value(),
+                        params.Version.Value(),
+                        params.UninstallType.Value(), result);
+                }
+                response = result;
+
+                INFO("Uninstall finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        module.Register<MoveParamsData,Core::JSON::String>(_T("move"),
+            [destination, this](const MoveParamsData& params, Core::JSON::String& response) -> uint32_t
+            {
+                uint32_t errorCode = Core::ERROR_NONE;
+                INFO("Move");
+
+                std::string result;
+                errorCode = destination->Move(
                     params.Type.Value(),
                     params.Id.Value(),
                     params.Version.Value(),
-                    params.UninstallType.Value(), result);
+                    params.Volume.Value(), result);
                 response = result;
 
-                INFO("Uninstall finished with code: ", errorCode);
+                INFO("Move finished with code: ", errorCode);
                 return errorCode;
             });
 
@@ -278,6 +388,33 @@ namespace Plugin {
                 return errorCode;
             });
 
+        module.Register<SetAuxMetadataBatchParamsData,void>(_T("setAuxMetadataBatch"),
+            [destination, this](const SetAuxMetadataBatchParamsData& params) -> uint32_t
+            {
+                uint32_t errorCode = Core::ERROR_NONE;
+                INFO("SetAuxMetadataBatch");
+
+                std::list<KeyValueImpl*> keyValues;
+                auto index = params.Metadata.Elements();
+                while (index.Next()) {
+                    keyValues.push_back(Core::Service<KeyValueImpl>::Create<KeyValueImpl>(
+                        index.Current().Key.Value(), index.Current().Value.Value()));
+                }
+                auto metadata = makeUniqueRpc(Core::Service<KeyValueIteratorImpl>::Create<Exchange::ILISA::IKeyValueIterator>(keyValues));
+                for (auto keyValue : keyValues) {
+                    keyValue->Release();
+                }
+
+                errorCode = destination->SetAuxMetadataBatch(
+                    params.Type.Value(),
+                    params.Id.Value(),
+                    params.Version.Value(),
+                    metadata.get());
+
+                INFO("SetAuxMetadataBatch finished with code: ", errorCode);
+                return errorCode;
+            });
+
         module.Register<ClearAuxMetadataParamsData,void>(_T("clearAuxMetadata"),
             [destination, this](const ClearAuxMetadataParamsData& params) -> uint32_t
             {
@@ -306,89 +443,94 @@ namespace Plugin {
             {
                 INFO("GetMetadata");
                 uint32_t errorCode = Core::ERROR_NONE;
-                Exchange::ILISA::IMetadataPayload* resultRaw = nullptr;
-                Exchange::ILISA::IKeyValueIterator* resourcesRaw = nullptr;
-                Exchange::ILISA::IKeyValueIterator* auxMetadataRaw = nullptr;
-                Exchange::ILISA::IKeyValue* iKeyValueRaw = nullptr;
-                bool hasNext = false;
-                std::string val;
 
-                errorCode = destination->GetMetadata(
+                // one call for the whole payload instead of a proxied call per key/value
+                std::string payload;
+                errorCode = destination->GetMetadataPacked(
                     params.Type.Value(),
                     params.Id.Value(),
-                    params.Version.Value(), resultRaw);
+                    params.Version.Value(), payload);
 
                 if (errorCode != Core::ERROR_NONE) {
                     ERROR("LISAJsonRpc GetMetadata() result: ", errorCode);
                     return errorCode;
                 }
 
-                auto result = makeUniqueRpc(resultRaw);
+                if (!response.FromString(payload)) {
+                    ERROR("LISAJsonRpc GetMetadata() malformed payload");
+                    errorCode = Core::ERROR_GENERAL;
+                }
 
-                errorCode = result->Resources(resourcesRaw);
+                INFO("GetMetadata finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        module.Register<BatchParamsData,BatchpayloadData>(_T("installBatch"),
+            [destination, this](const BatchParamsData& params, BatchpayloadData& response) -> uint32_t
+            {
+                INFO("InstallBatch");
+
+                // items and results cross in one call each, as packed JSON documents
+                std::string items;
+                params.ToString(items);
+                std::string results;
+                uint32_t errorCode = destination->InstallBatch(items, results);
                 if (errorCode != Core::ERROR_NONE) {
-                    ERROR("LISAJsonRpc Resources() result: ", errorCode);
+                    ERROR("InstallBatch() result: ", errorCode);
                     return errorCode;
                 }
+                if (!response.FromString(results)) {
+                    ERROR("InstallBatch() malformed payload");
+                    errorCode = Core::ERROR_GENERAL;
+                }
 
-                auto resources = makeUniqueRpc(resourcesRaw);
+                INFO("InstallBatch finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        module.Register<BatchParamsData,BatchpayloadData>(_T("uninstallBatch"),
+            [destination, this](const BatchParamsData& params, BatchpayloadData& response) -> uint32_t
+            {
+                INFO("UninstallBatch");
 
-                errorCode = result->AuxMetadata(auxMetadataRaw);
+                // items and results cross in one call each, as packed JSON documents
+                std::string items;
+                params.ToString(items);
+                std::string results;
+                uint32_t errorCode = destination->UninstallBatch(items, results);
                 if (errorCode != Core::ERROR_NONE) {
-                    ERROR("LISAJsonRpc AuxMetadata() result: ", errorCode);
+                    ERROR("UninstallBatch() result: ", errorCode);
                     return errorCode;
                 }
+                if (!response.FromString(results)) {
+                    ERROR("UninstallBatch() malformed payload");
+                    errorCode = Core::ERROR_GENERAL;
+                }
 
-                auto auxMetadata = makeUniqueRpc(auxMetadataRaw);
+                INFO("UninstallBatch finished with code: ", errorCode);
+                return errorCode;
+            });
 
-                result->AppName(val);
-                response.AppName = Core::ToString(val);
-                result->Category(val);
-                response.Category = Core::ToString(val);
-                result->Url(val);
-                response.Url = Core::ToString(val);
+        module.Register<BatchParamsData,BatchpayloadData>(_T("getMetadataBatch"),
+            [destination, this](const BatchParamsData& params, BatchpayloadData& response) -> uint32_t
+            {
+                INFO("GetMetadataBatch");
 
-                // Loop through resources in the response
-                while ((errorCode = resources->Next(hasNext)) == Core::ERROR_NONE && hasNext)
-                {
-                    errorCode = resources->Current(iKeyValueRaw);
-                    if (errorCode != Core::ERROR_NONE) {
-                        ERROR("LISAJsonRpc getMetadata Current() result: ", errorCode);
-                        return errorCode;
-                    }
-                    auto iKeyValue = makeUniqueRpc(iKeyValueRaw);
-
-                    KeyvalueInfo resource;
-                    iKeyValue->Key(val);
-                    resource.Key = Core::ToString(val);
-                    INFO("LISAJsonRpc GetMetadata resource key: ", val);
-                    iKeyValue->Value(val);
-                    resource.Value = Core::ToString(val);
-                    INFO("LISAJsonRpc GetMetadata resource value: ", val);
-                    response.Resources.Add(resource);
+                // items and results cross in one call each, as packed JSON documents
+                std::string items;
+                params.ToString(items);
+                std::string results;
+                uint32_t errorCode = destination->GetMetadataBatch(items, results);
+                if (errorCode != Core::ERROR_NONE) {
+                    ERROR("GetMetadataBatch() result: ", errorCode);
+                    return errorCode;
                 }
-
-                // Loop through aux metadata in the response
-                while ((errorCode = auxMetadata->Next(hasNext)) == Core::ERROR_NONE && hasNext)
-                {
-                    errorCode = auxMetadata->Current(iKeyValueRaw);
-                    if (errorCode != Core::ERROR_NONE) {
-                        ERROR("LISAJsonRpc getMetadata Current() result: ", errorCode);
-                        return errorCode;
-                    }
-                    auto iKeyValue = makeUniqueRpc(iKeyValueRaw);
-
-                    KeyvalueInfo keyValue;
-                    iKeyValue->Key(val);
-                    keyValue.Key = Core::ToString(val);
-                    INFO("LISAJsonRpc GetMetadata keyValue key: ", val);
-                    iKeyValue->Value(val);
-                    keyValue.Value = Core::ToString(val);
-                    INFO("LISAJsonRpc GetMetadata keyValue value: ", val);
-                    response.AuxMetadata.Add(keyValue);
+                if (!response.FromString(results)) {
+                    ERROR("GetMetadataBatch() malformed payload");
+                    errorCode = Core::ERROR_GENERAL;
                 }
 
-                INFO("GetMetadata finished with code: ", errorCode);
+                INFO("GetMetadataBatch finished with code: ", errorCode);
                 return errorCode;
             });
 
@@ -406,6 +548,31 @@ namespace Plugin {
                 return errorCode;
             });
 
+        // CancelParamsInfo is used instead of PauseParamsInfo and ResumeParamsInfo, see getProgress
+        using PauseParamsInfo = CancelParamsInfo;
+        module.Register<PauseParamsInfo,Core::JSON::String>(_T("pause"),
+            [destination, this](const PauseParamsInfo& params, Core::JSON::String& response) -> uint32_t
+            {
+                INFO("Pause");
+                uint32_t errorCode = destination->Pause(params.Handle.Value());
+                response = std::string{};
+
+                INFO("Pause finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        using ResumeParamsInfo = CancelParamsInfo;
+        module.Register<ResumeParamsInfo,Core::JSON::String>(_T("resume"),
+            [destination, this](const ResumeParamsInfo& params, Core::JSON::String& response) -> uint32_t
+            {
+                INFO("Resume");
+                uint32_t errorCode = destination->Resume(params.Handle.Value());
+                response = std::string{};
+
+                INFO("Resume finished with code: ", errorCode);
+                return errorCode;
+            });
+
         // CancelParamsInfo is used instead of GetProgressParamsInfo which
         // simply wasn't generated. See the comment for getMetadata as this
         // is the same case
@@ -425,6 +592,48 @@ namespace Plugin {
                 return errorCode;
             });
 
+        module.Register<void,JobspayloadData>(_T("listJobs"),
+            [destination, this](JobspayloadData& response) -> uint32_t
+            {
+                INFO("ListJobs");
+
+                std::string payload;
+                uint32_t errorCode = destination->ListJobs(payload);
+                if (errorCode != Core::ERROR_NONE) {
+                    ERROR("ListJobs() result: ", errorCode);
+                    return errorCode;
+                }
+                if (!response.FromString(payload)) {
+                    ERROR("ListJobs() malformed payload");
+                    return Core::ERROR_GENERAL;
+                }
+
+                INFO("ListJobs finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        // CancelParamsInfo is used instead of GetJobParamsInfo, see getProgress
+        using GetJobParamsInfo = CancelParamsInfo;
+        module.Register<GetJobParamsInfo,JobInfo>(_T("getJob"),
+            [destination, this](const GetJobParamsInfo& params, JobInfo& response) -> uint32_t
+            {
+                INFO("GetJob");
+
+                std::string payload;
+                uint32_t errorCode = destination->GetJob(params.Handle.Value(), payload);
+                if (errorCode != Core::ERROR_NONE) {
+                    ERROR("GetJob() result: ", errorCode);
+                    return errorCode;
+                }
+                if (!response.FromString(payload)) {
+                    ERROR("GetJob() malformed payload");
+                    return Core::ERROR_GENERAL;
+                }
+
+                INFO("GetJob finished with code: ", errorCode);
+                return errorCode;
+            });
+
         module.Register<GetListParamsData,AppslistpayloadData>(_T("getList"),
             [destination, this](const GetListParamsData& params, AppslistpayloadData& response) -> uint32_t
             {
@@ -433,80 +642,177 @@ namespace Plugin {
                 INFO("GetList");
 
                 uint32_t errorCode = Core::ERROR_NONE;
-                ILISA::IAppsPayload* appListRaw = nullptr;
-                errorCode = destination->GetList(
-                    params.Type.Value(),
-                    params.Id.Value(),
-                    params.Version.Value(),
-                    params.AppName.Value(),
-                    params.Category.Value(), appListRaw);
-                auto appList = makeUniqueRpc(appListRaw);
-
-                if (errorCode != Core::ERROR_NONE) {
-                    ERROR("GetList() result: ", errorCode);
-                    return errorCode;
+                if (params.Limit.IsSet() || params.Cursor.IsSet() || params.SortBy.IsSet() || params.SortOrder.IsSet()) {
+                    ILISA::IAppsPayload* appListRaw = nullptr;
+                    std::string nextCursor;
+                    errorCode = destination->GetListPage(
+                        params.Type.Value(),
+                        params.Id.Value(),
+                        params.Version.Value(),
+                        params.AppName.Value(),
+                        params.Category.Value(),
+                        params.SortBy.Value(),
+                        params.SortOrder.Value(),
+                        params.Cursor.Value(),
+                        params.Limit.Value(), appListRaw, nextCursor);
+                    auto appList = makeUniqueRpc(appListRaw);
+                    if (errorCode != Core::ERROR_NONE) {
+                        ERROR("GetList() result: ", errorCode);
+                        return errorCode;
+                    }
+                    if (!nextCursor.empty()) {
+                        response.Cursor = nextCursor;
+                    }
+                    errorCode = toAppsList(appList.get(), response);
+                } else {
+                    // one call for the whole list instead of a proxied call per app and version
+                    std::string payload;
+                    errorCode = destination->GetListPacked(
+                        params.Type.Value(),
+                        params.Id.Value(),
+                        params.Version.Value(),
+                        params.AppName.Value(),
+                        params.Category.Value(), payload);
+                    if (errorCode != Core::ERROR_NONE) {
+                        ERROR("GetList() result: ", errorCode);
+                        return errorCode;
+                    }
+                    if (!response.FromString(payload)) {
+                        ERROR("GetList() malformed payload");
+                        return Core::ERROR_GENERAL;
+                    }
                 }
 
-                ILISA::IApp::IIterator* appsRaw = nullptr;
-                errorCode = appList->Apps(appsRaw);
-                auto apps = makeUniqueRpc(appsRaw);
+                INFO("GetList finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        module.Register<GetChangesParamsData,ChangespayloadData>(_T("getChanges"),
+            [destination, this](const GetChangesParamsData& params, ChangespayloadData& response) -> uint32_t
+            {
+                INFO("GetChanges");
+
+                uint64_t generation = 0;
+                bool complete = false;
+                Exchange::ILISA::IChange::IIterator* changesRaw = nullptr;
+                uint32_t errorCode = destination->GetChanges(params.Since.Value(), generation, complete, changesRaw);
+                auto changes = makeUniqueRpc(changesRaw);
                 if (errorCode != Core::ERROR_NONE) {
-                    ERROR("Apps() result: ", errorCode);
+                    ERROR("GetChanges() result: ", errorCode);
                     return errorCode;
                 }
+                response.Generation = generation;
+                response.Complete = complete;
 
-                // Loop through apps in the response
                 bool hasNext = false;
-                while ((errorCode = apps->Next(hasNext)) == Core::ERROR_NONE && hasNext)
+                while ((errorCode = changes->Next(hasNext)) == Core::ERROR_NONE && hasNext)
                 {
-                    ILISA::IApp* iAppRaw = nullptr;
-                    errorCode = apps->Current(iAppRaw);
-                    auto iApp = makeUniqueRpc(iAppRaw);
+                    Exchange::ILISA::IChange* iChangeRaw = nullptr;
+                    errorCode = changes->Current(iChangeRaw);
+                    auto iChange = makeUniqueRpc(iChangeRaw);
                     if (errorCode != Core::ERROR_NONE) {
                         ERROR("Current() result: ", errorCode);
                         return errorCode;
                     }
 
-                    AppslistpayloadData::AppData app;
+                    ChangespayloadData::ChangeData change;
+                    uint64_t changeGeneration = 0;
                     std::string val;
-                    iApp->Id(val);
-                    app.Id = Core::ToString(val);
-                    INFO("GetList app: ", val);
-                    iApp->Type(val);
-                    app.Type = Core::ToString(val);
-
-                    ILISA::IAppVersion::IIterator* versionsRaw = nullptr;
-                    errorCode = iApp->Installed(versionsRaw);
-                    auto versions = makeUniqueRpc(versionsRaw);
-                    if (errorCode != Core::ERROR_NONE) {
-                       ERROR("Installed() result: ", errorCode);
-                       return errorCode;
-                    }
+                    iChange->Generation(changeGeneration);
+                    change.Generation = changeGeneration;
+                    iChange->Change(val);
+                    change.Change = val;
+                    iChange->Type(val);
+                    change.Type = val;
+                    iChange->Id(val);
+                    change.Id = val;
+                    iChange->Version(val);
+                    change.Version = val;
+                    iChange->Key(val);
+                    change.Key = val;
+                    response.Changes.Add(change);
+                }
 
-                    // Loop through versions of a single app
-                    while ((errorCode = versions->Next(hasNext)) == Core::ERROR_NONE && hasNext)
-                    {
-                        ILISA::IAppVersion* iVersionRaw = nullptr;
-                        errorCode = versions->Current(iVersionRaw);
-                        auto iVersion = makeUniqueRpc(iVersionRaw);
-                        if (errorCode != Core::ERROR_NONE) {
-                            ERROR("Current() result: ", errorCode);
-                            return errorCode;
-                        }
-
-                        AppslistpayloadData::AppData::InstalledappData installedApp;
-                        iVersion->Version(val);
-                        installedApp.Version = Core::ToString(val);
-                        iVersion->AppName(val);
-                        installedApp.AppName = Core::ToString(val);
-                        iVersion->Url(val);
-                        installedApp.Url = Core::ToString(val);
-                        app.Installed.Add(installedApp);
-                    }
-                    response.Apps.Add(app);
+                INFO("GetChanges finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        module.Register<void,void>(_T("repairPermissions"),
+            [destination, this]() -> uint32_t
+            {
+                INFO("RepairPermissions");
+                uint32_t errorCode = destination->RepairPermissions();
+                INFO("RepairPermissions finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        // a channel filters only the events of a designator it registered for operationStatus itself
+        module.Register<SetEventFilterParamsData,void>(_T("setEventFilter"),
+            [this](const Core::JSONRPC::Context& context, const SetEventFilterParamsData& params) -> uint32_t
+            {
+                INFO("SetEventFilter client: ", params.Client.Value());
+
+                OperationStatusFilter::Criteria criteria;
+                criteria.handle = params.Handle.Value();
+                criteria.id = params.Id.Value();
+                auto index = params.Statuses.Elements();
+                while (index.Next()) {
+                    criteria.statuses.push_back(index.Current().Value());
                 }
+                criteria.progressStep = params.ProgressStep.Value();
+                criteria.progressIntervalMs = params.ProgressInterval.Value();
 
-                INFO("GetList finished with code: ", errorCode);
+                if (!_operationStatusFilters.set(context.ChannelId(), params.Client.Value(), criteria)) {
+                    ERROR("SetEventFilter: client not registered for operationStatus on this channel");
+                    return Core::ERROR_ILLEGAL_STATE;
+                }
+                return Core::ERROR_NONE;
+            });
+
+        module.Register<ClearEventFilterParamsData,void>(_T("clearEventFilter"),
+            [this](const Core::JSONRPC::Context& context, const ClearEventFilterParamsData& params) -> uint32_t
+            {
+                INFO("ClearEventFilter client: ", params.Client.Value());
+                if (!_operationStatusFilters.clear(context.ChannelId(), params.Client.Value())) {
+                    ERROR("ClearEventFilter: client not registered for operationStatus on this channel");
+                    return Core::ERROR_ILLEGAL_STATE;
+                }
+                return Core::ERROR_NONE;
+            });
+
+        module.Register<SearchParamsData,AppslistpayloadData>(_T("search"),
+            [destination, this](const SearchParamsData& params, AppslistpayloadData& response) -> uint32_t
+            {
+                INFO("Search");
+
+                Exchange::ILISA::IAppsPayload* appListRaw = nullptr;
+                uint32_t errorCode = destination->Search(params.Query.Value(), appListRaw);
+                auto appList = makeUniqueRpc(appListRaw);
+                if (errorCode != Core::ERROR_NONE) {
+                    ERROR("Search() result: ", errorCode);
+                    return errorCode;
+                }
+                errorCode = toAppsList(appList.get(), response);
+
+                INFO("Search finished with code: ", errorCode);
+                return errorCode;
+            });
+
+        module.Register<GetListByMetadataParamsData,AppslistpayloadData>(_T("getListByMetadata"),
+            [destination, this](const GetListByMetadataParamsData& params, AppslistpayloadData& response) -> uint32_t
+            {
+                INFO("GetListByMetadata");
+
+                Exchange::ILISA::IAppsPayload* appListRaw = nullptr;
+                uint32_t errorCode = destination->GetListByMetadata(params.Key.Value(), params.Value.Value(), appListRaw);
+                auto appList = makeUniqueRpc(appListRaw);
+                if (errorCode != Core::ERROR_NONE) {
+                    ERROR("GetListByMetadata() result: ", errorCode);
+                    return errorCode;
+                }
+                errorCode = toAppsList(appList.get(), response);
+
+                INFO("GetListByMetadata finished with code: ", errorCode);
                 return errorCode;
             });
     }
@@ -515,21 +821,69 @@ namespace Plugin {
     {
         module.Unregister(_T("install"));
         module.Unregister(_T("uninstall"));
+        module.Unregister(_T("move"));
         module.Unregister(_T("download"));
         module.Unregister(_T("getStorageDetails"));
         module.Unregister(_T("setAuxMetadata"));
+        module.Unregister(_T("setAuxMetadataBatch"));
         module.Unregister(_T("getMetadata"));
+        module.Unregister(_T("installBatch"));
+        module.Unregister(_T("uninstallBatch"));
+        module.Unregister(_T("getMetadataBatch"));
+        module.Unregister(_T("pause"));
+        module.Unregister(_T("resume"));
         module.Unregister(_T("getProgress"));
+        module.Unregister(_T("listJobs"));
+        module.Unregister(_T("getJob"));
         module.Unregister(_T("getList"));
+        module.Unregister(_T("search"));
+        module.Unregister(_T("getListByMetadata"));
+        module.Unregister(_T("getChanges"));
+        module.Unregister(_T("repairPermissions"));
+        module.Unregister(_T("setEventFilter"));
+        module.Unregister(_T("clearEventFilter"));
         module.Unregister(_T("lock"));
         module.Unregister(_T("unlock"));
         module.Unregister(_T("getLockInfo"));
     }
 
+    uint32_t LISA::Subscribe(const uint32_t channelId, const string& eventId, const string& designator)
+    {
+        auto result = PluginHost::JSONRPC::Subscribe(channelId, eventId, designator);
+        if (result == Core::ERROR_NONE && eventId == _T("operationStatus")) {
+            _operationStatusFilters.subscribe(channelId, designator);
+        }
+        return result;
+    }
+
+    uint32_t LISA::Unsubscribe(const uint32_t channelId, const string& eventId, const string& designator)
+    {
+        auto result = PluginHost::JSONRPC::Unsubscribe(channelId, eventId, designator);
+        if (result == Core::ERROR_NONE && eventId == _T("operationStatus")) {
+            _operationStatusFilters.unsubscribe(channelId, designator);
+        }
+        return result;
+    }
+
+    void LISA::Close(const uint32_t channelId)
+    {
+        _operationStatusFilters.close(channelId);
+        PluginHost::JSONRPC::Close(channelId);
+    }
+
     void LISA::SendEventOperationStatus(PluginHost::JSONRPC& module, const string& handle, const string& operation,
                                         const string& type, const string& id,
                                         const string& version, const string& status, const string& details)
     {
+        // decided on the plain strings, an event nobody wants is never serialized
+        OperationStatusFilters::Decision decision;
+        if (!_operationStatusFilters.empty()) {
+            decision = _operationStatusFilters.decide(handle, id, status, details);
+            if (!decision.any) {
+                return;
+            }
+        }
+
         OperationStatusParamsData params;
         params.Handle = handle;
         params.Operation = operation;
@@ -539,7 +893,13 @@ namespace Plugin {
         params.Status = status;
         params.Details = details;
 
-        module.Notify(_T("operationStatus"), params);
+        if (decision.subscribers.empty()) {
+            module.Notify(_T("operationStatus"), params);
+        } else {
+            module.Notify(_T("operationStatus"), params, [&decision](const string& designator) {
+                return decision.accepted(designator);
+            });
+        }
     }
 
 } // namespace Plugin
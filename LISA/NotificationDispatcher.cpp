@@ -0,0 +1,190 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NotificationDispatcher.h"
+
+#include <algorithm>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+namespace { // anonymous
+
+bool isProgress(const NotificationDispatcher::Event& event)
+{
+    return event.status == Executor::OperationStatus::PROGRESS;
+}
+
+} // namespace anonymous
+
+NotificationDispatcher::NotificationDispatcher(std::size_t aQueueLimit)
+    : queueLimit(std::max<std::size_t>(aQueueLimit, 1))
+{
+}
+
+NotificationDispatcher::~NotificationDispatcher()
+{
+    std::map<const void*, std::shared_ptr<Subscriber>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        remaining.swap(subscribers);
+    }
+    for (auto& entry : remaining) {
+        {
+            std::lock_guard<std::mutex> lock(entry.second->mutex);
+            entry.second->draining = true;
+        }
+        entry.second->wakeUp.notify_one();
+    }
+    for (auto& entry : remaining) {
+        stop(*entry.second);
+    }
+}
+
+void NotificationDispatcher::subscribe(const void* subscriber, Delivery delivery)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& entry = subscribers[subscriber];
+    if (entry) {
+        std::lock_guard<std::mutex> subscriberLock(entry->mutex);
+        entry->delivery = std::move(delivery);
+        return;
+    }
+    entry = std::make_shared<Subscriber>();
+    entry->delivery = std::move(delivery);
+    // the thread keeps its subscriber alive, also past an unsubscribe from its own delivery
+    entry->thread = std::thread{[entry]() { run(*entry); }};
+}
+
+void NotificationDispatcher::unsubscribe(const void* subscriber)
+{
+    std::shared_ptr<Subscriber> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = subscribers.find(subscriber);
+        if (it == subscribers.end()) {
+            return;
+        }
+        entry = std::move(it->second);
+        subscribers.erase(it);
+    }
+    {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        entry->stopped = true;
+    }
+    entry->wakeUp.notify_one();
+    stop(*entry);
+}
+
+void NotificationDispatcher::post(const Event& event)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& entry : subscribers) {
+        {
+            std::lock_guard<std::mutex> subscriberLock(entry.second->mutex);
+            enqueue(*entry.second, event);
+        }
+        entry.second->wakeUp.notify_one();
+    }
+}
+
+unsigned long long NotificationDispatcher::skipped(const void* subscriber) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = subscribers.find(subscriber);
+    if (it == subscribers.end()) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> subscriberLock(it->second->mutex);
+    return it->second->skipped;
+}
+
+void NotificationDispatcher::enqueue(Subscriber& subscriber, const Event& event)
+{
+    auto& queue = subscriber.queue;
+    auto sameHandleProgress = [&event](const Event& queued) {
+        return isProgress(queued) && queued.handle == event.handle;
+    };
+
+    if (!isProgress(event)) {
+        // progress still waiting is stale once the operation ended
+        auto stale = std::remove_if(queue.begin(), queue.end(), sameHandleProgress);
+        subscriber.skipped += std::distance(stale, queue.end());
+        queue.erase(stale, queue.end());
+        queue.push_back(event);
+        return;
+    }
+
+    auto pending = std::find_if(queue.begin(), queue.end(), sameHandleProgress);
+    if (pending != queue.end()) {
+        *pending = event;
+        ++subscriber.skipped;
+        return;
+    }
+    if (queue.size() >= queueLimit) {
+        auto oldest = std::find_if(queue.begin(), queue.end(), isProgress);
+        if (oldest == queue.end()) {
+            // only terminal events queued, they are kept
+            ++subscriber.skipped;
+            return;
+        }
+        queue.erase(oldest);
+        ++subscriber.skipped;
+    }
+    queue.push_back(event);
+}
+
+void NotificationDispatcher::run(Subscriber& subscriber)
+{
+    std::unique_lock<std::mutex> lock(subscriber.mutex);
+    while (true) {
+        subscriber.wakeUp.wait(lock, [&subscriber]() {
+            return subscriber.stopped || subscriber.draining || !subscriber.queue.empty();
+        });
+        if (subscriber.stopped || subscriber.queue.empty()) {
+            break;
+        }
+        Event event = std::move(subscriber.queue.front());
+        subscriber.queue.pop_front();
+        auto delivery = subscriber.delivery;
+
+        lock.unlock();
+        try {
+            delivery(event);
+        } catch (const std::exception& error) {
+            ERROR("notification delivery failed: ", error.what());
+        }
+        lock.lock();
+    }
+}
+
+void NotificationDispatcher::stop(Subscriber& subscriber)
+{
+    // a subscriber may unsubscribe from its own delivery, its thread then ends on its own
+    if (subscriber.thread.get_id() == std::this_thread::get_id()) {
+        subscriber.thread.detach();
+    } else {
+        subscriber.thread.join();
+    }
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,92 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Executor.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+/**
+ * Delivers operation status events to subscribers, each on a thread of its own,
+ * so neither the install worker nor the other subscribers wait for a slow or hung
+ * one.
+ *
+ * Every subscriber has its own queue. A PROGRESS event replaces a PROGRESS of the
+ * same handle still waiting in the queue, and a full queue drops its oldest
+ * PROGRESS event. Terminal events (SUCCESS, FAILED, CANCELLED) are never dropped.
+ */
+class NotificationDispatcher
+{
+public:
+    using Event = Executor::OperationStatusEvent;
+    using Delivery = std::function<void(const Event& event)>;
+
+    constexpr static std::size_t DEFAULT_QUEUE_LIMIT = 64;
+
+    explicit NotificationDispatcher(std::size_t queueLimit = DEFAULT_QUEUE_LIMIT);
+    NotificationDispatcher(const NotificationDispatcher&) = delete;
+    NotificationDispatcher& operator=(const NotificationDispatcher&) = delete;
+    // delivers the events already queued
+    ~NotificationDispatcher();
+
+    void subscribe(const void* subscriber, Delivery delivery);
+    // no delivery to the subscriber is in progress once this returns, unless called from it
+    void unsubscribe(const void* subscriber);
+    void post(const Event& event);
+
+    // PROGRESS events of the subscriber dropped or replaced so far
+    unsigned long long skipped(const void* subscriber) const;
+
+private:
+    struct Subscriber
+    {
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        Delivery delivery;
+        std::deque<Event> queue;
+        unsigned long long skipped{0};
+        bool draining{false};   // ends once the queue is delivered
+        bool stopped{false};    // ends without delivering the rest
+        std::thread thread;
+    };
+
+    static void run(Subscriber& subscriber);
+    void enqueue(Subscriber& subscriber, const Event& event);
+    static void stop(Subscriber& subscriber);
+
+    const std::size_t queueLimit;
+    mutable std::mutex mutex;
+    std::map<const void*, std::shared_ptr<Subscriber>> subscribers;
+};
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,207 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "OperationStatusFilter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iterator>
+
+namespace WPEFramework {
+namespace Plugin {
+
+namespace { // anonymous
+
+const std::string PROGRESS_STATUS{"Progress"};
+
+// overall percent of progress details like "DOWNLOADING 45 %", -1 if there is none
+int progressPercent(const std::string& details)
+{
+    auto sign = details.rfind('%');
+    if (sign == std::string::npos) {
+        return -1;
+    }
+    auto end = details.find_last_not_of(' ', sign == 0 ? 0 : sign - 1);
+    if (end == std::string::npos || !isdigit(static_cast<unsigned char>(details[end]))) {
+        return -1;
+    }
+    auto begin = end;
+    while (begin > 0 && isdigit(static_cast<unsigned char>(details[begin - 1]))) {
+        --begin;
+    }
+    return std::atoi(details.substr(begin, end - begin + 1).c_str());
+}
+
+} // namespace anonymous
+
+OperationStatusFilter::OperationStatusFilter(const Criteria& aCriteria)
+    : criteria(aCriteria)
+{
+}
+
+bool OperationStatusFilter::accept(const std::string& handle, const std::string& id, const std::string& status,
+                                   const std::string& details, Clock::time_point now)
+{
+    if ((!criteria.handle.empty() && criteria.handle != handle) || (!criteria.id.empty() && criteria.id != id)) {
+        return false;
+    }
+    if (status != PROGRESS_STATUS) {
+        progress.erase(handle);
+    }
+    if (!criteria.statuses.empty()
+        && std::find(criteria.statuses.begin(), criteria.statuses.end(), status) == criteria.statuses.end()) {
+        return false;
+    }
+    if (status != PROGRESS_STATUS || (criteria.progressStep == 0 && criteria.progressIntervalMs == 0)) {
+        return true;
+    }
+
+    auto percent = progressPercent(details);
+    auto last = progress.find(handle);
+    if (last != progress.end()) {
+        bool stepped = percent < 0 || std::abs(percent - last->second.percent) >= static_cast<int>(criteria.progressStep);
+        bool waited = now - last->second.passed >= std::chrono::milliseconds(criteria.progressIntervalMs);
+        if (!stepped || !waited) {
+            return false;
+        }
+    }
+    progress[handle] = Progress{percent, now};
+    return true;
+}
+
+bool OperationStatusFilters::Decision::accepted(const std::string& designator) const
+{
+    auto it = subscribers.find(designator);
+    return it == subscribers.end() || it->second;
+}
+
+void OperationStatusFilters::subscribe(uint32_t channel, const std::string& designator)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (designator.empty()) {
+        anonymous.insert(channel);
+    } else {
+        subscribers[designator].channels.push_back(channel);
+    }
+}
+
+void OperationStatusFilters::unsubscribe(uint32_t channel, const std::string& designator)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (designator.empty()) {
+        auto it = anonymous.find(channel);
+        if (it != anonymous.end()) {
+            anonymous.erase(it);
+        }
+        return;
+    }
+    auto it = subscribers.find(designator);
+    if (it == subscribers.end()) {
+        return;
+    }
+    auto& channels = it->second.channels;
+    auto position = std::find(channels.begin(), channels.end(), channel);
+    if (position == channels.end()) {
+        return;
+    }
+    if (position == channels.begin()) {
+        it->second.filtered = false;
+        it->second.filter = OperationStatusFilter{};
+    }
+    channels.erase(position);
+    if (channels.empty()) {
+        subscribers.erase(it);
+    }
+}
+
+void OperationStatusFilters::close(uint32_t channel)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    anonymous.erase(channel);
+    for (auto it = subscribers.begin(); it != subscribers.end();) {
+        auto& channels = it->second.channels;
+        if (!channels.empty() && channels.front() == channel) {
+            it->second.filtered = false;
+            it->second.filter = OperationStatusFilter{};
+        }
+        channels.erase(std::remove(channels.begin(), channels.end(), channel), channels.end());
+        it = channels.empty() ? subscribers.erase(it) : std::next(it);
+    }
+}
+
+bool OperationStatusFilters::owns(uint32_t channel, const std::string& designator) const
+{
+    auto it = subscribers.find(designator);
+    return it != subscribers.end() && it->second.channels.front() == channel;
+}
+
+bool OperationStatusFilters::set(uint32_t channel, const std::string& designator,
+                                 const OperationStatusFilter::Criteria& criteria)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!owns(channel, designator)) {
+        return false;
+    }
+    auto& subscriber = subscribers[designator];
+    subscriber.filtered = true;
+    subscriber.filter = OperationStatusFilter{criteria};
+    return true;
+}
+
+bool OperationStatusFilters::clear(uint32_t channel, const std::string& designator)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!owns(channel, designator)) {
+        return false;
+    }
+    auto& subscriber = subscribers[designator];
+    subscriber.filtered = false;
+    subscriber.filter = OperationStatusFilter{};
+    return true;
+}
+
+bool OperationStatusFilters::empty() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::none_of(subscribers.begin(), subscribers.end(),
+                        [](const std::pair<const std::string, Subscriber>& entry) { return entry.second.filtered; });
+}
+
+OperationStatusFilters::Decision OperationStatusFilters::decide(const std::string& handle, const std::string& id,
+                                                                const std::string& status, const std::string& details)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Decision decision;
+    decision.any = !anonymous.empty();
+    auto now = OperationStatusFilter::Clock::now();
+    for (auto& entry : subscribers) {
+        if (!entry.second.filtered) {
+            decision.any = true;
+            continue;
+        }
+        bool accepted = entry.second.filter.accept(handle, id, status, details, now);
+        decision.subscribers[entry.first] = accepted;
+        decision.any = decision.any || accepted;
+    }
+    return decision;
+}
+
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,119 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+
+/**
+ * Decides which operationStatus events a subscriber gets. Works on the event
+ * strings, so it is applied before an event is serialized.
+ *
+ * Empty fields match everything. Progress of a handle is passed only once it
+ * moved by progressStep percent and progressIntervalMs elapsed since the last
+ * one passed; terminal events always pass the rate limit.
+ */
+class OperationStatusFilter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Criteria
+    {
+        std::string handle;
+        std::string id;
+        std::vector<std::string> statuses;      // e.g. "Progress", "Success"
+        unsigned int progressStep{0};           // percent
+        unsigned int progressIntervalMs{0};
+    };
+
+    OperationStatusFilter() = default;
+    explicit OperationStatusFilter(const Criteria& criteria);
+
+    bool accept(const std::string& handle, const std::string& id, const std::string& status,
+                const std::string& details, Clock::time_point now = Clock::now());
+
+private:
+    struct Progress
+    {
+        int percent;
+        Clock::time_point passed;
+    };
+
+    Criteria criteria;
+    // last progress passed per handle, dropped when the operation ends
+    std::map<std::string, Progress> progress;
+};
+
+/**
+ * Filters of the JSON-RPC subscribers, keyed by the designator a channel registered
+ * for events with. Only the channel which registered a designator first may filter
+ * it, and the filter goes away when that channel unregisters or closes. Subscribers
+ * without a filter, anonymous ones included, get every event.
+ */
+class OperationStatusFilters
+{
+public:
+    struct Decision
+    {
+        bool any{true};                     // false if nobody gets the event
+        std::map<std::string, bool> subscribers;
+
+        bool accepted(const std::string& designator) const;
+    };
+
+    void subscribe(uint32_t channel, const std::string& designator);
+    void unsubscribe(uint32_t channel, const std::string& designator);
+    void close(uint32_t channel);
+
+    // false unless the channel owns the designator
+    bool set(uint32_t channel, const std::string& designator, const OperationStatusFilter::Criteria& criteria);
+    bool clear(uint32_t channel, const std::string& designator);
+    bool empty() const;
+
+    // evaluates every filter once, also advancing their progress rate limits
+    Decision decide(const std::string& handle, const std::string& id, const std::string& status,
+                    const std::string& details);
+
+private:
+    struct Subscriber
+    {
+        std::vector<uint32_t> channels;     // the first one owns the filter
+        bool filtered{false};
+        OperationStatusFilter filter;
+    };
+
+    bool owns(uint32_t channel, const std::string& designator) const;
+
+    mutable std::mutex mutex;
+    std::map<std::string, Subscriber> subscribers;
+    std::multiset<uint32_t> anonymous;
+};
+
+} // namespace Plugin
+} // namespace WPEFramework
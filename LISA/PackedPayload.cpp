@@ -0,0 +1,278 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PackedPayload.h"
+
+#include <map>
+#include <sstream>
+#include <utility>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+namespace { // anonymous
+
+void appendString(std::string& out, const std::string& value)
+{
+    static const char digits[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += digits[c >> 4];
+                    out += digits[c & 0x0f];
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+void appendField(std::string& out, const char* name, const std::string& value)
+{
+    out += '"';
+    out += name;
+    out += "\":";
+    appendString(out, value);
+}
+
+void appendNumber(std::string& out, const char* name, unsigned long long value)
+{
+    out += '"';
+    out += name;
+    out += "\":";
+    out += std::to_string(value);
+}
+
+void appendJob(std::string& out, const JobInfo& job)
+{
+    out += '{';
+    appendField(out, "handle", job.handle);
+    out += ',';
+    appendField(out, "operation", job.operation);
+    out += ',';
+    appendField(out, "type", job.type);
+    out += ',';
+    appendField(out, "id", job.id);
+    out += ',';
+    appendField(out, "version", job.version);
+    out += ',';
+    appendField(out, "state", jobStateStr(job.state));
+    out += ',';
+    appendNumber(out, "progress", job.progress);
+    out += ',';
+    appendNumber(out, "bytesDownloaded", job.bytesDownloaded);
+    out += ',';
+    appendNumber(out, "queuedAt", job.queuedAt);
+    out += ',';
+    appendNumber(out, "startedAt", job.startedAt);
+    out += ',';
+    appendNumber(out, "finishedAt", job.finishedAt);
+    out += ",\"stages\":[";
+    for (size_t i = 0; i < job.stages.size(); ++i) {
+        if (i != 0) {
+            out += ',';
+        }
+        out += '{';
+        appendField(out, "stage", job.stages[i].first);
+        out += ',';
+        appendNumber(out, "durationMs", job.stages[i].second);
+        out += '}';
+    }
+    out += "],";
+    appendField(out, "error", job.error);
+    out += '}';
+}
+
+} // namespace anonymous
+
+std::string packAppsList(const std::vector<DataStorage::AppDetails>& apps)
+{
+    // versions of an app are collected first, the rows of one app need not be adjacent
+    std::vector<std::pair<const DataStorage::AppDetails*, std::vector<const DataStorage::AppDetails*> > > grouped;
+    std::map<std::pair<std::string, std::string>, size_t> appIndex;
+    for (const auto& app : apps) {
+        auto inserted = appIndex.emplace(std::make_pair(app.type, app.id), grouped.size());
+        if (inserted.second) {
+            grouped.emplace_back(&app, std::vector<const DataStorage::AppDetails*>{});
+        }
+        if (!app.version.empty()) {
+            grouped[inserted.first->second].second.push_back(&app);
+        }
+    }
+
+    std::string out;
+    out.reserve(64 + apps.size() * 128);
+    out += "{\"apps\":[";
+    for (size_t i = 0; i < grouped.size(); ++i) {
+        if (i != 0) {
+            out += ',';
+        }
+        out += '{';
+        appendField(out, "id", grouped[i].first->id);
+        out += ',';
+        appendField(out, "type", grouped[i].first->type);
+        out += ",\"installed\":[";
+        const auto& versions = grouped[i].second;
+        for (size_t j = 0; j < versions.size(); ++j) {
+            if (j != 0) {
+                out += ',';
+            }
+            out += '{';
+            appendField(out, "version", versions[j]->version);
+            out += ',';
+            appendField(out, "appName", versions[j]->appName);
+            out += ',';
+            appendField(out, "url", versions[j]->url);
+            out += '}';
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return out;
+}
+
+std::string packMetadata(const DataStorage::AppMetadata& metadata)
+{
+    std::string out;
+    out.reserve(128 + metadata.metadata.size() * 64);
+    out += '{';
+    appendField(out, "appName", metadata.appDetails.appName);
+    out += ',';
+    appendField(out, "category", metadata.appDetails.category);
+    out += ',';
+    appendField(out, "url", metadata.appDetails.url);
+    // TODO: add resources (downloads) here when download function is implemented
+    out += ",\"resources\":[],\"auxMetadata\":[";
+    for (size_t i = 0; i < metadata.metadata.size(); ++i) {
+        if (i != 0) {
+            out += ',';
+        }
+        out += '{';
+        appendField(out, "key", metadata.metadata[i].first);
+        out += ',';
+        appendField(out, "value", metadata.metadata[i].second);
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+std::string packJob(const JobInfo& job)
+{
+    std::string out;
+    appendJob(out, job);
+    return out;
+}
+
+std::string packJobs(const std::vector<JobInfo>& jobs)
+{
+    std::string out;
+    out.reserve(16 + jobs.size() * 384);
+    out += "{\"jobs\":[";
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        if (i != 0) {
+            out += ',';
+        }
+        appendJob(out, jobs[i]);
+    }
+    out += "]}";
+    return out;
+}
+
+bool unpackBatchItems(const std::string& payload, std::vector<Executor::BatchItem>& items)
+{
+    boost::property_tree::ptree tree;
+    try {
+        std::istringstream stream{payload};
+        boost::property_tree::read_json(stream, tree);
+    } catch (const boost::property_tree::json_parser_error&) {
+        return false;
+    }
+    auto apps = tree.get_child_optional("apps");
+    if (!apps) {
+        return true;
+    }
+    for (const auto& app : *apps) {
+        // elements of an array have no name
+        if (!app.first.empty()) {
+            return false;
+        }
+        Executor::BatchItem item;
+        item.type = app.second.get<std::string>("type", "");
+        item.id = app.second.get<std::string>("id", "");
+        item.version = app.second.get<std::string>("version", "");
+        item.url = app.second.get<std::string>("url", "");
+        item.appName = app.second.get<std::string>("appName", "");
+        item.category = app.second.get<std::string>("category", "");
+        item.uninstallType = app.second.get<std::string>("uninstallType", "");
+        if (!Executor::priorityFromStr(app.second.get<std::string>("priority", ""), item.priority)) {
+            return false;
+        }
+        items.push_back(std::move(item));
+    }
+    return true;
+}
+
+std::string packBatchResults(const std::vector<Executor::BatchItem>& items,
+                             const std::vector<Executor::BatchResult>& results, bool withMetadata)
+{
+    std::string out;
+    out.reserve(16 + results.size() * (withMetadata ? 384 : 128));
+    out += "{\"results\":[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i != 0) {
+            out += ',';
+        }
+        out += '{';
+        appendField(out, "type", items[i].type);
+        out += ',';
+        appendField(out, "id", items[i].id);
+        out += ',';
+        appendField(out, "version", items[i].version);
+        out += ',';
+        appendNumber(out, "code", results[i].code);
+        if (!results[i].handle.empty()) {
+            out += ',';
+            appendField(out, "handle", results[i].handle);
+        }
+        if (withMetadata && results[i].code == Executor::ERROR_NONE) {
+            out += ",\"metadata\":";
+            out += packMetadata(results[i].metadata);
+        }
+        out += '}';
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
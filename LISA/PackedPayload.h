@@ -0,0 +1,63 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "DataStorage.h"
+#include "Executor.h"
+#include "JobHistory.h"
+
+#include <string>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+// Whole getList/getMetadata results as one JSON document, in the layout of the
+// JSON-RPC responses, so they cross the COM-RPC boundary in a single call.
+
+// {"apps":[{"id":..,"type":..,"installed":[{"version":..,"appName":..,"url":..}]}]},
+// apps grouped by type and id in order of their first version
+std::string packAppsList(const std::vector<DataStorage::AppDetails>& apps);
+
+// {"appName":..,"category":..,"url":..,"resources":[],"auxMetadata":[{"key":..,"value":..}]}
+std::string packMetadata(const DataStorage::AppMetadata& metadata);
+
+// {"handle":..,"operation":..,"type":..,"id":..,"version":..,"state":..,"progress":..,
+//  "bytesDownloaded":..,"queuedAt":..,"startedAt":..,"finishedAt":..,
+//  "stages":[{"stage":..,"durationMs":..}],"error":..}
+std::string packJob(const JobInfo& job);
+
+// {"jobs":[<packJob>,..]}
+std::string packJobs(const std::vector<JobInfo>& jobs);
+
+// {"apps":[{"type":..,"id":..,"version":..,"url":..,"appName":..,"category":..,"uninstallType":..,"priority":..}]},
+// the params of installBatch, uninstallBatch and getMetadataBatch; missing fields are empty.
+// False if the payload is malformed or names an unknown priority.
+bool unpackBatchItems(const std::string& payload, std::vector<Executor::BatchItem>& items);
+
+// {"results":[{"type":..,"id":..,"version":..,"code":..,"handle":..,"metadata":<packMetadata>}]},
+// the handle only if one was given, the metadata only with withMetadata and for items that succeeded
+std::string packBatchResults(const std::vector<Executor::BatchItem>& items,
+                             const std::vector<Executor::BatchResult>& results, bool withMetadata);
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
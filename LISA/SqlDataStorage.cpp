@@ -19,8 +19,14 @@
 
 #include "Debug.h"
 #include "SqlDataStorage.h"
+#include "StorageCursor.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
 #include <fstream>
+#include <set>
 #include <string.h>
 #include <sstream>
 
@@ -44,15 +50,90 @@ namespace { // anonymous
     };
     using SqlUniqueString = std::unique_ptr<char, SqliteDeleter>;
 
-    std::string timeNow()
+    std::int64_t timeNow()
     {
         const auto now = std::chrono::system_clock::now();
-        std::time_t todayTime = std::chrono::system_clock::to_time_t(now);
-        return std::ctime(&todayTime);
+        return std::chrono::system_clock::to_time_t(now);
+    }
+
+    // lisa_ctime_to_epoch(created): converts 'created' values written by older versions
+    // (std::ctime() output in local time) to seconds since epoch, 0 if unparsable
+    void ctimeToEpoch(sqlite3_context* context, int, sqlite3_value** argv)
+    {
+        if (sqlite3_value_type(argv[0]) == SQLITE_INTEGER) {
+            sqlite3_result_int64(context, sqlite3_value_int64(argv[0]));
+            return;
+        }
+        auto text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+        struct tm tm{};
+        if (!text || !strptime(text, "%a %b %d %H:%M:%S %Y", &tm)) {
+            sqlite3_result_int64(context, 0);
+            return;
+        }
+        tm.tm_isdst = -1;
+        sqlite3_result_int64(context, mktime(&tm));
+    }
+
+    const char* sortColumn(DataStorage::SortKey sortKey)
+    {
+        switch (sortKey) {
+            case DataStorage::SortKey::TYPE: return "type";
+            case DataStorage::SortKey::CREATED: return "created";
+            case DataStorage::SortKey::ID: break;
+        }
+        return "app_id";
+    }
+
+    // searchable metadata values of the installed app version with the given index expression
+    std::string searchedMetadata(const std::string& installedAppIdx)
+    {
+        return "(SELECT ifnull(group_concat(meta_value, ' '), '') FROM metadata WHERE metadata.app_idx = " + installedAppIdx
+               + " AND (NOT EXISTS (SELECT 1 FROM search_keys) OR meta_key IN (SELECT meta_key FROM search_keys)))";
+    }
+
+    // trigger recording a change of the entity selected by 'entity' (type, app_id, version, meta_key)
+    // as a new generation; 'cleanup' runs first to drop entries the change supersedes
+    std::string changeLogTrigger(const std::string& name, const std::string& event, const std::string& change,
+                                 const std::string& entity, const std::string& cleanup = {})
+    {
+        return "CREATE TRIGGER " + name + " AFTER " + event + " BEGIN "
+               "UPDATE catalog_state SET generation = generation + 1, "
+               "trimmed_through = max(trimmed_through, generation + 1 - log_size); "
+               "DELETE FROM change_log WHERE generation <= (SELECT trimmed_through FROM catalog_state); "
+               + cleanup +
+               "INSERT OR REPLACE INTO change_log(generation, change, type, app_id, version, meta_key) "
+               "SELECT (SELECT generation FROM catalog_state), '" + change + "', * FROM (" + entity + "); END;";
+    }
+
+    // every word of the query becomes a quoted prefix term, so user input is never parsed as FTS5 syntax
+    std::string toMatchExpression(const std::string& query)
+    {
+        std::istringstream words(query);
+        std::string word, expression;
+        while (words >> word) {
+            if (!expression.empty()) {
+                expression += ' ';
+            }
+            expression += '"';
+            for (char c : word) {
+                expression += c;
+                if (c == '"') {
+                    expression += '"';
+                }
+            }
+            expression += "\"*";
+        }
+        return expression;
     }
-} // namespace anonymous
 
-    sqlite3* SqlDataStorage::sqlite = nullptr;
+    // installed_apps.idx of the version bound at ?first, ?first+1 and ?first+2 (type, id, version)
+    std::string installedIdx(int first)
+    {
+        return "(SELECT installed_apps.idx FROM installed_apps INNER JOIN apps ON apps.idx = installed_apps.app_idx "
+               "WHERE type = ?" + std::to_string(first) + " AND app_id = ?" + std::to_string(first + 1)
+               + " AND version = ?" + std::to_string(first + 2) + ")";
+    }
+} // namespace anonymous
 
     SqlDataStorage::~SqlDataStorage()
     {
@@ -61,6 +142,18 @@ namespace { // anonymous
 
     void SqlDataStorage::Terminate()
     {
+        {
+            std::unique_lock<std::mutex> lock(readers_mutex);
+            // readers still in use are waited for
+            reader_released.wait(lock, [this] { return idle_readers.size() == readers.size(); });
+            for (auto& reader : readers) {
+                reader->statementCache.Clear();
+                sqlite3_close(reader->sqlite);
+            }
+            readers.clear();
+            idle_readers.clear();
+        }
+        statement_cache.Clear();
         if(sqlite) {
             sqlite3_close(sqlite);
         }
@@ -79,10 +172,12 @@ namespace { // anonymous
                                          const std::string& appName,
                                          const std::string& category,
                                          const std::string& appPath,
-                                         const std::string& appStoragePath)
+                                         const std::string& appStoragePath,
+                                         const std::string& volume)
     {
         auto timeCreated = timeNow();
 
+        Transaction transaction{*this};
         int appIdx;
         try {
             appIdx = GetAppIdx(type, id);
@@ -90,7 +185,8 @@ namespace { // anonymous
             InsertIntoApps(type, id, appStoragePath, timeCreated);
             appIdx = GetAppIdx(type, id);
         }
-        InsertIntoInstalledApps(appIdx, version, appName, category, url, appPath, timeCreated);
+        InsertIntoInstalledApps(appIdx, version, appName, category, url, appPath, volume, timeCreated);
+        transaction.Commit();
     }
 
     bool SqlDataStorage::IsAppInstalled(const std::string& type,
@@ -98,61 +194,98 @@ namespace { // anonymous
                                         const std::string& version)
     {
         INFO(" ");
-        std::string query = "SELECT idx FROM installed_apps WHERE app_idx IN (SELECT idx FROM apps WHERE (?1 IS NULL OR type = ?1) AND app_id = ?2 AND version = ?3);";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        Reader reader{*this};
+        std::string query = "SELECT installed_apps.idx FROM apps INNER JOIN installed_apps ON installed_apps.app_idx = apps.idx "
+                            "WHERE (?1 IS NULL OR type = ?1) AND app_id = ?2 AND version = ?3;";
+        auto stmt = reader.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, version.empty() ? nullptr : version.c_str(), -1, SQLITE_TRANSIENT);
         int rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
         if (rc == SQLITE_ROW) {
             return true;
         } else if (rc == SQLITE_DONE) {
             return false;
         } else {
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
     }
 
     std::string SqlDataStorage::GetTypeOfApp(const std::string& id)
     {
         INFO(" ");
+        Reader reader{*this};
         std::string type{};
         std::string query = "SELECT type FROM apps WHERE app_id ==  $1;";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_TRANSIENT);
         if (sqlite3_step(stmt) != SQLITE_ROW) {
-            sqlite3_finalize(stmt);
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
         auto col1 = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
         type = (col1 ? col1 : "");
-        sqlite3_finalize(stmt);
         return type;
     }
 
+    std::string SqlDataStorage::GetAppVolume(const std::string& type,
+                                             const std::string& id,
+                                             const std::string& version)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        std::string query = "SELECT volume FROM installed_apps WHERE app_idx IN (SELECT idx FROM apps WHERE (?1 IS NULL OR type = ?1) AND app_id = ?2) AND version = ?3;";
+        auto stmt = reader.Acquire(query);
+
+        sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+        }
+        auto col1 = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0));
+        std::string volume = (col1 ? col1 : "");
+        return volume;
+    }
+
+    void SqlDataStorage::SetAppVolume(const std::string& type,
+                                      const std::string& id,
+                                      const std::string& version,
+                                      const std::string& volume)
+    {
+        std::lock_guard<std::recursive_mutex> lock(transaction_mutex);
+        INFO(" ");
+        std::string query = "UPDATE installed_apps SET volume = ?4 WHERE app_idx IN (SELECT idx FROM apps WHERE type = ?1 AND app_id = ?2) AND version = ?3;";
+        auto stmt = statement_cache.Acquire(query);
+
+        sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 4, volume.c_str(), -1, SQLITE_TRANSIENT);
+        ExecuteSqlStep(stmt);
+        if (sqlite3_changes(sqlite) != 1) {
+            throw SqlDataStorageError(std::string{"app not installed: "} + id + " " + version);
+        }
+    }
+
     bool SqlDataStorage::IsAppData(const std::string& type,
                                    const std::string& id)
     {
         INFO(" ");
+        Reader reader{*this};
         std::string query = "SELECT idx FROM apps WHERE (?1 IS NULL OR type = ?1) AND (?2 IS NULL OR app_id = ?2)";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
         int rc = sqlite3_step(stmt);
-        sqlite3_finalize(stmt);
         if (rc == SQLITE_ROW) {
             return true;
         } else if (rc == SQLITE_DONE) {
             return false;
         } else {
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
     }
 
@@ -160,13 +293,16 @@ namespace { // anonymous
                                             const std::string& id,
                                             const std::string& version)
     {
+        Transaction transaction{*this};
         ClearMetadata(type, id, version, "");
         DeleteFromInstalledApps(type, id, version);
+        transaction.Commit();
     }
 
     void SqlDataStorage::RemoveAppData(const std::string& type,
                                        const std::string& id)
     {
+        std::lock_guard<std::recursive_mutex> lock(transaction_mutex);
         DeleteFromApps(type, id);
     }
 
@@ -176,14 +312,14 @@ namespace { // anonymous
                          const std::string& key,
                          const std::string& value)
     {
+        std::lock_guard<std::recursive_mutex> lock(transaction_mutex);
         std::string query = "INSERT OR REPLACE INTO metadata(app_idx, meta_key, meta_value) "
                         "VALUES("
                         "(SELECT installed_apps.idx FROM installed_apps INNER JOIN apps ON apps.idx = installed_apps.app_idx WHERE type = ?1 AND app_id = ?2 AND version = ?3),"
                         "?4,"
                         "?5);";
 
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = statement_cache.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
@@ -191,7 +327,35 @@ namespace { // anonymous
         sqlite3_bind_text(stmt, 4, key.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 5, value.c_str(), -1, SQLITE_TRANSIENT);
         ExecuteSqlStep(stmt);
-        sqlite3_finalize(stmt);
+    }
+    void SqlDataStorage::SetMetadataBatch(const std::string& type,
+                         const std::string& id,
+                         const std::string& version,
+                         const std::vector<std::pair<std::string, std::string> >& metadata)
+    {
+        Transaction transaction{*this};
+
+        std::string idxQuery = "SELECT installed_apps.idx FROM installed_apps INNER JOIN apps ON apps.idx = installed_apps.app_idx "
+                               "WHERE type = ?1 AND app_id = ?2 AND version = ?3;";
+        auto idxStmt = statement_cache.Acquire(idxQuery);
+        sqlite3_bind_text(idxStmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(idxStmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(idxStmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(idxStmt) != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"app not installed: "} + id + " " + version);
+        }
+        auto installedAppIdx = sqlite3_column_int64(idxStmt, 0);
+
+        std::string query = "INSERT OR REPLACE INTO metadata(app_idx, meta_key, meta_value) VALUES(?1, ?2, ?3);";
+        auto stmt = statement_cache.Acquire(query);
+        sqlite3_bind_int64(stmt, 1, installedAppIdx);
+        for (const auto& keyValue : metadata) {
+            sqlite3_bind_text(stmt, 2, keyValue.first.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, keyValue.second.c_str(), -1, SQLITE_TRANSIENT);
+            ExecuteSqlStep(stmt);
+            sqlite3_reset(stmt);
+        }
+        transaction.Commit();
     }
 
     // key can be empty to clear all metadata of an app
@@ -200,6 +364,7 @@ namespace { // anonymous
                          const std::string& version,
                          const std::string& key)
     {
+        std::lock_guard<std::recursive_mutex> lock(transaction_mutex);
         std::string query = "DELETE FROM metadata "
                        "WHERE metadata.idx IN ("
                        "SELECT metadata.idx FROM metadata "
@@ -207,15 +372,13 @@ namespace { // anonymous
                        "INNER JOIN apps ON apps.idx = installed_apps.app_idx "
                        "WHERE type = ?1 AND app_id = ?2 AND version = ?3 AND (?4 IS NULL OR meta_key = ?4));";
 
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = statement_cache.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 4, key.empty()? nullptr: key.c_str(), -1, SQLITE_TRANSIENT);
         ExecuteSqlStep(stmt);
-        sqlite3_finalize(stmt);
     }
 
     DataStorage::AppMetadata SqlDataStorage::GetMetadata(const std::string& type,
@@ -223,36 +386,33 @@ namespace { // anonymous
                                const std::string& version)
     {
         INFO(" ");
+        Reader reader{*this};
 
-        sqlite3_stmt* stmt;
         std::string appDetailsQuery =
             "SELECT type, app_id, version, name, category, url FROM installed_apps "
             "INNER JOIN apps ON apps.idx = installed_apps.app_idx "
             "WHERE type = ?1 AND app_id = ?2 AND version = ?3";
 
-        sqlite3_prepare_v2(sqlite, appDetailsQuery.c_str(), appDetailsQuery.length(), &stmt, nullptr);
+        auto appDetailsStmt = reader.Acquire(appDetailsQuery);
 
-        sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(appDetailsStmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(appDetailsStmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(appDetailsStmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
 
-        if (sqlite3_step(stmt) != SQLITE_ROW) {
-            sqlite3_finalize(stmt);
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+        if (sqlite3_step(appDetailsStmt) != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
         DataStorage::AppDetails appDetails{
-            reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
-            reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)),
-            reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5))};
-
-        sqlite3_finalize(stmt);
+            reinterpret_cast<const char*>(sqlite3_column_text(appDetailsStmt, 0)), reinterpret_cast<const char*>(sqlite3_column_text(appDetailsStmt, 1)),
+            reinterpret_cast<const char*>(sqlite3_column_text(appDetailsStmt, 2)), reinterpret_cast<const char*>(sqlite3_column_text(appDetailsStmt, 3)),
+            reinterpret_cast<const char*>(sqlite3_column_text(appDetailsStmt, 4)), reinterpret_cast<const char*>(sqlite3_column_text(appDetailsStmt, 5))};
 
         std::string metadataQuery = "SELECT meta_key, meta_value FROM metadata "
                        "INNER JOIN installed_apps ON installed_apps.idx = metadata.app_idx "
                        "INNER JOIN apps ON apps.idx = installed_apps.app_idx "
                        "WHERE type = ?1 AND app_id = ?2 AND version = ?3";
 
-        sqlite3_prepare_v2(sqlite, metadataQuery.c_str(), metadataQuery.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(metadataQuery);
 
         sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
@@ -268,23 +428,66 @@ namespace { // anonymous
             metadata.push_back(keyValue);
         }
         if (rc != SQLITE_DONE) {
-            sqlite3_finalize(stmt);
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
 
-        sqlite3_finalize(stmt);
 
         return AppMetadata{appDetails, metadata};
     }
+    DataStorage::ChangeSet SqlDataStorage::GetChanges(std::uint64_t sinceGeneration)
+    {
+        INFO(" ");
+        // generation and log are read in one snapshot
+        Reader reader{*this};
+        reader.BeginSnapshot();
+
+        ChangeSet changeSet;
+        {
+            auto stmt = reader.Acquire("SELECT generation, trimmed_through FROM catalog_state;");
+            if (sqlite3_step(stmt) != SQLITE_ROW) {
+                throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+            }
+            changeSet.generation = sqlite3_column_int64(stmt, 0);
+            std::uint64_t trimmedThrough = sqlite3_column_int64(stmt, 1);
+            // a generation from the future means the database was recreated
+            changeSet.complete = sinceGeneration >= trimmedThrough && sinceGeneration <= changeSet.generation;
+        }
+        if (!changeSet.complete) {
+            return changeSet;
+        }
+
+        std::string query = "SELECT generation, change, type, app_id, version, meta_key FROM change_log "
+                            "WHERE generation > ?1 ORDER BY generation;";
+        auto stmt = reader.Acquire(query);
+        sqlite3_bind_int64(stmt, 1, sinceGeneration);
+        int rc{};
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            changeSet.changes.push_back(Change{
+                static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 0)),
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)),
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)),
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)),
+                reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5))});
+        }
+        if (rc != SQLITE_DONE) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+        }
+        return changeSet;
+    }
 
     void SqlDataStorage::InitDB()
     {
         INFO("Initializing database");
         Terminate();
         OpenConnection();
+        ConfigureConnection();
         Validate();
-        CreateTables();
+        Migrate();
+        SyncSearchKeys();
+        SyncChangeLogSize();
         EnableForeignKeys();
+        OpenReaders();
     }
 
     void SqlDataStorage::OpenConnection()
@@ -295,6 +498,45 @@ namespace { // anonymous
             auto msg = std::string{"Error opening connection: "} + std::to_string(rc) + " - " + sqlite3_errmsg(sqlite);
             throw SqlDataStorageError(msg);
         }
+        statement_cache.Initialize(sqlite);
+    }
+
+    // opened once migrations are done, WAL lets them read while the writer has a transaction open
+    void SqlDataStorage::OpenReaders()
+    {
+        std::lock_guard<std::mutex> lock(readers_mutex);
+        for (unsigned int i = 0; i < read_connections; ++i) {
+            std::unique_ptr<Connection> reader{new Connection};
+            // a reader is only used by the thread that borrowed it
+            int rc = sqlite3_open_v2(db_path.c_str(), &reader->sqlite, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+            if (rc != SQLITE_OK) {
+                auto msg = std::string{"Error opening read connection: "} + std::to_string(rc) + " - " + sqlite3_errmsg(reader->sqlite);
+                sqlite3_close(reader->sqlite);
+                throw SqlDataStorageError(msg);
+            }
+            auto command = "PRAGMA mmap_size = " + std::to_string(mmap_size) + ";";
+            sqlite3_exec(reader->sqlite, command.c_str(), nullptr, nullptr, nullptr);
+            reader->statementCache.Initialize(reader->sqlite);
+            idle_readers.push_back(reader.get());
+            readers.push_back(std::move(reader));
+        }
+        INFO("read connections: ", readers.size());
+    }
+
+    // WAL keeps readers and the writer apart and with synchronous=NORMAL it only
+    // syncs on checkpoints, a power loss may roll back the last transactions but
+    // never corrupts the database
+    void SqlDataStorage::ConfigureConnection() const
+    {
+        std::string journalMode;
+        ExecuteCommand("PRAGMA journal_mode = WAL;", [](void* mode, int, char** resp, char**)->int
+        {
+            *static_cast<std::string*>(mode) = resp[0] ? resp[0] : "";
+            return 0;
+        }, &journalMode);
+        INFO("journal mode: ", journalMode);
+        ExecuteCommand("PRAGMA synchronous = NORMAL;");
+        ExecuteCommand("PRAGMA mmap_size = " + std::to_string(mmap_size) + ";");
     }
 
     void SqlDataStorage::CreateTables() const
@@ -319,6 +561,7 @@ namespace { // anonymous
                                               "created TEXT NOT NULL,"
                                               "resources TEXT,"
                                               "metadata TEXT,"
+                                              "volume TEXT,"
                                               "FOREIGN KEY(app_idx) REFERENCES apps(idx),"
                                               "UNIQUE(app_idx, version)"
                                               ");");
@@ -333,6 +576,273 @@ namespace { // anonymous
                             ");");
     }
 
+    /**
+     * Schema changes, applied in order. PRAGMA user_version holds the number of
+     * applied steps, each step runs in its own transaction together with the
+     * version bump. Steps are never changed once released, new ones are appended.
+     * Databases created before versioning (user_version 0) run all of them, so the
+     * first steps must be no-ops on an existing schema.
+     */
+    const std::vector<SqlDataStorage::Migration>& SqlDataStorage::Migrations()
+    {
+        static const std::vector<Migration> migrations{
+            {"initial schema", &SqlDataStorage::CreateTables},
+            {"installed_apps.volume", &SqlDataStorage::AddMissingColumns},
+            {"integer metadata.app_idx", &SqlDataStorage::MigrateMetadataAppIdx},
+            {"integer created", &SqlDataStorage::MigrateCreatedToEpoch},
+            {"covering indexes", &SqlDataStorage::CreateIndexes},
+            {"search index", &SqlDataStorage::CreateSearchIndex},
+            {"change log", &SqlDataStorage::CreateChangeLog},
+            {"shared package dependencies", &SqlDataStorage::CreateDependencies},
+            {"image layers", &SqlDataStorage::CreateAppLayers},
+        };
+        return migrations;
+    }
+
+    void SqlDataStorage::Migrate()
+    {
+        int version{};
+        ExecuteCommand("PRAGMA user_version;", [](void* version, int, char** resp, char**)->int
+        {
+            *static_cast<int*>(version) = resp[0] ? atoi(resp[0]) : 0;
+            return 0;
+        }, &version);
+
+        const auto& migrations = Migrations();
+        if (version > static_cast<int>(migrations.size())) {
+            throw SqlDataStorageError("database schema version " + std::to_string(version) + " is newer than supported "
+                                      + std::to_string(migrations.size()));
+        }
+
+        for (auto step = static_cast<size_t>(version); step < migrations.size(); ++step) {
+            INFO("Migrating database to version ", step + 1, ": ", migrations[step].description);
+            Transaction transaction{*this};
+            (this->*migrations[step].apply)();
+            ExecuteCommand("PRAGMA user_version = " + std::to_string(step + 1) + ";");
+            transaction.Commit();
+        }
+        // prepared statements may refer to replaced tables
+        statement_cache.Clear();
+    }
+
+    // columns added after the initial schema, older databases get them here
+    void SqlDataStorage::AddMissingColumns() const
+    {
+        if (!HasColumn("installed_apps", "volume")) {
+            INFO("Adding installed_apps.volume column");
+            ExecuteCommand("ALTER TABLE installed_apps ADD COLUMN volume TEXT;");
+        }
+    }
+
+    bool SqlDataStorage::HasColumn(const std::string& table, const std::string& column) const
+    {
+        std::string query = "SELECT COUNT(*) FROM pragma_table_info(?1) WHERE name = ?2;";
+        auto stmt = statement_cache.Acquire(query);
+
+        sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, column.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+        }
+        bool found = sqlite3_column_int(stmt, 0) > 0;
+        return found;
+    }
+
+    // SQLite cannot change a column type, the table is rebuilt with the old rows
+    void SqlDataStorage::MigrateMetadataAppIdx() const
+    {
+        ExecuteCommand("CREATE TABLE metadata_new("
+                            "idx INTEGER PRIMARY KEY,"
+                            "app_idx INTEGER NOT NULL,"
+                            "meta_key TEXT NOT NULL,"
+                            "meta_value TEXT NOT NULL,"
+                            "FOREIGN KEY(app_idx) REFERENCES installed_apps(idx),"
+                            "UNIQUE(app_idx, meta_key)"
+                            ");");
+        ExecuteCommand("INSERT INTO metadata_new SELECT idx, CAST(app_idx AS INTEGER), meta_key, meta_value FROM metadata;");
+        ExecuteCommand("DROP TABLE metadata;");
+        ExecuteCommand("ALTER TABLE metadata_new RENAME TO metadata;");
+    }
+
+    void SqlDataStorage::MigrateCreatedToEpoch() const
+    {
+        if (sqlite3_create_function(sqlite, "lisa_ctime_to_epoch", 1, SQLITE_UTF8, nullptr, ctimeToEpoch, nullptr, nullptr) != SQLITE_OK) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+        }
+
+        ExecuteCommand("CREATE TABLE apps_new("
+                                    "idx INTEGER PRIMARY KEY,"
+                                    "type TEXT NOT NULL,"
+                                    "app_id TEXT UNIQUE NOT NULL,"
+                                    "data_path TEXT,"
+                                    "created INTEGER NOT NULL"
+                                    ");");
+        ExecuteCommand("INSERT INTO apps_new SELECT idx, type, app_id, data_path, lisa_ctime_to_epoch(created) FROM apps;");
+
+        ExecuteCommand("CREATE TABLE installed_apps_new ("
+                                              "idx INTEGER PRIMARY KEY,"
+                                              "app_idx INTEGER NOT NULL,"
+                                              "version TEXT NOT NULL,"
+                                              "name TEXT NOT NULL,"
+                                              "category TEXT,"
+                                              "url TEXT,"
+                                              "app_path TEXT,"
+                                              "created INTEGER NOT NULL,"
+                                              "resources TEXT,"
+                                              "metadata TEXT,"
+                                              "volume TEXT,"
+                                              "FOREIGN KEY(app_idx) REFERENCES apps(idx),"
+                                              "UNIQUE(app_idx, version)"
+                                              ");");
+        ExecuteCommand("INSERT INTO installed_apps_new SELECT idx, app_idx, version, name, category, url, app_path, "
+                       "lisa_ctime_to_epoch(created), resources, metadata, volume FROM installed_apps;");
+
+        ExecuteCommand("DROP TABLE installed_apps;");
+        ExecuteCommand("DROP TABLE apps;");
+        ExecuteCommand("ALTER TABLE apps_new RENAME TO apps;");
+        ExecuteCommand("ALTER TABLE installed_apps_new RENAME TO installed_apps;");
+
+        sqlite3_create_function(sqlite, "lisa_ctime_to_epoch", 1, SQLITE_UTF8, nullptr, nullptr, nullptr, nullptr);
+    }
+
+    // covering indexes: the lookups below are answered from the index alone
+    void SqlDataStorage::CreateIndexes() const
+    {
+        // IsAppInstalled, GetAppsPaths, GetAppVolume
+        ExecuteCommand("CREATE INDEX installed_apps_by_app ON installed_apps(app_idx, version, app_path, volume);");
+        // GetTypeOfApp, GetAppIdx, GetDataPaths
+        ExecuteCommand("CREATE INDEX apps_by_app_id ON apps(app_id, type, data_path);");
+        // GetMetadata
+        ExecuteCommand("CREATE INDEX metadata_by_app ON metadata(app_idx, meta_key, meta_value);");
+    }
+    void SqlDataStorage::CreateSearchIndex() const
+    {
+        ExecuteCommand("CREATE TABLE search_keys(meta_key TEXT PRIMARY KEY);");
+        // GetAppDetailsListByMetadata
+        ExecuteCommand("CREATE INDEX metadata_by_key ON metadata(meta_key, meta_value, app_idx);");
+
+        if (!sqlite3_compileoption_used("ENABLE_FTS5")) {
+            ERROR("sqlite built without FTS5, app search is not available");
+            return;
+        }
+        // one row per installed app version, rowid = installed_apps.idx, kept up to date by triggers
+        // so every write updates the index in its own transaction
+        ExecuteCommand("CREATE VIRTUAL TABLE app_search USING fts5(name, category, metadata);");
+        ExecuteCommand("CREATE TRIGGER app_search_insert AFTER INSERT ON installed_apps BEGIN "
+                       "INSERT INTO app_search(rowid, name, category, metadata) VALUES(NEW.idx, NEW.name, NEW.category, ''); END;");
+        ExecuteCommand("CREATE TRIGGER app_search_update AFTER UPDATE OF name, category ON installed_apps BEGIN "
+                       "UPDATE app_search SET name = NEW.name, category = NEW.category WHERE rowid = NEW.idx; END;");
+        ExecuteCommand("CREATE TRIGGER app_search_delete AFTER DELETE ON installed_apps BEGIN "
+                       "DELETE FROM app_search WHERE rowid = OLD.idx; END;");
+        ExecuteCommand("CREATE TRIGGER app_search_metadata_insert AFTER INSERT ON metadata BEGIN "
+                       "UPDATE app_search SET metadata = " + searchedMetadata("NEW.app_idx") + " WHERE rowid = NEW.app_idx; END;");
+        ExecuteCommand("CREATE TRIGGER app_search_metadata_update AFTER UPDATE ON metadata BEGIN "
+                       "UPDATE app_search SET metadata = " + searchedMetadata("NEW.app_idx") + " WHERE rowid = NEW.app_idx; END;");
+        ExecuteCommand("CREATE TRIGGER app_search_metadata_delete AFTER DELETE ON metadata BEGIN "
+                       "UPDATE app_search SET metadata = " + searchedMetadata("OLD.app_idx") + " WHERE rowid = OLD.app_idx; END;");
+        ExecuteCommand("INSERT INTO app_search(rowid, name, category, metadata) "
+                       "SELECT idx, name, category, " + searchedMetadata("installed_apps.idx") + " FROM installed_apps;");
+    }
+    void SqlDataStorage::SyncSearchKeys()
+    {
+        std::set<std::string> storedKeys;
+        {
+            auto stmt = statement_cache.Acquire("SELECT meta_key FROM search_keys;");
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                storedKeys.emplace(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+            }
+        }
+        {
+            auto stmt = statement_cache.Acquire("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'app_search';");
+            search_index = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) == 1;
+        }
+
+        std::set<std::string> configuredKeys(search_metadata_keys.begin(), search_metadata_keys.end());
+        if (storedKeys == configuredKeys) {
+            return;
+        }
+
+        INFO("Searchable metadata keys changed, rebuilding the search index");
+        Transaction transaction{*this};
+        ExecuteCommand("DELETE FROM search_keys;");
+        auto stmt = statement_cache.Acquire("INSERT INTO search_keys(meta_key) VALUES(?1);");
+        for (const auto& key : configuredKeys) {
+            sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+            ExecuteSqlStep(stmt);
+            sqlite3_reset(stmt);
+        }
+        if (search_index) {
+            ExecuteCommand("UPDATE app_search SET metadata = " + searchedMetadata("app_search.rowid") + ";");
+        }
+        transaction.Commit();
+    }
+    void SqlDataStorage::CreateChangeLog() const
+    {
+        // generation is bumped by every change, anything up to trimmed_through may be missing from the log
+        ExecuteCommand("CREATE TABLE catalog_state(generation INTEGER NOT NULL, trimmed_through INTEGER NOT NULL, log_size INTEGER NOT NULL);");
+        ExecuteCommand("INSERT INTO catalog_state VALUES(0, 0, " + std::to_string(DEFAULT_CHANGE_LOG_SIZE) + ");");
+        // only the latest change of an app, version or metadata key is kept
+        ExecuteCommand("CREATE TABLE change_log(generation INTEGER PRIMARY KEY, change TEXT NOT NULL, type TEXT NOT NULL,"
+                       "app_id TEXT NOT NULL, version TEXT NOT NULL, meta_key TEXT NOT NULL,"
+                       "UNIQUE(type, app_id, version, meta_key));");
+
+        const std::string appEntity = "SELECT type, app_id, '', '' FROM apps WHERE idx = ";
+        const std::string versionEntity = "SELECT type, app_id, %s.version, '' FROM apps WHERE idx = %s.app_idx";
+        const std::string metadataEntity = "SELECT type, app_id, version, %s.meta_key FROM installed_apps "
+                                           "INNER JOIN apps ON apps.idx = installed_apps.app_idx WHERE installed_apps.idx = %s.app_idx";
+        auto row = [](std::string entity, const std::string& alias) {
+            for (auto pos = entity.find("%s"); pos != std::string::npos; pos = entity.find("%s", pos)) {
+                entity.replace(pos, 2, alias);
+            }
+            return entity;
+        };
+
+        ExecuteCommand(changeLogTrigger("change_log_app_insert", "INSERT ON apps", "added", appEntity + "NEW.idx"));
+        // the apps row is gone when AFTER DELETE runs
+        ExecuteCommand(changeLogTrigger("change_log_app_delete", "DELETE ON apps", "removed", "SELECT OLD.type, OLD.app_id, '', ''",
+                                        "DELETE FROM change_log WHERE type = OLD.type AND app_id = OLD.app_id; "));
+        ExecuteCommand(changeLogTrigger("change_log_version_insert", "INSERT ON installed_apps", "added", row(versionEntity, "NEW")));
+        ExecuteCommand(changeLogTrigger("change_log_version_update", "UPDATE ON installed_apps", "updated", row(versionEntity, "NEW")));
+        ExecuteCommand(changeLogTrigger("change_log_version_delete", "DELETE ON installed_apps", "removed", row(versionEntity, "OLD"),
+                                        "DELETE FROM change_log WHERE (type, app_id, version) IN "
+                                        "(SELECT type, app_id, OLD.version FROM apps WHERE idx = OLD.app_idx); "));
+        ExecuteCommand(changeLogTrigger("change_log_metadata_insert", "INSERT ON metadata", "updated", row(metadataEntity, "NEW")));
+        ExecuteCommand(changeLogTrigger("change_log_metadata_update", "UPDATE ON metadata", "updated", row(metadataEntity, "NEW")));
+        ExecuteCommand(changeLogTrigger("change_log_metadata_delete", "DELETE ON metadata", "removed", row(metadataEntity, "OLD")));
+    }
+    void SqlDataStorage::CreateDependencies() const
+    {
+        // removing a dependent drops its rows, a dependency cannot be removed while it is referenced
+        ExecuteCommand("CREATE TABLE dependencies("
+                            "dependent_idx INTEGER NOT NULL,"
+                            "dependency_idx INTEGER NOT NULL,"
+                            "FOREIGN KEY(dependent_idx) REFERENCES installed_apps(idx) ON DELETE CASCADE,"
+                            "FOREIGN KEY(dependency_idx) REFERENCES installed_apps(idx),"
+                            "PRIMARY KEY(dependent_idx, dependency_idx)"
+                            ") WITHOUT ROWID;");
+        // GetRefCount
+        ExecuteCommand("CREATE INDEX dependencies_by_dependency ON dependencies(dependency_idx, dependent_idx);");
+    }
+    void SqlDataStorage::CreateAppLayers() const
+    {
+        ExecuteCommand("CREATE TABLE app_layers("
+                            "app_idx INTEGER NOT NULL,"
+                            "position INTEGER NOT NULL,"
+                            "digest TEXT NOT NULL,"
+                            "FOREIGN KEY(app_idx) REFERENCES installed_apps(idx) ON DELETE CASCADE,"
+                            "PRIMARY KEY(app_idx, position)"
+                            ") WITHOUT ROWID;");
+        // GetLayerRefCount
+        ExecuteCommand("CREATE INDEX app_layers_by_digest ON app_layers(digest, app_idx);");
+    }
+    void SqlDataStorage::SyncChangeLogSize()
+    {
+        std::lock_guard<std::recursive_mutex> lock(transaction_mutex);
+        auto stmt = statement_cache.Acquire("UPDATE catalog_state SET log_size = ?1;");
+        sqlite3_bind_int64(stmt, 1, std::max(change_log_size, 1u));
+        ExecuteSqlStep(stmt);
+    }
+
     void SqlDataStorage::EnableForeignKeys() const
     {
         INFO("Enabling foreign keys");
@@ -369,38 +879,43 @@ namespace { // anonymous
 
         if (integrityCheckFailed) {
             ERROR("database integrity check failed, dropping tables");
+            ExecuteCommand("DROP TABLE IF EXISTS dependencies;");
+            ExecuteCommand("DROP TABLE IF EXISTS app_layers;");
             ExecuteCommand("DROP TABLE apps;");
             ExecuteCommand("DROP TABLE installed_apps;");
             ExecuteCommand("DROP TABLE metadata;");
+            ExecuteCommand("DROP TABLE IF EXISTS search_keys;");
+            ExecuteCommand("DROP TABLE IF EXISTS app_search;");
+            ExecuteCommand("DROP TABLE IF EXISTS change_log;");
+            ExecuteCommand("DROP TABLE IF EXISTS catalog_state;");
+            ExecuteCommand("PRAGMA user_version = 0;");
         }
     }
 
     std::vector<std::string> SqlDataStorage::GetAppsPaths(const std::string& type, const std::string& id, const std::string& version)
     {
         INFO(" ");
+        Reader reader{*this};
         std::string query = "SELECT app_path FROM installed_apps WHERE app_idx IN (SELECT idx FROM apps WHERE (?1 IS NULL OR type = ?1) AND (?2 IS NULL OR app_id = ?2)) AND (?3 IS NULL OR version = ?3)";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, version.empty() ? nullptr : version.c_str(), -1, SQLITE_TRANSIENT);
         auto paths = GetPaths(stmt);
-        sqlite3_finalize(stmt);
         return paths;
     }
 
     std::vector<std::string> SqlDataStorage::GetDataPaths(const std::string& type, const std::string& id)
     {
         INFO(" ");
+        Reader reader{*this};
         std::string query = "SELECT data_path FROM apps WHERE (?1 IS NULL OR type = ?1) AND (?2 IS NULL OR app_id = ?2)";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
         auto paths = GetPaths(stmt);
-        sqlite3_finalize(stmt);
         return paths;
     }
 
@@ -413,19 +928,33 @@ namespace { // anonymous
             paths.push_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
         }
         if (rc != SQLITE_DONE) {
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite3_db_handle(stmt)));
         }
         return paths;
     }
+    std::vector<DataStorage::AppDetails> SqlDataStorage::GetAppDetails(sqlite3_stmt* stmt) const
+    {
+        std::vector<AppDetails> appsList;
+        int rc{};
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            appsList.push_back(AppDetails{reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                                          reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)),
+                                          reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5))});
+        }
+        if (rc != SQLITE_DONE) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite3_db_handle(stmt)));
+        }
+        return appsList;
+    }
 
     std::vector<DataStorage::AppDetails> SqlDataStorage::GetAppDetailsList(const std::string& type, const std::string& id, const std::string& version,
                                                               const std::string& appName, const std::string& category)
     {
         INFO(" ");
+        Reader reader{*this};
         std::string query = "SELECT A.type,A.app_id,IA.version,IA.name,IA.category,IA.url FROM installed_apps IA, apps A WHERE (IA.app_idx == A.idx) AND (?1 IS NULL OR A.type = ?1) AND (?2 IS NULL OR app_id = ?2) "
                        "AND (?3 IS NULL OR version = ?3) AND (?4 IS NULL OR name = ?4) AND (?5 IS NULL OR category = ?5);";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(query);
         sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, version.empty() ? nullptr : version.c_str(), -1, SQLITE_TRANSIENT);
@@ -440,10 +969,8 @@ namespace { // anonymous
                           reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5))});
         }
         if (rc != SQLITE_DONE) {
-            sqlite3_finalize(stmt);
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
-        sqlite3_finalize(stmt);
         return appsList;
     }
 
@@ -452,10 +979,10 @@ namespace { // anonymous
                                                                            const std::string& appName, const std::string& category)
     {
         INFO(" ");
+        Reader reader{*this};
         std::string query = "SELECT type, app_id, version, name, category, url FROM apps LEFT OUTER JOIN installed_apps ON installed_apps.app_idx = apps.idx WHERE (?1 IS NULL OR type = ?1) AND (?2 IS NULL OR app_id = ?2) "
                             "AND (?3 IS NULL OR version = ?3) AND (?4 IS NULL OR name = ?4) AND (?5 IS NULL OR category = ?5);";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = reader.Acquire(query);
         sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, version.empty() ? nullptr : version.c_str(), -1, SQLITE_TRANSIENT);
@@ -470,28 +997,268 @@ namespace { // anonymous
                                           reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5))});
         }
         if (rc != SQLITE_DONE) {
-            sqlite3_finalize(stmt);
-            throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
         }
-        sqlite3_finalize(stmt);
         return appsList;
     }
+    DataStorage::AppDetailsPage SqlDataStorage::GetAppDetailsPage(const std::string& type,
+                                                                  const std::string& id,
+                                                                  const std::string& version,
+                                                                  const std::string& appName,
+                                                                  const std::string& category,
+                                                                  SortKey sortKey,
+                                                                  bool descending,
+                                                                  const std::string& cursor,
+                                                                  unsigned int limit)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        const std::string column = sortColumn(sortKey);
+        const std::string order = descending ? "DESC" : "ASC";
+        const std::string after = descending ? "<" : ">";
+        // identifies the listing the cursor was issued for
+        const std::string listing = column + ":" + order;
+
+        std::string lastSortValue, lastId;
+        if (!cursor.empty()) {
+            auto fields = decodeCursor(cursor);
+            if (fields.size() != 3 || fields[0] != listing) {
+                throw InvalidCursorError("cursor does not match the requested order: " + cursor);
+            }
+            lastSortValue = fields[1];
+            lastId = fields[2];
+        }
+
+        // the page of apps is selected first so a limit never splits the versions of an app
+        std::string query =
+            "SELECT page.type, page.app_id, version, name, category, url, page.sort_value FROM "
+            "(SELECT idx, type, app_id, " + column + " AS sort_value FROM apps "
+            "WHERE (?1 IS NULL OR type = ?1) AND (?2 IS NULL OR app_id = ?2) "
+            "AND ((?3 IS NULL AND ?4 IS NULL AND ?5 IS NULL) OR EXISTS (SELECT 1 FROM installed_apps WHERE app_idx = apps.idx "
+            "AND (?3 IS NULL OR version = ?3) AND (?4 IS NULL OR name = ?4) AND (?5 IS NULL OR category = ?5))) "
+            "AND (?6 IS NULL OR " + column + " " + after + " ?6 OR (" + column + " = ?6 AND app_id " + after + " ?7)) "
+            "ORDER BY sort_value " + order + ", app_id " + order + " LIMIT ?8) AS page "
+            "LEFT OUTER JOIN installed_apps ON installed_apps.app_idx = page.idx "
+            "AND (?3 IS NULL OR version = ?3) AND (?4 IS NULL OR name = ?4) AND (?5 IS NULL OR category = ?5) "
+            "ORDER BY page.sort_value " + order + ", page.app_id " + order + ", installed_apps.idx;";
+        auto stmt = reader.Acquire(query);
+        sqlite3_bind_text(stmt, 1, type.empty() ? nullptr : type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.empty() ? nullptr : id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.empty() ? nullptr : version.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 4, appName.empty() ? nullptr : appName.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 5, category.empty() ? nullptr : category.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 6, cursor.empty() ? nullptr : lastSortValue.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 7, lastId.c_str(), -1, SQLITE_TRANSIENT);
+        // one app more than requested tells whether there is a next page
+        sqlite3_bind_int64(stmt, 8, limit == 0 ? -1 : static_cast<sqlite3_int64>(limit) + 1);
+
+        AppDetailsPage page;
+        unsigned int appsCount{0};
+        std::string previousSortValue;
+        int rc{};
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            AppDetails details{reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)),
+                               reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3)),
+                               reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4)), reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5))};
+            if (page.apps.empty() || page.apps.back().id != details.id) {
+                if (limit != 0 && appsCount == limit) {
+                    page.nextCursor = encodeCursor({listing, previousSortValue, page.apps.back().id});
+                    break;
+                }
+                ++appsCount;
+                auto sortValue = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+                previousSortValue = sortValue ? sortValue : "";
+            }
+            page.apps.push_back(std::move(details));
+        }
+        if (rc != SQLITE_DONE && rc != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+        }
+        return page;
+    }
+    std::vector<DataStorage::AppDetails> SqlDataStorage::SearchApps(const std::string& query)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        if (!search_index) {
+            throw SqlDataStorageError("app search is not available");
+        }
+        auto expression = toMatchExpression(query);
+        if (expression.empty()) {
+            return {};
+        }
+        std::string sql = "SELECT type, app_id, version, installed_apps.name, installed_apps.category, url FROM app_search "
+                          "INNER JOIN installed_apps ON installed_apps.idx = app_search.rowid "
+                          "INNER JOIN apps ON apps.idx = installed_apps.app_idx "
+                          "WHERE app_search MATCH ?1 ORDER BY rank;";
+        auto stmt = reader.Acquire(sql);
+        sqlite3_bind_text(stmt, 1, expression.c_str(), -1, SQLITE_TRANSIENT);
+        return GetAppDetails(stmt);
+    }
+    std::vector<DataStorage::AppDetails> SqlDataStorage::GetAppDetailsListByMetadata(const std::string& key,
+                                                                                      const std::string& value)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        std::string query = "SELECT type, app_id, version, name, category, url FROM metadata "
+                            "INNER JOIN installed_apps ON installed_apps.idx = metadata.app_idx "
+                            "INNER JOIN apps ON apps.idx = installed_apps.app_idx "
+                            "WHERE meta_key = ?1 AND meta_value = ?2 ORDER BY app_id, installed_apps.idx;";
+        auto stmt = reader.Acquire(query);
+        sqlite3_bind_text(stmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, value.c_str(), -1, SQLITE_TRANSIENT);
+        return GetAppDetails(stmt);
+    }
+    void SqlDataStorage::AddDependency(const std::string& type,
+                                       const std::string& id,
+                                       const std::string& version,
+                                       const std::string& dependencyType,
+                                       const std::string& dependencyId,
+                                       const std::string& dependencyVersion)
+    {
+        INFO(" ");
+        std::lock_guard<std::recursive_mutex> lock(transaction_mutex);
+        // a version not installed leaves an index NULL and fails the NOT NULL constraint,
+        // OR IGNORE would skip that as well
+        std::string query = "INSERT INTO dependencies(dependent_idx, dependency_idx) VALUES("
+                            + installedIdx(1) + ", " + installedIdx(4) + ") ON CONFLICT DO NOTHING;";
+        auto stmt = statement_cache.Acquire(query);
+        sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 4, dependencyType.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 5, dependencyId.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 6, dependencyVersion.c_str(), -1, SQLITE_TRANSIENT);
+        ExecuteSqlStep(stmt);
+    }
+
+    std::vector<DataStorage::AppDetails> SqlDataStorage::GetDependencies(const std::string& type,
+                                                                         const std::string& id,
+                                                                         const std::string& version)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        std::string query = "SELECT type, app_id, version, name, category, url FROM dependencies "
+                            "INNER JOIN installed_apps ON installed_apps.idx = dependencies.dependency_idx "
+                            "INNER JOIN apps ON apps.idx = installed_apps.app_idx "
+                            "WHERE dependent_idx = " + installedIdx(1) + " ORDER BY app_id, version;";
+        auto stmt = reader.Acquire(query);
+        sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        return GetAppDetails(stmt);
+    }
+
+    unsigned int SqlDataStorage::GetRefCount(const std::string& type,
+                                             const std::string& id,
+                                             const std::string& version)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        std::string query = "SELECT COUNT(*) FROM dependencies WHERE dependency_idx = " + installedIdx(1) + ";";
+        auto stmt = reader.Acquire(query);
+        sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+        }
+        return static_cast<unsigned int>(sqlite3_column_int(stmt, 0));
+    }
+
+    void SqlDataStorage::AddInstalledApps(const std::vector<Installation>& installations)
+    {
+        INFO(" ");
+        Transaction transaction{*this};
+        for (const auto& installation : installations) {
+            const auto& app = installation.app;
+            AddInstalledApp(app.type, app.id, app.version, app.url, app.appName, app.category,
+                            installation.appPath, installation.appStoragePath, installation.volume);
+            for (const auto& dependency : installation.dependencies) {
+                AddDependency(app.type, app.id, app.version, dependency.type, dependency.id, dependency.version);
+            }
+            if (!installation.layers.empty()) {
+                SetAppLayers(app.type, app.id, app.version, installation.layers);
+            }
+        }
+        transaction.Commit();
+    }
+
+    void SqlDataStorage::SetAppLayers(const std::string& type,
+                                      const std::string& id,
+                                      const std::string& version,
+                                      const std::vector<std::string>& digests)
+    {
+        INFO(" ");
+        Transaction transaction{*this};
+        {
+            auto stmt = statement_cache.Acquire("DELETE FROM app_layers WHERE app_idx = " + installedIdx(1) + ";");
+            sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+            ExecuteSqlStep(stmt);
+        }
+        // a version not installed fails the NOT NULL constraint of app_idx
+        std::string query = "INSERT INTO app_layers(app_idx, position, digest) VALUES(" + installedIdx(1) + ", ?4, ?5);";
+        for (std::size_t position = 0; position < digests.size(); ++position) {
+            auto stmt = statement_cache.Acquire(query);
+            sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(position));
+            sqlite3_bind_text(stmt, 5, digests[position].c_str(), -1, SQLITE_TRANSIENT);
+            ExecuteSqlStep(stmt);
+        }
+        transaction.Commit();
+    }
+
+    std::vector<std::string> SqlDataStorage::GetAppLayers(const std::string& type,
+                                                          const std::string& id,
+                                                          const std::string& version)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        auto stmt = reader.Acquire("SELECT digest FROM app_layers WHERE app_idx = " + installedIdx(1) + " ORDER BY position;");
+        sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, version.c_str(), -1, SQLITE_TRANSIENT);
+        std::vector<std::string> digests;
+        int rc{};
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            digests.emplace_back(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)));
+        }
+        if (rc != SQLITE_DONE) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+        }
+        return digests;
+    }
+
+    unsigned int SqlDataStorage::GetLayerRefCount(const std::string& digest)
+    {
+        INFO(" ");
+        Reader reader{*this};
+        auto stmt = reader.Acquire("SELECT COUNT(DISTINCT app_idx) FROM app_layers WHERE digest = ?1;");
+        sqlite3_bind_text(stmt, 1, digest.c_str(), -1, SQLITE_TRANSIENT);
+        if (sqlite3_step(stmt) != SQLITE_ROW) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + reader.Error());
+        }
+        return static_cast<unsigned int>(sqlite3_column_int(stmt, 0));
+    }
+
     void SqlDataStorage::InsertIntoApps(const std::string& type,
                                         const std::string& id,
                                         const std::string& appPath,
-                                        const std::string& timeCreated)
+                                        std::int64_t timeCreated)
     {
         INFO(" ");
         std::string query = "INSERT INTO apps VALUES(NULL, $1, $2, $3, $4);";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = statement_cache.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, appPath.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 4, timeCreated.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 4, timeCreated);
         ExecuteSqlStep(stmt);
-        sqlite3_finalize(stmt);
     }
 
     int SqlDataStorage::GetAppIdx(const std::string& type,
@@ -500,17 +1267,14 @@ namespace { // anonymous
         INFO(" ");
         int appIdx{INVALID_INDEX};
         std::string query = "SELECT idx FROM apps WHERE type == $1 AND app_id ==  $2;";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = statement_cache.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
         if (sqlite3_step(stmt) != SQLITE_ROW) {
-            sqlite3_finalize(stmt);
             throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
         }
         appIdx = sqlite3_column_int(stmt, 0);
-        sqlite3_finalize(stmt);
         return appIdx;
     }
 
@@ -520,23 +1284,24 @@ namespace { // anonymous
                                              const std::string& category,
                                              const std::string& url,
                                              const std::string& appPath,
-                                             const std::string& timeCreated)
+                                             const std::string& volume,
+                                             std::int64_t timeCreated)
     {
         INFO(" ");
         assert(appIdx != INVALID_INDEX);
-        std::string query = "INSERT INTO installed_apps VALUES(NULL, $1, $2, $3, $4, $5, $6, $7, NULL, NULL);";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        std::string query = "INSERT INTO installed_apps(app_idx, version, name, category, url, app_path, created, volume) "
+                            "VALUES($1, $2, $3, $4, $5, $6, $7, $8);";
+        auto stmt = statement_cache.Acquire(query);
 
-        sqlite3_bind_text(stmt, 1, std::to_string(appIdx).c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 1, appIdx);
         sqlite3_bind_text(stmt, 2, version.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 3, name.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 4, category.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 5, url.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 6, appPath.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 7, timeCreated.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 7, timeCreated);
+        sqlite3_bind_text(stmt, 8, volume.empty() ? nullptr : volume.c_str(), -1, SQLITE_TRANSIENT);
         ExecuteSqlStep(stmt);
-        sqlite3_finalize(stmt);
     }
 
     void SqlDataStorage::DeleteFromInstalledApps(const std::string& type,
@@ -547,13 +1312,11 @@ namespace { // anonymous
         auto appIdx = GetAppIdx(type, id);
 
         std::string query = "DELETE FROM installed_apps WHERE app_idx == $1 AND version == $2;";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = statement_cache.Acquire(query);
 
-        sqlite3_bind_text(stmt, 1, std::to_string(appIdx).c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 1, appIdx);
         sqlite3_bind_text(stmt, 2, version.c_str(), -1, SQLITE_TRANSIENT);
         ExecuteSqlStep(stmt);
-        sqlite3_finalize(stmt);
     }
 
     void SqlDataStorage::DeleteFromApps(const std::string& type,
@@ -561,20 +1324,88 @@ namespace { // anonymous
     {
         INFO(" ");
         std::string query = "DELETE FROM apps WHERE type == $1 AND app_id == $2;";
-        sqlite3_stmt* stmt;
-        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        auto stmt = statement_cache.Acquire(query);
 
         sqlite3_bind_text(stmt, 1, type.c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(stmt, 2, id.c_str(), -1, SQLITE_TRANSIENT);
         ExecuteSqlStep(stmt);
-        sqlite3_finalize(stmt);
+    }
+
+    SqlDataStorage::Transaction::Transaction(SqlDataStorage& aStorage)
+        : storage(aStorage), lock(aStorage.transaction_mutex)
+    {
+        if (storage.transaction_depth == 0) {
+            storage.ExecuteCommand("BEGIN IMMEDIATE;");
+            outermost = true;
+        }
+        ++storage.transaction_depth;
+    }
+
+    SqlDataStorage::Transaction::~Transaction()
+    {
+        --storage.transaction_depth;
+        if (outermost && !committed) {
+            ERROR("rolling back transaction");
+            sqlite3_exec(storage.sqlite, "ROLLBACK;", nullptr, nullptr, nullptr);
+        }
+    }
+
+    void SqlDataStorage::Transaction::Commit()
+    {
+        if (outermost) {
+            storage.ExecuteCommand("COMMIT;");
+        }
+        committed = true;
+    }
+
+    SqlDataStorage::Reader::Reader(SqlDataStorage& aStorage)
+        : storage(aStorage)
+    {
+        std::unique_lock<std::mutex> lock(storage.readers_mutex);
+        if (storage.readers.empty()) {
+            lock.unlock();
+            writerLock = std::unique_lock<std::recursive_mutex>(storage.transaction_mutex);
+            return;
+        }
+        storage.reader_released.wait(lock, [this] { return !storage.idle_readers.empty(); });
+        connection = storage.idle_readers.back();
+        storage.idle_readers.pop_back();
+    }
+
+    SqlDataStorage::Reader::~Reader()
+    {
+        if (snapshot) {
+            sqlite3_exec(connection ? connection->sqlite : storage.sqlite, "COMMIT;", nullptr, nullptr, nullptr);
+        }
+        if (connection) {
+            std::lock_guard<std::mutex> lock(storage.readers_mutex);
+            storage.idle_readers.push_back(connection);
+            storage.reader_released.notify_all();
+        }
+    }
+
+    SqlStatement SqlDataStorage::Reader::Acquire(const std::string& query)
+    {
+        return connection ? connection->statementCache.Acquire(query) : storage.statement_cache.Acquire(query);
+    }
+
+    const char* SqlDataStorage::Reader::Error() const
+    {
+        return sqlite3_errmsg(connection ? connection->sqlite : storage.sqlite);
+    }
+
+    void SqlDataStorage::Reader::BeginSnapshot()
+    {
+        if (sqlite3_exec(connection ? connection->sqlite : storage.sqlite, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            throw SqlDataStorageError(std::string{"sqlite error: "} + Error());
+        }
+        snapshot = true;
     }
 
     void SqlDataStorage::ExecuteSqlStep(sqlite3_stmt* stmt)
     {
         INFO(" ");
         if (sqlite3_step(stmt) != SQLITE_DONE) {
-            sqlite3_finalize(stmt);
             throw SqlDataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite));
         }
     }
@@ -20,7 +20,12 @@
 #pragma once
 
 #include "DataStorage.h"
+#include "SqlStatementCache.h"
 
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sqlite3.h>
 #include <stdexcept>
@@ -36,7 +41,12 @@ using SqlDataStorageError = DataStorageError;
 class SqlDataStorage: public DataStorage
 {
     public:
-        explicit SqlDataStorage(const std::string& path): db_path(path + db_name) {}
+        explicit SqlDataStorage(const std::string& path, unsigned long long mmapSize = 0,
+                                const std::vector<std::string>& searchMetadataKeys = {},
+                                unsigned int changeLogSize = DEFAULT_CHANGE_LOG_SIZE,
+                                unsigned int readConnections = DEFAULT_READ_CONNECTIONS)
+            : db_path(path + db_name), mmap_size(mmapSize), search_metadata_keys(searchMetadataKeys),
+              change_log_size(changeLogSize), read_connections(readConnections) {}
         SqlDataStorage(const SqlDataStorage&) = delete;
         SqlDataStorage& operator=(const SqlDataStorage&) = delete;
         ~SqlDataStorage();
@@ -51,6 +61,18 @@ class SqlDataStorage: public DataStorage
 
         std::vector<DataStorage::AppDetails> GetAppDetailsListOuterJoin(const std::string& type, const std::string& id, const std::string& version,
                                                                         const std::string& appName, const std::string& category) override;
+        AppDetailsPage GetAppDetailsPage(const std::string& type,
+                                         const std::string& id,
+                                         const std::string& version,
+                                         const std::string& appName,
+                                         const std::string& category,
+                                         SortKey sortKey,
+                                         bool descending,
+                                         const std::string& cursor,
+                                         unsigned int limit) override;
+        std::vector<DataStorage::AppDetails> SearchApps(const std::string& query) override;
+        std::vector<DataStorage::AppDetails> GetAppDetailsListByMetadata(const std::string& key,
+                                                                         const std::string& value) override;
         void AddInstalledApp(const std::string& type,
                              const std::string& id,
                              const std::string& version,
@@ -58,7 +80,8 @@ class SqlDataStorage: public DataStorage
                              const std::string& appName,
                              const std::string& category,
                              const std::string& appPath,
-                             const std::string& appStoragePath) override;
+                             const std::string& appStoragePath,
+                             const std::string& volume) override;
 
         bool IsAppInstalled(const std::string& type,
                             const std::string& id,
@@ -66,6 +89,15 @@ class SqlDataStorage: public DataStorage
 
         std::string GetTypeOfApp(const std::string& id) override;
 
+        std::string GetAppVolume(const std::string& type,
+                                 const std::string& id,
+                                 const std::string& version) override;
+
+        void SetAppVolume(const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          const std::string& volume) override;
+
         bool IsAppData(const std::string& type,
                        const std::string& id) override;
 
@@ -82,6 +114,11 @@ class SqlDataStorage: public DataStorage
                          const std::string& key,
                          const std::string& value) override;
 
+        void SetMetadataBatch(const std::string& type,
+                              const std::string& id,
+                              const std::string& version,
+                              const std::vector<std::pair<std::string, std::string> >& metadata) override;
+
         void ClearMetadata(const std::string& type,
                          const std::string& id,
                          const std::string& version,
@@ -91,26 +128,146 @@ class SqlDataStorage: public DataStorage
                                const std::string& id,
                                const std::string& version) override;
 
+        DataStorage::ChangeSet GetChanges(std::uint64_t sinceGeneration) override;
+
+        void AddDependency(const std::string& type,
+                           const std::string& id,
+                           const std::string& version,
+                           const std::string& dependencyType,
+                           const std::string& dependencyId,
+                           const std::string& dependencyVersion) override;
+
+        std::vector<DataStorage::AppDetails> GetDependencies(const std::string& type,
+                                                             const std::string& id,
+                                                             const std::string& version) override;
+
+        unsigned int GetRefCount(const std::string& type,
+                                 const std::string& id,
+                                 const std::string& version) override;
+
+        void AddInstalledApps(const std::vector<Installation>& installations) override;
+
+        void SetAppLayers(const std::string& type,
+                          const std::string& id,
+                          const std::string& version,
+                          const std::vector<std::string>& digests) override;
+
+        std::vector<std::string> GetAppLayers(const std::string& type,
+                                              const std::string& id,
+                                              const std::string& version) override;
+
+        unsigned int GetLayerRefCount(const std::string& digest) override;
+
+        constexpr static unsigned int DEFAULT_CHANGE_LOG_SIZE = 1000;
+        constexpr static unsigned int DEFAULT_READ_CONNECTIONS = 2;
+
     private:
-        static sqlite3* sqlite;
+        /**
+         * Scoped write transaction (BEGIN IMMEDIATE), rolled back unless Commit() is called.
+         * Writes from other threads wait until it ends, nested scopes join the outer one.
+         */
+        class Transaction
+        {
+            public:
+                explicit Transaction(SqlDataStorage& storage);
+                Transaction(const Transaction&) = delete;
+                Transaction& operator=(const Transaction&) = delete;
+                ~Transaction();
+                void Commit();
+
+            private:
+                SqlDataStorage& storage;
+                std::unique_lock<std::recursive_mutex> lock;
+                bool outermost{false};
+                bool committed{false};
+        };
+
+        struct Connection
+        {
+            sqlite3* sqlite{nullptr};
+            SqlStatementCache statementCache;
+        };
+
+        /**
+         * Read-only connection borrowed from the pool for the lifetime of the object, waits
+         * while all of them are in use. Readers see the last committed state and do not
+         * wait for writes. Without a pool the writer connection is used.
+         */
+        class Reader
+        {
+            public:
+                explicit Reader(SqlDataStorage& storage);
+                Reader(const Reader&) = delete;
+                Reader& operator=(const Reader&) = delete;
+                ~Reader();
+
+                SqlStatement Acquire(const std::string& query);
+                const char* Error() const;
+                // following statements read from one snapshot of the database
+                void BeginSnapshot();
+
+            private:
+                SqlDataStorage& storage;
+                std::unique_lock<std::recursive_mutex> writerLock;
+                Connection* connection{nullptr};
+                bool snapshot{false};
+        };
+
+        // the writer, all writes are serialized on it
+        sqlite3* sqlite{nullptr};
+        mutable SqlStatementCache statement_cache;
+        std::vector<std::unique_ptr<Connection> > readers;
+        std::vector<Connection*> idle_readers;
+        std::mutex readers_mutex;
+        std::condition_variable reader_released;
+        // held by Transaction and by single statement writes
+        std::recursive_mutex transaction_mutex;
+        int transaction_depth{0};
         const std::string db_name = "apps.db";
         const std::string db_path;
+        const unsigned long long mmap_size;
+        const std::vector<std::string> search_metadata_keys;
+        const unsigned int change_log_size;
+        const unsigned int read_connections;
+        // false if sqlite was built without FTS5
+        bool search_index{false};
         using SqlCallback = int (*)(void*, int, char**, char**);
         constexpr static int INVALID_INDEX = -1;
 
         void Terminate();
         void InitDB();
         void OpenConnection();
+        void OpenReaders();
+        void ConfigureConnection() const;
+        struct Migration
+        {
+            const char* description;
+            void (SqlDataStorage::*apply)() const;
+        };
+        static const std::vector<Migration>& Migrations();
+        void Migrate();
         void CreateTables() const;
+        void AddMissingColumns() const;
+        void MigrateMetadataAppIdx() const;
+        void MigrateCreatedToEpoch() const;
+        void CreateIndexes() const;
+        void CreateSearchIndex() const;
+        void SyncSearchKeys();
+        void CreateChangeLog() const;
+        void CreateDependencies() const;
+        void CreateAppLayers() const;
+        void SyncChangeLogSize();
+        bool HasColumn(const std::string& table, const std::string& column) const;
         void EnableForeignKeys() const;
         void ExecuteCommand(const std::string& command, SqlCallback callback = nullptr, void* val = nullptr) const;
         void Validate() const;
         std::vector<std::string> GetPaths(sqlite3_stmt* stmt) const;
+        std::vector<DataStorage::AppDetails> GetAppDetails(sqlite3_stmt* stmt) const;
 
         void InsertIntoApps(const std::string& type,
                             const std::string& id,
                             const std::string& appPath,
-                            const std::string& created);
+                            std::int64_t created);
 
         int GetAppIdx(const std::string& type,
                       const std::string& id);
@@ -121,7 +278,8 @@ class SqlDataStorage: public DataStorage
                                      const std::string& category,
                                      const std::string& url,
                                      const std::string& appPath,
-                                     const std::string& timeCreated);
+                                     const std::string& volume,
+                                     std::int64_t timeCreated);
 
         void DeleteFromInstalledApps(const std::string& type,
                                      const std::string& id,
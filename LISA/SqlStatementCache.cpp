@@ -0,0 +1,107 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Debug.h"
+#include "DataStorage.h"
+#include "SqlStatementCache.h"
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+    SqlStatement::SqlStatement(SqlStatementCache& aCache, Pool& aPool, unsigned long aGeneration, sqlite3_stmt* aStmt)
+        : cache(aCache), pool(aPool), generation(aGeneration), stmt(aStmt)
+    {
+    }
+
+    SqlStatement::SqlStatement(SqlStatement&& other)
+        : cache(other.cache), pool(other.pool), generation(other.generation), stmt(other.stmt)
+    {
+        other.stmt = nullptr;
+    }
+
+    SqlStatement::~SqlStatement()
+    {
+        if (stmt) {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+            cache.Release(pool, generation, stmt);
+        }
+    }
+
+    SqlStatementCache::~SqlStatementCache()
+    {
+        Clear();
+    }
+
+    void SqlStatementCache::Initialize(sqlite3* connection)
+    {
+        Clear();
+        std::lock_guard<std::mutex> lock(mutex);
+        sqlite = connection;
+    }
+
+    SqlStatement SqlStatementCache::Acquire(const std::string& query)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // references to the pool stay valid on rehash, only Clear() removes it
+        auto& pool = statements[query];
+        if (!pool.empty()) {
+            auto stmt = pool.back();
+            pool.pop_back();
+            return SqlStatement{*this, pool, generation, stmt};
+        }
+
+        sqlite3_stmt* stmt{nullptr};
+#if SQLITE_VERSION_NUMBER >= 3020000
+        int rc = sqlite3_prepare_v3(sqlite, query.c_str(), query.length(), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+#else
+        int rc = sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+#endif
+        if (rc != SQLITE_OK) {
+            throw DataStorageError(std::string{"sqlite error: "} + sqlite3_errmsg(sqlite) + " preparing " + query);
+        }
+        return SqlStatement{*this, pool, generation, stmt};
+    }
+
+    void SqlStatementCache::Release(SqlStatement::Pool& pool, unsigned long aGeneration, sqlite3_stmt* stmt)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (aGeneration == generation) {
+            pool.push_back(stmt);
+        } else {
+            // cache was cleared while the statement was in use
+            sqlite3_finalize(stmt);
+        }
+    }
+
+    void SqlStatementCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& entry : statements) {
+            for (auto stmt : entry.second) {
+                sqlite3_finalize(stmt);
+            }
+        }
+        statements.clear();
+        ++generation;
+    }
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,90 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+class SqlStatementCache;
+
+/**
+ * RAII handle of a prepared statement borrowed from SqlStatementCache.
+ * On destruction the statement is reset, its bindings cleared and it is
+ * returned to the cache for the next call of the same query.
+ */
+class SqlStatement
+{
+    public:
+        using Pool = std::vector<sqlite3_stmt*>;
+
+        SqlStatement(SqlStatementCache& cache, Pool& pool, unsigned long generation, sqlite3_stmt* stmt);
+        SqlStatement(SqlStatement&& other);
+        SqlStatement(const SqlStatement&) = delete;
+        SqlStatement& operator=(const SqlStatement&) = delete;
+        SqlStatement& operator=(SqlStatement&&) = delete;
+        ~SqlStatement();
+
+        operator sqlite3_stmt*() const { return stmt; }
+
+    private:
+        SqlStatementCache& cache;
+        Pool& pool;
+        unsigned long generation;
+        sqlite3_stmt* stmt;
+};
+
+/**
+ * Prepared statements of one connection, keyed by their SQL text. A query is
+ * parsed and planned once, later calls reuse the statement. Nested or concurrent
+ * use of the same query gets another instance, so handles never share state.
+ */
+class SqlStatementCache
+{
+    public:
+        SqlStatementCache() = default;
+        SqlStatementCache(const SqlStatementCache&) = delete;
+        SqlStatementCache& operator=(const SqlStatementCache&) = delete;
+        ~SqlStatementCache();
+
+        void Initialize(sqlite3* connection);
+        SqlStatement Acquire(const std::string& query);
+        // finalizes all statements, must be called before the connection is closed
+        void Clear();
+
+    private:
+        friend class SqlStatement;
+        void Release(SqlStatement::Pool& pool, unsigned long generation, sqlite3_stmt* stmt);
+
+        std::mutex mutex;
+        sqlite3* sqlite{nullptr};
+        // bumped by Clear(), handles of older generations finalize their statement
+        unsigned long generation{0};
+        std::unordered_map<std::string, SqlStatement::Pool> statements;
+};
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
@@ -0,0 +1,64 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StorageCursor.h"
+#include "DataStorage.h"
+
+#include <cctype>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+std::string encodeCursor(const std::vector<std::string>& fields)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string cursor;
+    for (const auto& field : fields) {
+        if (!cursor.empty()) {
+            cursor += '.';
+        }
+        for (unsigned char c : field) {
+            cursor += digits[c >> 4];
+            cursor += digits[c & 0x0f];
+        }
+    }
+    return cursor;
+}
+
+std::vector<std::string> decodeCursor(const std::string& cursor)
+{
+    std::vector<std::string> fields(1);
+    for (size_t i = 0; i < cursor.size(); ++i) {
+        if (cursor[i] == '.') {
+            fields.emplace_back();
+            continue;
+        }
+        if (i + 1 >= cursor.size() || !isxdigit(static_cast<unsigned char>(cursor[i])) || !isxdigit(static_cast<unsigned char>(cursor[i + 1]))) {
+            throw InvalidCursorError("malformed cursor: " + cursor);
+        }
+        fields.back() += static_cast<char>(std::stoi(cursor.substr(i, 2), nullptr, 16));
+        ++i;
+    }
+    return fields;
+}
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
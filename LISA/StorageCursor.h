@@ -0,0 +1,38 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2021 Liberty Global Service B.V.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace WPEFramework {
+namespace Plugin {
+namespace LISA {
+
+// Continuation tokens of DataStorage::GetAppDetailsPage, opaque to clients:
+// hex encoded fields joined with '.'
+std::string encodeCursor(const std::vector<std::string>& fields);
+
+// throws InvalidCursorError if the cursor is malformed
+std::vector<std::string> decodeCursor(const std::string& cursor);
+
+} // namespace LISA
+} // namespace Plugin
+} // namespace WPEFramework
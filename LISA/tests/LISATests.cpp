@@ -21,6 +21,7 @@
 #include <chrono>
 #include <thread>
 #include <boost/filesystem.hpp>
+#include <boost/property_tree/json_parser.hpp>
 #include <sqlite3.h>
 #include <unistd.h>
 #include <cstdlib>
@@ -29,8 +30,23 @@
 #include <string>
 #include <iostream>
 
+#include <Archives.h>
+#include <DirectoryWalker.h>
+#include <Downloader.h>
 #include <Executor.h>
 #include <Filesystem.h>
+#include <ImageStore.h>
+#include <JobHistory.h>
+#include <JobJournal.h>
+#include <KvDataStorage.h>
+#include <NotificationDispatcher.h>
+#include <OperationStatusFilter.h>
+#include <PackedPayload.h>
+#include <SqlDataStorage.h>
+#include <StorageCursor.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <set>
 
 using namespace std;
 using namespace WPEFramework::Plugin::LISA;
@@ -131,8 +147,11 @@ public:
 CATCH_REGISTER_LISTENER(TestRunListener)
 #endif //USE_INTERNAL_TARBALL
 
-static void configure(Executor &lisa, std::string annotations_file = "") {
-    boost::filesystem::remove_all(lisa_playground);
+// a kept playground is what the executor finds after a restart
+static void configure(Executor &lisa, std::string annotations_file = "", bool keep_playground = false) {
+    if (!keep_playground) {
+        boost::filesystem::remove_all(lisa_playground);
+    }
     boost::filesystem::create_directories(lisa_playground);
     lisa_playground = boost::filesystem::canonical(lisa_playground).string();
     lisa.Configure(" { \"dbpath\":\""   + lisa_playground + db_subpath   + "\","
@@ -1152,3 +1171,2226 @@ CATCH_TEST_CASE("LISA : test of downloadTimeoutSeconds", "[all][test18][slow][mo
     CATCH_CHECK(last_event_received_.version == DACAPP_VERSION);
     CATCH_CHECK(last_event_received_.handle == handle);
 }
+
+CATCH_TEST_CASE("LISA : unpack applies ownership and permissions per entry", "[all][test19][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground + "/unpack");
+    string destination = lisa_playground + "/unpack/";
+
+    Archive::unpack("files/waylandegltest.tar.gz", destination, getgid(), false);
+
+    struct stat st{};
+    CATCH_REQUIRE(stat((destination + "config.json").c_str(), &st) == 0);
+    CATCH_CHECK((st.st_mode & 07777) == Filesystem::getPermissionMode(false, false));
+    CATCH_CHECK(st.st_uid == getuid());
+    CATCH_CHECK(st.st_gid == getgid());
+
+    CATCH_REQUIRE(stat((destination + "rootfs/usr/bin").c_str(), &st) == 0);
+    CATCH_CHECK((st.st_mode & 07777) == Filesystem::getPermissionMode(true, false));
+    CATCH_CHECK(st.st_gid == getgid());
+}
+
+static void createTree(const string& root, int dirs, int filesPerDir, int fileSize) {
+    for (int d = 0; d < dirs; ++d) {
+        string dir = root + "/dir" + to_string(d) + "/sub";
+        boost::filesystem::create_directories(dir);
+        for (int f = 0; f < filesPerDir; ++f) {
+            ofstream(dir + "/file" + to_string(f)) << string(fileSize, 'x');
+        }
+    }
+}
+
+CATCH_TEST_CASE("LISA : directory walker", "[all][test20][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string root = lisa_playground + "/walk";
+    createTree(root, 8, 5, 100);
+    boost::filesystem::create_directory_symlink(root + "/dir0", root + "/link0");
+
+    // 17 directories each opened once and read to its end, d_type spares the stat of the symlink
+    // and the directories, usage needs the blocks of every entry but nothing is stat'ed twice
+    Filesystem::WalkCounter counter;
+    Filesystem::setWalkCounter(&counter);
+    CATCH_CHECK(Filesystem::getDirectorySpace(root) == 8 * 5 * 100);
+    CATCH_CHECK(counter.opens == 17);
+    CATCH_CHECK(counter.reads == 2 * 17);
+    CATCH_CHECK(counter.stats == 8 + 1 + 8 + 8 * 5);
+    counter.opens = counter.reads = counter.stats = 0;
+    CATCH_CHECK(Filesystem::getSubdirectories(root).size() == 8);
+    CATCH_CHECK(counter.opens == 1);
+    CATCH_CHECK(counter.reads == 2);
+    CATCH_CHECK(counter.stats == 0);
+    Filesystem::setWalkCounter(nullptr);
+    CATCH_CHECK(!Filesystem::isEmpty(root));
+    boost::filesystem::create_directories(root + "/empty");
+    CATCH_CHECK(Filesystem::isEmpty(root + "/empty"));
+
+    std::set<string> sequential;
+    Filesystem::walkDirectory(root, [&sequential](const Filesystem::DirEntry& entry) {
+        sequential.insert(to_string(entry.depth) + entry.name);
+        return Filesystem::WalkAction::CONTINUE;
+    });
+    std::mutex parallelMutex;
+    std::set<string> parallel;
+    Filesystem::walkDirectoryParallel(root, [&](const Filesystem::DirEntry& entry) {
+        std::lock_guard<std::mutex> lock(parallelMutex);
+        parallel.insert(to_string(entry.depth) + entry.name);
+        return Filesystem::WalkAction::CONTINUE;
+    }, 4);
+    CATCH_CHECK(sequential == parallel);
+
+    std::atomic<int> visited{0};
+    CATCH_CHECK_FALSE(Filesystem::walkDirectoryParallel(root, [&visited](const Filesystem::DirEntry&) {
+        return (++visited == 3) ? Filesystem::WalkAction::STOP : Filesystem::WalkAction::CONTINUE;
+    }, 4));
+
+    Filesystem::removeAllDirectoriesExcept(root, "dir1");
+    auto remaining = Filesystem::getSubdirectories(root);
+    CATCH_REQUIRE(remaining.size() == 1);
+    CATCH_CHECK(remaining[0] == "dir1");
+}
+
+CATCH_TEST_CASE("LISA : directory usage with sparse and hardlinked files", "[all][test21][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string root = lisa_playground + "/usage";
+    boost::filesystem::create_directories(root + "/sub");
+
+    const unsigned long long sparseSize = 16 * 1024 * 1024;
+    ofstream(root + "/sparse").close();
+    CATCH_REQUIRE(truncate((root + "/sparse").c_str(), sparseSize) == 0);
+    ofstream(root + "/sub/data") << string(8192, 'x');
+    boost::filesystem::create_hard_link(root + "/sub/data", root + "/linked");
+
+    auto usage = Filesystem::getDirectoryUsage({root});
+    CATCH_CHECK(usage.apparentBytes == sparseSize + 8192);
+    CATCH_CHECK(usage.allocatedBytes < sparseSize);
+    CATCH_CHECK(usage.allocatedBytes >= 8192);
+
+    // nested roots are not counted twice
+    auto nestedUsage = Filesystem::getDirectoryUsage({root, root + "/sub"});
+    CATCH_CHECK(nestedUsage.apparentBytes == usage.apparentBytes);
+    CATCH_CHECK(nestedUsage.allocatedBytes == usage.allocatedBytes);
+}
+
+CATCH_TEST_CASE("LISA : install on secondary volume when primary is over its reserve", "[all][test22][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground + "/usb/images");
+    lisa_playground = boost::filesystem::canonical(lisa_playground).string();
+    string usbMount = lisa_playground + "/usb/images/";
+    string usbPath = usbMount + Config::SECONDARY_VOLUME_DIR;
+    // data of others on the volume is left alone
+    ofstream(usbMount + "photo.jpg") << "photo";
+    boost::filesystem::create_directories(usbMount + "music");
+    // reserve on the primary volume larger than any disk
+    lisa.Configure(" { \"dbpath\":\"" + lisa_playground + db_subpath + "\","
+                   "   \"datapath\":\"" + lisa_playground + data_subpath + "\","
+                   "   \"tmppath\":\"" + lisa_playground + apps_subpath + "/tmp\","
+                   "   \"volumes\":["
+                   "     {\"name\":\"internal\", \"path\":\"" + lisa_playground + apps_subpath + "\", \"reserveKB\":" + std::to_string(1ULL << 40) + "},"
+                   "     {\"name\":\"usb\", \"path\":\"" + usbMount + "\", \"speed\":\"slow\"},"
+                   "     {\"name\":\"sdcard\", \"path\":\"" + lisa_playground + "/not_mounted\"}"
+                   "   ]}");
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 1);
+    CATCH_CHECK(boost::filesystem::exists(usbPath + "0/" DACAPP_ID "/" DACAPP_VERSION "/config.json"));
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/" DACAPP_ID));
+    CATCH_CHECK_FALSE(boost::filesystem::exists(lisa_playground + "/not_mounted"));
+    CATCH_CHECK(boost::filesystem::exists(usbMount + "photo.jpg"));
+    CATCH_CHECK(boost::filesystem::exists(usbMount + "music"));
+
+    Filesystem::StorageDetails details;
+    result = lisa.GetStorageDetails(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, details);
+    CATCH_REQUIRE(result == 0);
+    CATCH_CHECK(details.appPath.find(usbPath) == 0);
+
+    result = lisa.Uninstall(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 0);
+    CATCH_CHECK_FALSE(boost::filesystem::exists(usbPath + "0/" DACAPP_ID "/" DACAPP_VERSION));
+}
+
+CATCH_TEST_CASE("LISA : move app between volumes", "[all][test23][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground + "/usb/images");
+    lisa_playground = boost::filesystem::canonical(lisa_playground).string();
+    string internalPath = lisa_playground + apps_subpath + "/";
+    string usbMount = lisa_playground + "/usb/images/";
+    string usbPath = usbMount + Config::SECONDARY_VOLUME_DIR;
+    lisa.Configure(" { \"dbpath\":\"" + lisa_playground + db_subpath + "\","
+                   "   \"datapath\":\"" + lisa_playground + data_subpath + "\","
+                   "   \"volumes\":["
+                   "     {\"name\":\"internal\", \"path\":\"" + internalPath + "\"},"
+                   "     {\"name\":\"usb\", \"path\":\"" + usbMount + "\", \"speed\":\"slow\"}"
+                   "   ]}");
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    string appSubPath = "0/" DACAPP_ID "/" DACAPP_VERSION "/";
+    CATCH_REQUIRE(boost::filesystem::exists(internalPath + appSubPath + "config.json"));
+    boost::filesystem::create_symlink("config.json", internalPath + appSubPath + "link");
+    auto sourceUsage = Filesystem::getDirectoryUsage({internalPath + appSubPath});
+
+    // locked app is never moved
+    string lockHandle;
+    CATCH_REQUIRE(lisa.Lock(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "running", "test", lockHandle) == 0);
+    CATCH_CHECK(lisa.Move(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "usb", handle) == Executor::ERROR_APP_LOCKED);
+    CATCH_REQUIRE(lisa.Unlock(lockHandle) == 0);
+
+    CATCH_CHECK(lisa.Move(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "unknown", handle) == Executor::ERROR_WRONG_PARAMS);
+
+    result = lisa.Move(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "usb", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(last_event_received_.operation == Executor::OperationType::MOVING);
+
+    CATCH_CHECK_FALSE(boost::filesystem::exists(internalPath + appSubPath));
+    CATCH_CHECK(boost::filesystem::is_symlink(usbPath + appSubPath + "link"));
+    CATCH_CHECK(boost::filesystem::read_symlink(usbPath + appSubPath + "link") == "config.json");
+    auto targetUsage = Filesystem::getDirectoryUsage({usbPath + appSubPath});
+    CATCH_CHECK(targetUsage.apparentBytes == sourceUsage.apparentBytes);
+
+    Filesystem::StorageDetails details;
+    CATCH_REQUIRE(lisa.GetStorageDetails(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, details) == 0);
+    CATCH_CHECK(details.appPath == usbPath + appSubPath);
+
+    // already there
+    result = lisa.Move(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "usb", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_CHECK(last_event_received_.status == Executor::OperationStatus::FAILED);
+    CATCH_CHECK(boost::filesystem::exists(usbPath + appSubPath + "config.json"));
+
+    result = lisa.Move(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "internal", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(boost::filesystem::exists(internalPath + appSubPath + "config.json"));
+    CATCH_CHECK_FALSE(boost::filesystem::exists(usbPath + appSubPath));
+
+    // a copy of the right size but with other data is not taken as a copy
+    string copyPath = lisa_playground + "/copy";
+    boost::filesystem::create_directories(copyPath);
+    CATCH_REQUIRE(Filesystem::copyDirectory(internalPath + appSubPath, copyPath, nullptr));
+    CATCH_CHECK_NOTHROW(Filesystem::verifyDirectoryCopy(internalPath + appSubPath, copyPath));
+    {
+        fstream file(copyPath + "/config.json", ios::in | ios::out | ios::binary);
+        file.seekp(-1, ios::end);
+        file.put('#');
+    }
+    CATCH_CHECK_THROWS_AS(Filesystem::verifyDirectoryCopy(internalPath + appSubPath, copyPath), Filesystem::FilesystemError);
+}
+
+CATCH_TEST_CASE("LISA : database uses WAL and rolls back failed multi-step writes", "[all][test24][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    SqlDataStorage storage{dbPath, 1024 * 1024};
+    storage.Initialize();
+
+    sqlite3* sqlite;
+    CATCH_REQUIRE(sqlite3_open((dbPath + "apps.db").c_str(), &sqlite) == SQLITE_OK);
+    sqlite3_stmt* stmt;
+    sqlite3_prepare_v2(sqlite, "PRAGMA journal_mode;", -1, &stmt, nullptr);
+    CATCH_REQUIRE(sqlite3_step(stmt) == SQLITE_ROW);
+    CATCH_CHECK(string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))) == "wal");
+    sqlite3_finalize(stmt);
+
+    // make the second statement of AddInstalledApp fail
+    CATCH_REQUIRE(sqlite3_exec(sqlite, "CREATE TRIGGER fail_insert BEFORE INSERT ON installed_apps "
+                                       "BEGIN SELECT RAISE(ABORT, 'test'); END;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(sqlite);
+
+    CATCH_CHECK_THROWS_AS(storage.AddInstalledApp(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "url", "name", "cat",
+                                                  Filesystem::createAppPath(DACAPP_ID, DACAPP_VERSION),
+                                                  Filesystem::createAppPath(DACAPP_ID), ""),
+                          DataStorageError);
+    // the apps row inserted before is rolled back too
+    CATCH_CHECK_FALSE(storage.IsAppData(DACAPP_MIME, DACAPP_ID));
+    CATCH_CHECK(countAppsInDB() == 0);
+}
+
+CATCH_TEST_CASE("LISA : database schema migrations keep existing data", "[all][test25][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    // database as written by versions without schema versioning
+    sqlite3* sqlite;
+    CATCH_REQUIRE(sqlite3_open((dbPath + "apps.db").c_str(), &sqlite) == SQLITE_OK);
+    CATCH_REQUIRE(sqlite3_exec(sqlite,
+        "CREATE TABLE apps(idx INTEGER PRIMARY KEY, type TEXT NOT NULL, app_id TEXT UNIQUE NOT NULL, data_path TEXT, created TEXT NOT NULL);"
+        "CREATE TABLE installed_apps (idx INTEGER PRIMARY KEY, app_idx INTEGER NOT NULL, version TEXT NOT NULL, name TEXT NOT NULL,"
+        "  category TEXT, url TEXT, app_path TEXT, created TEXT NOT NULL, resources TEXT, metadata TEXT,"
+        "  FOREIGN KEY(app_idx) REFERENCES apps(idx), UNIQUE(app_idx, version));"
+        "CREATE TABLE metadata(idx INTEGER PRIMARY KEY, app_idx TEXT NOT NULL, meta_key TEXT NOT NULL, meta_value TEXT NOT NULL,"
+        "  FOREIGN KEY(app_idx) REFERENCES installed_apps(idx), UNIQUE(app_idx, meta_key));"
+        "INSERT INTO apps VALUES(1, '" DACAPP_MIME "', '" DACAPP_ID "', '0/" DACAPP_ID "/', 'Thu Jan  1 00:01:40 1970\n');"
+        "INSERT INTO installed_apps VALUES(1, 1, '" DACAPP_VERSION "', 'name', 'cat', 'url', '0/" DACAPP_ID "/" DACAPP_VERSION "/',"
+        "  'Thu Jan  1 00:01:40 1970\n', NULL, NULL);"
+        "INSERT INTO metadata VALUES(1, '1', 'key', 'value');",
+        nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(sqlite);
+
+    {
+        SqlDataStorage storage{dbPath};
+        storage.Initialize();
+        CATCH_CHECK(storage.IsAppInstalled(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION));
+        CATCH_CHECK(storage.GetAppVolume(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION).empty());
+        auto metadata = storage.GetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION);
+        CATCH_REQUIRE(metadata.metadata.size() == 1);
+        CATCH_CHECK(metadata.metadata[0].second == "value");
+    }
+
+    auto queryValue = [&dbPath](const char* query, int column = 0) {
+        sqlite3* sqlite;
+        sqlite3_open((dbPath + "apps.db").c_str(), &sqlite);
+        sqlite3_stmt* stmt;
+        sqlite3_prepare_v2(sqlite, query, -1, &stmt, nullptr);
+        string value = (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, column))
+                       ? reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)) : "";
+        sqlite3_finalize(stmt);
+        sqlite3_close(sqlite);
+        return value;
+    };
+    CATCH_CHECK(queryValue("PRAGMA user_version;") == "9");
+    CATCH_CHECK(queryValue("SELECT typeof(app_idx) FROM metadata;") == "integer");
+    CATCH_CHECK(queryValue("SELECT typeof(created) FROM apps;") == "integer");
+    // local time in the old format, so compare against the same conversion
+    struct tm tm{};
+    strptime("Thu Jan  1 00:01:40 1970", "%a %b %d %H:%M:%S %Y", &tm);
+    tm.tm_isdst = -1;
+    CATCH_CHECK(queryValue("SELECT created FROM installed_apps;") == std::to_string(mktime(&tm)));
+    auto plan = queryValue("EXPLAIN QUERY PLAN SELECT meta_key, meta_value FROM metadata WHERE app_idx = 1;", 3);
+    CATCH_CHECK(plan.find("COVERING INDEX metadata_by_app") != string::npos);
+    CATCH_CHECK(queryValue("SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name IN "
+                           "('installed_apps_by_app', 'apps_by_app_id', 'metadata_by_app');") == "3");
+
+    // reopening does not migrate again
+    SqlDataStorage storage{dbPath};
+    storage.Initialize();
+    CATCH_CHECK(queryValue("PRAGMA user_version;") == "9");
+    CATCH_CHECK(storage.IsAppInstalled(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION));
+}
+
+CATCH_TEST_CASE("LISA : reads are served from the catalog snapshot", "[all][test26][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+
+    // readers never wait for the install running in the background
+    std::vector<DataStorage::AppDetails> appsList;
+    CATCH_CHECK(lisa.GetAppDetailsList("", "", "", "", "", appsList) == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+
+    CATCH_REQUIRE(lisa.GetAppDetailsList("", DACAPP_ID, "", "", "", appsList) == 0);
+    CATCH_REQUIRE(appsList.size() == 1);
+    CATCH_CHECK(appsList[0].version == DACAPP_VERSION);
+    CATCH_CHECK(appsList[0].appName == "appname");
+    CATCH_REQUIRE(lisa.GetAppDetailsList("", "", "", "othername", "", appsList) == 0);
+    CATCH_CHECK(appsList.empty());
+
+    // a change made behind the executor's back is not visible until the next write
+    sqlite3* sqlite;
+    CATCH_REQUIRE(sqlite3_open((lisa_playground + db_subpath + "/0/apps.db").c_str(), &sqlite) == SQLITE_OK);
+    CATCH_REQUIRE(sqlite3_exec(sqlite, "INSERT INTO metadata(app_idx, meta_key, meta_value) "
+                                       "SELECT idx, 'external', 'value' FROM installed_apps;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    sqlite3_close(sqlite);
+
+    DataStorage::AppMetadata metadata;
+    CATCH_REQUIRE(lisa.GetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, metadata) == 0);
+    CATCH_CHECK(metadata.metadata.empty());
+
+    CATCH_REQUIRE(lisa.SetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "key1", "value1") == 0);
+    CATCH_REQUIRE(lisa.GetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, metadata) == 0);
+    CATCH_CHECK(metadata.metadata.size() == 2);
+    CATCH_CHECK(findInMetadata(metadata, "external", "value"));
+    CATCH_CHECK(findInMetadata(metadata, "key1", "value1"));
+    CATCH_CHECK(lisa.GetMetadata(DACAPP_MIME, DACAPP_ID, "9.9.9", metadata) == Executor::ERROR_GENERAL);
+
+    result = lisa.Uninstall(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_REQUIRE(lisa.GetAppDetailsList("", "", "", "", "", appsList) == 0);
+    CATCH_CHECK(appsList.empty());
+    CATCH_CHECK(lisa.GetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, metadata) == Executor::ERROR_GENERAL);
+}
+
+CATCH_TEST_CASE("LISA : metadata batch", "[all][test27][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+
+    CATCH_REQUIRE(lisa.SetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "key1", "old") == 0);
+
+    std::vector<std::pair<std::string, std::string> > batch;
+    for (int i = 1; i <= 100; ++i) {
+        batch.emplace_back("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    CATCH_REQUIRE(lisa.SetMetadataBatch(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, batch) == 0);
+
+    DataStorage::AppMetadata metadata;
+    CATCH_REQUIRE(lisa.GetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, metadata) == 0);
+    CATCH_CHECK(metadata.metadata.size() == 100);
+    CATCH_CHECK(findInMetadata(metadata, "key1", "value1"));
+    CATCH_CHECK(findInMetadata(metadata, "key100", "value100"));
+    CATCH_CHECK(countInDB("metadata") == 100);
+
+    CATCH_CHECK(lisa.SetMetadataBatch(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, {{"key1", "x"}, {"", "empty"}})
+                == Executor::ERROR_WRONG_PARAMS);
+    CATCH_CHECK(lisa.SetMetadataBatch(DACAPP_MIME, DACAPP_ID, "9.9.9", {{"key1", "x"}}) == Executor::ERROR_GENERAL);
+
+    CATCH_REQUIRE(lisa.GetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, metadata) == 0);
+    CATCH_CHECK(findInMetadata(metadata, "key1", "value1"));
+    CATCH_CHECK(countInDB("metadata") == 100);
+}
+
+CATCH_TEST_CASE("LISA : paginated app list", "[all][test28][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    SqlDataStorage storage{dbPath};
+    storage.Initialize();
+    for (auto id : {"app3", "app1", "app5", "app2", "app4"}) {
+        storage.AddInstalledApp(DACAPP_MIME, id, "1.0", "url", "name", "cat", string{id} + "/1.0", id, "");
+    }
+    storage.AddInstalledApp(DACAPP_MIME, "app2", "2.0", "url", "name", "cat", "app2/2.0", "app2", "");
+    // app data without installed versions is listed too
+    storage.RemoveInstalledApp(DACAPP_MIME, "app4", "1.0");
+
+    using SortKey = DataStorage::SortKey;
+    auto page = storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, false, "", 2);
+    CATCH_REQUIRE(page.apps.size() == 3);
+    CATCH_CHECK(page.apps[0].id == "app1");
+    CATCH_CHECK(page.apps[1].id == "app2");
+    CATCH_CHECK(page.apps[1].version == "1.0");
+    CATCH_CHECK(page.apps[2].version == "2.0");
+    CATCH_REQUIRE_FALSE(page.nextCursor.empty());
+
+    page = storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, false, page.nextCursor, 2);
+    CATCH_REQUIRE(page.apps.size() == 2);
+    CATCH_CHECK(page.apps[0].id == "app3");
+    CATCH_CHECK(page.apps[1].id == "app4");
+    CATCH_CHECK(page.apps[1].version.empty());
+    CATCH_REQUIRE_FALSE(page.nextCursor.empty());
+
+    auto cursor = page.nextCursor;
+    page = storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, false, cursor, 2);
+    CATCH_REQUIRE(page.apps.size() == 1);
+    CATCH_CHECK(page.apps[0].id == "app5");
+    CATCH_CHECK(page.nextCursor.empty());
+
+    // a cursor is only valid for the order it was issued for
+    CATCH_CHECK_THROWS_AS(storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, true, cursor, 2), InvalidCursorError);
+    CATCH_CHECK_THROWS_AS(storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, false, "xyz", 2), InvalidCursorError);
+
+    page = storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, true, "", 1);
+    CATCH_REQUIRE(page.apps.size() == 1);
+    CATCH_CHECK(page.apps[0].id == "app5");
+    page = storage.GetAppDetailsPage("", "", "", "", "", SortKey::ID, true, page.nextCursor, 1);
+    CATCH_REQUIRE(page.apps.size() == 1);
+    CATCH_CHECK(page.apps[0].id == "app4");
+
+    // filters on versions apply before the limit
+    page = storage.GetAppDetailsPage("", "", "2.0", "", "", SortKey::TYPE, false, "", 1);
+    CATCH_REQUIRE(page.apps.size() == 1);
+    CATCH_CHECK(page.apps[0].id == "app2");
+    CATCH_CHECK(page.nextCursor.empty());
+
+    page = storage.GetAppDetailsPage("", "", "", "", "", SortKey::CREATED, false, "", 0);
+    CATCH_CHECK(page.apps.size() == 6);
+    CATCH_CHECK(page.nextCursor.empty());
+}
+
+CATCH_TEST_CASE("LISA : search by name, category and metadata", "[all][test29][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    auto ids = [](const std::vector<DataStorage::AppDetails>& apps) {
+        std::set<std::string> result;
+        for (const auto& app : apps) {
+            result.insert(app.id + "/" + app.version);
+        }
+        return result;
+    };
+
+    {
+        SqlDataStorage storage{dbPath, 0, {"genre"}};
+        storage.Initialize();
+        storage.AddInstalledApp(DACAPP_MIME, "player", "1.0", "url", "Netflix Player", "video", "player/1.0", "player", "");
+        storage.AddInstalledApp(DACAPP_MIME, "player", "2.0", "url", "Netflix Player", "video", "player/2.0", "player", "");
+        storage.AddInstalledApp(DACAPP_MIME, "radio", "1.0", "url", "Radio", "audio", "radio/1.0", "radio", "");
+        storage.SetMetadataBatch(DACAPP_MIME, "radio", "1.0", {{"genre", "jazz music"}, {"vendor", "acme"}});
+
+        CATCH_CHECK(ids(storage.SearchApps("netf")) == std::set<std::string>{"player/1.0", "player/2.0"});
+        CATCH_CHECK(ids(storage.SearchApps("AUDIO")) == std::set<std::string>{"radio/1.0"});
+        CATCH_CHECK(ids(storage.SearchApps("jazz")) == std::set<std::string>{"radio/1.0"});
+        // only the configured metadata keys are searchable
+        CATCH_CHECK(storage.SearchApps("acme").empty());
+        // all words must match, quotes are not FTS syntax
+        CATCH_CHECK(ids(storage.SearchApps("netflix video")) == std::set<std::string>{"player/1.0", "player/2.0"});
+        CATCH_CHECK(storage.SearchApps("netflix audio").empty());
+        CATCH_CHECK(storage.SearchApps("\"net OR").empty());
+        CATCH_CHECK(storage.SearchApps("  ").empty());
+
+        storage.SetMetadata(DACAPP_MIME, "player", "2.0", "genre", "movies");
+        CATCH_CHECK(ids(storage.SearchApps("movies")) == std::set<std::string>{"player/2.0"});
+        storage.ClearMetadata(DACAPP_MIME, "player", "2.0", "genre");
+        CATCH_CHECK(storage.SearchApps("movies").empty());
+
+        CATCH_CHECK(ids(storage.GetAppDetailsListByMetadata("vendor", "acme")) == std::set<std::string>{"radio/1.0"});
+        CATCH_CHECK(storage.GetAppDetailsListByMetadata("vendor", "other").empty());
+
+        storage.RemoveInstalledApp(DACAPP_MIME, "player", "1.0");
+        CATCH_CHECK(ids(storage.SearchApps("netflix")) == std::set<std::string>{"player/2.0"});
+    }
+
+    // changed configuration rebuilds the index
+    SqlDataStorage storage{dbPath, 0, {"vendor"}};
+    storage.Initialize();
+    CATCH_CHECK(ids(storage.SearchApps("acme")) == std::set<std::string>{"radio/1.0"});
+    CATCH_CHECK(storage.SearchApps("jazz").empty());
+}
+
+CATCH_TEST_CASE("LISA : change log", "[all][test30][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    auto describe = [](const DataStorage::ChangeSet& changeSet) {
+        std::vector<std::string> result;
+        for (const auto& change : changeSet.changes) {
+            result.push_back(change.change + " " + change.id + "/" + change.version + "/" + change.key);
+        }
+        return result;
+    };
+
+    {
+        SqlDataStorage storage{dbPath};
+        storage.Initialize();
+        auto initial = storage.GetChanges(0);
+        CATCH_CHECK(initial.generation == 0);
+        CATCH_CHECK(initial.complete);
+        CATCH_CHECK(initial.changes.empty());
+
+        storage.AddInstalledApp(DACAPP_MIME, "app1", "1.0", "url", "name", "cat", "app1/1.0", "app1", "");
+        auto changes = storage.GetChanges(0);
+        CATCH_CHECK(changes.generation == 2);
+        CATCH_CHECK(describe(changes) == std::vector<std::string>{"added app1//", "added app1/1.0/"});
+
+        auto since = changes.generation;
+        storage.SetMetadata(DACAPP_MIME, "app1", "1.0", "key1", "a");
+        storage.SetMetadata(DACAPP_MIME, "app1", "1.0", "key1", "b");
+        storage.SetMetadata(DACAPP_MIME, "app1", "1.0", "key2", "c");
+        storage.SetAppVolume(DACAPP_MIME, "app1", "1.0", "usb");
+        changes = storage.GetChanges(since);
+        CATCH_CHECK(changes.complete);
+        // only the latest change of every key is reported
+        CATCH_CHECK(describe(changes) == std::vector<std::string>{"updated app1/1.0/key1", "updated app1/1.0/key2", "updated app1/1.0/"});
+        CATCH_CHECK(storage.GetChanges(changes.generation).changes.empty());
+
+        storage.AddInstalledApp(DACAPP_MIME, "app1", "2.0", "url", "name", "cat", "app1/2.0", "app1", "");
+        storage.RemoveInstalledApp(DACAPP_MIME, "app1", "1.0");
+        changes = storage.GetChanges(since);
+        CATCH_CHECK(describe(changes) == std::vector<std::string>{"added app1/2.0/", "removed app1/1.0/"});
+
+        // the database was recreated since the client synchronized
+        CATCH_CHECK_FALSE(storage.GetChanges(changes.generation + 1).complete);
+    }
+
+    SqlDataStorage storage{dbPath, 0, {}, 2};
+    storage.Initialize();
+    auto since = storage.GetChanges(0).generation;
+    storage.SetMetadata(DACAPP_MIME, "app1", "2.0", "key1", "a");
+    storage.SetMetadata(DACAPP_MIME, "app1", "2.0", "key2", "a");
+    storage.SetMetadata(DACAPP_MIME, "app1", "2.0", "key3", "a");
+    auto changes = storage.GetChanges(since);
+    CATCH_CHECK_FALSE(changes.complete);
+    CATCH_CHECK(changes.changes.empty());
+    changes = storage.GetChanges(since + 1);
+    CATCH_CHECK(changes.complete);
+    CATCH_CHECK(describe(changes) == std::vector<std::string>{"updated app1/2.0/key2", "updated app1/2.0/key3"});
+}
+
+// behaviour every DataStorage backend must share, 'open' returns a new instance on the same files
+static void checkStorageConformance(const std::function<std::unique_ptr<DataStorage>()>& open) {
+    const std::string otherType = "application/vnd.other";
+    auto rows = [](const std::vector<DataStorage::AppDetails>& apps) {
+        std::vector<std::string> result;
+        for (const auto& app : apps) {
+            result.push_back(app.id + "/" + app.version);
+        }
+        return result;
+    };
+    auto sortedRows = [&rows](const std::vector<DataStorage::AppDetails>& apps) {
+        auto result = rows(apps);
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    auto sorted = [](std::vector<std::string> values) {
+        std::sort(values.begin(), values.end());
+        return values;
+    };
+
+    auto storage = open();
+    CATCH_CHECK(storage->GetAppDetailsList().empty());
+    CATCH_CHECK_FALSE(storage->IsAppData("", ""));
+    CATCH_CHECK(storage->GetChanges(0).generation == 0);
+
+    storage->AddInstalledApp(DACAPP_MIME, "app1", "1.0", "url1", "First App", "games", "app1/1.0", "data/app1", "");
+    storage->AddInstalledApp(DACAPP_MIME, "app1", "2.0", "url2", "First App", "games", "app1/2.0", "data/app1", "");
+    storage->AddInstalledApp(otherType, "app2", "1.0", "url3", "Second", "tools", "app2/1.0", "data/app2", "");
+    CATCH_CHECK_THROWS_AS(storage->AddInstalledApp(DACAPP_MIME, "app1", "1.0", "url", "n", "c", "p", "d", ""), DataStorageError);
+    CATCH_CHECK_THROWS_AS(storage->AddInstalledApp(otherType, "app1", "3.0", "url", "n", "c", "p", "d", ""), DataStorageError);
+
+    CATCH_CHECK(storage->IsAppInstalled(DACAPP_MIME, "app1", "1.0"));
+    CATCH_CHECK(storage->IsAppInstalled("", "app1", "2.0"));
+    CATCH_CHECK_FALSE(storage->IsAppInstalled(otherType, "app1", "1.0"));
+    CATCH_CHECK_FALSE(storage->IsAppInstalled(DACAPP_MIME, "app1", "3.0"));
+    CATCH_CHECK(storage->IsAppData(DACAPP_MIME, "app1"));
+    CATCH_CHECK(storage->IsAppData(otherType, ""));
+    CATCH_CHECK_FALSE(storage->IsAppData(otherType, "app1"));
+    CATCH_CHECK(storage->GetTypeOfApp("app2") == otherType);
+    CATCH_CHECK_THROWS_AS(storage->GetTypeOfApp("unknown"), DataStorageError);
+
+    CATCH_CHECK(sorted(storage->GetAppsPaths()) == std::vector<std::string>{"app1/1.0", "app1/2.0", "app2/1.0"});
+    CATCH_CHECK(storage->GetAppsPaths(DACAPP_MIME, "app1", "2.0") == std::vector<std::string>{"app1/2.0"});
+    CATCH_CHECK(sorted(storage->GetDataPaths()) == std::vector<std::string>{"data/app1", "data/app2"});
+    CATCH_CHECK(storage->GetDataPaths(otherType, "") == std::vector<std::string>{"data/app2"});
+
+    CATCH_CHECK(sortedRows(storage->GetAppDetailsList()) == std::vector<std::string>{"app1/1.0", "app1/2.0", "app2/1.0"});
+    CATCH_CHECK(rows(storage->GetAppDetailsList("", "", "", "", "tools")) == std::vector<std::string>{"app2/1.0"});
+    CATCH_CHECK(rows(storage->GetAppDetailsList(DACAPP_MIME, "", "2.0")) == std::vector<std::string>{"app1/2.0"});
+
+    CATCH_CHECK(storage->GetAppVolume(DACAPP_MIME, "app1", "1.0").empty());
+    storage->SetAppVolume(DACAPP_MIME, "app1", "1.0", "usb");
+    CATCH_CHECK(storage->GetAppVolume("", "app1", "1.0") == "usb");
+    CATCH_CHECK_THROWS_AS(storage->SetAppVolume(DACAPP_MIME, "app1", "3.0", "usb"), DataStorageError);
+    CATCH_CHECK_THROWS_AS(storage->GetAppVolume(DACAPP_MIME, "app1", "3.0"), DataStorageError);
+
+    storage->SetMetadata(DACAPP_MIME, "app1", "1.0", "rating", "5");
+    storage->SetMetadataBatch(DACAPP_MIME, "app1", "1.0", {{"author", "someone"}, {"rating", "4"}});
+    storage->SetMetadata(otherType, "app2", "1.0", "rating", "4");
+    CATCH_CHECK_THROWS_AS(storage->SetMetadata(DACAPP_MIME, "app1", "3.0", "rating", "1"), DataStorageError);
+    CATCH_CHECK_THROWS_AS(storage->SetMetadataBatch(DACAPP_MIME, "app1", "3.0", {{"rating", "1"}}), DataStorageError);
+    auto metadata = storage->GetMetadata(DACAPP_MIME, "app1", "1.0");
+    CATCH_CHECK(metadata.appDetails.appName == "First App");
+    CATCH_CHECK(metadata.appDetails.url == "url1");
+    CATCH_CHECK(metadata.metadata == (std::vector<std::pair<std::string, std::string>>{{"author", "someone"}, {"rating", "4"}}));
+    CATCH_CHECK_THROWS_AS(storage->GetMetadata(DACAPP_MIME, "app1", "3.0"), DataStorageError);
+    CATCH_CHECK(rows(storage->GetAppDetailsListByMetadata("rating", "4")) == std::vector<std::string>{"app1/1.0", "app2/1.0"});
+    storage->ClearMetadata(DACAPP_MIME, "app1", "1.0", "author");
+    storage->ClearMetadata(DACAPP_MIME, "app1", "3.0", "");
+    CATCH_CHECK(storage->GetMetadata(DACAPP_MIME, "app1", "1.0").metadata.size() == 1);
+
+    CATCH_CHECK(sortedRows(storage->SearchApps("fir gam")) == std::vector<std::string>{"app1/1.0", "app1/2.0"});
+    CATCH_CHECK(rows(storage->SearchApps("SECOND")) == std::vector<std::string>{"app2/1.0"});
+    CATCH_CHECK(storage->SearchApps("first tools").empty());
+    CATCH_CHECK(storage->SearchApps("  ").empty());
+
+    std::vector<std::string> listed;
+    std::string cursor;
+    do {
+        auto page = storage->GetAppDetailsPage("", "", "", "", "", DataStorage::SortKey::ID, true, cursor, 1);
+        auto pageRows = rows(page.apps);
+        listed.insert(listed.end(), pageRows.begin(), pageRows.end());
+        cursor = page.nextCursor;
+    } while (!cursor.empty());
+    CATCH_CHECK(listed == std::vector<std::string>{"app2/1.0", "app1/1.0", "app1/2.0"});
+    CATCH_CHECK_THROWS_AS(storage->GetAppDetailsPage("", "", "", "", "", DataStorage::SortKey::TYPE, false,
+                                                     encodeCursor({"app_id:DESC", "app1", "app1"}), 1), InvalidCursorError);
+
+    CATCH_CHECK_THROWS_AS(storage->RemoveAppData(otherType, "app2"), DataStorageError);
+    CATCH_CHECK_THROWS_AS(storage->RemoveInstalledApp(otherType, "unknown", "1.0"), DataStorageError);
+    auto since = storage->GetChanges(0).generation;
+    storage->RemoveInstalledApp(otherType, "app2", "1.0");
+    CATCH_CHECK(rows(storage->GetAppDetailsListByMetadata("rating", "4")) == std::vector<std::string>{"app1/1.0"});
+    CATCH_CHECK(rows(storage->GetAppDetailsListOuterJoin(otherType)) == std::vector<std::string>{"app2/"});
+    CATCH_CHECK(storage->GetAppDetailsListOuterJoin(otherType, "", "1.0").empty());
+    storage->RemoveAppData(otherType, "app2");
+    CATCH_CHECK_FALSE(storage->IsAppData(otherType, "app2"));
+
+    auto changes = storage->GetChanges(since);
+    CATCH_CHECK(changes.complete);
+    CATCH_CHECK(changes.generation == since + 3);
+    CATCH_REQUIRE(changes.changes.size() == 1);
+    CATCH_CHECK(changes.changes[0].change == "removed");
+    CATCH_CHECK(changes.changes[0].id == "app2");
+    CATCH_CHECK(changes.changes[0].version.empty());
+
+    // a version others depend on stays until they are removed, dependencies are not logged as changes
+    storage->AddDependency(DACAPP_MIME, "app1", "2.0", DACAPP_MIME, "app1", "1.0");
+    storage->AddDependency(DACAPP_MIME, "app1", "2.0", DACAPP_MIME, "app1", "1.0");
+    CATCH_CHECK_THROWS_AS(storage->AddDependency(DACAPP_MIME, "app1", "2.0", DACAPP_MIME, "app1", "3.0"), DataStorageError);
+    CATCH_CHECK(storage->GetRefCount(DACAPP_MIME, "app1", "1.0") == 1);
+    CATCH_CHECK(storage->GetRefCount(DACAPP_MIME, "app1", "2.0") == 0);
+    CATCH_CHECK(rows(storage->GetDependencies(DACAPP_MIME, "app1", "2.0")) == std::vector<std::string>{"app1/1.0"});
+    CATCH_CHECK(storage->GetDependencies(DACAPP_MIME, "app1", "1.0").empty());
+    CATCH_CHECK_THROWS_AS(storage->RemoveInstalledApp(DACAPP_MIME, "app1", "1.0"), DataStorageError);
+
+    storage->SetAppLayers(DACAPP_MIME, "app1", "1.0", {"sha256:base", "sha256:app1"});
+    storage->SetAppLayers(DACAPP_MIME, "app1", "2.0", {"sha256:old"});
+    storage->SetAppLayers(DACAPP_MIME, "app1", "2.0", {"sha256:base", "sha256:app2"});
+    CATCH_CHECK_THROWS_AS(storage->SetAppLayers(DACAPP_MIME, "app1", "3.0", {"sha256:base"}), DataStorageError);
+    CATCH_CHECK(storage->GetAppLayers(DACAPP_MIME, "app1", "2.0") == (std::vector<std::string>{"sha256:base", "sha256:app2"}));
+    CATCH_CHECK(storage->GetLayerRefCount("sha256:base") == 2);
+    CATCH_CHECK(storage->GetLayerRefCount("sha256:app1") == 1);
+    CATCH_CHECK(storage->GetLayerRefCount("sha256:old") == 0);
+
+    // everything survives reopening
+    auto generation = changes.generation;
+    storage.reset();
+    storage = open();
+    CATCH_CHECK(sortedRows(storage->GetAppDetailsList()) == std::vector<std::string>{"app1/1.0", "app1/2.0"});
+    CATCH_CHECK(storage->GetAppVolume(DACAPP_MIME, "app1", "1.0") == "usb");
+    CATCH_CHECK(storage->GetMetadata(DACAPP_MIME, "app1", "1.0").metadata.size() == 1);
+    CATCH_CHECK(storage->GetChanges(since).generation == generation);
+    CATCH_CHECK(storage->GetChanges(since).changes.size() == 1);
+    CATCH_CHECK(storage->GetRefCount(DACAPP_MIME, "app1", "1.0") == 1);
+    CATCH_CHECK(rows(storage->GetDependencies(DACAPP_MIME, "app1", "2.0")) == std::vector<std::string>{"app1/1.0"});
+    CATCH_CHECK(storage->GetAppLayers(DACAPP_MIME, "app1", "1.0") == (std::vector<std::string>{"sha256:base", "sha256:app1"}));
+    CATCH_CHECK(storage->GetLayerRefCount("sha256:base") == 2);
+
+    // a registration is stored as a whole or not at all
+    auto installation = [](const std::string& id, const std::vector<std::string>& dependencies) {
+        DataStorage::Installation result;
+        result.app = DataStorage::AppDetails{DACAPP_MIME, id.c_str(), "1.0", id.c_str(), "cat", "url"};
+        result.appPath = id + "/1.0";
+        result.appStoragePath = id;
+        for (const auto& dependency : dependencies) {
+            result.dependencies.push_back(DataStorage::AppDetails{DACAPP_MIME, dependency.c_str(), "1.0", "", "", ""});
+        }
+        result.layers = {"sha256:" + id};
+        return result;
+    };
+    CATCH_CHECK_THROWS_AS(storage->AddInstalledApps({installation("runtime", {}), installation("app3", {"runtime", "missing"})}),
+                          DataStorageError);
+    CATCH_CHECK_THROWS_AS(storage->AddInstalledApps({installation("runtime", {}), installation("runtime", {})}), DataStorageError);
+    CATCH_CHECK_FALSE(storage->IsAppData(DACAPP_MIME, "runtime"));
+    CATCH_CHECK_FALSE(storage->IsAppInstalled(DACAPP_MIME, "app3", "1.0"));
+    CATCH_CHECK(storage->GetLayerRefCount("sha256:runtime") == 0);
+    storage->AddInstalledApps({installation("runtime", {}), installation("app3", {"runtime", "app1"})});
+    storage.reset();
+    storage = open();
+    CATCH_CHECK(storage->IsAppInstalled(DACAPP_MIME, "app3", "1.0"));
+    CATCH_CHECK(storage->GetRefCount(DACAPP_MIME, "runtime", "1.0") == 1);
+    CATCH_CHECK(rows(storage->GetDependencies(DACAPP_MIME, "app3", "1.0")) == (std::vector<std::string>{"app1/1.0", "runtime/1.0"}));
+    CATCH_CHECK(storage->GetAppLayers(DACAPP_MIME, "app3", "1.0") == std::vector<std::string>{"sha256:app3"});
+    CATCH_CHECK(storage->GetLayerRefCount("sha256:runtime") == 1);
+}
+
+CATCH_TEST_CASE("LISA : sqlite storage conformance", "[all][test31][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    checkStorageConformance([&dbPath]() {
+        std::unique_ptr<DataStorage> storage = std::make_unique<SqlDataStorage>(dbPath);
+        storage->Initialize();
+        return storage;
+    });
+}
+
+CATCH_TEST_CASE("LISA : kv storage conformance", "[all][test32][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+
+    checkStorageConformance([&dbPath]() {
+        std::unique_ptr<DataStorage> storage = std::make_unique<KvDataStorage>(dbPath);
+        storage->Initialize();
+        return storage;
+    });
+}
+
+CATCH_TEST_CASE("LISA : kv storage recovers from a damaged log", "[all][test33][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + db_subpath + "/0/";
+    boost::filesystem::create_directories(dbPath);
+    string logPath = dbPath + "apps.kv";
+
+    {
+        KvDataStorage storage{dbPath};
+        storage.Initialize();
+        storage.AddInstalledApp(DACAPP_MIME, "app1", "1.0", "url", "name", "cat", "app1/1.0", "app1", "");
+        storage.SetMetadata(DACAPP_MIME, "app1", "1.0", "key1", "a");
+    }
+    auto size = boost::filesystem::file_size(logPath);
+
+    // power loss in the middle of appending a record
+    {
+        std::ofstream log(logPath, std::ios::binary | std::ios::app);
+        log.write("\x40\x00\x00\x00\x12\x34", 6);
+    }
+    {
+        KvDataStorage storage{dbPath};
+        storage.Initialize();
+        CATCH_CHECK(storage.GetMetadata(DACAPP_MIME, "app1", "1.0").metadata.size() == 1);
+    }
+    CATCH_CHECK(boost::filesystem::file_size(logPath) == size);
+
+    // damaged last record, the metadata write is lost but the app is kept
+    {
+        std::fstream log(logPath, std::ios::binary | std::ios::in | std::ios::out);
+        log.seekp(size - 1);
+        log.put('\xff');
+    }
+    {
+        KvDataStorage storage{dbPath};
+        storage.Initialize();
+        CATCH_CHECK(storage.IsAppInstalled(DACAPP_MIME, "app1", "1.0"));
+        CATCH_CHECK(storage.GetMetadata(DACAPP_MIME, "app1", "1.0").metadata.empty());
+        storage.SetMetadata(DACAPP_MIME, "app1", "1.0", "key2", "b");
+    }
+    {
+        KvDataStorage storage{dbPath};
+        storage.Initialize();
+        auto metadata = storage.GetMetadata(DACAPP_MIME, "app1", "1.0").metadata;
+        CATCH_CHECK(metadata == (std::vector<std::pair<std::string, std::string>>{{"key2", "b"}}));
+    }
+
+    // superseded records are compacted away, state and change log are kept
+    std::uint64_t generation{};
+    {
+        KvDataStorage storage{dbPath};
+        storage.Initialize();
+        for (int i = 0; i < 1000; ++i) {
+            storage.SetMetadata(DACAPP_MIME, "app1", "1.0", "counter", std::to_string(i));
+        }
+        generation = storage.GetChanges(0).generation;
+    }
+    CATCH_CHECK(boost::filesystem::file_size(logPath) < 32 * 1024);
+    {
+        KvDataStorage storage{dbPath};
+        storage.Initialize();
+        auto metadata = storage.GetMetadata(DACAPP_MIME, "app1", "1.0").metadata;
+        CATCH_CHECK(metadata == (std::vector<std::pair<std::string, std::string>>{{"counter", "999"}, {"key2", "b"}}));
+        auto changes = storage.GetChanges(generation - 1);
+        CATCH_CHECK(changes.generation == generation);
+        CATCH_REQUIRE(changes.changes.size() == 1);
+        CATCH_CHECK(changes.changes[0].key == "counter");
+    }
+
+    // not a log at all
+    {
+        std::ofstream log(logPath, std::ios::binary | std::ios::trunc);
+        log << "SQLite format 3";
+    }
+    KvDataStorage storage{dbPath};
+    storage.Initialize();
+    CATCH_CHECK_FALSE(storage.IsAppData("", ""));
+    storage.AddInstalledApp(DACAPP_MIME, "app1", "1.0", "url", "name", "cat", "app1/1.0", "app1", "");
+    CATCH_CHECK(storage.IsAppInstalled(DACAPP_MIME, "app1", "1.0"));
+}
+
+CATCH_TEST_CASE("LISA : independent storages and concurrent readers", "[all][test34][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string firstPath = lisa_playground + "/db1/";
+    string secondPath = lisa_playground + "/db2/";
+    boost::filesystem::create_directories(firstPath);
+    boost::filesystem::create_directories(secondPath);
+
+    SqlDataStorage second{secondPath};
+    {
+        SqlDataStorage first{firstPath};
+        first.Initialize();
+        second.Initialize();
+        first.AddInstalledApp(DACAPP_MIME, "app1", "1.0", "url", "name", "cat", "app1/1.0", "app1", "");
+        CATCH_CHECK(first.IsAppInstalled(DACAPP_MIME, "app1", "1.0"));
+        CATCH_CHECK_FALSE(second.IsAppInstalled(DACAPP_MIME, "app1", "1.0"));
+    }
+    // closing the first storage leaves the second one working
+    second.AddInstalledApp(DACAPP_MIME, "app2", "1.0", "url", "name", "cat", "app2/1.0", "app2", "");
+    CATCH_CHECK(second.IsAppInstalled(DACAPP_MIME, "app2", "1.0"));
+
+    // a write transaction in progress neither blocks readers nor is seen by them
+    sqlite3* sqlite;
+    CATCH_REQUIRE(sqlite3_open((secondPath + "apps.db").c_str(), &sqlite) == SQLITE_OK);
+    CATCH_REQUIRE(sqlite3_exec(sqlite, "BEGIN IMMEDIATE; UPDATE installed_apps SET volume = 'usb';", nullptr, nullptr, nullptr) == SQLITE_OK);
+    CATCH_CHECK(second.GetAppVolume(DACAPP_MIME, "app2", "1.0").empty());
+    CATCH_CHECK(second.GetChanges(0).generation == 2);
+    sqlite3_exec(sqlite, "ROLLBACK;", nullptr, nullptr, nullptr);
+    sqlite3_close(sqlite);
+
+    for (unsigned int readConnections : {0u, 2u}) {
+        boost::filesystem::remove_all(firstPath);
+        boost::filesystem::create_directories(firstPath);
+        SqlDataStorage storage{firstPath, 0, {}, SqlDataStorage::DEFAULT_CHANGE_LOG_SIZE, readConnections};
+        storage.Initialize();
+
+        std::atomic_bool done{false};
+        std::atomic<int> failures{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&storage, &done, &failures]() {
+                size_t seen = 0;
+                while (!done) {
+                    try {
+                        auto apps = storage.GetAppDetailsList("", "", "", "", "");
+                        // installs are committed one by one, a reader never goes back
+                        if (apps.size() < seen) {
+                            ++failures;
+                        }
+                        seen = apps.size();
+                        storage.GetChanges(0);
+                    } catch (const DataStorageError&) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        for (int i = 0; i < 50; ++i) {
+            auto id = "app" + std::to_string(i);
+            storage.AddInstalledApp(DACAPP_MIME, id, "1.0", "url", "name", "cat", id + "/1.0", id, "");
+            storage.SetMetadata(DACAPP_MIME, id, "1.0", "key", "value");
+        }
+        done = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        CATCH_CHECK(failures == 0);
+        CATCH_CHECK(storage.GetAppDetailsList("", "", "", "", "").size() == 50);
+        CATCH_CHECK(storage.GetAppDetailsListByMetadata("key", "value").size() == 50);
+    }
+}
+
+CATCH_TEST_CASE("LISA : notification dispatcher", "[all][test35][quick]") {
+    using Event = Executor::OperationStatusEvent;
+    using Status = Executor::OperationStatus;
+    auto event = [](const std::string& handle, Status status, const std::string& details) {
+        return Event{handle, Executor::OperationType::INSTALLING, DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, status, details};
+    };
+
+    NotificationDispatcher dispatcher{4};
+    std::mutex mutex;
+    std::condition_variable released;
+    bool blocked{true};
+    std::vector<std::string> slowEvents, fastEvents;
+    int slowSubscriber, fastSubscriber;
+
+    dispatcher.subscribe(&slowSubscriber, [&](const Event& received) {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&blocked]() { return !blocked; });
+        slowEvents.push_back(received.handle + ":" + received.statusStr() + ":" + received.details);
+    });
+    dispatcher.subscribe(&fastSubscriber, [&](const Event& received) {
+        std::lock_guard<std::mutex> lock(mutex);
+        fastEvents.push_back(received.handle + ":" + received.statusStr() + ":" + received.details);
+    });
+
+    // the slow subscriber is stuck in its first delivery, posting never waits for it
+    auto start = std::chrono::steady_clock::now();
+    dispatcher.post(event("h1", Status::PROGRESS, "0"));
+    for (int i = 1; i <= 100; ++i) {
+        dispatcher.post(event("h1", Status::PROGRESS, std::to_string(i)));
+        dispatcher.post(event("h2", Status::PROGRESS, std::to_string(i)));
+    }
+    dispatcher.post(event("h2", Status::SUCCESS, ""));
+    for (int i = 0; i < 10; ++i) {
+        dispatcher.post(event("h" + std::to_string(i + 3), Status::FAILED, ""));
+    }
+    CATCH_CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+
+    // nor does the fast subscriber, it gets everything while the slow one is still stuck
+    bool fastDone{false};
+    for (int i = 0; i < 500 && !fastDone; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::lock_guard<std::mutex> lock(mutex);
+        fastDone = !fastEvents.empty() && fastEvents.back() == "h12:Failed:";
+    }
+    CATCH_CHECK(fastDone);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        CATCH_CHECK(slowEvents.empty());
+        blocked = false;
+    }
+    released.notify_all();
+    auto waitForQueues = [&]() {
+        for (int i = 0; i < 500; ++i) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (slowEvents.size() >= 13 && fastEvents.size() >= 13) {
+                    return;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+    waitForQueues();
+    CATCH_CHECK(dispatcher.skipped(&slowSubscriber) > 150);
+    // unsubscribing waits for a delivery in progress
+    dispatcher.unsubscribe(&slowSubscriber);
+    dispatcher.unsubscribe(&fastSubscriber);
+
+    for (const auto& events : {slowEvents, fastEvents}) {
+        // terminal events are all delivered, in order
+        std::vector<std::string> terminal;
+        for (const auto& received : events) {
+            if (received.find(":Progress:") == std::string::npos) {
+                terminal.push_back(received);
+            }
+        }
+        CATCH_REQUIRE(terminal.size() == 11);
+        CATCH_CHECK(terminal.front() == "h2:Success:");
+        CATCH_CHECK(terminal.back() == "h12:Failed:");
+        // progress never goes back, the latest h1 progress is delivered
+        CATCH_CHECK(std::find(events.begin(), events.end(), "h1:Progress:100") != events.end());
+    }
+    // stale progress events were coalesced for the slow subscriber
+    CATCH_CHECK(slowEvents.size() < 20);
+
+    auto delivered = slowEvents.size();
+    dispatcher.post(event("h1", Status::SUCCESS, ""));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::lock_guard<std::mutex> lock(mutex);
+    CATCH_CHECK(slowEvents.size() == delivered);
+}
+
+CATCH_TEST_CASE("LISA : operation status filters", "[all][test36][quick]") {
+    using WPEFramework::Plugin::OperationStatusFilter;
+    using WPEFramework::Plugin::OperationStatusFilters;
+    using namespace std::chrono;
+
+    OperationStatusFilter::Criteria criteria;
+    criteria.id = DACAPP_ID;
+    criteria.statuses = {"Progress", "Success"};
+    criteria.progressStep = 10;
+    criteria.progressIntervalMs = 100;
+    OperationStatusFilter filter{criteria};
+
+    auto start = OperationStatusFilter::Clock::now();
+    CATCH_CHECK_FALSE(filter.accept("h1", "other.app", "Success", "", start));
+    CATCH_CHECK_FALSE(filter.accept("h1", DACAPP_ID, "Failed", "", start));
+
+    // first progress of a handle passes, then both the step and the interval are needed
+    CATCH_CHECK(filter.accept("h1", DACAPP_ID, "Progress", "DOWNLOADING 0 %", start));
+    CATCH_CHECK_FALSE(filter.accept("h1", DACAPP_ID, "Progress", "DOWNLOADING 5 %", start + milliseconds(500)));
+    CATCH_CHECK_FALSE(filter.accept("h1", DACAPP_ID, "Progress", "DOWNLOADING 20 %", start + milliseconds(50)));
+    CATCH_CHECK(filter.accept("h1", DACAPP_ID, "Progress", "DOWNLOADING 20 %", start + milliseconds(150)));
+    CATCH_CHECK_FALSE(filter.accept("h1", DACAPP_ID, "Progress", "DOWNLOADING 25 %", start + milliseconds(300)));
+    // other handles are limited on their own
+    CATCH_CHECK(filter.accept("h2", DACAPP_ID, "Progress", "DOWNLOADING 25 %", start + milliseconds(150)));
+
+    // terminal events always pass and reset the rate limit of their handle
+    CATCH_CHECK(filter.accept("h1", DACAPP_ID, "Success", "", start + milliseconds(160)));
+    CATCH_CHECK(filter.accept("h1", DACAPP_ID, "Progress", "DOWNLOADING 0 %", start + milliseconds(170)));
+
+    OperationStatusFilters filters;
+    CATCH_CHECK(filters.empty());
+    filters.subscribe(1, "client1");
+    filters.subscribe(2, "client2");
+
+    // only the channel which registered a designator may filter it, anonymous ones never
+    OperationStatusFilter::Criteria handleOnly;
+    handleOnly.handle = "h1";
+    CATCH_CHECK_FALSE(filters.set(2, "client1", handleOnly));
+    CATCH_CHECK_FALSE(filters.set(1, "", handleOnly));
+    CATCH_CHECK_FALSE(filters.set(1, "client3", handleOnly));
+    CATCH_CHECK(filters.empty());
+    CATCH_CHECK(filters.set(1, "client1", handleOnly));
+    CATCH_CHECK_FALSE(filters.empty());
+
+    auto decision = filters.decide("h2", DACAPP_ID, "Success", "");
+    CATCH_CHECK(decision.any);
+    CATCH_CHECK_FALSE(decision.accepted("client1"));
+    CATCH_CHECK(decision.accepted("client2"));
+
+    // once every subscriber filters, nobody may want the event
+    OperationStatusFilter::Criteria successOnly;
+    successOnly.statuses = {"Success"};
+    CATCH_CHECK(filters.set(2, "client2", successOnly));
+    decision = filters.decide("h2", DACAPP_ID, "Progress", "DOWNLOADING 1 %");
+    CATCH_CHECK_FALSE(decision.any);
+    decision = filters.decide("h1", DACAPP_ID, "Progress", "DOWNLOADING 1 %");
+    CATCH_CHECK(decision.any);
+    CATCH_CHECK(decision.accepted("client1"));
+    CATCH_CHECK_FALSE(decision.accepted("client2"));
+
+    // an anonymous subscriber gets everything
+    filters.subscribe(3, "");
+    CATCH_CHECK(filters.decide("h2", DACAPP_ID, "Progress", "DOWNLOADING 2 %").any);
+    filters.close(3);
+    CATCH_CHECK_FALSE(filters.decide("h2", DACAPP_ID, "Progress", "DOWNLOADING 3 %").any);
+
+    // filters go with their subscription, be it unregistered or its channel closed
+    CATCH_CHECK_FALSE(filters.clear(2, "client1"));
+    filters.unsubscribe(1, "client1");
+    CATCH_CHECK_FALSE(filters.set(1, "client1", handleOnly));
+    filters.close(2);
+    CATCH_CHECK(filters.empty());
+    CATCH_CHECK(filters.decide("h2", DACAPP_ID, "Progress", "DOWNLOADING 4 %").accepted("client2"));
+}
+
+CATCH_TEST_CASE("LISA : batch install, metadata and uninstall", "[all][test37][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    auto finishedEvents = [](size_t count, int timeout_secs) {
+        std::vector<Executor::OperationStatusEvent> finished;
+        for (int i = 0; i < timeout_secs * 10 && finished.size() < count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished.clear();
+            for (const auto& event : all_events_received_) {
+                if (event.status != Executor::OperationStatus::PROGRESS) {
+                    finished.push_back(event);
+                }
+            }
+        }
+        return finished;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        all_events_received_.clear();
+        record_all_events_ = true;
+    }
+
+    std::vector<Executor::BatchItem> items{
+        {DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "app1", "cat", ""},
+        {DACAPP_MIME, "com.rdk.waylandegltest2", DACAPP_VERSION, demo_tarball, "app2", "cat", ""},
+        {DACAPP_MIME, "com.rdk.waylandegltest3", "", demo_tarball, "app3", "cat", ""},
+        {DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "app1 again", "cat", ""},
+        {DACAPP_MIME, "com.rdk.waylandegltest4", DACAPP_VERSION, demo_tarball, "app4", "cat", ""}};
+    std::vector<Executor::BatchResult> results;
+    CATCH_REQUIRE(lisa.InstallBatch(items, results) == 0);
+    CATCH_REQUIRE(results.size() == items.size());
+    CATCH_CHECK(results[0].code == 0);
+    CATCH_CHECK(results[1].code == 0);
+    CATCH_CHECK(results[2].code == Executor::ERROR_WRONG_PARAMS);
+    CATCH_CHECK(results[3].code == Executor::ERROR_TOO_MANY_REQUESTS);
+    CATCH_CHECK(results[4].code == 0);
+    CATCH_CHECK(results[0].handle != results[1].handle);
+
+    // queued behind the batch, single calls are refused and queued items may be cancelled
+    string handle;
+    CATCH_CHECK(lisa.Install(DACAPP_MIME, "com.rdk.other", DACAPP_VERSION, demo_tarball, "other", "cat", handle)
+                == Executor::ERROR_TOO_MANY_REQUESTS);
+    uint32_t progress = 100;
+    CATCH_CHECK(lisa.GetProgress(results[4].handle, progress) == 0);
+    CATCH_CHECK(progress == 0);
+    CATCH_CHECK(lisa.Cancel(results[4].handle) == 0);
+
+    auto finished = finishedEvents(3, 60);
+    CATCH_REQUIRE(finished.size() == 3);
+    std::map<std::string, Executor::OperationStatus> statuses;
+    for (const auto& event : finished) {
+        statuses[event.handle] = event.status;
+    }
+    CATCH_CHECK(statuses[results[0].handle] == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(statuses[results[1].handle] == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(statuses[results[4].handle] == Executor::OperationStatus::CANCELLED);
+    CATCH_CHECK(countInstalledAppsInDB() == 2);
+    {
+        // the outcome of the first install is out before anything of the second one
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto firstDone = std::find_if(all_events_received_.begin(), all_events_received_.end(), [&](const Executor::OperationStatusEvent& event) {
+            return event.handle == results[0].handle && event.status != Executor::OperationStatus::PROGRESS;
+        });
+        auto secondStarted = std::find_if(all_events_received_.begin(), all_events_received_.end(), [&](const Executor::OperationStatusEvent& event) {
+            return event.handle == results[1].handle;
+        });
+        CATCH_CHECK(firstDone < secondStarted);
+    }
+
+    CATCH_REQUIRE(lisa.SetMetadata(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "key1", "value1") == 0);
+    items = {{DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "", "", "", ""},
+             {DACAPP_MIME, "com.rdk.waylandegltest2", DACAPP_VERSION, "", "", "", ""},
+             {DACAPP_MIME, "com.rdk.waylandegltest4", DACAPP_VERSION, "", "", "", ""}};
+    CATCH_REQUIRE(lisa.GetMetadataBatch(items, results) == 0);
+    CATCH_REQUIRE(results.size() == 3);
+    CATCH_CHECK(results[0].code == 0);
+    CATCH_CHECK(results[0].metadata.appDetails.appName == "app1");
+    CATCH_CHECK(findInMetadata(results[0].metadata, "key1", "value1"));
+    CATCH_CHECK(results[1].code == 0);
+    CATCH_CHECK(results[1].metadata.appDetails.appName == "app2");
+    CATCH_CHECK(results[2].code != 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        all_events_received_.clear();
+    }
+    for (auto& item : items) {
+        item.uninstallType = "full";
+    }
+    CATCH_REQUIRE(lisa.UninstallBatch(items, results) == 0);
+    CATCH_REQUIRE(results.size() == 3);
+    CATCH_CHECK(results[0].code == 0);
+    CATCH_CHECK(results[1].code == 0);
+    CATCH_CHECK(results[2].code == Executor::ERROR_WRONG_PARAMS);
+
+    finished = finishedEvents(2, 30);
+    CATCH_REQUIRE(finished.size() == 2);
+    CATCH_CHECK(finished[0].operation == Executor::OperationType::UNINSTALLING);
+    CATCH_CHECK(finished[0].status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(finished[1].status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        record_all_events_ = false;
+    }
+}
+
+CATCH_TEST_CASE("LISA : packed list, metadata and batch payloads", "[all][test38][quick]") {
+    namespace pt = boost::property_tree;
+    auto parse = [](const std::string& json) {
+        pt::ptree tree;
+        std::istringstream stream(json);
+        pt::read_json(stream, tree);
+        return tree;
+    };
+
+    std::vector<DataStorage::AppDetails> apps{
+        {"type1", "app1", "1.0", "App \"one\"", "cat", "http://x/1"},
+        {"type2", "app2", "", "", "", ""},
+        {"type1", "app1", "2.0", "tab\there", "cat", "http://x/2"},
+        {"type1", "app3", "1.0", "three\\", "cat", "http://x/3"}};
+    auto packed = packAppsList(apps);
+    auto list = parse(packed);
+    std::vector<std::string> ids;
+    for (const auto& app : list.get_child("apps")) {
+        ids.push_back(app.second.get<std::string>("id"));
+    }
+    CATCH_CHECK(ids == std::vector<std::string>{"app1", "app2", "app3"});
+
+    auto first = list.get_child("apps").begin()->second;
+    CATCH_CHECK(first.get<std::string>("type") == "type1");
+    CATCH_REQUIRE(first.get_child("installed").size() == 2);
+    CATCH_CHECK(first.get_child("installed").begin()->second.get<std::string>("appName") == "App \"one\"");
+    CATCH_CHECK(std::next(first.get_child("installed").begin())->second.get<std::string>("appName") == "tab\there");
+    CATCH_CHECK(std::next(list.get_child("apps").begin())->second.get_child("installed").empty());
+    CATCH_CHECK(packAppsList({}) == "{\"apps\":[]}");
+
+    DataStorage::AppMetadata metadata;
+    metadata.appDetails = DataStorage::AppDetails{"type1", "app1", "1.0", "name", "cat", "http://x/1"};
+    metadata.metadata = {{"key1", "value1"}, {"key\n2", std::string("a\x01b")}};
+    auto tree = parse(packMetadata(metadata));
+    CATCH_CHECK(tree.get<std::string>("appName") == "name");
+    CATCH_CHECK(tree.get<std::string>("category") == "cat");
+    CATCH_CHECK(tree.get<std::string>("url") == "http://x/1");
+    CATCH_CHECK(tree.get_child("resources").empty());
+    CATCH_REQUIRE(tree.get_child("auxMetadata").size() == 2);
+    auto second = std::next(tree.get_child("auxMetadata").begin())->second;
+    CATCH_CHECK(second.get<std::string>("key") == "key\n2");
+    CATCH_CHECK(second.get<std::string>("value") == std::string("a\x01b"));
+
+    // batch params and results cross as one document each
+    std::vector<Executor::BatchItem> items;
+    CATCH_REQUIRE(unpackBatchItems("{\"apps\":[{\"type\":\"type1\",\"id\":\"app1\",\"version\":\"1.0\",\"url\":\"http://x/1\","
+                                   "\"appName\":\"one\",\"category\":\"cat\",\"priority\":\"background\"},"
+                                   "{\"type\":\"type1\",\"id\":\"app3\",\"uninstallType\":\"full\"}]}", items));
+    CATCH_REQUIRE(items.size() == 2);
+    CATCH_CHECK(items[0].url == "http://x/1");
+    CATCH_CHECK(items[0].priority == Executor::Priority::BACKGROUND);
+    CATCH_CHECK(items[1].version.empty());
+    CATCH_CHECK(items[1].uninstallType == "full");
+    CATCH_CHECK(items[1].priority == Executor::Priority::FOREGROUND);
+    std::vector<Executor::BatchItem> rejected;
+    CATCH_CHECK_FALSE(unpackBatchItems("{\"apps\":[{\"id\":\"app1\",\"priority\":\"urgent\"}]}", rejected));
+    CATCH_CHECK_FALSE(unpackBatchItems("{\"apps\":[", rejected));
+    CATCH_CHECK(unpackBatchItems("{}", rejected));
+    CATCH_CHECK(rejected.empty());
+
+    std::vector<Executor::BatchResult> results(2);
+    results[0].handle = "1234";
+    results[0].metadata = metadata;
+    results[1].code = Executor::ERROR_WRONG_PARAMS;
+    auto batch = parse(packBatchResults(items, results, true));
+    CATCH_REQUIRE(batch.get_child("results").size() == 2);
+    auto firstResult = batch.get_child("results").begin()->second;
+    CATCH_CHECK(firstResult.get<std::string>("id") == "app1");
+    CATCH_CHECK(firstResult.get<unsigned>("code") == 0);
+    CATCH_CHECK(firstResult.get<std::string>("handle") == "1234");
+    CATCH_CHECK(firstResult.get_child("metadata.auxMetadata").size() == 2);
+    auto secondResult = std::next(batch.get_child("results").begin())->second;
+    CATCH_CHECK(secondResult.get<unsigned>("code") == Executor::ERROR_WRONG_PARAMS);
+    CATCH_CHECK(secondResult.count("handle") == 0);
+    CATCH_CHECK(secondResult.count("metadata") == 0);
+    CATCH_CHECK(parse(packBatchResults(items, results, false)).get_child("results").begin()->second.count("metadata") == 0);
+}
+
+CATCH_TEST_CASE("LISA : job history", "[all][test39][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+
+    JobInfo job;
+    CATCH_REQUIRE(lisa.GetJob(handle, job) == 0);
+    CATCH_CHECK(job.operation == "Installing");
+    CATCH_CHECK_FALSE(job.finished());
+
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+
+    // the outcome is still known after the event
+    CATCH_REQUIRE(lisa.GetJob(handle, job) == 0);
+    CATCH_CHECK(job.state == JobState::SUCCEEDED);
+    CATCH_CHECK(job.id == DACAPP_ID);
+    CATCH_CHECK(job.progress == 100);
+    CATCH_CHECK(job.bytesDownloaded > 0);
+    CATCH_CHECK(job.queuedAt > 0);
+    CATCH_CHECK(job.startedAt >= job.queuedAt);
+    CATCH_CHECK(job.finishedAt >= job.startedAt);
+    std::vector<std::string> stages;
+    for (const auto& stage : job.stages) {
+        stages.push_back(stage.first);
+    }
+    CATCH_CHECK(stages == std::vector<std::string>{"DOWNLOADING", "UNTARING", "UPDATING_DATABASE", "FINISHED"});
+
+    result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_CHECK(result == Executor::ERROR_ALREADY_INSTALLED);
+    result = lisa.Uninstall(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+
+    std::vector<JobInfo> jobList;
+    CATCH_REQUIRE(lisa.ListJobs(jobList) == 0);
+    CATCH_REQUIRE(jobList.size() == 2);
+    CATCH_CHECK(jobList[0].operation == "Installing");
+    CATCH_CHECK(jobList[1].operation == "Uninstalling");
+    CATCH_CHECK(jobList[1].handle == handle);
+    CATCH_CHECK(jobList[1].state == JobState::SUCCEEDED);
+    CATCH_CHECK(lisa.GetJob("unknown", job) == Executor::ERROR_WRONG_HANDLE);
+
+    // only the most recent finished jobs are kept, active ones always
+    JobHistory history{2};
+    history.queue("queued", "Installing", "t", "a", "1");
+    for (int i = 0; i < 4; ++i) {
+        auto name = "job" + std::to_string(i);
+        history.start(name, "Installing", "t", name, "1", "DOWNLOADING");
+        history.enterStage(name, "UNTARING");
+        history.finish(name, i % 2 ? JobState::FAILED : JobState::SUCCEEDED, i % 2 ? "broken" : "");
+    }
+    history.start("running", "Moving", "t", "b", "1", "COPYING");
+    auto all = history.list();
+    CATCH_REQUIRE(all.size() == 4);
+    CATCH_CHECK(all[0].handle == "queued");
+    CATCH_CHECK(all[0].state == JobState::QUEUED);
+    CATCH_CHECK(all[1].handle == "job2");
+    CATCH_CHECK(all[2].handle == "job3");
+    CATCH_CHECK(all[2].error == "broken");
+    CATCH_CHECK(all[2].stages.size() == 2);
+    CATCH_CHECK(all[3].state == JobState::RUNNING);
+
+    namespace pt = boost::property_tree;
+    pt::ptree tree;
+    std::istringstream stream(packJobs(all));
+    pt::read_json(stream, tree);
+    CATCH_REQUIRE(tree.get_child("jobs").size() == 4);
+    auto failed = std::next(tree.get_child("jobs").begin(), 2)->second;
+    CATCH_CHECK(failed.get<std::string>("state") == "Failed");
+    CATCH_CHECK(failed.get<std::string>("error") == "broken");
+    CATCH_CHECK(failed.get_child("stages").begin()->second.get<std::string>("stage") == "DOWNLOADING");
+}
+
+CATCH_TEST_CASE("LISA : pause and resume installation", "[all][test40][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(lisa.Pause(handle) == 0);
+    // pausing twice is harmless
+    CATCH_CHECK(lisa.Pause(handle) == 0);
+    CATCH_CHECK(lisa.Pause("unknown") == Executor::ERROR_WRONG_PARAMS);
+
+    // nothing finishes while paused
+    CATCH_CHECK_FALSE(waitForEvent(2));
+    JobInfo job;
+    CATCH_REQUIRE(lisa.GetJob(handle, job) == 0);
+    CATCH_CHECK(job.state == JobState::PAUSED);
+    CATCH_CHECK_FALSE(job.finished());
+    CATCH_CHECK(countInstalledAppsInDB() == 0);
+
+    CATCH_REQUIRE(lisa.Resume(handle) == 0);
+    CATCH_CHECK(lisa.Resume(handle) == Executor::ERROR_WRONG_PARAMS);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 1);
+
+    CATCH_REQUIRE(lisa.GetJob(handle, job) == 0);
+    CATCH_CHECK(job.state == JobState::SUCCEEDED);
+    CATCH_CHECK(std::find_if(job.stages.begin(), job.stages.end(), [](const std::pair<std::string, std::uint64_t>& stage) {
+        return stage.first == "PAUSED" && stage.second >= 2000;
+    }) != job.stages.end());
+    CATCH_CHECK(job.stages.back().first == "FINISHED");
+
+    // a paused install can still be cancelled
+    result = lisa.Uninstall(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(lisa.Pause(handle) == 0);
+    CATCH_REQUIRE(lisa.Cancel(handle) == 0);
+    CATCH_REQUIRE(waitForEventIncludingAlreadyArrivedOne(30));
+    CATCH_CHECK(last_event_received_.status == Executor::OperationStatus::CANCELLED);
+    CATCH_CHECK(countInstalledAppsInDB() == 0);
+
+    JobHistory history;
+    history.start("job", "Installing", "t", "a", "1", "DOWNLOADING");
+    history.pause("job");
+    history.resume("job");
+    history.enterStage("job", "UNTARING");
+    CATCH_REQUIRE(history.find("job", job));
+    std::vector<std::string> stages;
+    for (const auto& stage : job.stages) {
+        stages.push_back(stage.first);
+    }
+    CATCH_CHECK(stages == std::vector<std::string>{"DOWNLOADING", "PAUSED", "DOWNLOADING", "UNTARING"});
+}
+
+CATCH_TEST_CASE("LISA : install priorities and preemption", "[all][test41][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    Executor::Priority priority;
+    CATCH_CHECK(Executor::priorityFromStr("user", priority));
+    CATCH_CHECK(priority == Executor::Priority::USER_INITIATED);
+    CATCH_CHECK(Executor::priorityFromStr("", priority));
+    CATCH_CHECK(priority == Executor::Priority::FOREGROUND);
+    CATCH_CHECK(Executor::priorityFromStr("maintenance", priority));
+    CATCH_CHECK(priority == Executor::Priority::MAINTENANCE);
+    CATCH_CHECK_FALSE(Executor::priorityFromStr("urgent", priority));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        all_events_received_.clear();
+        record_all_events_ = true;
+    }
+
+    // held in its download so the urgent install finds it running
+    string background;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "app1", "cat", background,
+                               Executor::Priority::BACKGROUND);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(lisa.Pause(background) == 0);
+
+    string handle;
+    result = lisa.Install(DACAPP_MIME, "com.rdk.waylandegltest3", DACAPP_VERSION, demo_tarball, "app3", "cat", handle,
+                          Executor::Priority::MAINTENANCE);
+    CATCH_CHECK(result == Executor::ERROR_TOO_MANY_REQUESTS);
+    result = lisa.Install(DACAPP_MIME, "com.rdk.waylandegltest3", DACAPP_VERSION, demo_tarball, "app3", "cat", handle,
+                          Executor::Priority::BACKGROUND);
+    CATCH_CHECK(result == Executor::ERROR_TOO_MANY_REQUESTS);
+    // the same app is never scheduled twice, whatever its priority
+    result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "app1", "cat", handle,
+                          Executor::Priority::USER_INITIATED);
+    CATCH_CHECK(result == Executor::ERROR_TOO_MANY_REQUESTS);
+
+    string urgent;
+    result = lisa.Install(DACAPP_MIME, "com.rdk.waylandegltest2", DACAPP_VERSION, demo_tarball, "app2", "cat", urgent,
+                          Executor::Priority::USER_INITIATED);
+    CATCH_REQUIRE(result == 0);
+
+    std::vector<Executor::OperationStatusEvent> finished;
+    auto waitForFinished = [&finished](size_t count, int timeout_secs) {
+        for (int i = 0; i < timeout_secs * 10; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished.clear();
+            for (const auto& event : all_events_received_) {
+                if (event.status != Executor::OperationStatus::PROGRESS) {
+                    finished.push_back(event);
+                }
+            }
+            if (finished.size() >= count) {
+                return;
+            }
+        }
+    };
+    waitForFinished(1, 30);
+    CATCH_REQUIRE(finished.size() == 1);
+    CATCH_CHECK(finished[0].handle == urgent);
+
+    // the preempted install starts again as it was left, paused, until it is resumed
+    waitForFinished(2, 2);
+    CATCH_CHECK(finished.size() == 1);
+    JobInfo job;
+    CATCH_REQUIRE(lisa.GetJob(background, job) == 0);
+    CATCH_CHECK(job.state == JobState::PAUSED);
+    CATCH_REQUIRE(lisa.Resume(background) == 0);
+    waitForFinished(2, 30);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        record_all_events_ = false;
+    }
+
+    // the preempted install is not reported until it ran again after the urgent one
+    CATCH_REQUIRE(finished.size() == 2);
+    CATCH_CHECK(finished[0].handle == urgent);
+    CATCH_CHECK(finished[0].status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(finished[1].handle == background);
+    CATCH_CHECK(finished[1].status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 2);
+
+    CATCH_REQUIRE(lisa.GetJob(background, job) == 0);
+    CATCH_CHECK(job.state == JobState::SUCCEEDED);
+    std::vector<std::string> stages;
+    for (const auto& stage : job.stages) {
+        stages.push_back(stage.first);
+    }
+    CATCH_CHECK(std::find(stages.begin(), stages.end(), "PREEMPTED") != stages.end());
+    CATCH_CHECK(stages.back() == "FINISHED");
+}
+
+// packs a tarball served by the test http server, its annotations declare the given dependencies
+static string makePackage(const string& name, const vector<string>& dependencies) {
+    string root = lisa_playground + "/packages/" + name;
+    boost::filesystem::create_directories(root + "/rootfs/usr/bin");
+    ofstream(root + "/rootfs/usr/bin/" + name) << name;
+    string declared;
+    for (const auto& id : dependencies) {
+        declared += string(declared.empty() ? "" : ",") + "{\"type\":\"" + DACAPP_MIME + "\",\"id\":\"" + id
+                    + "\",\"version\":\"1.0\",\"url\":\"http://127.0.0.1:8899/" + id + ".tar.gz\"}";
+    }
+    ofstream(root + "/annotations.json") << "{\"annotations\":{},\"dependencies\":[" + declared + "]}";
+    string command = "tar czf files/" + name + ".tar.gz -C " + root + " .";
+    CATCH_REQUIRE(std::system(command.c_str()) == 0);
+    return "http://127.0.0.1:8899/" + name + ".tar.gz";
+}
+
+CATCH_TEST_CASE("LISA : dependency graph", "[all][test42][quick]") {
+    auto package = [](const string& id) {
+        return Package{DACAPP_MIME, id, "1.0", "url"};
+    };
+    auto ids = [](const vector<Package>& packages) {
+        vector<string> result;
+        for (const auto& p : packages) {
+            result.push_back(p.id);
+        }
+        return result;
+    };
+
+    DependencyGraph graph;
+    CATCH_CHECK(graph.add(package("app")));
+    CATCH_CHECK(graph.add(package("codecs")));
+    CATCH_CHECK(graph.add(package("runtime")));
+    CATCH_CHECK_FALSE(graph.add(package("runtime")));
+    graph.setDependencies(package("app"), {package("codecs"), package("runtime")});
+    // not part of the graph, taken as installed
+    graph.setDependencies(package("codecs"), {package("runtime"), package("installed")});
+    CATCH_CHECK(ids(graph.order()) == (vector<string>{"runtime", "codecs", "app"}));
+
+    graph.setDependencies(package("runtime"), {package("app")});
+    CATCH_CHECK_THROWS_AS(graph.order(), DependencyError);
+
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground);
+    string annotations = lisa_playground + "/annotations.json";
+    CATCH_CHECK(readDependencies(annotations).empty());
+    ofstream(annotations) << "{\"dependencies\":[{\"type\":\"t\",\"id\":\"runtime\",\"version\":\"1.0\",\"url\":\"u\"}]}";
+    CATCH_CHECK(ids(readDependencies(annotations)) == vector<string>{"runtime"});
+    ofstream(annotations) << "{\"dependencies\":[{\"id\":\"runtime\"}]}";
+    CATCH_CHECK_THROWS_AS(readDependencies(annotations), DependencyError);
+}
+
+CATCH_TEST_CASE("LISA : install with shared dependencies", "[all][test43][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa, "annotations.json");
+
+    // app depends on codecs and runtime, codecs on runtime too
+    makePackage("com.rdk.runtime", {});
+    makePackage("com.rdk.codecs", {"com.rdk.runtime"});
+    auto appUrl = makePackage("com.rdk.app1", {"com.rdk.codecs", "com.rdk.runtime"});
+    auto secondAppUrl = makePackage("com.rdk.app2", {"com.rdk.runtime"});
+    auto brokenUrl = makePackage("com.rdk.broken", {"com.rdk.missing"});
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, "com.rdk.app1", "1.0", appUrl, "app1", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 3);
+    CATCH_CHECK(findPathInAppsPath("0/com.rdk.runtime/1.0/rootfs/usr/bin/com.rdk.runtime"));
+    CATCH_CHECK(findPathInAppsPath("0/com.rdk.codecs/1.0/rootfs/usr/bin/com.rdk.codecs"));
+    std::vector<DataStorage::AppDetails> apps;
+    CATCH_REQUIRE(lisa.GetAppDetailsList(DACAPP_MIME, "com.rdk.runtime", "", "", "", apps) == 0);
+    CATCH_REQUIRE(apps.size() == 1);
+    CATCH_CHECK(apps[0].category == "dependency");
+
+    // a runtime in use cannot be uninstalled
+    result = lisa.Uninstall(DACAPP_MIME, "com.rdk.runtime", "1.0", "full", handle);
+    CATCH_CHECK(result == Executor::ERROR_APP_LOCKED);
+    CATCH_CHECK(handle == "AppInUse");
+
+    // the installed runtime is shared, not fetched again
+    result = lisa.Install(DACAPP_MIME, "com.rdk.app2", "1.0", secondAppUrl, "app2", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 4);
+
+    // a dependency which cannot be fetched fails the whole install
+    result = lisa.Install(DACAPP_MIME, "com.rdk.broken", "1.0", brokenUrl, "broken", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_CHECK(last_event_received_.status == Executor::OperationStatus::FAILED);
+    CATCH_CHECK(countInstalledAppsInDB() == 4);
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.broken"));
+
+    // codecs go with the first app, the runtime stays for the second one
+    result = lisa.Uninstall(DACAPP_MIME, "com.rdk.app1", "1.0", "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 2);
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.codecs"));
+    CATCH_CHECK(findPathInAppsPath("0/com.rdk.runtime"));
+
+    result = lisa.Uninstall(DACAPP_MIME, "com.rdk.app2", "1.0", "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 0);
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.runtime"));
+}
+
+CATCH_TEST_CASE("LISA : image manifests and layers", "[all][test44][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground);
+    auto write = [](const string& path, const string& content) {
+        boost::filesystem::create_directories(boost::filesystem::path(path).parent_path());
+        ofstream(path) << content;
+    };
+
+    write(lisa_playground + "/abc", "abc");
+    CATCH_CHECK(Image::sha256Digest(lisa_playground + "/abc") == "sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    write(lisa_playground + "/long", string(1000, 'a'));
+    CATCH_CHECK(Image::sha256Digest(lisa_playground + "/long") == "sha256:41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3");
+
+    const string digest = "sha256:" + string(64, 'a');
+    CATCH_CHECK(Image::blobUrl("http://registry/v2/apps/app1/manifests/1.0", digest) == "http://registry/v2/apps/app1/blobs/" + digest);
+    CATCH_CHECK(Image::blobUrl("http://host/layout/app1.json", digest) == "http://host/layout/blobs/sha256/" + string(64, 'a'));
+
+    string manifest = lisa_playground + "/manifest.json";
+    write(manifest, "{\"schemaVersion\":2,\"mediaType\":\"application/vnd.oci.image.manifest.v1+json\",\"layers\":["
+                    "{\"mediaType\":\"application/vnd.oci.image.layer.v1.tar+gzip\",\"digest\":\"" + digest + "\",\"size\":10},"
+                    "{\"mediaType\":\"application/vnd.oci.image.layer.v1.tar\",\"digest\":\"" + digest + "\",\"size\":5}]}");
+    CATCH_REQUIRE(Image::isManifest(manifest));
+    CATCH_CHECK(Image::readManifest(manifest).layers.size() == 2);
+    CATCH_CHECK(Image::readManifest(manifest).size() == 15);
+    CATCH_CHECK_FALSE(Image::isManifest("files/waylandegltest.tar.gz"));
+    write(manifest, "{\"schemaVersion\":2,\"layers\":[{\"mediaType\":\"application/vnd.oci.image.layer.v1.tar\",\"digest\":\"sha256:x\"}]}");
+    CATCH_CHECK_THROWS_AS(Image::readManifest(manifest), Image::ImageError);
+    write(manifest, "{\"schemaVersion\":2,\"mediaType\":\"application/vnd.oci.image.index.v1+json\",\"manifests\":[]}");
+    CATCH_CHECK(Image::isManifest(manifest));
+    CATCH_CHECK_THROWS_AS(Image::readManifest(manifest), Image::ImageError);
+
+    // the upper layer replaces a file, hides another one and the lower content of a directory
+    string lower = lisa_playground + "/lower", upper = lisa_playground + "/upper", root = lisa_playground + "/root";
+    write(lower + "/bin/app", "lower");
+    write(lower + "/etc/config", "lower");
+    write(lower + "/lib/old", "lower");
+    write(upper + "/bin/app", "upper");
+    write(upper + "/etc/.wh.config", "");
+    write(upper + "/lib/.wh..wh..opq", "");
+    write(upper + "/lib/new", "upper");
+    boost::filesystem::create_directories(root);
+    Image::mergeLayer(lower, root);
+    Image::mergeLayer(upper, root);
+    ifstream app(root + "/bin/app");
+    string content;
+    app >> content;
+    CATCH_CHECK(content == "upper");
+    CATCH_CHECK(boost::filesystem::hard_link_count(root + "/bin/app") == 2);
+    CATCH_CHECK(boost::filesystem::is_directory(root + "/etc"));
+    CATCH_CHECK_FALSE(boost::filesystem::exists(root + "/etc/config"));
+    CATCH_CHECK_FALSE(boost::filesystem::exists(root + "/lib/old"));
+    CATCH_CHECK(boost::filesystem::exists(root + "/lib/new"));
+    CATCH_CHECK_FALSE(boost::filesystem::exists(root + "/lib/.wh..wh..opq"));
+
+    // a lower symlink pointing outside the root must not let upper entries reach through it
+    string outside = lisa_playground + "/outside", evil = lisa_playground + "/evil";
+    write(outside + "/keep", "outside");
+    boost::filesystem::create_directories(evil);
+    boost::filesystem::create_directory_symlink(outside, evil + "/escape");
+    Image::mergeLayer(evil, root);
+    CATCH_REQUIRE(boost::filesystem::is_symlink(root + "/escape"));
+    string whiteout = lisa_playground + "/whiteout", opaque = lisa_playground + "/opaque", added = lisa_playground + "/added";
+    write(whiteout + "/escape/.wh.keep", "");
+    write(opaque + "/escape/.wh..wh..opq", "");
+    write(added + "/escape/planted", "upper");
+    CATCH_CHECK_THROWS_AS(Image::mergeLayer(whiteout, root), Image::ImageError);
+    CATCH_CHECK_THROWS_AS(Image::mergeLayer(opaque, root), Image::ImageError);
+    CATCH_CHECK(boost::filesystem::exists(outside + "/keep"));
+    // an upper directory replaces the symlink instead of following it
+    Image::mergeLayer(added, root);
+    CATCH_CHECK(boost::filesystem::is_directory(boost::filesystem::symlink_status(root + "/escape")));
+    CATCH_CHECK(boost::filesystem::exists(root + "/escape/planted"));
+    CATCH_CHECK_FALSE(boost::filesystem::exists(outside + "/planted"));
+}
+
+// a layer blob in the local registry directory served by the test http server
+static string makeLayer(const string& name) {
+    string root = lisa_playground + "/layers/" + name;
+    boost::filesystem::create_directories(root + "/rootfs/usr/lib");
+    ofstream(root + "/rootfs/usr/lib/" + name) << name;
+    boost::filesystem::create_directories("files/registry/blobs/sha256");
+    string blob = "files/registry/blobs/" + name;
+    string command = "tar czf " + blob + " -C " + root + " .";
+    CATCH_REQUIRE(std::system(command.c_str()) == 0);
+    auto digest = Image::sha256Digest(blob);
+    boost::filesystem::rename(blob, "files/registry/blobs/sha256/" + digest.substr(7));
+    return digest;
+}
+
+static string makeManifest(const string& name, const vector<string>& digests) {
+    string layers;
+    for (const auto& digest : digests) {
+        layers += string(layers.empty() ? "" : ",") + "{\"mediaType\":\"application/vnd.oci.image.layer.v1.tar+gzip\","
+                  "\"digest\":\"" + digest + "\",\"size\":1024}";
+    }
+    ofstream("files/registry/" + name + ".json") << "{\"schemaVersion\":2,"
+        "\"mediaType\":\"application/vnd.oci.image.manifest.v1+json\",\"layers\":[" + layers + "]}";
+    return "http://127.0.0.1:8899/registry/" + name + ".json";
+}
+
+CATCH_TEST_CASE("LISA : install layered images", "[all][test45][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+    boost::filesystem::remove_all("files/registry");
+
+    auto base = makeLayer("base");
+    auto first = makeLayer("first");
+    auto second = makeLayer("second");
+    auto firstUrl = makeManifest("first", {base, first});
+    auto secondUrl = makeManifest("second", {base, second});
+    auto layerPath = [](const string& digest) {
+        return "0/" + Image::LAYERS_DIR + "/sha256/" + digest.substr(7);
+    };
+
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, "com.rdk.first", "1.0", firstUrl, "first", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(findPathInAppsPath("0/com.rdk.first/1.0/rootfs/usr/lib/base"));
+    CATCH_CHECK(findPathInAppsPath("0/com.rdk.first/1.0/rootfs/usr/lib/first"));
+    CATCH_CHECK(findPathInAppsPath(layerPath(base)));
+    CATCH_CHECK(findPathInAppsPath(layerPath(first)));
+
+    // the base layer is present, so it is not fetched again
+    boost::filesystem::remove("files/registry/blobs/sha256/" + base.substr(7));
+    result = lisa.Install(DACAPP_MIME, "com.rdk.second", "1.0", secondUrl, "second", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(countInstalledAppsInDB() == 2);
+    CATCH_CHECK(boost::filesystem::hard_link_count(lisa_playground + apps_subpath + "/0/com.rdk.second/1.0/rootfs/usr/lib/base") == 3);
+    // the files shared with the layer cannot be written through any app
+    auto sharedFile = lisa_playground + apps_subpath + "/0/com.rdk.second/1.0/rootfs/usr/lib/base";
+    auto writeBits = boost::filesystem::owner_write | boost::filesystem::group_write | boost::filesystem::others_write;
+    CATCH_CHECK((boost::filesystem::status(sharedFile).permissions() & writeBits) == 0);
+    CATCH_CHECK(boost::filesystem::status(lisa_playground + apps_subpath + "/0/com.rdk.second/1.0/rootfs/usr/lib").permissions()
+                == boost::filesystem::status(lisa_playground + apps_subpath + "/" + layerPath(second) + "/rootfs/usr/lib").permissions());
+
+    // a blob not matching its digest fails the install and leaves nothing behind
+    auto corrupted = makeLayer("corrupted");
+    auto corruptedUrl = makeManifest("corrupted", {first, corrupted});
+    ofstream("files/registry/blobs/sha256/" + corrupted.substr(7), ios::app) << "x";
+    result = lisa.Install(DACAPP_MIME, "com.rdk.corrupted", "1.0", corruptedUrl, "corrupted", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_CHECK(last_event_received_.status == Executor::OperationStatus::FAILED);
+    CATCH_CHECK_FALSE(findPathInAppsPath(layerPath(corrupted)));
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.corrupted"));
+
+    // layers go with the last app using them
+    result = lisa.Uninstall(DACAPP_MIME, "com.rdk.first", "1.0", "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_CHECK_FALSE(findPathInAppsPath(layerPath(first)));
+    CATCH_CHECK(findPathInAppsPath(layerPath(base)));
+
+    result = lisa.Uninstall(DACAPP_MIME, "com.rdk.second", "1.0", "full", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_CHECK_FALSE(findPathInAppsPath(layerPath(base)));
+    CATCH_CHECK_FALSE(findPathInAppsPath(layerPath(second)));
+}
+
+CATCH_TEST_CASE("LISA : job journal", "[all][test46][quick]") {
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground);
+    auto path = lisa_playground + "/jobs.journal";
+
+    auto makeJob = [](const string& handle, const string& operation, const string& id) {
+        JobJournal::Job job;
+        job.handle = handle;
+        job.operation = operation;
+        job.type = DACAPP_MIME;
+        job.id = id;
+        job.version = DACAPP_VERSION;
+        job.priority = 1;
+        job.arguments = {demo_tarball, "app", "cat"};
+        return job;
+    };
+
+    {
+        JobJournal journal;
+        CATCH_CHECK_FALSE(journal.open(path));
+        CATCH_CHECK(journal.pending().empty());
+        journal.queue(makeJob("1", "Installing", "com.rdk.first"));
+        journal.queue(makeJob("2", "Installing", "com.rdk.second"));
+        journal.start("1", "DOWNLOADING");
+        journal.enterStage("1", "EXTRACTING");
+        journal.addPath("1", "/apps/0/com.rdk.first/1.0/");
+    }
+    {
+        JobJournal journal;
+        CATCH_REQUIRE(journal.open(path));
+        const auto& pending = journal.pending();
+        CATCH_REQUIRE(pending.size() == 2);
+        CATCH_CHECK(pending[0].handle == "1");
+        CATCH_CHECK(pending[0].stage == "EXTRACTING");
+        CATCH_CHECK(pending[0].arguments == vector<string>({demo_tarball, "app", "cat"}));
+        CATCH_CHECK(pending[0].paths == vector<string>({"/apps/0/com.rdk.first/1.0/"}));
+        CATCH_CHECK(pending[1].handle == "2");
+        CATCH_CHECK(pending[1].stage.empty());
+
+        // queued again after a restart it starts over
+        auto job = pending[0];
+        ++job.recoveries;
+        journal.queue(job);
+        CATCH_CHECK(journal.pending()[0].stage.empty());
+        CATCH_CHECK(journal.pending()[0].paths.empty());
+        CATCH_CHECK(journal.pending()[0].recoveries == 1);
+
+        journal.finish("1");
+        journal.finish("2");
+        CATCH_CHECK(journal.pending().empty());
+        CATCH_CHECK(boost::filesystem::file_size(path) == 0);
+    }
+
+    // power loss in the middle of a record
+    {
+        JobJournal journal;
+        CATCH_REQUIRE(journal.open(path));
+        journal.queue(makeJob("3", "Uninstalling", "com.rdk.third"));
+    }
+    ofstream(path, ios::app) << "{\"record\":\"start\",\"han";
+    {
+        JobJournal journal;
+        CATCH_REQUIRE(journal.open(path));
+        CATCH_REQUIRE(journal.pending().size() == 1);
+        CATCH_CHECK(journal.pending()[0].stage.empty());
+        journal.start("3", "REMOVING");
+    }
+    {
+        JobJournal journal;
+        CATCH_REQUIRE(journal.open(path));
+        CATCH_CHECK(journal.pending()[0].stage == "REMOVING");
+    }
+
+    // a damaged record in the middle leaves the jobs in flight unknown
+    ofstream(path, ios::app) << "garbage\n{\"record\":\"finish\",\"handle\":\"3\"}\n";
+    {
+        JobJournal journal;
+        CATCH_CHECK_FALSE(journal.open(path));
+        CATCH_CHECK(journal.pending().size() == 1);
+    }
+}
+
+CATCH_TEST_CASE("LISA : recover jobs in flight after a restart", "[all][test47][quick]") {
+    auto onEvent = [](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    };
+    string handle;
+    {
+        Executor lisa(onEvent);
+        configure(lisa);
+        auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "app", "cat", handle);
+        CATCH_REQUIRE(result == 0);
+        CATCH_REQUIRE(waitForEvent(30));
+        CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+    }
+
+    // what the journal holds when the device goes down with jobs in flight
+    auto appsRoot = lisa_playground + apps_subpath + "/0/";
+    auto makeJob = [](const string& handle, const string& operation, const string& id, vector<string> arguments) {
+        JobJournal::Job job;
+        job.handle = handle;
+        job.operation = operation;
+        job.type = DACAPP_MIME;
+        job.id = id;
+        job.version = DACAPP_VERSION;
+        job.priority = 1;
+        job.arguments = std::move(arguments);
+        return job;
+    };
+    {
+        JobJournal journal;
+        CATCH_REQUIRE(journal.open(lisa_playground + db_subpath + "/0/jobs.journal"));
+        CATCH_REQUIRE(journal.pending().empty());
+
+        // interrupted while unpacking, rolled back and installed again
+        journal.queue(makeJob("101", "Installing", "com.rdk.interrupted", {demo_tarball, "app", "cat"}));
+        journal.start("101", "EXTRACTING");
+        journal.addPath("101", appsRoot + "com.rdk.interrupted/" + DACAPP_VERSION + "/");
+        boost::filesystem::create_directories(appsRoot + "com.rdk.interrupted/" + DACAPP_VERSION);
+        ofstream(appsRoot + "com.rdk.interrupted/" + DACAPP_VERSION + "/partial") << "partial";
+
+        // registered before the restart, completed as it is
+        journal.queue(makeJob("102", "Installing", DACAPP_ID, {demo_tarball, "app", "cat"}));
+        journal.start("102", "UPDATING_DATABASE");
+
+        // removed from the database, the files are removed on recovery
+        journal.queue(makeJob("103", "Uninstalling", "com.rdk.removed", {"full"}));
+        journal.start("103", "REMOVING");
+        boost::filesystem::create_directories(appsRoot + "com.rdk.removed/" + DACAPP_VERSION);
+        ofstream(appsRoot + "com.rdk.removed/" + DACAPP_VERSION + "/leftover") << "leftover";
+
+        // interrupted too many times, given up
+        auto failing = makeJob("104", "Installing", "com.rdk.failing", {demo_tarball, "app", "cat"});
+        failing.recoveries = 2;
+        journal.queue(failing);
+        journal.start("104", "DOWNLOADING");
+
+        // never started, queued again
+        journal.queue(makeJob("105", "Installing", "com.rdk.queued", {demo_tarball, "app", "cat"}));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        all_events_received_.clear();
+        record_all_events_ = true;
+    }
+    auto finishedEvents = [](size_t count, int timeout_secs) {
+        std::map<string, Executor::OperationStatusEvent> finished;
+        for (int i = 0; i < timeout_secs * 10 && finished.size() < count; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished.clear();
+            for (const auto& event : all_events_received_) {
+                if (event.status != Executor::OperationStatus::PROGRESS) {
+                    finished[event.handle] = event;
+                }
+            }
+        }
+        return finished;
+    };
+
+    Executor lisa(onEvent);
+    configure(lisa, "", true);
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.removed/"s + DACAPP_VERSION));
+
+    // only the jobs run again report their outcome, the others are resolved before anyone subscribes
+    auto finished = finishedEvents(2, 60);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        record_all_events_ = false;
+    }
+    CATCH_REQUIRE(finished.size() == 2);
+    CATCH_CHECK(finished["101"].status == Executor::OperationStatus::SUCCESS);
+    CATCH_CHECK(finished["105"].status == Executor::OperationStatus::SUCCESS);
+
+    CATCH_CHECK(countInstalledAppsInDB() == 3);
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.interrupted/"s + DACAPP_VERSION + "/partial"));
+    CATCH_CHECK_FALSE(findPathInAppsPath("0/com.rdk.failing"));
+
+    JobInfo job;
+    CATCH_REQUIRE(lisa.GetJob("101", job) == 0);
+    CATCH_CHECK(job.state == JobState::SUCCEEDED);
+    CATCH_REQUIRE(lisa.GetJob("102", job) == 0);
+    CATCH_CHECK(job.state == JobState::SUCCEEDED);
+    CATCH_REQUIRE(lisa.GetJob("103", job) == 0);
+    CATCH_CHECK(job.state == JobState::SUCCEEDED);
+    CATCH_CHECK(job.operation == "Uninstalling");
+    CATCH_REQUIRE(lisa.GetJob("104", job) == 0);
+    CATCH_CHECK(job.state == JobState::FAILED);
+    CATCH_CHECK(boost::filesystem::file_size(lisa_playground + db_subpath + "/0/jobs.journal") == 0);
+}
+
+CATCH_TEST_CASE("LISA : download paused after its last byte", "[all][test48][quick][mock=serverrange.py]") {
+    // pauses once the whole body is written, before the server closes the connection
+    struct PauseAtEnd : public DownloaderListener {
+        unsigned long long size{};
+        unsigned long long bytes{};
+        int pauses{};
+        bool resumed{false};
+        void setProgress(int) override {}
+        void setBytesDownloaded(unsigned long long value) override { bytes = value; }
+        bool isCancelled() override { return false; }
+        bool isPaused() override { return !resumed && bytes == size; }
+        void waitWhilePaused() override {
+            ++pauses;
+            resumed = true;
+        }
+    };
+
+    boost::filesystem::remove_all(lisa_playground);
+    boost::filesystem::create_directories(lisa_playground);
+    auto source = "files/waylandegltest.tar.gz"s;
+    auto sourceSize = boost::filesystem::file_size(source);
+    auto url = "http://127.0.0.1:8896/waylandegltest.tar.gz"s;
+    Config config;
+
+    // the range past the end is refused, the file is complete nevertheless
+    for (bool lengthKnown : {true, false}) {
+        PauseAtEnd listener;
+        listener.size = sourceSize;
+        Downloader downloader{url, listener, config};
+        if (lengthKnown) {
+            CATCH_REQUIRE(downloader.getContentLength() == sourceSize);
+        }
+        auto destination = lisa_playground + "/download" + (lengthKnown ? "1" : "2");
+        CATCH_REQUIRE_NOTHROW(downloader.get(destination));
+        CATCH_CHECK(listener.pauses == 1);
+        CATCH_CHECK(boost::filesystem::file_size(destination) == sourceSize);
+        std::ifstream expected(source, ios::binary), received(destination, ios::binary);
+        CATCH_CHECK(std::equal(std::istreambuf_iterator<char>(expected), std::istreambuf_iterator<char>(),
+                               std::istreambuf_iterator<char>(received)));
+    }
+}
+
+CATCH_TEST_CASE("LISA : repair permissions on demand", "[all][test49][quick]") {
+    Executor lisa([](const Executor::OperationStatusEvent &event) {
+        eventHandler(event);
+    });
+    configure(lisa);
+
+    CATCH_CHECK(lisa.RepairPermissions() == 0);
+
+    // never walks the trees under a running operation
+    string handle;
+    auto result = lisa.Install(DACAPP_MIME, DACAPP_ID, DACAPP_VERSION, demo_tarball, "appname", "cat", handle);
+    CATCH_REQUIRE(result == 0);
+    CATCH_REQUIRE(lisa.Pause(handle) == 0);
+    CATCH_CHECK(lisa.RepairPermissions() == Executor::ERROR_TOO_MANY_REQUESTS);
+    CATCH_REQUIRE(lisa.Resume(handle) == 0);
+    CATCH_REQUIRE(waitForEvent(30));
+    CATCH_REQUIRE(last_event_received_.status == Executor::OperationStatus::SUCCESS);
+
+    CATCH_CHECK(lisa.RepairPermissions() == 0);
+    CATCH_CHECK(countInstalledAppsInDB() == 1);
+    CATCH_CHECK(findPathInAppsPath("0/"s + DACAPP_ID + "/" + DACAPP_VERSION));
+}
+
+CATCH_TEST_CASE("LISA : directory walker benchmark", "[benchmark][.]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string root = lisa_playground + "/walk";
+    createTree(root, 200, 50, 10);
+
+    namespace bf = boost::filesystem;
+    auto measure = [](const char* name, std::function<unsigned long long()> fn) {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long result{};
+        for (int i = 0; i < 10; ++i) {
+            result = fn();
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        cout << name << ": " << elapsed.count() / 10 << " us per walk, result " << result << endl;
+        return result;
+    };
+
+    auto boostSpace = measure("boost recursive_directory_iterator", [&root]() {
+        uintmax_t space{};
+        for (bf::recursive_directory_iterator it(root); it != bf::recursive_directory_iterator(); ++it) {
+            if (bf::exists(*it) && !bf::is_directory(*it) && !bf::is_symlink(*it)) {
+                space += bf::file_size(*it);
+            }
+        }
+        return (unsigned long long)space;
+    });
+    Filesystem::WalkCounter counter;
+    Filesystem::setWalkCounter(&counter);
+    auto walkerSpace = measure("getdents64 walker", [&root]() {
+        return Filesystem::getDirectorySpace(root);
+    });
+    Filesystem::setWalkCounter(nullptr);
+    cout << "getdents64 walker: " << counter.opens / 10 << " opens, " << counter.reads / 10 << " getdents64, "
+         << counter.stats / 10 << " fstatat per walk" << endl;
+    // boost stats every entry at least three times (exists, is_directory, is_symlink) plus file_size,
+    // the walker opens and reads every directory once and stats every entry once
+    const unsigned long long directories = 1 + 200 * 2;
+    const unsigned long long entries = 200 * 2 + 200 * 50;
+    CATCH_CHECK(counter.opens == 10 * directories);
+    CATCH_CHECK(counter.reads == 10 * 2 * directories);
+    CATCH_CHECK(counter.stats == 10 * entries);
+    auto parallelSpace = measure("getdents64 walker, 4 threads", [&root]() {
+        std::atomic<unsigned long long> space{0};
+        Filesystem::walkDirectoryParallel(root, [&space](const Filesystem::DirEntry& entry) {
+            if (entry.isRegularFile()) {
+                struct stat st{};
+                entry.stat(st);
+                space += st.st_size;
+            }
+            return Filesystem::WalkAction::CONTINUE;
+        }, 4);
+        return space.load();
+    });
+    CATCH_CHECK(boostSpace == walkerSpace);
+    CATCH_CHECK(walkerSpace == parallelSpace);
+}
+
+CATCH_TEST_CASE("LISA : storage backends benchmark", "[benchmark][.]") {
+    const int apps = 200;
+    const int calls = 20000;
+    auto measure = [](const std::string& name, int count, std::function<void(int)> fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            fn(i);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        cout << name << ": " << elapsed.count() / count << " ns per call" << endl;
+    };
+
+    auto run = [&](const std::string& backend, const std::function<std::unique_ptr<DataStorage>(const std::string&)>& open) {
+        boost::filesystem::remove_all(lisa_playground);
+        string dbPath = lisa_playground + "/db/";
+        boost::filesystem::create_directories(dbPath);
+
+        auto openStart = std::chrono::steady_clock::now();
+        auto storage = open(dbPath);
+        measure(backend + " install", apps, [&](int i) {
+            auto id = "app" + std::to_string(i);
+            storage->AddInstalledApp(DACAPP_MIME, id, DACAPP_VERSION, "url", "name " + id, "cat",
+                                     Filesystem::createAppPath(id, DACAPP_VERSION), Filesystem::createAppPath(id), "");
+            storage->SetMetadataBatch(DACAPP_MIME, id, DACAPP_VERSION, {{"author", "someone"}, {"rating", "5"}});
+        });
+        measure(backend + " set metadata", apps, [&](int i) {
+            storage->SetMetadata(DACAPP_MIME, "app" + std::to_string(i), DACAPP_VERSION, "rating", "4");
+        });
+        measure(backend + " is installed", calls, [&](int i) {
+            CATCH_REQUIRE(storage->IsAppInstalled(DACAPP_MIME, "app" + std::to_string(i % apps), DACAPP_VERSION));
+        });
+        measure(backend + " get metadata", calls, [&](int i) {
+            CATCH_REQUIRE(storage->GetMetadata(DACAPP_MIME, "app" + std::to_string(i % apps), DACAPP_VERSION).metadata.size() == 2);
+        });
+        measure(backend + " list all", 100, [&](int) {
+            CATCH_REQUIRE(storage->GetAppDetailsList().size() == apps);
+        });
+        storage.reset();
+        measure(backend + " open", 10, [&](int) {
+            CATCH_REQUIRE(open(dbPath)->IsAppData(DACAPP_MIME, "app0"));
+        });
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - openStart);
+        cout << backend << " total: " << elapsed.count() << " ms" << endl;
+    };
+
+    run("sqlite", [](const std::string& path) {
+        std::unique_ptr<DataStorage> storage = std::make_unique<SqlDataStorage>(path);
+        storage->Initialize();
+        return storage;
+    });
+    run("kv", [](const std::string& path) {
+        std::unique_ptr<DataStorage> storage = std::make_unique<KvDataStorage>(path);
+        storage->Initialize();
+        return storage;
+    });
+}
+
+CATCH_TEST_CASE("LISA : sqlite statement cache benchmark", "[benchmark][.]") {
+    boost::filesystem::remove_all(lisa_playground);
+    string dbPath = lisa_playground + "/db/";
+    boost::filesystem::create_directories(dbPath);
+
+    const int apps = 100;
+    const int calls = 20000;
+    SqlDataStorage storage{dbPath};
+    storage.Initialize();
+    for (int i = 0; i < apps; ++i) {
+        auto id = "app" + std::to_string(i);
+        storage.AddInstalledApp(DACAPP_MIME, id, DACAPP_VERSION, "url", "name", "cat",
+                                Filesystem::createAppPath(id, DACAPP_VERSION), Filesystem::createAppPath(id), "");
+    }
+
+    auto measure = [calls](const char* name, std::function<int(int)> fn) {
+        int found{};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; ++i) {
+            found += fn(i);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        cout << name << ": " << elapsed.count() / calls << " ns per call" << endl;
+        return found;
+    };
+
+    // same connection and one read transaction for both, so only statement preparation differs
+    sqlite3* sqlite;
+    CATCH_REQUIRE(sqlite3_open((dbPath + "apps.db").c_str(), &sqlite) == SQLITE_OK);
+    CATCH_REQUIRE(sqlite3_exec(sqlite, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK);
+    const std::string query = "SELECT type FROM apps WHERE app_id ==  $1;";
+    auto typeFound = [apps](sqlite3_stmt* stmt, int i) {
+        std::string id = "app" + std::to_string(i % apps);
+        sqlite3_bind_text(stmt, 1, id.c_str(), -1, SQLITE_TRANSIENT);
+        return sqlite3_step(stmt) == SQLITE_ROW ? 1 : 0;
+    };
+
+    // what every call did before: prepare, bind, step, finalize
+    auto uncached = measure("prepare per call", [&](int i) {
+        sqlite3_stmt* stmt;
+        sqlite3_prepare_v2(sqlite, query.c_str(), query.length(), &stmt, nullptr);
+        int found = typeFound(stmt, i);
+        sqlite3_finalize(stmt);
+        return found;
+    });
+
+    SqlStatementCache cache;
+    cache.Initialize(sqlite);
+    auto cached = measure("statement cache", [&](int i) {
+        auto stmt = cache.Acquire(query);
+        return typeFound(stmt, i);
+    });
+    cache.Clear();
+    sqlite3_exec(sqlite, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_close(sqlite);
+
+    // end to end, including logging and a read transaction per call
+    auto storageCalls = measure("SqlDataStorage::GetTypeOfApp", [&storage, apps](int i) {
+        return storage.GetTypeOfApp("app" + std::to_string(i % apps)) == DACAPP_MIME ? 1 : 0;
+    });
+    CATCH_CHECK(uncached == calls);
+    CATCH_CHECK(cached == calls);
+    CATCH_CHECK(storageCalls == calls);
+}
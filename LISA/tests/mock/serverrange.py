@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+# If not stated otherwise in this file or this component's LICENSE file the
+# following copyright and licenses apply:
+#
+# Copyright 2023 Liberty Global Service B.V.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import http.server
+import os
+import re
+import socketserver
+import time
+
+# serves ./files with byte ranges; a full response has no length and the connection
+# is held open after the last byte, so a client can be paused at the end of the body
+class RangeRequestHandler(http.server.SimpleHTTPRequestHandler):
+    def read_file(self):
+        path = os.path.join("files", os.path.basename(self.path))
+        with open(path, "rb") as file:
+            return file.read()
+    def do_HEAD(self):
+        data = self.read_file()
+        self.send_response(200)
+        self.send_header('Content-Length', str(len(data)))
+        self.send_header('Accept-Ranges', 'bytes')
+        self.end_headers()
+    def do_GET(self):
+        data = self.read_file()
+        match = re.match(r"bytes=(\d+)-", self.headers.get('Range', ''))
+        if match:
+            start = int(match.group(1))
+            if start >= len(data):
+                self.send_response(416)
+                self.send_header('Content-Range', 'bytes */{0}'.format(len(data)))
+                self.send_header('Content-Length', '0')
+                self.end_headers()
+                return
+            self.send_response(206)
+            self.send_header('Content-Range', 'bytes {0}-{1}/{2}'.format(start, len(data) - 1, len(data)))
+            self.send_header('Content-Length', str(len(data) - start))
+            self.end_headers()
+            self.wfile.write(data[start:])
+            return
+        self.send_response(200)
+        self.send_header('Connection', 'close')
+        self.end_headers()
+        self.wfile.write(data)
+        self.wfile.flush()
+        time.sleep(3)
+        self.close_connection = True
+
+PORT = 8896
+
+with socketserver.TCPServer(("", PORT), RangeRequestHandler) as httpd:
+    print("Server started at localhost:{0}".format(PORT))
+    httpd.serve_forever()